@@ -7,9 +7,12 @@
 /*! \def EDLSHARED_EXPORT
  * \brief Macro used to export classes shared by the dll.
  * \note Defining macro \a EDL_LIBRARY will prevent poroject building.
+ * \note On systems other than Windows the macro is empty: there the class is provided by the simulated backend (edl_simulator.cpp).
  */
 
-#if defined(EDL_LIBRARY)
+#if !defined(_WIN32)
+#  define EDLSHARED_EXPORT
+#elif defined(EDL_LIBRARY)
 #  define EDLSHARED_EXPORT __declspec(dllexport)
 #else
 #  define EDLSHARED_EXPORT __declspec(dllimport)
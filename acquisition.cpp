@@ -0,0 +1,326 @@
+/*! \file acquisition.cpp
+ * \brief Defines class Acquisition.
+ */
+#include "acquisition.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+
+#include "thread_affinity.h"
+
+Acquisition::Acquisition(PacketSource &source, unsigned int blocksNum, unsigned int blockPackets) :
+    source(source),
+    pool(blocksNum, blockPackets),
+    ring(blocksNum),
+    readerRunning(false),
+    consumerRunning(false),
+    result(EdlSuccess),
+    readerCoreIdx(-1),
+    readerCore(-1),
+    skippedPacketsNum(0),
+    controllerConfig(readControllerDefaultConfig()),
+    expectedRate(0.0),
+    readPackets(0),
+    consumedPackets(0),
+    droppedPackets(0),
+    bufferOverflows(0),
+    lostDataEvents(0),
+    statusChecks(0),
+    reads(0),
+    readThreshold(0),
+    packetRate(0.0),
+    readBufferGrowths(0),
+    lostPackets(0),
+    streamPackets(0),
+    commandsPending(false) {
+}
+
+void deliverBlock(AcquisitionSink * sink, PacketBlock * block, uint64_t &nextPacket) {
+    if (block->getFirstPacket() > nextPacket) {
+        sink->consumeGap(nextPacket, block->getFirstPacket()-nextPacket);
+    }
+    sink->consumeBlock(block);
+    nextPacket = block->getFirstPacket()+block->getPacketsNum();
+}
+
+Acquisition::~Acquisition() {
+    stop();
+}
+
+void Acquisition::addSink(AcquisitionSink * sink) {
+    sinks.push_back(sink);
+}
+
+void Acquisition::setReaderCore(int coreIdx) {
+    readerCoreIdx = coreIdx;
+}
+
+void Acquisition::setSkippedPackets(unsigned long long packetsNum) {
+    skippedPacketsNum = packetsNum;
+}
+
+void Acquisition::setReadController(const ReadControllerConfig_t &config, double expectedRate) {
+    controllerConfig = config;
+    this->expectedRate = expectedRate;
+}
+
+void Acquisition::setConsumerWakeup(unsigned long long packetsNum) {
+    dataReady.setThreshold(packetsNum);
+}
+
+void Acquisition::postCommand(AcquisitionCommand * command) {
+    std::lock_guard <std::mutex> lock(commandsMutex);
+    commands.push_back(command);
+    commandsPending = true;
+}
+
+void Acquisition::cancelCommand(AcquisitionCommand * command) {
+    /*! The reader thread holds the lock while it runs the commands, so a command is either pending or done. */
+    std::lock_guard <std::mutex> lock(commandsMutex);
+    commands.erase(std::remove(commands.begin(), commands.end(), command), commands.end());
+    commandsPending = !commands.empty();
+}
+
+EdlErrorCode_t Acquisition::start() {
+    if (readerThread.joinable() || consumerThread.joinable()) {
+        return EdlUnknownError;
+    }
+
+    result = EdlSuccess;
+    readerRunning = true;
+    consumerRunning = true;
+    consumerThread = std::thread(&Acquisition::consumerLoop, this);
+    readerThread = std::thread(&Acquisition::readerLoop, this);
+    return EdlSuccess;
+}
+
+EdlErrorCode_t Acquisition::stop() {
+    /*! Stop the reads first, then let the consumer drain the ring buffer. */
+    readerRunning = false;
+    if (readerThread.joinable()) {
+        readerThread.join();
+    }
+
+    consumerRunning = false;
+    dataReady.notify();
+    if (consumerThread.joinable()) {
+        consumerThread.join();
+    }
+
+    return (EdlErrorCode_t)result.load();
+}
+
+bool Acquisition::isRunning() const {
+    return readerRunning;
+}
+
+AcquisitionStats_t Acquisition::getStats() const {
+    AcquisitionStats_t stats;
+    stats.readPackets = readPackets;
+    stats.consumedPackets = consumedPackets;
+    stats.droppedPackets = droppedPackets;
+    stats.bufferOverflows = bufferOverflows;
+    stats.lostDataEvents = lostDataEvents;
+    stats.readerCore = readerCore;
+    stats.statusChecks = statusChecks;
+    stats.reads = reads;
+    stats.readThreshold = readThreshold;
+    stats.packetRate = packetRate;
+    stats.maxBlocksInUse = pool.getMaxBlocksInUse();
+    stats.readBufferGrowths = readBufferGrowths;
+    stats.lostPackets = lostPackets;
+    stats.streamPackets = streamPackets;
+    stats.consumerWakeups = dataReady.getSignalsNum();
+    return stats;
+}
+
+Instrumentation &Acquisition::getInstrumentation() {
+    return instrumentation;
+}
+
+void Acquisition::readerLoop() {
+    EdlErrorCode_t res;
+    EdlDeviceStatus_t status;
+    unsigned int readPacketsNum;
+    unsigned long long skipNum = skippedPacketsNum;
+    uint64_t nextPacket = 0; /*!< Index of the next data packet handed to the sinks. */
+    ReadController controller(controllerConfig);
+    controller.reset(expectedRate);
+
+    /*! Data packets available and read since the previous status check, to count those that arrived in between. */
+    std::chrono::steady_clock::time_point checkTime;
+    unsigned int checkAvailableNum = 0;
+    unsigned int checkReadNum = 0;
+    bool checked = false;
+    streamPackets = 0;
+
+    /*! The vector is reused by all reads and reserved for the largest one, so it never reallocates. */
+    std::vector <float> data;
+    data.reserve((size_t)ACQUISITION_MAX_READ_PACKETS*EDL_CHANNEL_NUM);
+
+    readerCore = -1;
+    if (readerCoreIdx >= 0 && pinCurrentThread((unsigned int)readerCoreIdx)) {
+        readerCore = readerCoreIdx%processorCoresNum();
+    }
+
+    while (readerRunning) {
+        /*! The device is used by this thread alone: the commands of the other threads are sent between the reads. */
+        if (commandsPending) {
+            runCommands();
+        }
+
+        uint64_t probeNs = instrumentationNow();
+        res = source.getDeviceStatus(status);
+        if (res != EdlSuccess) {
+            result = res;
+            break;
+        }
+        probeNs = instrumentation.record(ProbeStatus, probeNs);
+        statusChecks++;
+        std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        controller.update(status.availableDataPackets, status.bufferOverflowFlag, now);
+        readThreshold = controller.getThreshold();
+        packetRate = controller.getRate();
+
+        if (status.bufferOverflowFlag) {
+            bufferOverflows++;
+        }
+
+        if (status.lostDataFlag) {
+            lostDataEvents++;
+        }
+
+        /*! The source reports a loss without its size: the missing data packets are those that should have arrived since the
+         * previous status check and did not. They were the oldest pending ones, so the sample counter skips them before
+         * the next read; those still to be skipped for the alignment are taken out of the skip first. */
+        if ((status.bufferOverflowFlag || status.lostDataFlag) && checked) {
+            double rate = expectedRate > 0.0 ? expectedRate : controller.getRate();
+            double expectedNum = rate*std::chrono::duration <double> (now-checkTime).count();
+            double arrivedNum = (double)status.availableDataPackets-(double)checkAvailableNum+(double)checkReadNum;
+            unsigned long long lostNum = expectedNum > arrivedNum ? (unsigned long long)std::llround(expectedNum-arrivedNum) : 0;
+            unsigned long long lostSkipNum = skipNum < lostNum ? skipNum : lostNum;
+            skipNum -= lostSkipNum;
+            nextPacket += lostNum-lostSkipNum;
+            streamPackets = nextPacket;
+            lostPackets += lostNum;
+        }
+        checkTime = now;
+        checkAvailableNum = status.availableDataPackets;
+        checkReadNum = 0;
+        checked = true;
+
+        if (status.availableDataPackets > 0 && status.availableDataPackets >= readThreshold) {
+            unsigned int toReadNum = status.availableDataPackets < ACQUISITION_MAX_READ_PACKETS ? status.availableDataPackets : ACQUISITION_MAX_READ_PACKETS;
+            size_t capacity = data.capacity();
+            probeNs = instrumentationNow();
+            res = source.readData(toReadNum, readPacketsNum, data);
+            probeNs = instrumentation.record(ProbeRead, probeNs, readPacketsNum);
+            if (data.capacity() != capacity) {
+                readBufferGrowths++;
+            }
+
+            /*! A missing device is fatal; a short read still returns the available data. */
+            if (res == EdlDeviceNotConnectedError) {
+                result = res;
+                break;
+            }
+            result = res;
+
+            /*! Discard the data packets to be skipped, then publish the others. */
+            unsigned int readSkipNum = skipNum < readPacketsNum ? (unsigned int)skipNum : readPacketsNum;
+            skipNum -= readSkipNum;
+            unsigned int publishNum = readPacketsNum-readSkipNum;
+            unsigned int writtenPacketsNum = publish(data.data()+(size_t)readSkipNum*EDL_CHANNEL_NUM, publishNum, nextPacket);
+            instrumentation.record(ProbePublish, probeNs, writtenPacketsNum);
+            if (writtenPacketsNum > 0) {
+                dataReady.add(writtenPacketsNum);
+            }
+            nextPacket += publishNum;
+            streamPackets = nextPacket;
+            checkReadNum += readPacketsNum;
+            readPackets += readPacketsNum;
+            droppedPackets += publishNum-writtenPacketsNum;
+            controller.consumed(readPacketsNum);
+            reads++;
+
+        } else {
+            /*! If the read was not performed wait until the threshold is expected to be reached. */
+            std::this_thread::sleep_for(controller.getWait(status.availableDataPackets));
+        }
+    }
+    readerRunning = false;
+
+    /*! Hand over the data packets still below the wakeup threshold. */
+    dataReady.notify();
+}
+
+unsigned int Acquisition::publish(const float * packets, unsigned int packetsNum, uint64_t firstPacket) {
+    unsigned int publishedNum = 0;
+    while (publishedNum < packetsNum) {
+        PacketBlock * block = pool.acquire();
+        if (block == NULL) {
+            break;
+        }
+
+        unsigned int blockNum = packetsNum-publishedNum < block->getCapacity() ? packetsNum-publishedNum : block->getCapacity();
+        std::memcpy(block->getPackets(), packets+(size_t)publishedNum*EDL_CHANNEL_NUM, (size_t)blockNum*EDL_CHANNEL_NUM*sizeof(float));
+        block->setPacketsNum(blockNum);
+        block->setFirstPacket(firstPacket+publishedNum);
+
+        /*! The ring holds as many pointers as there are blocks, so the write cannot fail. */
+        ring.write(&block, 1);
+        publishedNum += blockNum;
+    }
+    return publishedNum;
+}
+
+void Acquisition::consumerLoop() {
+    PacketBlock * const * blocks;
+    size_t blocksNum;
+    bool running;
+    uint64_t nextPacket = 0; /*!< Index of the data packet following the last block consumed. */
+
+    /*! Keep consuming after #stop until the ring buffer is empty.
+     * The flag is sampled before the ring buffer so that the last packets written by the reader are not missed,
+     * and the ticket of the #Notifier before both, so that a signal sent after they are checked ends the wait. */
+    for (;;) {
+        uint64_t ticket = dataReady.prepare();
+        running = consumerRunning;
+        blocksNum = ring.peek(blocks);
+        if (blocksNum > 0) {
+            /*! Remove each block from the ring before releasing it, so that the ring always has room for the free blocks.
+             * A block that does not follow the previous one is preceded by the notice of the missing data packets. */
+            for (size_t blockIdx = 0; blockIdx < blocksNum; blockIdx++) {
+                PacketBlock * block = blocks[blockIdx];
+                uint64_t probeNs = instrumentationNow();
+                for (size_t sinkIdx = 0; sinkIdx < sinks.size(); sinkIdx++) {
+                    uint64_t sinkNextPacket = nextPacket;
+                    deliverBlock(sinks[sinkIdx], block, sinkNextPacket);
+                }
+                instrumentation.record(ProbeConsume, probeNs, block->getPacketsNum());
+                nextPacket = block->getFirstPacket()+block->getPacketsNum();
+                consumedPackets += block->getPacketsNum();
+                ring.consume(1);
+                block->release();
+            }
+
+        } else if (running) {
+            dataReady.wait(ticket, std::chrono::milliseconds(ACQUISITION_CONSUMER_MAX_WAIT_MS));
+
+        } else {
+            break;
+        }
+    }
+}
+
+void Acquisition::runCommands() {
+    std::lock_guard <std::mutex> lock(commandsMutex);
+    while (!commands.empty()) {
+        AcquisitionCommand * command = commands.front();
+        commands.pop_front();
+        command->run();
+    }
+    commandsPending = false;
+}
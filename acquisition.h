@@ -0,0 +1,264 @@
+/*! \file acquisition.h
+ * \brief Declares class Acquisition, which collects data packets on a dedicated thread.
+ */
+#ifndef ACQUISITION_H
+#define ACQUISITION_H
+
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "edl.h"
+#include "ring_buffer.h"
+#include "packet_pool.h"
+#include "packet_source.h"
+#include "read_controller.h"
+#include "instrumentation.h"
+#include "notifier.h"
+
+/*! \def ACQUISITION_BLOCK_PACKETS
+ * \brief Default number of data packets per block of the #PacketPool: about one read at 200kHz.
+ */
+#define ACQUISITION_BLOCK_PACKETS 1024
+
+/*! \def ACQUISITION_POOL_BLOCKS
+ * \brief Default number of blocks held between the reader and the consumer thread.
+ * The #ReadController reads about every 5 ms at any sampling rate, so 1024 blocks absorb about 5 seconds of storage stalls.
+ */
+#define ACQUISITION_POOL_BLOCKS 1024
+
+/*! \def ACQUISITION_MAX_READ_PACKETS
+ * \brief Maximum number of data packets requested by a single read; the read buffer is reserved for it once.
+ */
+#define ACQUISITION_MAX_READ_PACKETS 65536
+
+/*! \def ACQUISITION_CONSUMER_MAX_WAIT_MS
+ * \brief Longest wait of the consumer thread for a signal of the reader thread [ms]; it only expires if the reader stalls.
+ */
+#define ACQUISITION_CONSUMER_MAX_WAIT_MS 100
+
+/*! \struct AcquisitionStats_t
+ * \brief Counters collected by an #Acquisition.
+ */
+typedef struct {
+    unsigned long long readPackets; /*!< Data packets read from the source, including the skipped ones. */
+    unsigned long long consumedPackets; /*!< Data packets handed to the sinks. */
+    unsigned long long droppedPackets; /*!< Data packets discarded because the ring buffer was full. */
+    unsigned int bufferOverflows; /*!< Reads with #EdlDeviceStatus_t::bufferOverflowFlag set. */
+    unsigned int lostDataEvents; /*!< Reads with #EdlDeviceStatus_t::lostDataFlag set. */
+    int readerCore; /*!< Core the reader thread is pinned to, -1 if it is not pinned. */
+    unsigned long long statusChecks; /*!< Device status requests made by the reader thread. */
+    unsigned long long reads; /*!< Reads performed by the reader thread. */
+    unsigned int readThreshold; /*!< Current read threshold, see #ReadController [data packets]. */
+    double packetRate; /*!< Estimated packet rate [Hz], 0 if unknown. */
+    unsigned int maxBlocksInUse; /*!< Highest number of #PacketPool blocks in use at the same time. */
+    unsigned int readBufferGrowths; /*!< Reads that had to enlarge the read buffer: 0 once the acquisition is started. */
+    unsigned long long lostPackets; /*!< Data packets lost by the source, estimated from the packet rate at each
+                                      * #EdlDeviceStatus_t::bufferOverflowFlag or #EdlDeviceStatus_t::lostDataFlag. */
+    unsigned long long streamPackets; /*!< Index of the next data packet since the start of the acquisition, counting the
+                                        * lost and the dropped ones: the sample counter that maps data packets to time. */
+    unsigned long long consumerWakeups; /*!< Signals of new data packets sent by the reader thread to the consumer thread. */
+} AcquisitionStats_t;
+
+/*! \class AcquisitionSink
+ * \brief Interface of the stages that receive the collected data packets, e.g. storage.
+ */
+class AcquisitionSink {
+public:
+    virtual ~AcquisitionSink() {}
+
+    /*! \brief Receives consecutive data packets.
+     * Called on the consumer thread only, so implementations may block without affecting the reads.
+     *
+     * \param packets [in] \a packetsNum data packets of #EDL_CHANNEL_NUM samples each.
+     * \param packetsNum [in] Number of data packets.
+     */
+    virtual void consumePackets(const float * packets, unsigned int packetsNum) = 0;
+
+    /*! \brief Receives the next block of data packets.
+     * The default implementation calls #consumePackets. Stages that need the data packets after returning,
+     * e.g. to process them on another thread, override it and call PacketBlock::addRef instead of copying them;
+     * the references must be released before the acquisition is destroyed.
+     *
+     * \param block [in] Block of consecutive data packets.
+     */
+    virtual void consumeBlock(PacketBlock * block) {
+        consumePackets(block->getPackets(), block->getPacketsNum());
+    }
+
+    /*! \brief Receives the notice that data packets are missing before the next ones, because the source lost them
+     * or the sinks fell behind. Stages that keep time, e.g. recordings, override it; by default it is ignored.
+     *
+     * \param firstPacket [in] Index of the first missing data packet since the start of the acquisition.
+     * \param packetsNum [in] Number of missing data packets.
+     */
+    virtual void consumeGap(uint64_t firstPacket, unsigned long long packetsNum) {
+        (void)firstPacket;
+        (void)packetsNum;
+    }
+};
+
+/*! \class AcquisitionCommand
+ * \brief Work run by the reader thread of an #Acquisition between two reads, e.g. sending commands to the device:
+ * an #EDL object is not meant to be used by several threads, so once the acquisition is started only its reader thread
+ * may use it.
+ */
+class AcquisitionCommand {
+public:
+    virtual ~AcquisitionCommand() {}
+
+    /*! \brief Runs on the reader thread, which reads again once it returns.
+     */
+    virtual void run() = 0;
+};
+
+/*! \fn deliverBlock
+ * \brief Hands a block to a sink, preceded by a call to AcquisitionSink::consumeGap if data packets are missing
+ * since the previous block.
+ *
+ * \param sink [in] Sink of the block.
+ * \param block [in] Block of consecutive data packets.
+ * \param nextPacket [in/out] Index of the data packet following the previous block; updated past \a block.
+ */
+void deliverBlock(AcquisitionSink * sink, PacketBlock * block, uint64_t &nextPacket);
+
+/*! \class Acquisition
+ * \brief Collects data packets from a #PacketSource on a reader thread and hands them to the sinks on a consumer thread.
+ * The reader copies each read into blocks of a #PacketPool and passes them to the consumer through a lock-free ring buffer
+ * of block pointers, so slow sinks never delay the reads and nothing is allocated once the acquisition is started.
+ * If the sinks fall behind until the pool is exhausted the newest packets are dropped and counted in
+ * AcquisitionStats_t::droppedPackets.
+ * The data packets are numbered by a sample counter that also advances over the dropped packets and over those lost by
+ * the source, whose number is estimated from the packet rate when the source reports a loss, so that the index of a
+ * data packet keeps mapping to its time; the sinks are told about the missing packets by AcquisitionSink::consumeGap.
+ * The reader thread reads when a #ReadController says that enough data packets are available, and otherwise
+ * sleeps until they are expected to be. The EDL API offers no notification, so this is the only polling: the consumer thread
+ * blocks on a #Notifier until the reader signals new blocks, without consuming CPU or adding latency in between.
+ * Each status check, read, copy in the pool and hand-over to the sinks is timed in the #Instrumentation of the acquisition.
+ * The reader thread is the only one that uses the source while it runs: other threads that need the device, e.g. to send
+ * commands, post an #AcquisitionCommand that the reader thread runs between two reads.
+ */
+class Acquisition {
+public:
+    /*! \brief Acquisition constructor.
+     *
+     * \param source [in] Source of the data packets; it must outlive this object.
+     * \param blocksNum [in] Number of blocks of the #PacketPool.
+     * \param blockPackets [in] Data packets per block.
+     */
+    Acquisition(PacketSource &source, unsigned int blocksNum = ACQUISITION_POOL_BLOCKS, unsigned int blockPackets = ACQUISITION_BLOCK_PACKETS);
+
+    /*! \brief Acquisition destructor. Stops the threads if still running.
+     */
+    ~Acquisition();
+
+    /*! \brief Adds a sink. Sinks must be added before #start and must outlive the acquisition.
+     */
+    void addSink(AcquisitionSink * sink);
+
+    /*! \brief Pins the reader thread to a core, so that it is not delayed by the other threads of the process.
+     * Must be called before #start.
+     *
+     * \param coreIdx [in] Index of the core, see #pinCurrentThread; -1 lets the system schedule the thread.
+     */
+    void setReaderCore(int coreIdx);
+
+    /*! \brief Discards the first data packets read, e.g. to align several devices. Must be called before #start.
+     * The first data packet handed to the sinks has index 0, see PacketBlock::getFirstPacket.
+     */
+    void setSkippedPackets(unsigned long long packetsNum);
+
+    /*! \brief Sets the parameters that decide when the reader thread reads. Must be called before #start.
+     *
+     * \param config [in] Parameters of the #ReadController.
+     * \param expectedRate [in] Expected packet rate [Hz], e.g. the sampling rate, used until it is measured; 0 if unknown.
+     */
+    void setReadController(const ReadControllerConfig_t &config, double expectedRate = 0.0);
+
+    /*! \brief Sets how many data packets the reader thread publishes before waking up the consumer thread.
+     * The default, 1, hands each read to the sinks as soon as possible; larger values let the sinks handle larger batches
+     * and wake up less often, at the cost of latency. May be called at any time.
+     */
+    void setConsumerWakeup(unsigned long long packetsNum);
+
+    /*! \brief Has the reader thread run a command before its next status check. May be called at any time from any thread.
+     * The commands are run in the order they are posted; those still pending when the reader thread stops are not run.
+     *
+     * \param command [in] Command to run; it must stay valid until it has been run or withdrawn by #cancelCommand.
+     */
+    void postCommand(AcquisitionCommand * command);
+
+    /*! \brief Withdraws a command posted by #postCommand if it has not been run yet, otherwise waits until it has returned.
+     * After this call the acquisition no longer refers to \a command.
+     */
+    void cancelCommand(AcquisitionCommand * command);
+
+    /*! \brief Starts the reader and consumer threads.
+     *
+     * \return #EdlErrorCode_t Error code.
+     */
+    EdlErrorCode_t start(EDL_VOID);
+
+    /*! \brief Stops the reader thread, waits for the sinks to consume the pending packets and stops the consumer thread.
+     *
+     * \return The error that stopped the reader thread, if any, otherwise the result of the last read.
+     */
+    EdlErrorCode_t stop(EDL_VOID);
+
+    /*! \brief Returns false once the reader thread has stopped, either because of #stop or of a source error.
+     */
+    bool isRunning(EDL_VOID) const;
+
+    /*! \brief Returns a snapshot of the counters.
+     */
+    AcquisitionStats_t getStats(EDL_VOID) const;
+
+    /*! \brief Returns the durations of the steps of the reader and consumer threads, to which the sinks may add their own,
+     * see #InstrumentedSink.
+     */
+    Instrumentation &getInstrumentation(EDL_VOID);
+
+private:
+    void readerLoop(EDL_VOID);
+    void consumerLoop(EDL_VOID);
+    unsigned int publish(const float * packets, unsigned int packetsNum, uint64_t firstPacket);
+    void runCommands(EDL_VOID);
+
+    PacketSource &source;
+    PacketPool pool;
+    SpscRingBuffer <PacketBlock *> ring; /*!< Blocks read and not yet consumed; each holds one reference. */
+    std::vector <AcquisitionSink *> sinks;
+
+    std::thread readerThread;
+    std::thread consumerThread;
+    std::atomic <bool> readerRunning;
+    std::atomic <bool> consumerRunning;
+    std::atomic <int> result; /*!< #EdlErrorCode_t of the reader thread. */
+    int readerCoreIdx;
+    std::atomic <int> readerCore; /*!< Core the reader thread is actually pinned to. */
+    unsigned long long skippedPacketsNum;
+    ReadControllerConfig_t controllerConfig;
+    double expectedRate;
+
+    std::atomic <unsigned long long> readPackets;
+    std::atomic <unsigned long long> consumedPackets;
+    std::atomic <unsigned long long> droppedPackets;
+    std::atomic <unsigned int> bufferOverflows;
+    std::atomic <unsigned int> lostDataEvents;
+    std::atomic <unsigned long long> statusChecks;
+    std::atomic <unsigned long long> reads;
+    std::atomic <unsigned int> readThreshold;
+    std::atomic <double> packetRate;
+    std::atomic <unsigned int> readBufferGrowths;
+    std::atomic <unsigned long long> lostPackets;
+    std::atomic <unsigned long long> streamPackets;
+    Instrumentation instrumentation;
+    Notifier dataReady; /*!< Signalled by the reader thread when blocks are published, and by #stop. */
+    std::mutex commandsMutex; /*!< Held by the reader thread while it runs the commands. */
+    std::deque <AcquisitionCommand *> commands; /*!< Commands posted and not yet run. */
+    std::atomic <bool> commandsPending; /*!< True if \a commands is not empty, checked by the reader thread without locking. */
+};
+
+#endif // ACQUISITION_H
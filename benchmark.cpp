@@ -0,0 +1,1410 @@
+/*! \file benchmark.cpp
+ * \brief Benchmarks of the acquisition data path.
+ * Usage: benchmark [name ...] [trace ...]. With no names all of the benchmarks are run.
+ * Traces are recordings, or files of raw data packets acquired in the 200pA range as written by the original caller (data.dat):
+ * the compression benchmark runs on them too.
+ */
+#include <iostream>
+#include <iomanip>
+#include <cstdio>
+#include <cstring>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <string>
+#include <cmath>
+#include <cstdlib>
+#include <algorithm>
+#include <atomic>
+#include <new>
+
+#ifdef _WIN32
+#include "windows.h"
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#include <unistd.h>
+#endif
+
+#include "edl.h"
+#include "packet_source.h"
+#include "acquisition.h"
+#include "broadcast.h"
+#include "data_writer.h"
+#include "edl_settings.h"
+#include "event_detector.h"
+#include "lowpass_filter.h"
+#include "decimator.h"
+#include "channel_statistics.h"
+#include "deinterleave.h"
+#include "trace_compression.h"
+#include "recording_writer.h"
+#include "recording_rotation.h"
+#include "recording_reader.h"
+#include "trace_pyramid.h"
+#include "event_reprocessing.h"
+#include "work_stealing_pool.h"
+#include "thread_affinity.h"
+#include "instrumentation.h"
+#include "notifier.h"
+
+/*! \def BENCHMARK_FILE
+ * \brief Temporary file written by the storage benchmarks.
+ */
+#define BENCHMARK_FILE "benchmark.dat"
+
+/*! \def BENCHMARK_WRITER_MB
+ * \brief Megabytes written by each writer benchmark.
+ */
+#define BENCHMARK_WRITER_MB 256
+
+/*! \def BENCHMARK_PROCESSING_PACKETS
+ * \brief Data packets processed by each processing benchmark.
+ */
+#define BENCHMARK_PROCESSING_PACKETS 2000000
+
+/*! \def BENCHMARK_READ_PACKETS
+ * \brief Data packets returned by each simulated EDL::readData.
+ */
+#define BENCHMARK_READ_PACKETS 1000
+
+/*! \def BENCHMARK_TRACE_MAX_PACKETS
+ * \brief Maximum number of data packets loaded from each trace given on the command line.
+ */
+#define BENCHMARK_TRACE_MAX_PACKETS 20000000
+
+/*! \def BENCHMARK_PYRAMID_BUCKETS
+ * \brief Buckets of each pyramid query, as for a full HD screen.
+ */
+#define BENCHMARK_PYRAMID_BUCKETS 1920
+
+/*! \def BENCHMARK_REPROCESSING_SECONDS
+ * \brief Seconds at 200kHz of the recording processed again by the reprocessing benchmark.
+ */
+#define BENCHMARK_REPROCESSING_SECONDS 20
+
+/*! \def BENCHMARK_REPROCESSING_CHUNK_SECONDS
+ * \brief Duration of the chunks of the reprocessing benchmark [s], short enough to give each core a few of them.
+ */
+#define BENCHMARK_REPROCESSING_CHUNK_SECONDS 1.0
+
+/*! \def BENCHMARK_READS_SECONDS
+ * \brief Seconds of acquisition of each read scheduling case.
+ */
+#define BENCHMARK_READS_SECONDS 1
+
+/*! \def BENCHMARK_FANOUT_SECONDS
+ * \brief Seconds of acquisition of the fan-out benchmark.
+ */
+#define BENCHMARK_FANOUT_SECONDS 2
+
+/*! \def BENCHMARK_SOAK_SECONDS
+ * \brief Seconds of acquisition of the soak benchmark; define it on the command line for long runs, e.g. 86400 for a day.
+ */
+#ifndef BENCHMARK_SOAK_SECONDS
+#define BENCHMARK_SOAK_SECONDS 30
+#endif
+
+/*! \def BENCHMARK_SOAK_REPORT_SECONDS
+ * \brief Seconds between the reports of the soak benchmark.
+ */
+#define BENCHMARK_SOAK_REPORT_SECONDS 5
+
+/*! \def BENCHMARK_SOAK_ROTATION_SECONDS
+ * \brief Duration of the recording files written by the soak benchmark [s], short to exercise the rotation.
+ */
+#define BENCHMARK_SOAK_ROTATION_SECONDS 2.0
+
+/*! \def BENCHMARK_SWEEP_SECONDS
+ * \brief Seconds of acquisition of each case of the sweep benchmark.
+ */
+#define BENCHMARK_SWEEP_SECONDS 1
+
+/*! \def BENCHMARK_SWEEP_RESULTS
+ * \brief Machine-readable results of the sweep benchmark, one CSV line per case, for regression tracking.
+ */
+#define BENCHMARK_SWEEP_RESULTS "benchmark_sweep.csv"
+
+/*! \def BENCHMARK_PROBE_RECORDS
+ * \brief Durations recorded to measure the cost of a probe of an #Instrumentation.
+ */
+#define BENCHMARK_PROBE_RECORDS 10000000
+
+/*! \def BENCHMARK_WAKEUPS
+ * \brief Signals sent to measure the wakeup latency of a consumer thread.
+ */
+#define BENCHMARK_WAKEUPS 1000
+
+/*! \def BENCHMARK_IDLE_SECONDS
+ * \brief Seconds a consumer thread waits without data to measure the CPU it uses while idle.
+ */
+#define BENCHMARK_IDLE_SECONDS 2
+
+/*! \struct Benchmark_t
+ * \brief Named benchmark.
+ */
+typedef struct {
+    const char * name; /*!< Name used to select the benchmark from the command line. */
+    void (* run)(); /*!< Benchmark function. */
+} Benchmark_t;
+
+/*! Traces given on the command line. */
+static std::vector <std::string> traces;
+
+/*! Heap allocations made by all of the threads, counted by the replaced global operator new. */
+static std::atomic <unsigned long long> heapAllocations(0);
+
+void * operator new(size_t size) {
+    heapAllocations.fetch_add(1, std::memory_order_relaxed);
+    void * ptr = malloc(size > 0 ? size : 1);
+    if (ptr == NULL) {
+        throw std::bad_alloc();
+    }
+    return ptr;
+}
+
+void operator delete(void * ptr) noexcept {
+    free(ptr);
+}
+
+/*! \fn processCpuSeconds
+ * \brief Returns the CPU time used by all of the threads of the process in seconds.
+ */
+static double processCpuSeconds() {
+#ifdef _WIN32
+    FILETIME creationTime, exitTime, kernelTime, userTime;
+    GetProcessTimes(GetCurrentProcess(), &creationTime, &exitTime, &kernelTime, &userTime);
+    unsigned long long kernel = ((unsigned long long)kernelTime.dwHighDateTime << 32) | kernelTime.dwLowDateTime;
+    unsigned long long user = ((unsigned long long)userTime.dwHighDateTime << 32) | userTime.dwLowDateTime;
+    return (double)(kernel+user)*1.0e-7;
+#else
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return (double)(usage.ru_utime.tv_sec+usage.ru_stime.tv_sec)+(double)(usage.ru_utime.tv_usec+usage.ru_stime.tv_usec)*1.0e-6;
+#endif
+}
+
+/*! \fn residentBytes
+ * \brief Returns the physical memory currently used by the process in bytes, 0 if unknown.
+ */
+static unsigned long long residentBytes() {
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+        return 0;
+    }
+    return counters.WorkingSetSize;
+#else
+    unsigned long long sizePages = 0;
+    unsigned long long residentPages = 0;
+    FILE * f = fopen("/proc/self/statm", "r");
+    if (f == NULL) {
+        return 0;
+    }
+    if (fscanf(f, "%llu %llu", &sizePages, &residentPages) != 2) {
+        residentPages = 0;
+    }
+    fclose(f);
+    return residentPages*(unsigned long long)sysconf(_SC_PAGESIZE);
+#endif
+}
+
+/*! \class Stopwatch
+ * \brief Measures wall-clock and process CPU time from its construction.
+ */
+class Stopwatch {
+public:
+    Stopwatch() :
+        wallStart(std::chrono::steady_clock::now()),
+        cpuStart(processCpuSeconds()) {
+    }
+
+    double wallSeconds() const {
+        return std::chrono::duration <double> (std::chrono::steady_clock::now()-wallStart).count();
+    }
+
+    double cpuSeconds() const {
+        return processCpuSeconds()-cpuStart;
+    }
+
+private:
+    std::chrono::steady_clock::time_point wallStart;
+    double cpuStart;
+};
+
+/*! \fn printThroughput
+ * \brief Prints the throughput and CPU usage of a benchmark case.
+ */
+static void printThroughput(const char * label, double bytes, const Stopwatch &stopwatch) {
+    double wall = stopwatch.wallSeconds();
+    double cpu = stopwatch.cpuSeconds();
+    std::cout << "  " << std::left << std::setw(28) << label << std::right << std::fixed << std::setprecision(1)
+              << std::setw(10) << bytes/wall/1.0e6 << " MB/s"
+              << std::setw(8) << 100.0*cpu/wall << " % CPU" << std::endl;
+}
+
+/*! \fn printRate
+ * \brief Prints the samples processed per second by a benchmark case and how many times faster than real time
+ * it is at the highest sampling rate.
+ */
+static void printRate(const char * label, double samples, double channelsNum, const Stopwatch &stopwatch) {
+    double rate = samples/stopwatch.wallSeconds();
+    double realTimeRate = channelsNum*edlSamplingRateHz(EDL_RADIO_SAMPLING_RATE_200_KHZ);
+    std::cout << "  " << std::left << std::setw(28) << label << std::right << std::fixed << std::setprecision(1)
+              << std::setw(10) << rate/1.0e6 << " Msamples/s"
+              << std::setw(8) << rate/realTimeRate << " x real time at 200kHz" << std::endl;
+}
+
+/*! \fn readBatch
+ * \brief Generates a batch of data packets, as returned by EDL::readData.
+ */
+static std::vector <float> readBatch(unsigned int packetsNum = BENCHMARK_READ_PACKETS) {
+    SyntheticPacketSource source(1.0e9, packetsNum);
+    std::vector <float> data;
+    unsigned int readPacketsNum;
+    while (source.getGeneratedPackets() < packetsNum) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    source.readData(packetsNum, readPacketsNum, data);
+    return data;
+}
+
+/*! \fn benchmarkWriter
+ * \brief Compares the per-sample fwrite storage with the #DataWriter modes.
+ */
+static void benchmarkWriter() {
+    std::vector <float> data = readBatch();
+    size_t batchBytes = data.size()*sizeof(float);
+    size_t batchesNum = (size_t)BENCHMARK_WRITER_MB*1000000/batchBytes;
+    double totalBytes = (double)(batchesNum*batchBytes);
+
+    std::cout << "writer: " << BENCHMARK_WRITER_MB << " MB in batches of " << BENCHMARK_READ_PACKETS << " packets" << std::endl;
+
+    {
+        /*! Reference: one fwrite per sample. */
+        Stopwatch stopwatch;
+        FILE * f = fopen(BENCHMARK_FILE, "wb+");
+        for (size_t batchIdx = 0; batchIdx < batchesNum; batchIdx++) {
+            for (unsigned int readPacketsIdx = 0; readPacketsIdx < BENCHMARK_READ_PACKETS; readPacketsIdx++) {
+                for (unsigned int channelIdx = 0; channelIdx < EDL_CHANNEL_NUM; channelIdx++) {
+                    fwrite((unsigned char *)&data.at(readPacketsIdx*EDL_CHANNEL_NUM+channelIdx), sizeof(float), 1, f);
+                }
+            }
+        }
+        fclose(f);
+        printThroughput("fwrite per sample", totalBytes, stopwatch);
+    }
+
+    DataWriterMode_t modes[] = {DataWriterBuffered, DataWriterDirect};
+    for (unsigned int modeIdx = 0; modeIdx < 2; modeIdx++) {
+        Stopwatch stopwatch;
+        DataWriter writer;
+        writer.open(BENCHMARK_FILE, modes[modeIdx]);
+        bool direct = writer.isDirect();
+        for (size_t batchIdx = 0; batchIdx < batchesNum; batchIdx++) {
+            writer.write(data.data(), batchBytes);
+        }
+        writer.close();
+        printThroughput(modes[modeIdx] == DataWriterBuffered ? "DataWriter buffered" :
+                        (direct ? "DataWriter direct" : "DataWriter direct (n/a)"), totalBytes, stopwatch);
+    }
+
+    remove(BENCHMARK_FILE);
+}
+
+/*! \fn benchmarkDetector
+ * \brief Measures the throughput of the #EventDetector on the current channels.
+ */
+static void benchmarkDetector() {
+    std::vector <float> data = readBatch(BENCHMARK_PROCESSING_PACKETS);
+    EventDetector detector(eventDetectorDefaultConfig(edlSamplingRateHz(EDL_RADIO_SAMPLING_RATE_200_KHZ)));
+    std::vector <NanoporeEvent_t> events;
+
+    std::cout << "detector: " << BENCHMARK_PROCESSING_PACKETS << " packets in batches of " << BENCHMARK_READ_PACKETS << " packets" << std::endl;
+    Stopwatch stopwatch;
+    for (unsigned int packetIdx = 0; packetIdx < BENCHMARK_PROCESSING_PACKETS; packetIdx += BENCHMARK_READ_PACKETS) {
+        events.clear();
+        detector.process(&data[packetIdx*EDL_CHANNEL_NUM], BENCHMARK_READ_PACKETS, events);
+    }
+    printRate("EventDetector", (double)BENCHMARK_PROCESSING_PACKETS*(EDL_CHANNEL_NUM-1), EDL_CHANNEL_NUM-1, stopwatch);
+
+    /*! Check the gaps on a trace without events whose baseline changes sign across a gap in the middle: a detector that
+     * does not seed its baselines again after a gap starts from a stale baseline and sees blockades. */
+    unsigned int tracePacketsNum = BENCHMARK_PROCESSING_PACKETS/10;
+    std::vector <float> trace = readBatch(tracePacketsNum);
+    uint32_t noiseState = 12345;
+    for (unsigned int packetIdx = 0; packetIdx < tracePacketsNum; packetIdx++) {
+        for (unsigned int channelIdx = 1; channelIdx < EDL_CHANNEL_NUM; channelIdx++) {
+            /*! Sum of uniform noises, about 1 pA RMS, on a baseline of 100 pA before the gap and -100 pA after it. */
+            float noise = 0.0f;
+            for (unsigned int termIdx = 0; termIdx < 4; termIdx++) {
+                noiseState = noiseState*1664525u+1013904223u;
+                noise += (float)(noiseState >> 8)/(float)(1u << 24)-0.5f;
+            }
+            trace[(size_t)packetIdx*EDL_CHANNEL_NUM+channelIdx] = (packetIdx < tracePacketsNum/2 ? 100.0f : -100.0f)+1.7f*noise;
+        }
+    }
+
+    unsigned int halfPacketsNum = tracePacketsNum/2;
+    detector.reset();
+    events.clear();
+    detector.skip(halfPacketsNum);
+    detector.process(&trace[(size_t)halfPacketsNum*EDL_CHANNEL_NUM], tracePacketsNum-halfPacketsNum, events);
+    size_t leadingGapEvents = events.size();
+
+    detector.reset();
+    events.clear();
+    detector.process(trace.data(), halfPacketsNum, events);
+    detector.skip(halfPacketsNum);
+    detector.process(&trace[(size_t)halfPacketsNum*EDL_CHANNEL_NUM], tracePacketsNum-halfPacketsNum, events);
+    std::cout << "  gaps: " << leadingGapEvents << " spurious events after a leading gap, " << events.size()
+              << " after a gap in the middle" << (leadingGapEvents+events.size() == 0 ? " (ok)" : " (SHOULD BE 0)") << std::endl;
+}
+
+/*! \fn benchmarkDeinterleave
+ * \brief Compares the vectorized conversions between data packets and channel arrays with the scalar ones.
+ */
+static void benchmarkDeinterleave() {
+    std::vector <float> data = readBatch(BENCHMARK_PROCESSING_PACKETS);
+    std::vector <float> interleaved(data.size());
+    ChannelBlock block(BENCHMARK_READ_PACKETS);
+    ChannelBlock reference(BENCHMARK_READ_PACKETS);
+    block.resize(BENCHMARK_READ_PACKETS);
+    double totalBytes = (double)data.size()*sizeof(float);
+
+    std::cout << "deinterleave: " << BENCHMARK_PROCESSING_PACKETS << " packets in batches of " << BENCHMARK_READ_PACKETS << " packets" << std::endl;
+
+    /*! Check that the vectorized conversions match the scalar ones. */
+    bool match = true;
+    for (unsigned int packetIdx = 0; packetIdx < BENCHMARK_PROCESSING_PACKETS; packetIdx += BENCHMARK_READ_PACKETS) {
+        const float * packets = &data[packetIdx*EDL_CHANNEL_NUM];
+        block.deinterleave(packets, BENCHMARK_READ_PACKETS);
+        reference.resize(BENCHMARK_READ_PACKETS);
+        deinterleavePacketsScalar(packets, BENCHMARK_READ_PACKETS, (float * const *)reference.channels());
+        for (unsigned int channelIdx = 0; channelIdx < EDL_CHANNEL_NUM; channelIdx++) {
+            match = match && memcmp(block.channel(channelIdx), reference.channel(channelIdx), BENCHMARK_READ_PACKETS*sizeof(float)) == 0;
+        }
+        block.interleave(&interleaved[packetIdx*EDL_CHANNEL_NUM]);
+    }
+    match = match && memcmp(interleaved.data(), data.data(), data.size()*sizeof(float)) == 0;
+    std::cout << "  results " << (match ? "match" : "DO NOT MATCH") << " the scalar conversions" << std::endl;
+
+    float * const * channels = (float * const *)block.channels();
+    {
+        Stopwatch stopwatch;
+        for (unsigned int packetIdx = 0; packetIdx < BENCHMARK_PROCESSING_PACKETS; packetIdx += BENCHMARK_READ_PACKETS) {
+            deinterleavePacketsScalar(&data[packetIdx*EDL_CHANNEL_NUM], BENCHMARK_READ_PACKETS, channels);
+        }
+        printThroughput("deinterleave scalar", totalBytes, stopwatch);
+    }
+    {
+        Stopwatch stopwatch;
+        for (unsigned int packetIdx = 0; packetIdx < BENCHMARK_PROCESSING_PACKETS; packetIdx += BENCHMARK_READ_PACKETS) {
+            deinterleavePackets(&data[packetIdx*EDL_CHANNEL_NUM], BENCHMARK_READ_PACKETS, channels);
+        }
+        printThroughput("deinterleave vectorized", totalBytes, stopwatch);
+    }
+    {
+        Stopwatch stopwatch;
+        for (unsigned int packetIdx = 0; packetIdx < BENCHMARK_PROCESSING_PACKETS; packetIdx += BENCHMARK_READ_PACKETS) {
+            interleavePacketsScalar(block.channels(), BENCHMARK_READ_PACKETS, &interleaved[packetIdx*EDL_CHANNEL_NUM]);
+        }
+        printThroughput("interleave scalar", totalBytes, stopwatch);
+    }
+    {
+        Stopwatch stopwatch;
+        for (unsigned int packetIdx = 0; packetIdx < BENCHMARK_PROCESSING_PACKETS; packetIdx += BENCHMARK_READ_PACKETS) {
+            interleavePackets(block.channels(), BENCHMARK_READ_PACKETS, &interleaved[packetIdx*EDL_CHANNEL_NUM]);
+        }
+        printThroughput("interleave vectorized", totalBytes, stopwatch);
+    }
+}
+
+/*! \fn benchmarkTraceCompression
+ * \brief Compresses and decompresses a trace chunk by chunk, as #RecordingWriter does, and checks that it is restored exactly.
+ */
+static void benchmarkTraceCompression(const char * label, const std::vector <float> &data, const double * resolutions) {
+    unsigned int packetsNum = (unsigned int)(data.size()/EDL_CHANNEL_NUM);
+    double totalBytes = (double)packetsNum*EDL_CHANNEL_NUM*sizeof(float);
+    TraceCompressor compressor(resolutions);
+    std::vector <std::vector <uint8_t> > chunks((packetsNum+RECORDING_CHUNK_PACKETS-1)/RECORDING_CHUNK_PACKETS);
+    std::vector <float> restored(data.size());
+
+    std::cout << "  " << label << ": " << packetsNum << " packets" << std::endl;
+    double compressedBytes = 0.0;
+    {
+        Stopwatch stopwatch;
+        for (size_t chunkIdx = 0; chunkIdx < chunks.size(); chunkIdx++) {
+            unsigned int firstPacket = (unsigned int)chunkIdx*RECORDING_CHUNK_PACKETS;
+            unsigned int chunkPackets = packetsNum-firstPacket < RECORDING_CHUNK_PACKETS ? packetsNum-firstPacket : RECORDING_CHUNK_PACKETS;
+            compressor.compress(&data[(size_t)firstPacket*EDL_CHANNEL_NUM], chunkPackets, chunks[chunkIdx]);
+            compressedBytes += chunks[chunkIdx].size();
+        }
+        printThroughput("compress", totalBytes, stopwatch);
+    }
+
+    bool match = true;
+    {
+        Stopwatch stopwatch;
+        for (size_t chunkIdx = 0; chunkIdx < chunks.size(); chunkIdx++) {
+            unsigned int firstPacket = (unsigned int)chunkIdx*RECORDING_CHUNK_PACKETS;
+            unsigned int chunkPackets = packetsNum-firstPacket < RECORDING_CHUNK_PACKETS ? packetsNum-firstPacket : RECORDING_CHUNK_PACKETS;
+            match = compressor.decompress(chunks[chunkIdx].data(), chunks[chunkIdx].size(), chunkPackets, &restored[(size_t)firstPacket*EDL_CHANNEL_NUM]) && match;
+        }
+        printThroughput("decompress", totalBytes, stopwatch);
+    }
+
+    match = match && memcmp(restored.data(), data.data(), data.size()*sizeof(float)) == 0;
+    std::cout << "  " << std::left << std::setw(28) << "ratio" << std::right << std::fixed << std::setprecision(2)
+              << std::setw(10) << (compressedBytes > 0.0 ? totalBytes/compressedBytes : 0.0) << (match ? " (lossless)" : " (DATA DOES NOT MATCH)") << std::endl;
+}
+
+/*! \fn benchmarkCompression
+ * \brief Measures the compression ratio and throughput of #TraceCompressor on synthetic data and on the traces given on the command line.
+ */
+static void benchmarkCompression() {
+    double resolutions[EDL_CHANNEL_NUM];
+    traceChannelResolutions(EDL_RADIO_RANGE_200_PA, resolutions);
+    std::cout << "compression: chunks of " << RECORDING_CHUNK_PACKETS << " packets" << std::endl;
+
+    /*! Synthetic data quantized as the ADCs do, then left as they are: the latter are stored uncompressed. */
+    std::vector <float> data = readBatch(BENCHMARK_PROCESSING_PACKETS);
+    std::vector <float> quantized(data.size());
+    for (size_t sampleIdx = 0; sampleIdx < data.size(); sampleIdx++) {
+        double resolution = resolutions[sampleIdx%EDL_CHANNEL_NUM];
+        quantized[sampleIdx] = (float)(std::floor(data[sampleIdx]/resolution+0.5)*resolution);
+    }
+    benchmarkTraceCompression("synthetic, ADC codes", quantized, resolutions);
+    benchmarkTraceCompression("synthetic, not quantized", data, resolutions);
+
+    RecordingHeader_t rawHeader;
+    recordingHeaderInit(rawHeader, EDL_RADIO_SAMPLING_RATE_200_KHZ, EDL_RADIO_RANGE_200_PA, EDL_RADIO_FINAL_BANDWIDTH_SR_2);
+    for (size_t traceIdx = 0; traceIdx < traces.size(); traceIdx++) {
+        RecordingReader reader;
+        if (!reader.open(traces[traceIdx], &rawHeader)) {
+            std::cout << "  failed to open " << traces[traceIdx] << std::endl;
+            continue;
+        }
+
+        unsigned int packetsNum = reader.getPacketsNum() < BENCHMARK_TRACE_MAX_PACKETS ? (unsigned int)reader.getPacketsNum() : BENCHMARK_TRACE_MAX_PACKETS;
+        std::vector <float> trace((size_t)packetsNum*EDL_CHANNEL_NUM);
+        trace.resize((size_t)reader.readPackets(0, packetsNum, trace.data())*EDL_CHANNEL_NUM);
+        traceChannelResolutions(reader.getHeader().rangeRadioId, resolutions);
+        benchmarkTraceCompression(traces[traceIdx].c_str(), trace, resolutions);
+    }
+}
+
+/*! \fn benchmarkReader
+ * \brief Measures the sequential scan of a recording through #RecordingReader, for each chunk encoding.
+ */
+static void benchmarkReader() {
+    std::vector <float> data = readBatch(BENCHMARK_PROCESSING_PACKETS);
+    double resolutions[EDL_CHANNEL_NUM];
+    traceChannelResolutions(EDL_RADIO_RANGE_200_PA, resolutions);
+    for (size_t sampleIdx = 0; sampleIdx < data.size(); sampleIdx++) {
+        double resolution = resolutions[sampleIdx%EDL_CHANNEL_NUM];
+        data[sampleIdx] = (float)(std::floor(data[sampleIdx]/resolution+0.5)*resolution);
+    }
+    double totalBytes = (double)data.size()*sizeof(float);
+    double referenceSums[EDL_CHANNEL_NUM] = {0.0};
+    for (size_t sampleIdx = 0; sampleIdx < data.size(); sampleIdx++) {
+        referenceSums[sampleIdx%EDL_CHANNEL_NUM] += data[sampleIdx];
+    }
+
+    std::cout << "reader: " << BENCHMARK_PROCESSING_PACKETS << " packets in blocks of " << RECORDING_READER_BLOCK_PACKETS << " packets" << std::endl;
+
+    RecordingEncoding_t encodings[] = {RecordingEncodingFloat32, RecordingEncodingPacked};
+    for (unsigned int encodingIdx = 0; encodingIdx < 2; encodingIdx++) {
+        RecordingHeader_t header;
+        recordingHeaderInit(header, EDL_RADIO_SAMPLING_RATE_200_KHZ, EDL_RADIO_RANGE_200_PA, EDL_RADIO_FINAL_BANDWIDTH_SR_2);
+        RecordingWriter writer;
+        writer.open(BENCHMARK_FILE, header, DataWriterBuffered, encodings[encodingIdx]);
+        writer.write(data.data(), BENCHMARK_PROCESSING_PACKETS);
+        writer.close();
+
+        /*! Sum each channel through its strided view, so that every sample is actually read. */
+        Stopwatch stopwatch;
+        RecordingReader reader;
+        reader.open(BENCHMARK_FILE);
+        double sums[EDL_CHANNEL_NUM] = {0.0};
+        uint64_t packetIdx = 0;
+        RecordingBlock_t block;
+        while (reader.readBlock(packetIdx, RECORDING_READER_BLOCK_PACKETS, block)) {
+            for (unsigned int channelIdx = 0; channelIdx < EDL_CHANNEL_NUM; channelIdx++) {
+                ChannelView view = recordingBlockChannel(block, channelIdx);
+                for (unsigned int sampleIdx = 0; sampleIdx < view.size(); sampleIdx++) {
+                    sums[channelIdx] += view[sampleIdx];
+                }
+            }
+            packetIdx += block.packetsNum;
+        }
+        printThroughput(encodings[encodingIdx] == RecordingEncodingFloat32 ? "scan float32" : "scan packed", totalBytes, stopwatch);
+
+        bool match = packetIdx == BENCHMARK_PROCESSING_PACKETS;
+        for (unsigned int channelIdx = 0; channelIdx < EDL_CHANNEL_NUM; channelIdx++) {
+            match = match && sums[channelIdx] == referenceSums[channelIdx];
+        }
+        if (!match) {
+            std::cout << "  DATA DOES NOT MATCH" << std::endl;
+        }
+    }
+
+    remove(BENCHMARK_FILE);
+}
+
+/*! \fn benchmarkPyramid
+ * \brief Measures how fast #PyramidWriter keeps up with the acquisition and how long #PyramidReader takes to render a window at each zoom.
+ */
+static void benchmarkPyramid() {
+    std::vector <float> data = readBatch(BENCHMARK_PROCESSING_PACKETS);
+    RecordingHeader_t header;
+    recordingHeaderInit(header, EDL_RADIO_SAMPLING_RATE_200_KHZ, EDL_RADIO_RANGE_200_PA, EDL_RADIO_FINAL_BANDWIDTH_SR_2);
+
+    std::cout << "pyramid: " << BENCHMARK_PROCESSING_PACKETS << " packets in batches of " << BENCHMARK_READ_PACKETS << " packets" << std::endl;
+    {
+        RecordingWriter recording;
+        recording.open(BENCHMARK_FILE, header);
+        recording.write(data.data(), BENCHMARK_PROCESSING_PACKETS);
+        recording.close();
+
+        Stopwatch stopwatch;
+        PyramidWriter pyramid;
+        pyramid.open(BENCHMARK_FILE);
+        for (unsigned int packetIdx = 0; packetIdx < BENCHMARK_PROCESSING_PACKETS; packetIdx += BENCHMARK_READ_PACKETS) {
+            pyramid.write(&data[packetIdx*EDL_CHANNEL_NUM], BENCHMARK_READ_PACKETS);
+        }
+        pyramid.close();
+        printRate("PyramidWriter", (double)BENCHMARK_PROCESSING_PACKETS*EDL_CHANNEL_NUM, EDL_CHANNEL_NUM, stopwatch);
+    }
+
+    float min = data[1];
+    float max = data[1];
+    for (unsigned int packetIdx = 0; packetIdx < BENCHMARK_PROCESSING_PACKETS; packetIdx++) {
+        min = data[packetIdx*EDL_CHANNEL_NUM+1] < min ? data[packetIdx*EDL_CHANNEL_NUM+1] : min;
+        max = data[packetIdx*EDL_CHANNEL_NUM+1] > max ? data[packetIdx*EDL_CHANNEL_NUM+1] : max;
+    }
+
+    /*! Zoom in by a factor 16 each time, from the whole recording down to the single data packets. */
+    PyramidReader reader;
+    reader.open(BENCHMARK_FILE);
+    std::vector <RecordingSummary_t> buckets;
+    for (uint64_t packetsNum = BENCHMARK_PROCESSING_PACKETS; packetsNum >= BENCHMARK_PYRAMID_BUCKETS/PYRAMID_FACTOR; packetsNum /= PYRAMID_FACTOR) {
+        Stopwatch stopwatch;
+        bool valid = reader.query(1, 0, packetsNum, BENCHMARK_PYRAMID_BUCKETS, buckets);
+        double wall = stopwatch.wallSeconds();
+
+        /*! The whole recording must have the same extremes as the data packets. */
+        if (packetsNum == BENCHMARK_PROCESSING_PACKETS) {
+            float queryMin = buckets[0].min;
+            float queryMax = buckets[0].max;
+            for (unsigned int bucketIdx = 0; bucketIdx < buckets.size(); bucketIdx++) {
+                queryMin = buckets[bucketIdx].min < queryMin ? buckets[bucketIdx].min : queryMin;
+                queryMax = buckets[bucketIdx].max > queryMax ? buckets[bucketIdx].max : queryMax;
+            }
+            valid = valid && queryMin == min && queryMax == max;
+        }
+
+        std::cout << "  " << std::left << std::setw(28) << ("window of " + std::to_string(packetsNum) + " packets") << std::right
+                  << std::fixed << std::setprecision(1) << std::setw(10) << wall*1.0e6 << " us" << (valid ? "" : " (INVALID)") << std::endl;
+    }
+    reader.close();
+
+    remove(BENCHMARK_FILE);
+    for (unsigned int level = 1; level <= PYRAMID_LEVELS; level++) {
+        remove(pyramidLevelPath(BENCHMARK_FILE, level).c_str());
+    }
+}
+
+/*! \fn benchmarkReads
+ * \brief Compares the fixed read threshold of the original caller (10 data packets, 1 ms wait) with the #ReadController
+ * at the lowest and highest sampling rates: wakeups and reads per second, data packets per read and overflows.
+ */
+static void benchmarkReads() {
+    ReadControllerConfig_t fixedConfig = readControllerDefaultConfig();
+    fixedConfig.minPackets = 10;
+    fixedConfig.maxPackets = 10;
+    fixedConfig.minWait = 1.0e-3;
+    fixedConfig.maxWait = 1.0e-3;
+
+    const unsigned int samplingRates[] = {EDL_RADIO_SAMPLING_RATE_1_25_KHZ, EDL_RADIO_SAMPLING_RATE_200_KHZ};
+    std::cout << "reads: " << BENCHMARK_READS_SECONDS << " s of acquisition per case" << std::endl;
+    for (unsigned int rateIdx = 0; rateIdx < sizeof(samplingRates)/sizeof(samplingRates[0]); rateIdx++) {
+        double samplingRate = edlSamplingRateHz(samplingRates[rateIdx]);
+        for (unsigned int configIdx = 0; configIdx < 2; configIdx++) {
+            SyntheticPacketSource source(samplingRate);
+            Acquisition acquisition(source);
+            acquisition.setReadController(configIdx == 0 ? fixedConfig : readControllerDefaultConfig(), samplingRate);
+
+            Stopwatch stopwatch;
+            acquisition.start();
+            std::this_thread::sleep_for(std::chrono::seconds(BENCHMARK_READS_SECONDS));
+            acquisition.stop();
+            double wall = stopwatch.wallSeconds();
+            double cpu = stopwatch.cpuSeconds();
+            AcquisitionStats_t stats = acquisition.getStats();
+
+            std::string label = std::string(configIdx == 0 ? "fixed" : "adaptive")+" at "+std::to_string((int)samplingRate)+" Hz";
+            std::cout << "  " << std::left << std::setw(28) << label << std::right << std::fixed << std::setprecision(1)
+                      << std::setw(10) << stats.statusChecks/wall << " checks/s"
+                      << std::setw(10) << stats.reads/wall << " reads/s"
+                      << std::setw(10) << (stats.reads > 0 ? (double)stats.readPackets/stats.reads : 0.0) << " packets/read"
+                      << std::setw(6) << stats.bufferOverflows << " overflows"
+                      << std::setw(8) << 100.0*cpu/wall << " % CPU" << std::endl;
+        }
+    }
+}
+
+/*! \class RetainingSink
+ * \brief #AcquisitionSink that keeps a reference to the last block, as a stage processing it on another thread would.
+ */
+class RetainingSink : public AcquisitionSink {
+public:
+    RetainingSink() :
+        block(NULL) {
+    }
+
+    /*! \brief Releases the last block; must be called before the acquisition is destroyed.
+     */
+    void releaseBlock() {
+        if (block != NULL) {
+            block->release();
+            block = NULL;
+        }
+    }
+
+    void consumePackets(const float * packets, unsigned int packetsNum) {
+        (void)packets;
+        (void)packetsNum;
+    }
+
+    void consumeBlock(PacketBlock * block) {
+        block->addRef();
+        if (this->block != NULL) {
+            this->block->release();
+        }
+        this->block = block;
+    }
+
+private:
+    PacketBlock * block;
+};
+
+/*! \fn benchmarkAllocations
+ * \brief Counts the heap allocations made while the acquisition runs in steady state, which must be 0.
+ */
+static void benchmarkAllocations() {
+    const unsigned int samplingRates[] = {EDL_RADIO_SAMPLING_RATE_1_25_KHZ, EDL_RADIO_SAMPLING_RATE_200_KHZ};
+    std::cout << "allocations: " << BENCHMARK_READS_SECONDS << " s of steady state acquisition per case" << std::endl;
+    for (unsigned int rateIdx = 0; rateIdx < sizeof(samplingRates)/sizeof(samplingRates[0]); rateIdx++) {
+        double samplingRate = edlSamplingRateHz(samplingRates[rateIdx]);
+        SyntheticPacketSource source(samplingRate);
+        RetainingSink sink;
+        Acquisition acquisition(source);
+        acquisition.addSink(&sink);
+        acquisition.setReadController(readControllerDefaultConfig(), samplingRate);
+        acquisition.start();
+
+        /*! Skip the start of the threads, then count. */
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        unsigned long long allocations = heapAllocations;
+        unsigned long long reads = acquisition.getStats().reads;
+        std::this_thread::sleep_for(std::chrono::seconds(BENCHMARK_READS_SECONDS));
+        allocations = heapAllocations-allocations;
+        AcquisitionStats_t stats = acquisition.getStats();
+        reads = stats.reads-reads;
+        acquisition.stop();
+        sink.releaseBlock();
+
+        std::string label = std::to_string((int)samplingRate)+" Hz";
+        std::cout << "  " << std::left << std::setw(28) << label << std::right
+                  << std::setw(10) << reads << " reads"
+                  << std::setw(10) << allocations << " allocations"
+                  << std::setw(6) << stats.maxBlocksInUse << " blocks in use at most"
+                  << std::setw(6) << stats.readBufferGrowths << " read buffer growths" << std::endl;
+    }
+}
+
+/*! \class PacingSink
+ * \brief #AcquisitionSink that takes a fixed time per block and counts the gaps between the blocks it receives.
+ */
+class PacingSink : public AcquisitionSink {
+public:
+    explicit PacingSink(unsigned int blockMs) :
+        blockMs(blockMs),
+        nextPacket(0),
+        gapsNum(0) {
+    }
+
+    void consumePackets(const float * packets, unsigned int packetsNum) {
+        (void)packets;
+        (void)packetsNum;
+    }
+
+    void consumeBlock(PacketBlock * block) {
+        if (block->getFirstPacket() != nextPacket) {
+            gapsNum++;
+        }
+        nextPacket = block->getFirstPacket()+block->getPacketsNum();
+        if (blockMs > 0) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(blockMs));
+        }
+    }
+
+    unsigned long long getGapsNum() const {
+        return gapsNum;
+    }
+
+private:
+    unsigned int blockMs;
+    uint64_t nextPacket;
+    unsigned long long gapsNum;
+};
+
+/*! \fn benchmarkFanout
+ * \brief Feeds one acquisition at 200kHz to a fast subscriber and to slow subscribers with each policy,
+ * and shows that only the subscribers with lossy policies lose blocks.
+ */
+static void benchmarkFanout() {
+    double samplingRate = edlSamplingRateHz(EDL_RADIO_SAMPLING_RATE_200_KHZ);
+    SyntheticPacketSource source(samplingRate);
+    Acquisition acquisition(source);
+    acquisition.setReadController(readControllerDefaultConfig(), samplingRate);
+
+    const char * labels[] = {"fast, block", "slow, drop oldest", "slow, decimate", "fast, block"};
+    PacingSink fastSink(0);
+    PacingSink dropSink(20);
+    PacingSink decimateSink(20);
+    PacingSink otherFastSink(0);
+    PacingSink * sinks[] = {&fastSink, &dropSink, &decimateSink, &otherFastSink};
+
+    SubscriberConfig_t slowConfig = subscriberDefaultConfig(BackpressureDropOldest);
+    slowConfig.queueBlocks = 16;
+    Broadcast broadcast;
+    broadcast.subscribe(&fastSink, subscriberDefaultConfig(BackpressureBlock));
+    broadcast.subscribe(&dropSink, slowConfig);
+    slowConfig.policy = BackpressureDecimate;
+    broadcast.subscribe(&decimateSink, slowConfig);
+    broadcast.subscribe(&otherFastSink, subscriberDefaultConfig(BackpressureBlock));
+    acquisition.addSink(&broadcast);
+
+    std::cout << "fanout: " << BENCHMARK_FANOUT_SECONDS << " s at 200kHz, slow subscribers take 20 ms per block" << std::endl;
+    broadcast.start();
+    acquisition.start();
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    unsigned long long allocations = heapAllocations;
+    std::this_thread::sleep_for(std::chrono::seconds(BENCHMARK_FANOUT_SECONDS));
+    allocations = heapAllocations-allocations;
+    acquisition.stop();
+    broadcast.stop();
+
+    AcquisitionStats_t stats = acquisition.getStats();
+    std::cout << "  " << std::left << std::setw(28) << "acquisition" << std::right
+              << std::setw(10) << stats.readPackets << " read" << std::setw(10) << stats.droppedPackets << " dropped"
+              << std::setw(6) << stats.maxBlocksInUse << " blocks in use at most" << std::setw(6) << allocations << " allocations" << std::endl;
+    for (unsigned int subscriberIdx = 0; subscriberIdx < broadcast.getSubscribersNum(); subscriberIdx++) {
+        SubscriberStats_t subscriberStats = broadcast.getStats(subscriberIdx);
+        std::cout << "  " << std::left << std::setw(28) << labels[subscriberIdx] << std::right
+                  << std::setw(10) << subscriberStats.consumedPackets << " consumed"
+                  << std::setw(10) << subscriberStats.droppedPackets+subscriberStats.decimatedPackets << " discarded"
+                  << std::setw(6) << sinks[subscriberIdx]->getGapsNum() << " gaps"
+                  << std::setw(6) << subscriberStats.maxQueuedBlocks << " blocks queued at most" << std::endl;
+    }
+}
+
+/*! \fn benchmarkFilter
+ * \brief Measures how fast #LowPassFilter filters the current channels, in place, for a few orders and responses.
+ */
+static void benchmarkFilter() {
+    std::vector <float> data = readBatch(BENCHMARK_PROCESSING_PACKETS);
+    double samplingRate = edlSamplingRateHz(EDL_RADIO_SAMPLING_RATE_200_KHZ);
+    const LowPassType_t types[] = {LowPassBessel, LowPassButterworth};
+    const unsigned int orders[] = {2, 4, 8};
+
+    std::cout << "filter: " << BENCHMARK_PROCESSING_PACKETS << " packets in batches of " << BENCHMARK_READ_PACKETS << " packets" << std::endl;
+    for (unsigned int typeIdx = 0; typeIdx < sizeof(types)/sizeof(types[0]); typeIdx++) {
+        for (unsigned int orderIdx = 0; orderIdx < sizeof(orders)/sizeof(orders[0]); orderIdx++) {
+            LowPassConfig_t config = lowPassDefaultConfig(samplingRate);
+            config.type = types[typeIdx];
+            config.order = orders[orderIdx];
+            LowPassFilter filter(config);
+
+            Stopwatch stopwatch;
+            for (unsigned int packetIdx = 0; packetIdx < BENCHMARK_PROCESSING_PACKETS; packetIdx += BENCHMARK_READ_PACKETS) {
+                filter.process(&data[packetIdx*EDL_CHANNEL_NUM], BENCHMARK_READ_PACKETS, &data[packetIdx*EDL_CHANNEL_NUM]);
+            }
+            std::string label = std::string(types[typeIdx] == LowPassBessel ? "Bessel" : "Butterworth")+", order "+std::to_string(orders[orderIdx]);
+            printRate(label.c_str(), (double)BENCHMARK_PROCESSING_PACKETS*LOWPASS_CURRENT_CHANNELS, LOWPASS_CURRENT_CHANNELS, stopwatch);
+        }
+    }
+}
+
+/*! \fn benchmarkStatistics
+ * \brief Compares the vectorized FFT of the current channels with the scalar one, then measures how fast #ChannelStatistics
+ * follows the current channels at 200 kHz, with its default configuration and with smaller Welch segments.
+ */
+static void benchmarkStatistics() {
+    std::vector <float> data = readBatch(BENCHMARK_PROCESSING_PACKETS);
+    double samplingRate = edlSamplingRateHz(EDL_RADIO_SAMPLING_RATE_200_KHZ);
+    ChannelStatisticsConfig_t defaultConfig = channelStatisticsDefaultConfig(samplingRate);
+
+    std::cout << "statistics: " << BENCHMARK_PROCESSING_PACKETS << " packets in batches of " << BENCHMARK_READ_PACKETS << " packets" << std::endl;
+
+    /*! Transform as many samples as the data with segments of the default size, without the overlap. */
+    unsigned int size = defaultConfig.fftSize;
+    unsigned int transformsNum = BENCHMARK_PROCESSING_PACKETS/size;
+    std::vector <double> cosTable(size/2);
+    std::vector <double> sinTable(size/2);
+    for (unsigned int k = 0; k < size/2; k++) {
+        cosTable[k] = std::cos(2.0*3.14159265358979323846*k/size);
+        sinTable[k] = std::sin(2.0*3.14159265358979323846*k/size);
+    }
+
+    size_t samplesNum = (size_t)size*STATISTICS_CURRENT_CHANNELS;
+    std::vector <double> re(samplesNum);
+    std::vector <double> im(samplesNum);
+    std::vector <double> referenceRe(samplesNum);
+    std::vector <double> referenceIm(samplesNum);
+    for (size_t sampleIdx = 0; sampleIdx < samplesNum; sampleIdx++) {
+        re[sampleIdx] = referenceRe[sampleIdx] = data[sampleIdx/STATISTICS_CURRENT_CHANNELS*EDL_CHANNEL_NUM+1+sampleIdx%STATISTICS_CURRENT_CHANNELS];
+        im[sampleIdx] = referenceIm[sampleIdx] = 0.0;
+    }
+    fftChannels(re.data(), im.data(), size, cosTable.data(), sinTable.data());
+    fftChannelsScalar(referenceRe.data(), referenceIm.data(), size, cosTable.data(), sinTable.data());
+
+    /*! The compiler may fuse the multiplications and additions of the scalar butterflies, so compare up to the rounding. */
+    double maxMagnitude = 0.0;
+    double maxError = 0.0;
+    for (size_t sampleIdx = 0; sampleIdx < samplesNum; sampleIdx++) {
+        maxMagnitude = std::max(maxMagnitude, std::hypot(referenceRe[sampleIdx], referenceIm[sampleIdx]));
+        maxError = std::max(maxError, std::hypot(re[sampleIdx]-referenceRe[sampleIdx], im[sampleIdx]-referenceIm[sampleIdx]));
+    }
+    bool match = maxError <= 1.0e-12*maxMagnitude;
+    std::cout << "  " << size << " point FFT results " << (match ? "match" : "DO NOT MATCH") << " the scalar ones" << std::endl;
+
+    {
+        Stopwatch stopwatch;
+        for (unsigned int transformIdx = 0; transformIdx < transformsNum; transformIdx++) {
+            fftChannelsScalar(re.data(), im.data(), size, cosTable.data(), sinTable.data());
+        }
+        printRate("FFT scalar", (double)transformsNum*size*STATISTICS_CURRENT_CHANNELS, STATISTICS_CURRENT_CHANNELS, stopwatch);
+    }
+    {
+        Stopwatch stopwatch;
+        for (unsigned int transformIdx = 0; transformIdx < transformsNum; transformIdx++) {
+            fftChannels(re.data(), im.data(), size, cosTable.data(), sinTable.data());
+        }
+        printRate("FFT vectorized", (double)transformsNum*size*STATISTICS_CURRENT_CHANNELS, STATISTICS_CURRENT_CHANNELS, stopwatch);
+    }
+
+    const unsigned int fftSizes[] = {defaultConfig.fftSize, 1024};
+    for (unsigned int sizeIdx = 0; sizeIdx < sizeof(fftSizes)/sizeof(fftSizes[0]); sizeIdx++) {
+        ChannelStatisticsConfig_t config = defaultConfig;
+        config.fftSize = fftSizes[sizeIdx];
+        ChannelStatistics statistics(config);
+
+        Stopwatch stopwatch;
+        for (unsigned int packetIdx = 0; packetIdx < BENCHMARK_PROCESSING_PACKETS; packetIdx += BENCHMARK_READ_PACKETS) {
+            const float * packets = &data[packetIdx*EDL_CHANNEL_NUM];
+            unsigned int packetsNum = BENCHMARK_READ_PACKETS;
+            while (packetsNum > 0) {
+                unsigned int processedNum = statistics.process(packets, packetsNum);
+                packets += (size_t)processedNum*EDL_CHANNEL_NUM;
+                packetsNum -= processedNum;
+            }
+        }
+        std::string label = "statistics, "+std::to_string(config.fftSize)+" point segments";
+        printRate(label.c_str(), (double)BENCHMARK_PROCESSING_PACKETS*STATISTICS_CURRENT_CHANNELS, STATISTICS_CURRENT_CHANNELS, stopwatch);
+    }
+}
+
+/*! \fn benchmarkDecimator
+ * \brief Measures how fast #Decimator decimates all of the channels on one core, for a few factors.
+ * The input samples are counted, so the rates compare with those of the other stages of the data path.
+ */
+static void benchmarkDecimator() {
+    std::vector <float> data = readBatch(BENCHMARK_PROCESSING_PACKETS);
+    std::vector <float> decimated;
+    const unsigned int factors[] = {2, 4, 20, 100};
+
+    std::cout << "decimator: " << BENCHMARK_PROCESSING_PACKETS << " packets in batches of " << BENCHMARK_READ_PACKETS << " packets" << std::endl;
+    for (unsigned int factorIdx = 0; factorIdx < sizeof(factors)/sizeof(factors[0]); factorIdx++) {
+        Decimator decimator(factors[factorIdx]);
+
+        Stopwatch stopwatch;
+        for (unsigned int packetIdx = 0; packetIdx < BENCHMARK_PROCESSING_PACKETS; packetIdx += BENCHMARK_READ_PACKETS) {
+            decimator.process(&data[packetIdx*EDL_CHANNEL_NUM], BENCHMARK_READ_PACKETS, decimated);
+        }
+        std::string label = "factor "+std::to_string(factors[factorIdx])+", "+std::to_string(decimator.getTapsNum())+" taps";
+        printRate(label.c_str(), (double)BENCHMARK_PROCESSING_PACKETS*EDL_CHANNEL_NUM, EDL_CHANNEL_NUM, stopwatch);
+    }
+}
+
+/*! \class LatencySink
+ * \brief #AcquisitionSink that measures how late each block is handed over, compared to when its last data packet
+ * was generated by a #SyntheticPacketSource created at a given time and read from its first data packet.
+ */
+class LatencySink : public AcquisitionSink {
+public:
+    LatencySink(std::chrono::steady_clock::time_point sourceStart, double packetRate) :
+        sourceStart(sourceStart),
+        packetRate(packetRate),
+        maxLatencyUs(0) {
+    }
+
+    void consumePackets(const float * packets, unsigned int packetsNum) {
+        (void)packets;
+        (void)packetsNum;
+    }
+
+    void consumeBlock(PacketBlock * block) {
+        double generatedSeconds = (double)(block->getFirstPacket()+block->getPacketsNum())/packetRate;
+        double seconds = std::chrono::duration <double> (std::chrono::steady_clock::now()-sourceStart).count();
+        unsigned long long latencyUs = seconds > generatedSeconds ? (unsigned long long)((seconds-generatedSeconds)*1.0e6) : 0;
+        unsigned long long maxUs = maxLatencyUs.load(std::memory_order_relaxed);
+        while (latencyUs > maxUs && !maxLatencyUs.compare_exchange_weak(maxUs, latencyUs, std::memory_order_relaxed)) {
+        }
+    }
+
+    /*! \brief Returns the highest latency since the previous call [ms].
+     */
+    double takeMaxLatencyMs() {
+        return (double)maxLatencyUs.exchange(0, std::memory_order_relaxed)*1.0e-3;
+    }
+
+private:
+    std::chrono::steady_clock::time_point sourceStart;
+    double packetRate;
+    std::atomic <unsigned long long> maxLatencyUs;
+};
+
+/*! \fn benchmarkReprocessing
+ * \brief Measures how the #EventReprocessor scales with the number of workers, from 1 to one per core, on a recording
+ * with known events, and checks that the events found do not depend on the number of workers.
+ */
+static void benchmarkReprocessing() {
+    double samplingRate = edlSamplingRateHz(EDL_RADIO_SAMPLING_RATE_200_KHZ);
+    unsigned int secondPacketsNum = (unsigned int)samplingRate;
+    std::vector <float> second = readBatch(secondPacketsNum);
+    RecordingHeader_t header;
+    recordingHeaderInit(header, EDL_RADIO_SAMPLING_RATE_200_KHZ, EDL_RADIO_RANGE_200_PA, EDL_RADIO_FINAL_BANDWIDTH_SR_2);
+    RecordingWriter writer;
+    writer.open(BENCHMARK_FILE, header, DataWriterBuffered, RecordingEncodingFloat32);
+
+    /*! About 1 pA RMS of noise on a baseline of 100 pA, with a blockade of 30 pA lasting 1 ms every 10 ms on each channel. */
+    uint32_t noiseState = 12345;
+    for (unsigned int secondIdx = 0; secondIdx < BENCHMARK_REPROCESSING_SECONDS; secondIdx++) {
+        for (unsigned int packetIdx = 0; packetIdx < secondPacketsNum; packetIdx++) {
+            for (unsigned int channelIdx = 1; channelIdx < EDL_CHANNEL_NUM; channelIdx++) {
+                float noise = 0.0f;
+                for (unsigned int termIdx = 0; termIdx < 4; termIdx++) {
+                    noiseState = noiseState*1664525u+1013904223u;
+                    noise += (float)(noiseState >> 8)/(float)(1u << 24)-0.5f;
+                }
+                unsigned int periodIdx = (packetIdx+channelIdx*secondPacketsNum/400)%(secondPacketsNum/100);
+                bool blockade = periodIdx >= secondPacketsNum/200 && periodIdx < secondPacketsNum/200+secondPacketsNum/1000;
+                second[(size_t)packetIdx*EDL_CHANNEL_NUM+channelIdx] = (blockade ? 70.0f : 100.0f)+1.7f*noise;
+            }
+        }
+        writer.write(second.data(), secondPacketsNum);
+    }
+    writer.close();
+
+    ReprocessingConfig_t config = reprocessingDefaultConfig(samplingRate);
+    config.chunkSeconds = BENCHMARK_REPROCESSING_CHUNK_SECONDS;
+    unsigned int coresNum = processorCoresNum();
+    std::cout << "reprocessing: " << BENCHMARK_REPROCESSING_SECONDS << " s at 200kHz in chunks of " << config.chunkSeconds
+              << " s, up to " << coresNum << " workers" << std::endl;
+
+    std::vector <NanoporeEvent_t> reference;
+    double referenceSeconds = 0.0;
+    for (unsigned int workersNum = 1; workersNum <= coresNum; workersNum = workersNum < coresNum && 2*workersNum > coresNum ? coresNum : 2*workersNum) {
+        WorkStealingPool pool(workersNum);
+        EventReprocessor reprocessor(pool);
+        std::vector <NanoporeEvent_t> events;
+        if (!reprocessor.run(BENCHMARK_FILE, config, events)) {
+            std::cout << "  " << reprocessor.getError() << std::endl;
+            break;
+        }
+
+        const ReprocessingStats_t &stats = reprocessor.getStats();
+        bool match = true;
+        if (workersNum == 1) {
+            reference = events;
+            referenceSeconds = stats.seconds;
+
+        } else {
+            match = events.size() == reference.size();
+            for (size_t eventIdx = 0; eventIdx < events.size() && match; eventIdx++) {
+                match = events[eventIdx].channel == reference[eventIdx].channel && events[eventIdx].startSample == reference[eventIdx].startSample &&
+                        events[eventIdx].duration == reference[eventIdx].duration;
+            }
+        }
+
+        std::string label = std::to_string(workersNum)+(workersNum == 1 ? " worker" : " workers");
+        double rate = (double)BENCHMARK_REPROCESSING_SECONDS*secondPacketsNum*(EDL_CHANNEL_NUM-1)/stats.seconds;
+        std::cout << "  " << std::left << std::setw(28) << label << std::right << std::fixed << std::setprecision(1)
+                  << std::setw(10) << rate/1.0e6 << " Msamples/s" << std::setprecision(2) << std::setw(8) << referenceSeconds/stats.seconds
+                  << " x speedup, " << stats.stolenTasksNum << " stolen, " << events.size() << " events" << (match ? "" : " (EVENTS DIFFER)") << std::endl;
+    }
+
+    std::cout << "  " << (size_t)BENCHMARK_REPROCESSING_SECONDS*100*(EDL_CHANNEL_NUM-1) << " blockades in the recording" << std::endl;
+    remove(BENCHMARK_FILE);
+}
+
+/*! \fn benchmarkSoak
+ * \brief Records at 200kHz for #BENCHMARK_SOAK_SECONDS through the same stages as the caller, rotating the files every
+ * #BENCHMARK_SOAK_ROTATION_SECONDS, and reports the memory used and the latency of the blocks over time:
+ * neither must grow however long the acquisition lasts. The files are deleted at the end.
+ */
+static void benchmarkSoak() {
+    double samplingRate = edlSamplingRateHz(EDL_RADIO_SAMPLING_RATE_200_KHZ);
+    std::chrono::steady_clock::time_point sourceStart = std::chrono::steady_clock::now();
+    SyntheticPacketSource source(samplingRate);
+    Acquisition acquisition(source);
+    acquisition.setReadController(readControllerDefaultConfig(), samplingRate);
+
+    RecordingHeader_t header;
+    recordingHeaderInit(header, EDL_RADIO_SAMPLING_RATE_200_KHZ, EDL_RADIO_RANGE_200_PA, EDL_RADIO_FINAL_BANDWIDTH_SR_2);
+    RotationConfig_t rotation = rotationDefaultConfig();
+    rotation.maxSeconds = BENCHMARK_SOAK_ROTATION_SECONDS;
+    RotatingRecording recording(rotation, true);
+    if (!recording.open("benchmark_soak", header, RecordingEncodingPacked)) {
+        std::cout << "soak: failed to open " << recording.getPath(0) << std::endl;
+        return;
+    }
+
+    LatencySink latencySink(sourceStart, samplingRate);
+    Broadcast broadcast;
+    broadcast.subscribe(&recording, subscriberDefaultConfig(BackpressureBlock));
+    broadcast.subscribe(&latencySink, subscriberDefaultConfig(BackpressureBlock));
+    acquisition.addSink(&broadcast);
+
+    std::cout << "soak: " << BENCHMARK_SOAK_SECONDS << " s at 200kHz, a new file every " << BENCHMARK_SOAK_ROTATION_SECONDS << " s" << std::endl;
+    broadcast.start();
+    acquisition.start();
+    Stopwatch stopwatch;
+    unsigned long long allocations = heapAllocations;
+    for (unsigned int reportIdx = 0; reportIdx < (BENCHMARK_SOAK_SECONDS+BENCHMARK_SOAK_REPORT_SECONDS-1)/BENCHMARK_SOAK_REPORT_SECONDS; reportIdx++) {
+        std::this_thread::sleep_for(std::chrono::seconds(BENCHMARK_SOAK_REPORT_SECONDS));
+        AcquisitionStats_t stats = acquisition.getStats();
+        unsigned long long newAllocations = heapAllocations;
+        std::cout << "  " << std::setw(8) << (unsigned int)stopwatch.wallSeconds() << " s" << std::fixed << std::setprecision(1)
+                  << std::setw(10) << residentBytes()/1.0e6 << " MB resident"
+                  << std::setw(10) << latencySink.takeMaxLatencyMs() << " ms max latency"
+                  << std::setw(8) << newAllocations-allocations << " allocations"
+                  << std::setw(6) << recording.getFilesNum() << " files"
+                  << std::setw(6) << stats.droppedPackets << " dropped" << std::endl;
+        allocations = newAllocations;
+    }
+    acquisition.stop();
+    broadcast.stop();
+
+    unsigned int filesNum = recording.getFilesNum();
+    if (!recording.close()) {
+        std::cout << "  failed to write the files" << std::endl;
+    }
+    for (unsigned int fileIdx = 0; fileIdx < filesNum; fileIdx++) {
+        remove(recording.getPath(fileIdx).c_str());
+        for (unsigned int levelIdx = 0; levelIdx < PYRAMID_LEVELS; levelIdx++) {
+            remove(pyramidLevelPath(recording.getPath(fileIdx), levelIdx+1).c_str());
+        }
+    }
+}
+
+/*! \struct SweepWriter_t
+ * \brief Storage backend of a case of the sweep benchmark.
+ */
+typedef struct {
+    const char * name; /*!< Name in the results. */
+    DataWriterMode_t mode; /*!< File access mode. */
+    RecordingEncoding_t encoding; /*!< Encoding of the chunks. */
+} SweepWriter_t;
+
+/*! \class StoringSink
+ * \brief #AcquisitionSink that writes the blocks in a recording and measures, for each block, the time from the generation
+ * of its last data packet by a #SyntheticPacketSource created at a given time to the return of RecordingWriter::write.
+ * The writer only blocks when its background thread cannot keep up, so the latency includes the storage backpressure.
+ */
+class StoringSink : public AcquisitionSink {
+public:
+    StoringSink(RecordingWriter &recording, std::chrono::steady_clock::time_point sourceStart, double packetRate, size_t maxBlocksNum) :
+        recording(recording),
+        sourceStart(sourceStart),
+        packetRate(packetRate) {
+        latencies.reserve(maxBlocksNum);
+    }
+
+    void consumePackets(const float * packets, unsigned int packetsNum) {
+        recording.write(packets, packetsNum);
+    }
+
+    void consumeBlock(PacketBlock * block) {
+        recording.write(block->getPackets(), block->getPacketsNum());
+        double generatedSeconds = (double)(block->getFirstPacket()+block->getPacketsNum())/packetRate;
+        double seconds = std::chrono::duration <double> (std::chrono::steady_clock::now()-sourceStart).count();
+        if (latencies.size() < latencies.capacity()) {
+            latencies.push_back(seconds > generatedSeconds ? seconds-generatedSeconds : 0.0);
+        }
+    }
+
+    /*! \brief Returns a percentile of the latencies [ms]; sorts them on the first call after the acquisition.
+     */
+    double percentileMs(double fraction) {
+        if (latencies.empty()) {
+            return 0.0;
+        }
+        std::sort(latencies.begin(), latencies.end());
+        size_t latencyIdx = (size_t)std::ceil(fraction*latencies.size());
+        return 1.0e3*latencies[latencyIdx > 0 ? latencyIdx-1 : 0];
+    }
+
+private:
+    RecordingWriter &recording;
+    std::chrono::steady_clock::time_point sourceStart;
+    double packetRate;
+    std::vector <double> latencies; /*!< Latency of each block [s]. */
+};
+
+/*! \fn benchmarkSweep
+ * \brief Acquires from a #SyntheticPacketSource and stores in a recording, for every sampling rate, a few read batch sizes
+ * and the storage backends, and reports for each case the sustained packet rate, the percentiles of the latency from the
+ * generation of the data packets to the recording, the CPU time per data packet of the whole process and the data packets
+ * dropped or lost. The results are also written to #BENCHMARK_SWEEP_RESULTS.
+ * Batches that take more than a quarter of the case to fill are skipped.
+ */
+static void benchmarkSweep() {
+    const unsigned int batches[] = {0, 64, 1024, 16384}; /*!< 0 stands for the adaptive #ReadController. */
+    const SweepWriter_t writers[] = {
+        {"float32", DataWriterBuffered, RecordingEncodingFloat32},
+        {"float32-direct", DataWriterDirect, RecordingEncodingFloat32},
+        {"packed", DataWriterBuffered, RecordingEncodingPacked}
+    };
+
+    FILE * results = fopen(BENCHMARK_SWEEP_RESULTS, "w");
+    if (results != NULL) {
+        fprintf(results, "sampling_rate_hz,batch,writer,seconds,packets,packets_per_s,latency_p50_ms,latency_p90_ms,"
+                "latency_p99_ms,latency_max_ms,cpu_ns_per_packet,dropped,lost,overflows\n");
+    }
+
+    std::cout << "sweep: " << BENCHMARK_SWEEP_SECONDS << " s of acquisition and storage per case, results in " << BENCHMARK_SWEEP_RESULTS << std::endl;
+    std::cout << "  " << std::left << std::setw(36) << "rate, batch, writer" << std::right
+              << std::setw(12) << "packets/s" << std::setw(9) << "p50 ms" << std::setw(9) << "p90 ms" << std::setw(9) << "p99 ms"
+              << std::setw(9) << "max ms" << std::setw(10) << "ns/packet" << std::setw(9) << "dropped" << std::setw(9) << "lost" << std::endl;
+    for (unsigned int rateId = EDL_RADIO_SAMPLING_RATE_1_25_KHZ; rateId <= EDL_RADIO_SAMPLING_RATE_200_KHZ; rateId++) {
+        double samplingRate = edlSamplingRateHz(rateId);
+        for (unsigned int batchIdx = 0; batchIdx < sizeof(batches)/sizeof(batches[0]); batchIdx++) {
+            if (batches[batchIdx]/samplingRate > 0.25*BENCHMARK_SWEEP_SECONDS) {
+                continue;
+            }
+
+            ReadControllerConfig_t readConfig = readControllerDefaultConfig();
+            if (batches[batchIdx] > 0) {
+                readConfig.minPackets = batches[batchIdx];
+                readConfig.maxPackets = batches[batchIdx];
+            }
+
+            for (unsigned int writerIdx = 0; writerIdx < sizeof(writers)/sizeof(writers[0]); writerIdx++) {
+                RecordingHeader_t header;
+                recordingHeaderInit(header, rateId, EDL_RADIO_RANGE_200_PA, EDL_RADIO_FINAL_BANDWIDTH_SR_2);
+                RecordingWriter recording;
+                if (!recording.open(BENCHMARK_FILE, header, writers[writerIdx].mode, writers[writerIdx].encoding)) {
+                    std::cout << "  failed to open " << BENCHMARK_FILE << std::endl;
+                    continue;
+                }
+
+                std::chrono::steady_clock::time_point sourceStart = std::chrono::steady_clock::now();
+                SyntheticPacketSource source(samplingRate);
+                Acquisition acquisition(source);
+                acquisition.setReadController(readConfig, samplingRate);
+                StoringSink sink(recording, sourceStart, samplingRate, (size_t)(2.0*samplingRate*BENCHMARK_SWEEP_SECONDS)+1024);
+                acquisition.addSink(&sink);
+
+                Stopwatch stopwatch;
+                acquisition.start();
+                std::this_thread::sleep_for(std::chrono::seconds(BENCHMARK_SWEEP_SECONDS));
+                acquisition.stop();
+                double wall = stopwatch.wallSeconds();
+                double cpu = stopwatch.cpuSeconds();
+                recording.close();
+                AcquisitionStats_t stats = acquisition.getStats();
+
+                double packetsRate = stats.consumedPackets/wall;
+                double cpuNs = stats.consumedPackets > 0 ? 1.0e9*cpu/stats.consumedPackets : 0.0;
+                double p50 = sink.percentileMs(0.5);
+                double p90 = sink.percentileMs(0.9);
+                double p99 = sink.percentileMs(0.99);
+                double pMax = sink.percentileMs(1.0);
+                std::string batch = batches[batchIdx] > 0 ? std::to_string(batches[batchIdx]) : std::string("adaptive");
+                std::string label = std::to_string((int)samplingRate)+" Hz, "+batch+", "+writers[writerIdx].name;
+                std::cout << "  " << std::left << std::setw(36) << label << std::right << std::fixed << std::setprecision(1)
+                          << std::setw(12) << packetsRate << std::setprecision(2)
+                          << std::setw(9) << p50 << std::setw(9) << p90 << std::setw(9) << p99 << std::setw(9) << pMax
+                          << std::setprecision(0) << std::setw(10) << cpuNs
+                          << std::setw(9) << stats.droppedPackets << std::setw(9) << stats.lostPackets << std::endl;
+
+                if (results != NULL) {
+                    fprintf(results, "%.0f,%s,%s,%.3f,%llu,%.1f,%.3f,%.3f,%.3f,%.3f,%.1f,%llu,%llu,%u\n", samplingRate, batch.c_str(),
+                            writers[writerIdx].name, wall, stats.consumedPackets, packetsRate, p50, p90, p99, pMax, cpuNs,
+                            stats.droppedPackets, stats.lostPackets, stats.bufferOverflows);
+                }
+            }
+        }
+    }
+
+    if (results != NULL) {
+        fclose(results);
+    }
+    remove(BENCHMARK_FILE);
+}
+
+/*! \fn benchmarkInstrumentation
+ * \brief Measures the cost of a probe of an #Instrumentation, then counts the probes recorded by an acquisition at 200kHz
+ * and reports the fraction of a core they take. The probes are recorded once per status check, read or block,
+ * so the overhead depends on the read rate, not on the packet rate.
+ */
+static void benchmarkInstrumentation() {
+    Instrumentation instrumentation;
+    HistogramSummary_t summary;
+    Stopwatch stopwatch;
+    uint64_t probeNs = instrumentationNow();
+    for (unsigned int recordIdx = 0; recordIdx < BENCHMARK_PROBE_RECORDS; recordIdx++) {
+        probeNs = instrumentation.record(ProbeRead, probeNs, 1);
+    }
+    double probeSeconds = stopwatch.wallSeconds()/BENCHMARK_PROBE_RECORDS;
+    instrumentation.drain(ProbeRead, summary);
+    std::cout << "instrumentation: " << std::fixed << std::setprecision(1) << probeSeconds*1.0e9 << " ns per probe, "
+              << "back to back probes p50 " << std::setprecision(3) << summary.p50Us << " us, p99.9 " << summary.p999Us << " us" << std::endl;
+
+    double samplingRate = edlSamplingRateHz(EDL_RADIO_SAMPLING_RATE_200_KHZ);
+    LatencySink sink(std::chrono::steady_clock::now(), samplingRate);
+    SyntheticPacketSource source(samplingRate);
+    Acquisition acquisition(source);
+    acquisition.setReadController(readControllerDefaultConfig(), samplingRate);
+    acquisition.addSink(&sink);
+    acquisition.start();
+    std::this_thread::sleep_for(std::chrono::seconds(BENCHMARK_READS_SECONDS));
+    acquisition.stop();
+
+    unsigned long long probesNum = 0;
+    for (int probe = 0; probe < ProbesNum; probe++) {
+        acquisition.getInstrumentation().drain((InstrumentationProbe_t)probe, summary);
+        probesNum += summary.count;
+        if (summary.count > 0) {
+            std::cout << "  " << std::left << std::setw(8) << instrumentationProbeName((InstrumentationProbe_t)probe) << std::right
+                      << std::setw(8) << summary.count << " calls, p50 " << std::setprecision(3) << summary.p50Us
+                      << " us, p99 " << summary.p99Us << " us, max " << summary.maxUs << " us" << std::endl;
+        }
+    }
+    double probesRate = probesNum/(double)BENCHMARK_READS_SECONDS;
+    std::cout << "  " << std::setprecision(0) << probesRate << " probes/s at 200kHz: " << std::setprecision(4)
+              << 100.0*probesRate*probeSeconds << "% of a core" << std::endl;
+}
+
+/*! \fn benchmarkWakeup
+ * \brief Compares how a consumer thread waits for data: polling every millisecond, as the consumer thread of the
+ * acquisition did, or blocking on a #Notifier. Reports the CPU used while no data arrive and the latency from the
+ * publication of data at irregular intervals of 1 to 3 ms to the wakeup of the consumer.
+ */
+static void benchmarkWakeup() {
+    const char * labels[2] = {"polling every 1 ms", "notifier"};
+    std::cout << "wakeup: " << BENCHMARK_IDLE_SECONDS << " s idle, then " << BENCHMARK_WAKEUPS << " signals" << std::endl;
+    for (int notified = 0; notified < 2; notified++) {
+        Notifier notifier;
+        std::atomic <uint64_t> publishedNs(0); /*!< Time of the pending publication, 0 if none. */
+        std::atomic <bool> running(true);
+        LatencyHistogram latencies;
+        std::thread consumer([&notifier, &publishedNs, &running, &latencies, notified]() {
+            for (;;) {
+                uint64_t ticket = notifier.prepare();
+                bool stillRunning = running;
+                uint64_t ns = publishedNs.exchange(0);
+                if (ns != 0) {
+                    latencies.record(instrumentationNow()-ns);
+
+                } else if (!stillRunning) {
+                    break;
+
+                } else if (notified) {
+                    notifier.wait(ticket, std::chrono::milliseconds(ACQUISITION_CONSUMER_MAX_WAIT_MS));
+
+                } else {
+                    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                }
+            }
+        });
+
+        Stopwatch idle;
+        std::this_thread::sleep_for(std::chrono::seconds(BENCHMARK_IDLE_SECONDS));
+        double idleCpu = idle.cpuSeconds()/idle.wallSeconds();
+
+        for (unsigned int wakeupIdx = 0; wakeupIdx < BENCHMARK_WAKEUPS; wakeupIdx++) {
+            std::this_thread::sleep_for(std::chrono::microseconds(1000+(wakeupIdx*997)%2000));
+            publishedNs = instrumentationNow();
+            notifier.notify();
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        running = false;
+        notifier.notify();
+        consumer.join();
+
+        HistogramSummary_t summary;
+        latencies.drain(summary);
+        std::cout << "  " << std::left << std::setw(20) << labels[notified] << std::right << std::fixed << std::setprecision(3)
+                  << "idle CPU " << 100.0*idleCpu << "%, wakeup latency p50 " << summary.p50Us << " us, p99 "
+                  << summary.p99Us << " us, max " << summary.maxUs << " us (" << summary.count << " wakeups)" << std::endl;
+    }
+}
+
+static const Benchmark_t benchmarks[] = {
+    {"writer", benchmarkWriter},
+    {"detector", benchmarkDetector},
+    {"deinterleave", benchmarkDeinterleave},
+    {"compression", benchmarkCompression},
+    {"reader", benchmarkReader},
+    {"pyramid", benchmarkPyramid},
+    {"reads", benchmarkReads},
+    {"allocations", benchmarkAllocations},
+    {"fanout", benchmarkFanout},
+    {"filter", benchmarkFilter},
+    {"decimator", benchmarkDecimator},
+    {"statistics", benchmarkStatistics},
+    {"reprocessing", benchmarkReprocessing},
+    {"soak", benchmarkSoak},
+    {"sweep", benchmarkSweep},
+    {"instrumentation", benchmarkInstrumentation},
+    {"wakeup", benchmarkWakeup}
+};
+
+/*! \fn main
+ * \brief Runs the benchmarks selected on the command line, or all of them.
+ */
+int main(int argc, char ** argv) {
+    unsigned int benchmarksNum = sizeof(benchmarks)/sizeof(benchmarks[0]);
+    bool allSelected = true;
+    for (int argIdx = 1; argIdx < argc; argIdx++) {
+        bool isName = false;
+        for (unsigned int benchmarkIdx = 0; benchmarkIdx < benchmarksNum; benchmarkIdx++) {
+            isName = isName || strcmp(argv[argIdx], benchmarks[benchmarkIdx].name) == 0;
+        }
+
+        if (isName) {
+            allSelected = false;
+
+        } else {
+            traces.push_back(argv[argIdx]);
+        }
+    }
+
+    for (unsigned int benchmarkIdx = 0; benchmarkIdx < benchmarksNum; benchmarkIdx++) {
+        bool selected = allSelected;
+        for (int argIdx = 1; argIdx < argc; argIdx++) {
+            selected = selected || strcmp(argv[argIdx], benchmarks[benchmarkIdx].name) == 0;
+        }
+
+        if (selected) {
+            benchmarks[benchmarkIdx].run();
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,232 @@
+/*! \file broadcast.cpp
+ * \brief Defines class Broadcast.
+ */
+#include "broadcast.h"
+
+#include <chrono>
+#include <cstring>
+
+/*! \class Subscriber
+ * \brief Queue of blocks and thread that hands them to the sink of a subscriber.
+ * The queue is a preallocated circular array, so queuing never allocates.
+ */
+class Subscriber {
+public:
+    Subscriber(AcquisitionSink * sink, const SubscriberConfig_t &config) :
+        sink(sink),
+        config(config),
+        queue(config.queueBlocks > 0 ? config.queueBlocks : 1),
+        headIdx(0),
+        queuedNum(0),
+        decimationIdx(0),
+        running(false),
+        consumedPackets(0),
+        droppedPackets(0),
+        decimatedPackets(0),
+        stalls(0),
+        maxQueuedBlocks(0) {
+        if (this->config.decimation == 0) {
+            this->config.decimation = 1;
+        }
+    }
+
+    void start() {
+        running = true;
+        thread = std::thread(&Subscriber::loop, this);
+    }
+
+    void stop() {
+        {
+            std::lock_guard <std::mutex> lock(mutex);
+            running = false;
+        }
+        notEmpty.notify_one();
+        if (thread.joinable()) {
+            thread.join();
+        }
+    }
+
+    /*! Queues a reference to the block, applying the policy if the queue is full. */
+    void push(PacketBlock * block) {
+        std::unique_lock <std::mutex> lock(mutex);
+        unsigned int capacity = (unsigned int)queue.size();
+        if (config.policy == BackpressureDecimate && queuedNum >= (capacity+1)/2) {
+            /*! Keep one block out of SubscriberConfig_t::decimation, and none if the queue is full. */
+            bool keep = decimationIdx == 0 && queuedNum < capacity;
+            decimationIdx = (decimationIdx+1)%config.decimation;
+            if (!keep) {
+                decimatedPackets += block->getPacketsNum();
+                return;
+            }
+
+        } else {
+            decimationIdx = 0;
+        }
+
+        if (queuedNum == capacity) {
+            if (config.policy == BackpressureDropOldest) {
+                PacketBlock * oldest = queue[headIdx];
+                headIdx = (headIdx+1)%capacity;
+                queuedNum--;
+                droppedPackets += oldest->getPacketsNum();
+                oldest->release();
+
+            } else {
+                stalls++;
+                notFull.wait(lock, [this, capacity] { return queuedNum < capacity; });
+            }
+        }
+
+        block->addRef();
+        queue[(headIdx+queuedNum)%capacity] = block;
+        queuedNum++;
+        if (queuedNum > maxQueuedBlocks) {
+            maxQueuedBlocks = queuedNum;
+        }
+        lock.unlock();
+        notEmpty.notify_one();
+    }
+
+    SubscriberStats_t getStats() const {
+        SubscriberStats_t stats;
+        stats.consumedPackets = consumedPackets;
+        stats.droppedPackets = droppedPackets;
+        stats.decimatedPackets = decimatedPackets;
+        stats.stalls = stalls;
+        stats.maxQueuedBlocks = maxQueuedBlocks;
+        return stats;
+    }
+
+private:
+    /*! Hands the queued blocks to the sink until stopped and the queue is empty. */
+    void loop() {
+        unsigned int capacity = (unsigned int)queue.size();
+        uint64_t nextPacket = 0;
+        for (;;) {
+            PacketBlock * block;
+            {
+                std::unique_lock <std::mutex> lock(mutex);
+                notEmpty.wait(lock, [this] { return queuedNum > 0 || !running; });
+                if (queuedNum == 0) {
+                    break;
+                }
+                block = queue[headIdx];
+                headIdx = (headIdx+1)%capacity;
+                queuedNum--;
+            }
+            notFull.notify_one();
+
+            /*! The sink is told about the blocks missing because of the policy as about those missing from the acquisition. */
+            deliverBlock(sink, block, nextPacket);
+            consumedPackets += block->getPacketsNum();
+            block->release();
+        }
+    }
+
+    AcquisitionSink * sink;
+    SubscriberConfig_t config;
+    std::vector <PacketBlock *> queue;
+    unsigned int headIdx; /*!< Index in \a queue of the oldest queued block. */
+    unsigned int queuedNum;
+    unsigned int decimationIdx; /*!< Blocks discarded since the last one kept by #BackpressureDecimate. */
+    bool running;
+    std::mutex mutex;
+    std::condition_variable notEmpty;
+    std::condition_variable notFull;
+    std::thread thread;
+
+    std::atomic <unsigned long long> consumedPackets;
+    std::atomic <unsigned long long> droppedPackets;
+    std::atomic <unsigned long long> decimatedPackets;
+    std::atomic <unsigned long long> stalls;
+    std::atomic <unsigned int> maxQueuedBlocks;
+};
+
+SubscriberConfig_t subscriberDefaultConfig(BackpressurePolicy_t policy) {
+    SubscriberConfig_t config;
+    config.policy = policy;
+    config.queueBlocks = BROADCAST_QUEUE_BLOCKS;
+    config.decimation = 4;
+    return config;
+}
+
+Broadcast::Broadcast() :
+    copyPool(BROADCAST_COPY_BLOCKS, ACQUISITION_BLOCK_PACKETS),
+    started(false),
+    nextPacket(0) {
+}
+
+Broadcast::~Broadcast() {
+    stop();
+    for (size_t subscriberIdx = 0; subscriberIdx < subscribers.size(); subscriberIdx++) {
+        delete subscribers[subscriberIdx];
+    }
+}
+
+unsigned int Broadcast::subscribe(AcquisitionSink * sink, const SubscriberConfig_t &config) {
+    subscribers.push_back(new Subscriber(sink, config));
+    return (unsigned int)subscribers.size()-1;
+}
+
+bool Broadcast::start() {
+    if (started) {
+        return false;
+    }
+
+    for (size_t subscriberIdx = 0; subscriberIdx < subscribers.size(); subscriberIdx++) {
+        subscribers[subscriberIdx]->start();
+    }
+    started = true;
+    return true;
+}
+
+void Broadcast::stop() {
+    if (!started) {
+        return;
+    }
+
+    for (size_t subscriberIdx = 0; subscriberIdx < subscribers.size(); subscriberIdx++) {
+        subscribers[subscriberIdx]->stop();
+    }
+    started = false;
+}
+
+unsigned int Broadcast::getSubscribersNum() const {
+    return (unsigned int)subscribers.size();
+}
+
+SubscriberStats_t Broadcast::getStats(unsigned int subscriberIdx) const {
+    return subscribers[subscriberIdx]->getStats();
+}
+
+void Broadcast::consumePackets(const float * packets, unsigned int packetsNum) {
+    while (packetsNum > 0) {
+        PacketBlock * block = copyPool.acquire();
+        if (block == NULL) {
+            /*! The subscribers release the blocks as they consume them. */
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            continue;
+        }
+
+        unsigned int blockNum = packetsNum < block->getCapacity() ? packetsNum : block->getCapacity();
+        std::memcpy(block->getPackets(), packets, (size_t)blockNum*EDL_CHANNEL_NUM*sizeof(float));
+        block->setPacketsNum(blockNum);
+        block->setFirstPacket(nextPacket);
+        consumeBlock(block);
+        block->release();
+
+        packets += (size_t)blockNum*EDL_CHANNEL_NUM;
+        packetsNum -= blockNum;
+    }
+}
+
+void Broadcast::consumeGap(uint64_t firstPacket, unsigned long long packetsNum) {
+    nextPacket = firstPacket+packetsNum;
+}
+
+void Broadcast::consumeBlock(PacketBlock * block) {
+    for (size_t subscriberIdx = 0; subscriberIdx < subscribers.size(); subscriberIdx++) {
+        subscribers[subscriberIdx]->push(block);
+    }
+    nextPacket = block->getFirstPacket()+block->getPacketsNum();
+}
@@ -0,0 +1,134 @@
+/*! \file broadcast.h
+ * \brief Declares class Broadcast, which feeds the blocks of one acquisition to several consumers running at their own pace.
+ */
+#ifndef BROADCAST_H
+#define BROADCAST_H
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "acquisition.h"
+#include "packet_pool.h"
+
+/*! \def BROADCAST_QUEUE_BLOCKS
+ * \brief Default number of blocks queued for each subscriber: at about 5 ms per block, 1 second of data.
+ */
+#define BROADCAST_QUEUE_BLOCKS 200
+
+/*! \def BROADCAST_COPY_BLOCKS
+ * \brief Blocks of the pool used for the data packets not handed over in blocks, see Broadcast::consumePackets.
+ */
+#define BROADCAST_COPY_BLOCKS 8
+
+/*! \enum BackpressurePolicy_t
+ * \brief What happens to the new blocks when the queue of a subscriber is full.
+ */
+typedef enum {
+    BackpressureBlock, /*!< Wait for room in the queue: no data packet is lost, but a slow subscriber delays all of the others
+                         * and eventually the acquisition, which then drops data packets, see AcquisitionStats_t::droppedPackets. */
+    BackpressureDropOldest, /*!< Discard the oldest queued block: the subscriber sees the most recent data, e.g. a live viewer. */
+    BackpressureDecimate /*!< Once the queue is half full, queue one block out of SubscriberConfig_t::decimation
+                           * and discard the others, and discard all of the new blocks while it is full:
+                           * the subscriber sees evenly spaced data, e.g. a statistics monitor. */
+} BackpressurePolicy_t;
+
+/*! \struct SubscriberConfig_t
+ * \brief Parameters of a subscriber of a #Broadcast.
+ */
+typedef struct {
+    BackpressurePolicy_t policy; /*!< What happens when the queue is full. */
+    unsigned int queueBlocks; /*!< Capacity of the queue [blocks]. */
+    unsigned int decimation; /*!< Blocks kept one out of this many by #BackpressureDecimate. */
+} SubscriberConfig_t;
+
+/*! \fn subscriberDefaultConfig
+ * \brief Returns the parameters of a subscriber with a given policy, a queue of #BROADCAST_QUEUE_BLOCKS and a decimation by 4.
+ */
+SubscriberConfig_t subscriberDefaultConfig(BackpressurePolicy_t policy = BackpressureBlock);
+
+/*! \struct SubscriberStats_t
+ * \brief Counters of a subscriber of a #Broadcast.
+ */
+typedef struct {
+    unsigned long long consumedPackets; /*!< Data packets handed to the sink. */
+    unsigned long long droppedPackets; /*!< Data packets discarded by #BackpressureDropOldest. */
+    unsigned long long decimatedPackets; /*!< Data packets discarded by #BackpressureDecimate. */
+    unsigned long long stalls; /*!< Blocks that had to wait for room in the queue with #BackpressureBlock. */
+    unsigned int maxQueuedBlocks; /*!< Highest number of blocks in the queue. */
+} SubscriberStats_t;
+
+class Subscriber;
+
+/*! \class Broadcast
+ * \brief #AcquisitionSink that hands each block to several subscribers, each running its own sink on its own thread.
+ * The blocks are shared, not copied: every subscriber queue holds a reference to them, so each sample is stored once
+ * however many subscribers there are. Each subscriber has its own queue and #BackpressurePolicy_t, so a slow subscriber
+ * only affects the others if its policy is #BackpressureBlock.
+ * Subscribers see the blocks in order; with the lossy policies some may be missing, which PacketBlock::getFirstPacket reveals
+ * and AcquisitionSink::consumeGap reports.
+ */
+class Broadcast : public AcquisitionSink {
+public:
+    /*! \brief Broadcast constructor.
+     */
+    Broadcast();
+
+    /*! \brief Broadcast destructor. Stops the subscribers if still running.
+     */
+    ~Broadcast();
+
+    /*! \brief Adds a subscriber. Must be called before #start.
+     *
+     * \param sink [in] Sink run on the thread of the subscriber; it must outlive this object.
+     * \param config [in] Parameters of the subscriber.
+     * \return Index of the subscriber, for #getStats.
+     */
+    unsigned int subscribe(AcquisitionSink * sink, const SubscriberConfig_t &config = subscriberDefaultConfig());
+
+    /*! \brief Starts the threads of the subscribers.
+     *
+     * \return False if already started.
+     */
+    bool start();
+
+    /*! \brief Waits for the subscribers to consume their queues and stops their threads.
+     * Call after the acquisition has stopped and before it is destroyed, as the queues hold references to its blocks.
+     */
+    void stop();
+
+    /*! \brief Returns the number of subscribers.
+     */
+    unsigned int getSubscribersNum() const;
+
+    /*! \brief Returns a snapshot of the counters of a subscriber.
+     */
+    SubscriberStats_t getStats(unsigned int subscriberIdx) const;
+
+    /*! \brief Copies data packets not handed over in a block into blocks of an internal pool and broadcasts them,
+     * numbered after the last block received. Waits for a block of the pool to be free if necessary.
+     */
+    void consumePackets(const float * packets, unsigned int packetsNum);
+
+    /*! \brief Queues a reference to the block for every subscriber.
+     */
+    void consumeBlock(PacketBlock * block);
+
+    /*! \brief Numbers the next data packets not handed over in blocks after the missing ones. The subscribers are told
+     * about the missing data packets when their next block arrives, see #deliverBlock.
+     */
+    void consumeGap(uint64_t firstPacket, unsigned long long packetsNum);
+
+private:
+    Broadcast(const Broadcast &);
+    Broadcast &operator=(const Broadcast &);
+
+    PacketPool copyPool;
+    std::vector <Subscriber *> subscribers;
+    bool started;
+    uint64_t nextPacket; /*!< Index of the data packet following the last one received. */
+};
+
+#endif // BROADCAST_H
@@ -1,269 +1,896 @@
 /*! \file caller.cpp
- * \brief Sample program to connect to an e4 device, set a working configuration and read some data.
+ * \brief Sample program to connect to all of the plugged in e4 devices, set a working configuration and read some data.
  */
 #include <iostream>
-#include "windows.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <csignal>
+#include <chrono>
+#include <thread>
+#include <functional>
+#include <vector>
+#include <string>
 #include "edl.h"
+#include "acquisition.h"
+#include "device_manager.h"
+#include "broadcast.h"
+#include "recording_writer.h"
+#include "recording_rotation.h"
+#include "edl_settings.h"
+#include "command_transaction.h"
+#include "offset_compensation.h"
+#include "protocol_scheduler.h"
+#include "event_detector.h"
+#include "channel_statistics.h"
+#include "lowpass_filter.h"
+#include "decimator.h"
+#include "deinterleave.h"
+#include "metrics_export.h"
+
+/*! \def ACQUISITION_DURATION_MS
+ * \brief Default duration of the data collection in ms.
+ */
+#define ACQUISITION_DURATION_MS 1000
+
+/*! \def PROGRESS_INTERVAL_MS
+ * \brief Interval between the progress reports of long data collections in ms.
+ */
+#define PROGRESS_INTERVAL_MS 10000
+
+/*! \def SAMPLING_RATE_RADIO_ID
+ * \brief Sampling rate set by #configureWorkingModality.
+ */
+#define SAMPLING_RATE_RADIO_ID EDL_RADIO_SAMPLING_RATE_5_KHZ
+
+/*! \def RANGE_RADIO_ID
+ * \brief Current range set by #configureWorkingModality.
+ */
+#define RANGE_RADIO_ID EDL_RADIO_RANGE_200_PA
+
+/*! \def FINAL_BANDWIDTH_RADIO_ID
+ * \brief Final bandwidth set by #configureWorkingModality.
+ */
+#define FINAL_BANDWIDTH_RADIO_ID EDL_RADIO_FINAL_BANDWIDTH_SR_2
+
+/*! \def RECORDING_ENCODING
+ * \brief Encoding of the chunks of data.edr: #RecordingEncodingPacked compresses the data losslessly.
+ */
+#define RECORDING_ENCODING RecordingEncodingPacked
+
+/*! \struct RunConfig_t
+ * \brief When the data collection stops and how the recordings are split, set from the command line by #parseArguments.
+ * The data collection stops at the first limit reached, or when the program is interrupted (Ctrl+C).
+ */
+typedef struct {
+    double durationSeconds; /*!< Duration of the data collection [s]; 0 for no limit. */
+    unsigned long long packetsNum; /*!< Data packets to collect from each device, at least; 0 for no limit. */
+    RotationConfig_t rotation; /*!< When a new recording file is started. */
+    std::string metricsPath; /*!< File or unix:<socket path> the metrics are exported to, see #MetricsExporter; empty for none. */
+    std::string protocolPath; /*!< Sequence file of the protocols applied during the data collection, see #ProtocolSequence;
+                                * empty for the triangular protocol alone. */
+} RunConfig_t;
+
+/*! \def EVENTS_FILTER_TYPE
+ * \brief Response of the low pass filter applied to the current channels before the event detection.
+ */
+#define EVENTS_FILTER_TYPE LowPassBessel
 
-/*! \def MINIMUM_DATA_PACKETS_TO_READ
- * \brief Minimum number of available data packets to perform a read.
- * May be increased in case of frequent data loss due to buffer overflow:
- * #EdlDeviceStatus_t::bufferOverflowFlag set true.
+/*! \def EVENTS_FILTER_ORDER
+ * \brief Order of the low pass filter applied to the current channels before the event detection.
  */
-#define MINIMUM_DATA_PACKETS_TO_READ 10
+#define EVENTS_FILTER_ORDER 4
+
+/*! \def EVENTS_FILTER_CUTOFF_RATIO
+ * \brief Cut-off of the low pass filter applied to the current channels before the event detection, relative to the sampling rate.
+ * The recording is not filtered.
+ */
+#define EVENTS_FILTER_CUTOFF_RATIO 0.2
+
+/*! \def SECONDARY_DECIMATION_FACTOR
+ * \brief Decimation factor of the secondary recording data_<device ID>_dec<factor>.edr, written alongside the full rate one
+ * for quick inspection of long experiments; 0 disables it.
+ */
+#define SECONDARY_DECIMATION_FACTOR 10
+
+/*! \def STATISTICS_PSD_UPDATES
+ * \brief The power spectral density of the current channels is written on psd_<device ID>.txt every this many updates of the
+ * statistics, see #channelStatisticsDefaultConfig; the other statistics are written on stats_<device ID>.txt at every update.
+ */
+#define STATISTICS_PSD_UPDATES 10
+
+/*! \def TRIANGULAR_VHOLD_MV
+ * \brief Holding voltage of the triangular protocol applied by #loadProtocolSequence without a sequence file [mV].
+ */
+#define TRIANGULAR_VHOLD_MV 0.0
+
+/*! \def TRIANGULAR_VAMP_MV
+ * \brief Amplitude of the triangular protocol applied by #loadProtocolSequence without a sequence file [mV].
+ */
+#define TRIANGULAR_VAMP_MV 50.0
+
+/*! \def TRIANGULAR_TPERIOD_MS
+ * \brief Period of the triangular protocol applied by #loadProtocolSequence without a sequence file [ms].
+ */
+#define TRIANGULAR_TPERIOD_MS 100.0
+
+/*! Set by #onInterrupt when the program is interrupted. */
+volatile std::sig_atomic_t interrupted = 0;
+
+/*! \fn onInterrupt
+ * \brief Signal handler that asks the data collection to stop, so that the recordings are closed properly.
+ */
+void onInterrupt(int signalNum) {
+    (void)signalNum;
+    interrupted = 1;
+}
+
+/*! \fn parseArguments
+ * \brief Reads the #RunConfig_t from the command line:
+ * caller [-d seconds] [-n packets] [-r rotation seconds] [-s rotation MB] [-m metrics file or unix:socket path]
+ * [-p protocol sequence file].
+ * A value of 0 removes a limit, so with -d 0 the data collection goes on until the program is interrupted.
+ * Without -d the data collection lasts #ACQUISITION_DURATION_MS, or has no duration limit if -n is given.
+ *
+ * \return False on an unknown option or an invalid value.
+ */
+bool parseArguments(int argc, char ** argv, RunConfig_t &run) {
+    run.durationSeconds = 0.0;
+    run.packetsNum = 0;
+    run.rotation = rotationDefaultConfig();
+    bool durationSet = false;
+    for (int argIdx = 1; argIdx < argc; argIdx += 2) {
+        if (argIdx+1 >= argc) {
+            return false;
+        }
+
+        if (strcmp(argv[argIdx], "-m") == 0) {
+            run.metricsPath = argv[argIdx+1];
+            continue;
+        }
+
+        if (strcmp(argv[argIdx], "-p") == 0) {
+            run.protocolPath = argv[argIdx+1];
+            continue;
+        }
+
+        char * end;
+        double value = strtod(argv[argIdx+1], &end);
+        if (*end != '\0' || !(value >= 0.0)) {
+            return false;
+        }
+
+        if (strcmp(argv[argIdx], "-d") == 0) {
+            run.durationSeconds = value;
+            durationSet = true;
+
+        } else if (strcmp(argv[argIdx], "-n") == 0) {
+            run.packetsNum = (unsigned long long)value;
+
+        } else if (strcmp(argv[argIdx], "-r") == 0) {
+            run.rotation.maxSeconds = value;
+
+        } else if (strcmp(argv[argIdx], "-s") == 0) {
+            run.rotation.maxBytes = (unsigned long long)(value*1.0e6);
+
+        } else {
+            return false;
+        }
+    }
+
+    if (!durationSet && run.packetsNum == 0) {
+        run.durationSeconds = ACQUISITION_DURATION_MS*1.0e-3;
+    }
+    return true;
+}
 
 /*! \fn configureWorkingModality
  * \brief Configure sampling rate, current range and bandwidth.
+ * The commands are only collected: they are sent with the next commit of the transaction.
  */
-void configureWorkingModality(EDL edl) {
-	/*! Declare an #EdlCommandStruct_t to be used as configuration for the commands. */
-    EdlCommandStruct_t commandStruct;
+void configureWorkingModality(CommandTransaction &transaction) {
+    /*! Set the sampling rate to 5kHz. */
+    transaction.setRadio(EdlCommandSamplingRate, SAMPLING_RATE_RADIO_ID);
 
-	/*! Set the sampling rate to 5kHz. Stack the command (do not apply). */
-    commandStruct.radioId = EDL_RADIO_SAMPLING_RATE_5_KHZ;
-    edl.setCommand(EdlCommandSamplingRate, commandStruct, false);
+    /*! Set the current range to 200pA. */
+    transaction.setRadio(EdlCommandRange, RANGE_RADIO_ID);
 
-	/*! Set the current range to 200pA. Stack the command (do not apply). */
-    commandStruct.radioId = EDL_RADIO_RANGE_200_PA;
-    edl.setCommand(EdlCommandRange, commandStruct, false);
+    /*! Disable current filters (final bandwidth equal to half sampling rate). */
+    transaction.setRadio(EdlCommandFinalBandwidth, FINAL_BANDWIDTH_RADIO_ID);
+}
 
-	/*! Disable current filters (final bandwidth equal to half sampling rate). Apply all of the stacked commands. */
-    commandStruct.radioId = EDL_RADIO_FINAL_BANDWIDTH_SR_2;
-    edl.setCommand(EdlCommandFinalBandwidth, commandStruct, true);
+/*! \fn commitCommands
+ * \brief Sends the commands of a transaction, printing why if they are invalid or cannot be sent.
+ *
+ * \return #EdlErrorCode_t Error code.
+ */
+EdlErrorCode_t commitCommands(CommandTransaction &transaction, const char * step) {
+    EdlErrorCode_t res = transaction.commit();
+    if (res != EdlSuccess) {
+        std::cout << step << " failed (error " << res << ")";
+        if (!transaction.getViolation().empty()) {
+            std::cout << ": " << transaction.getViolation();
+        }
+        std::cout << std::endl;
+    }
+    return res;
 }
 
 /*! \fn compensateDigitalOffset
- * \brief Compensate digital offset due to electrical load.
+ * \brief Start the compensation of the digital offset due to electrical load; see #OffsetCompensation for when it stops.
+ * The commands already collected in \a transaction, e.g. by #configureWorkingModality, are sent with the constant protocol,
+ * so that the device is reconfigured by a single write.
+ *
+ * \return #EdlErrorCode_t Error code.
  */
-void compensateDigitalOffset(EDL edl) {
-	/*! Declare an #EdlCommandStruct_t to be used as configuration for the commands. */
-    EdlCommandStruct_t commandStruct;
+EdlErrorCode_t compensateDigitalOffset(CommandTransaction &transaction, OffsetCompensation &compensation) {
+    /*! Select the constant protocol with the vHold at 0mV; it is applied together with the collected commands. */
+    transaction.setValue(EdlCommandMainTrial, EDL_PROTOCOL_CONSTANT);
+    transaction.setValue(EdlCommandVhold, 0.0);
+    EdlErrorCode_t res = commitCommands(transaction, "constant protocol");
+    if (res != EdlSuccess) {
+        return res;
+    }
 
-	/*! Select the constant protocol: protocol 0. */
-    commandStruct.value = 0.0;
-    edl.setCommand(EdlCommandMainTrial, commandStruct, false);
+    /*! Start the digital compensation: it is stopped once the offsets have settled. */
+    res = compensation.start();
+    if (res != EdlSuccess) {
+        std::cout << "digital offset compensation failed (error " << res << ")" << std::endl;
+    }
+    return res;
+}
 
-	/*! Set the vHold to 0mV. */
-    commandStruct.value = 0.0;
-    edl.setCommand(EdlCommandVhold, commandStruct, false);
+/*! \fn printCompensation
+ * \brief Print how long the digital offset compensation of a device took and the offsets left on its current channels.
+ */
+void printCompensation(const std::string &deviceId, const OffsetCompensationResult_t &result) {
+    std::cout << deviceId << ": " << (result.converged ? "settled" : "not settled") << " after " << result.seconds << " s, offsets";
+    for (unsigned int channelIdx = 1; channelIdx < EDL_CHANNEL_NUM; channelIdx++) {
+        std::cout << " " << result.offsets[channelIdx] << (result.settled[channelIdx] ? "" : "*");
+    }
+    std::cout << " " << edlRangeUnit(RANGE_RADIO_ID);
+    if (result.error != EdlSuccess) {
+        std::cout << " (error " << result.error << ")";
+    }
+    std::cout << std::endl;
+}
 
-	/*! Apply the protocol. */
-    edl.setCommand(EdlCommandApplyProtocol, commandStruct, true);
+/*! \fn loadProtocolSequence
+ * \brief Load the protocols to apply during the data collection from the sequence file of the #RunConfig_t,
+ * or set a triangular protocol if there is none. Every step is checked against the protocol rules before anything is sent.
+ *
+ * \return False if the sequence file cannot be read or breaks the protocol rules.
+ */
+bool loadProtocolSequence(const RunConfig_t &run, ProtocolSequence &sequence) {
+    if (!run.protocolPath.empty()) {
+        if (!sequence.load(run.protocolPath)) {
+            std::cout << "invalid protocol sequence " << run.protocolPath << ": " << sequence.getError() << std::endl;
+            return false;
+        }
+        return true;
+    }
 
-    /*! Start the digital compensation. */
-    commandStruct.buttonPressed = EDL_BUTTON_PRESSED;
-    edl.setCommand(EdlCommandCompAll, commandStruct, true);
+    /*! A triangular protocol with the vHold at 0mV, 50mV amplitude (100mV positive to negative delta voltage) and 100ms period. */
+    ProtocolStep_t step;
+    memset(&step, 0, sizeof(step));
+    step.durationSeconds = 1.0;
+    step.commandValues[EdlCommandMainTrial] = EDL_PROTOCOL_TRIANGULAR;
+    step.commandValues[EdlCommandVhold] = TRIANGULAR_VHOLD_MV;
+    step.commandValues[EdlCommandVamp] = TRIANGULAR_VAMP_MV;
+    step.commandValues[EdlCommandTPeriod] = TRIANGULAR_TPERIOD_MS;
+    if (!sequence.addStep(step)) {
+        std::cout << "invalid triangular protocol: " << sequence.getError() << std::endl;
+        return false;
+    }
+    return true;
+}
 
-    /*! Wait for some seconds. */
-    Sleep(5000);
+/*! \class EventSink
+ * \brief #AcquisitionSink that detects translocation events and writes them on an open text file.
+ */
+class EventSink : public AcquisitionSink {
+public:
+    EventSink(FILE * f, const EventDetectorConfig_t &config) :
+        f(f),
+        detector(config),
+        samplingRate(config.samplingRate),
+        eventsNum(0) {
+        fprintf(f, "channel\tstart [s]\tduration [ms]\tbaseline\tblockade\tstd\n");
+    }
 
-    /*! Stop the digital compensation. */
-    commandStruct.buttonPressed = EDL_BUTTON_RELEASED;
-    edl.setCommand(EdlCommandCompAll, commandStruct, true);
-}
+    void consumePackets(const float * packets, unsigned int packetsNum) {
+        events.clear();
+        block.deinterleave(packets, packetsNum);
+        detector.processChannels(block.channels(), packetsNum, events);
+        for (unsigned int eventIdx = 0; eventIdx < events.size(); eventIdx++) {
+            const NanoporeEvent_t &event = events[eventIdx];
+            fprintf(f, "%u\t%.6f\t%.3f\t%g\t%g\t%g\n", event.channel, (double)event.startSample/samplingRate,
+                    1.0e3*event.duration/samplingRate, event.baseline, event.meanBlockade, event.stdBlockade);
+        }
+        eventsNum += events.size();
+    }
 
-/*! \fn setTriangularProtocol
- * \brief Set the parameters and start a triangular protocol.
+    /*! Keeps the time of the following events exact; the events under way are lost. */
+    void consumeGap(uint64_t firstPacket, unsigned long long packetsNum) {
+        (void)firstPacket;
+        detector.skip(packetsNum);
+    }
+
+    unsigned long long getEventsNum() const {
+        return eventsNum;
+    }
+
+private:
+    FILE * f;
+    EventDetector detector;
+    ChannelBlock block; /*!< Reused by every call to avoid allocations. */
+    double samplingRate;
+    std::vector <NanoporeEvent_t> events; /*!< Reused by every call to avoid allocations. */
+    unsigned long long eventsNum;
+};
+
+/*! \class StatisticsSink
+ * \brief #AcquisitionSink that computes the statistics of the current channels with a #ChannelStatistics and writes them on
+ * open text files: every update on one and every #STATISTICS_PSD_UPDATES updates the power spectral density on the other.
  */
-void setTriangularProtocol(EDL edl) {
-    /*! Declare an #EdlCommandStruct_t to be used as configuration for the commands. */
-    EdlCommandStruct_t commandStruct;
+class StatisticsSink : public AcquisitionSink {
+public:
+    StatisticsSink(FILE * statsFile, FILE * psdFile, const ChannelStatisticsConfig_t &config) :
+        statsFile(statsFile),
+        psdFile(psdFile),
+        statistics(config),
+        samplingRate(config.samplingRate),
+        updatesNum(0) {
+        fprintf(statsFile, "start [s]\tchannel\tmean\trms\tmin\tmax\n");
+        fprintf(psdFile, "start [s]\tchannel");
+        for (unsigned int binIdx = 0; binIdx < statistics.getBinsNum(); binIdx++) {
+            fprintf(psdFile, "\t%g", statistics.getBinFrequency(binIdx));
+        }
+        fprintf(psdFile, "\n");
+    }
 
-    /*! Select the triangular protocol: protocol 1. */
-    commandStruct.value = 1.0;
-    edl.setCommand(EdlCommandMainTrial, commandStruct, false);
+    void consumePackets(const float * packets, unsigned int packetsNum) {
+        while (packetsNum > 0) {
+            unsigned int processedNum = statistics.process(packets, packetsNum);
+            if (statistics.hasUpdate()) {
+                writeUpdate();
+            }
+            packets += (size_t)processedNum*EDL_CHANNEL_NUM;
+            packetsNum -= processedNum;
+        }
+    }
 
-    /*! Set the vHold to 0mV. */
-    commandStruct.value = 0.0;
-    edl.setCommand(EdlCommandVhold, commandStruct, false);
+    /*! Keeps the time of the following updates exact. */
+    void consumeGap(uint64_t firstPacket, unsigned long long packetsNum) {
+        (void)firstPacket;
+        statistics.skip(packetsNum);
+    }
 
-    /*! Set the triangular wave amplitude to 50mV: 100mV positive to negative delta voltage. */
-    commandStruct.value = 50.0;
-    edl.setCommand(EdlCommandVamp, commandStruct, false);
+    unsigned long long getUpdatesNum() const {
+        return updatesNum;
+    }
 
-    /*! Set the triangular period to 100ms. */
-    commandStruct.value = 100.0;
-    edl.setCommand(EdlCommandTPeriod, commandStruct, false);
+    /*! The statistics of the last update, valid if #getUpdatesNum is not 0. */
+    const ChannelStatisticsUpdate_t &getLastUpdate() const {
+        return statistics.getUpdate();
+    }
 
-    /*! Apply the protocol. */
-    edl.setCommand(EdlCommandApplyProtocol, commandStruct, true);
-}
+private:
+    void writeUpdate() {
+        const ChannelStatisticsUpdate_t &update = statistics.getUpdate();
+        double startSeconds = (double)update.firstPacket/samplingRate;
+        for (unsigned int channelIdx = 0; channelIdx < STATISTICS_CURRENT_CHANNELS; channelIdx++) {
+            fprintf(statsFile, "%.6f\t%u\t%g\t%g\t%g\t%g\n", startSeconds, channelIdx+1, update.mean[channelIdx], update.rms[channelIdx],
+                    update.min[channelIdx], update.max[channelIdx]);
+        }
+
+        if (updatesNum%STATISTICS_PSD_UPDATES == 0 && update.segmentsNum > 0) {
+            for (unsigned int channelIdx = 0; channelIdx < STATISTICS_CURRENT_CHANNELS; channelIdx++) {
+                fprintf(psdFile, "%.6f\t%u", startSeconds, channelIdx+1);
+                for (unsigned int binIdx = 0; binIdx < statistics.getBinsNum(); binIdx++) {
+                    fprintf(psdFile, "\t%g", statistics.getPsd(binIdx, channelIdx));
+                }
+                fprintf(psdFile, "\n");
+            }
+        }
+        updatesNum++;
+    }
+
+    FILE * statsFile;
+    FILE * psdFile;
+    ChannelStatistics statistics;
+    double samplingRate;
+    unsigned long long updatesNum;
+};
+
+/*! \class DeviceOutputs
+ * \brief Files written for one device: the recordings with their pyramids, the detected events and the statistics of the current channels,
+ * together with the sinks that fill them.
+ */
+class DeviceOutputs {
+public:
+    /*! The time spent by each subscriber on its blocks is recorded in \a instrumentation: the recordings under #ProbeWrite,
+     * the event detection and the statistics under #ProbeProcess. */
+    DeviceOutputs(const RotationConfig_t &rotation, Instrumentation &instrumentation) :
+        recording(rotation, true),
+        secondary(rotation, false),
+        recordingProbe(instrumentation, ProbeWrite, &recording),
+        secondaryProbe(instrumentation, ProbeWrite, &secondary),
+        instrumentation(instrumentation),
+        secondaryDecimator(NULL),
+        eventsFile(NULL),
+        eventSink(NULL),
+        eventFilter(NULL),
+        eventProbe(NULL),
+        statsFile(NULL),
+        psdFile(NULL),
+        statisticsSink(NULL),
+        statisticsProbe(NULL) {
+    }
+
+    ~DeviceOutputs() {
+        close();
+    }
+
+    /*! Opens the first files of data_<device ID>, each with its pyramid files, of the decimated recording, events_<device ID>.txt,
+     * stats_<device ID>.txt and psd_<device ID>.txt. */
+    bool open(const std::string &deviceId, const RecordingHeader_t &header) {
+        /*! Build the min/max/mean pyramid alongside the recording, to browse it at any zoom without reading all of the data. */
+        if (!recording.open("data_"+deviceId, header, RECORDING_ENCODING)) {
+            std::cout << "failed to open " << recording.getPath(0) << " and its pyramid files" << std::endl;
+            return false;
+        }
+
+        /*! Write a decimated copy in float samples, as the filtered samples are no longer multiples of the device resolution. */
+        if (SECONDARY_DECIMATION_FACTOR > 0) {
+            secondaryDecimator = new DecimatorSink(SECONDARY_DECIMATION_FACTOR, &secondaryProbe);
+            RecordingHeader_t secondaryHeader = header;
+            secondaryHeader.samplingRate = header.samplingRate/SECONDARY_DECIMATION_FACTOR;
+            secondaryHeader.finalBandwidth = DECIMATOR_CUTOFF_RATIO*secondaryHeader.samplingRate;
+            if (!secondary.open("data_"+deviceId+"_dec"+std::to_string(SECONDARY_DECIMATION_FACTOR), secondaryHeader, RecordingEncodingFloat32)) {
+                std::cout << "failed to open " << secondary.getPath(0) << std::endl;
+                return false;
+            }
+        }
+
+        std::string eventsPath = "events_"+deviceId+".txt";
+        eventsFile = fopen(eventsPath.c_str(), "w");
+        if (eventsFile == NULL) {
+            std::cout << "failed to open " << eventsPath << std::endl;
+            return false;
+        }
+        eventSink = new EventSink(eventsFile, eventDetectorDefaultConfig(header.samplingRate));
+
+        /*! Detect the events on the current filtered further than by the device. */
+        LowPassConfig_t filterConfig = lowPassDefaultConfig(header.samplingRate);
+        filterConfig.type = EVENTS_FILTER_TYPE;
+        filterConfig.order = EVENTS_FILTER_ORDER;
+        filterConfig.cutoff = EVENTS_FILTER_CUTOFF_RATIO*header.samplingRate;
+        eventFilter = new LowPassSink(filterConfig, eventSink);
+        eventProbe = new InstrumentedSink(instrumentation, ProbeProcess, eventFilter);
+
+        /*! Follow the mean, the noise and the spectrum of the current channels as recorded, i.e. unfiltered. */
+        std::string statsPath = "stats_"+deviceId+".txt";
+        std::string psdPath = "psd_"+deviceId+".txt";
+        statsFile = fopen(statsPath.c_str(), "w");
+        psdFile = fopen(psdPath.c_str(), "w");
+        if (statsFile == NULL || psdFile == NULL) {
+            std::cout << "failed to open " << (statsFile == NULL ? statsPath : psdPath) << std::endl;
+            return false;
+        }
+        statisticsSink = new StatisticsSink(statsFile, psdFile, channelStatisticsDefaultConfig(header.samplingRate));
+        statisticsProbe = new InstrumentedSink(instrumentation, ProbeProcess, statisticsSink);
+
+        /*! Each output is written by its own subscriber thread from the same blocks; none of them may lose data.
+         * The pyramid is built on the thread of its recording, so that both start a new file at the same data packet. */
+        broadcast.subscribe(&recordingProbe, subscriberDefaultConfig(BackpressureBlock));
+        broadcast.subscribe(eventProbe, subscriberDefaultConfig(BackpressureBlock));
+        broadcast.subscribe(statisticsProbe, subscriberDefaultConfig(BackpressureBlock));
+        if (secondaryDecimator != NULL) {
+            broadcast.subscribe(secondaryDecimator, subscriberDefaultConfig(BackpressureBlock));
+        }
+        broadcast.start();
+        return true;
+    }
+
+    void addSinks(DeviceManager &devices, unsigned int deviceIdx) {
+        devices.addSink(deviceIdx, &broadcast);
+    }
+
+    /*! Waits for the subscribers to process the pending data packets; call after the acquisition has stopped. */
+    void stop() {
+        broadcast.stop();
+    }
+
+    unsigned int getFilesNum() const {
+        return recording.getFilesNum();
+    }
+
+    /*! The full rate recording, whose segments are tagged with the protocol steps. */
+    RotatingRecording &getRecording() {
+        return recording;
+    }
+
+    unsigned long long getEventsNum() const {
+        return eventSink != NULL ? eventSink->getEventsNum() : 0;
+    }
+
+    /*! The statistics sink, NULL until #open; call after #stop to read the last update. */
+    const StatisticsSink * getStatistics() const {
+        return statisticsSink;
+    }
+
+    /*! Closes all of the files, returning false if any of them could not be written. */
+    bool close() {
+        bool success = true;
+        broadcast.stop();
+        if (recording.isOpen()) {
+            std::string lastPath = recording.getPath(recording.getFilesNum()-1);
+            if (!recording.close()) {
+                std::cout << "failed to write " << lastPath << " or an earlier file" << std::endl;
+                success = false;
+
+            } else if (recording.getPayloadBytes() > 0) {
+                double rawBytes = (double)recording.getPacketsNum()*EDL_CHANNEL_NUM*sizeof(float);
+                std::cout << recording.getFilesNum() << " files up to " << lastPath << ", compression ratio " << rawBytes/recording.getPayloadBytes() << std::endl;
+            }
+        }
+
+        if (secondary.isOpen()) {
+            std::string lastPath = secondary.getPath(secondary.getFilesNum()-1);
+            if (!secondary.close()) {
+                std::cout << "failed to write " << lastPath << " or an earlier file" << std::endl;
+                success = false;
+            }
+        }
+
+        delete secondaryDecimator;
+        secondaryDecimator = NULL;
+        delete eventProbe;
+        eventProbe = NULL;
+        delete eventFilter;
+        eventFilter = NULL;
+        delete eventSink;
+        eventSink = NULL;
+        if (eventsFile != NULL) {
+            fclose(eventsFile);
+            eventsFile = NULL;
+        }
+
+        delete statisticsProbe;
+        statisticsProbe = NULL;
+        delete statisticsSink;
+        statisticsSink = NULL;
+        if (statsFile != NULL) {
+            fclose(statsFile);
+            statsFile = NULL;
+        }
+        if (psdFile != NULL) {
+            fclose(psdFile);
+            psdFile = NULL;
+        }
+        return success;
+    }
+
+private:
+    RotatingRecording recording;
+    RotatingRecording secondary;
+    InstrumentedSink recordingProbe;
+    InstrumentedSink secondaryProbe;
+    Instrumentation &instrumentation;
+    DecimatorSink * secondaryDecimator;
+    FILE * eventsFile;
+    EventSink * eventSink;
+    LowPassSink * eventFilter;
+    InstrumentedSink * eventProbe;
+    FILE * statsFile;
+    FILE * psdFile;
+    StatisticsSink * statisticsSink;
+    InstrumentedSink * statisticsProbe;
+    Broadcast broadcast;
+};
 
 /*! \fn readAndSaveSomeData
- * \brief Reads data from the EDL device and writes them on an open file.
+ * \brief Reads data from all of the connected devices until a limit of the #RunConfig_t is reached or the program is interrupted,
+ * and writes them on the open #DeviceOutputs, one per device.
+ * Each device is read by a dedicated thread pinned to its own core and each of its files is written by another one,
+ * so that slow writes do not cause buffer overflows on the devices.
+ * The steps of \a sequence after the first one, already applied, are applied on schedule while the data are collected.
  */
-EdlErrorCode_t readAndSaveSomeData(EDL edl, FILE * f) {
+EdlErrorCode_t readAndSaveSomeData(DeviceManager &devices, std::vector <DeviceOutputs *> &outputs, const RunConfig_t &run,
+                                   const ProtocolSequence &sequence) {
     /*! Declare an #EdlErrorCode_t to be returned from #EDL methods. */
     EdlErrorCode_t res;
 
-	/*! Declare an #EdlDeviceStatus_t variable to collect the device status. */
-    EdlDeviceStatus_t status;
+	/*! Start collecting data: the devices have been purged and aligned by #DeviceManager::align. */
+    std::cout << "collecting data, press Ctrl+C to stop" << std::endl;
+    for (unsigned int deviceIdx = 0; deviceIdx < devices.getDevicesNum(); deviceIdx++) {
+        outputs[deviceIdx]->addSinks(devices, deviceIdx);
+    }
 
-	/*! Declare a variable to collect the number of read data packets. */
-    unsigned int readPacketsNum;
+    /*! Export the durations of the reads, the processing and the writes while data are collected, if requested. */
+    MetricsExporter exporter;
+    if (!run.metricsPath.empty()) {
+        for (unsigned int deviceIdx = 0; deviceIdx < devices.getDevicesNum(); deviceIdx++) {
+            exporter.addAcquisition(devices.getDeviceId(deviceIdx), devices.getAcquisition(deviceIdx));
+        }
 
-	/*! Declare a vector to collect the read data packets. */
-    std::vector <float> data;
+        if (exporter.open(run.metricsPath) && exporter.start()) {
+            std::cout << "exporting metrics to " << run.metricsPath << " every " << METRICS_EXPORT_INTERVAL_MS << " ms" << std::endl;
 
-    Sleep(500);
+        } else {
+            std::cout << "failed to open " << run.metricsPath << ", metrics not exported" << std::endl;
+        }
+    }
 
-    std::cout << "purge old data" << std::endl;
-	/*! Get rid of data acquired during the device configuration */
-	res = edl.purgeData();
+    /*! Apply the next protocol steps at the data packets they are scheduled on, tagging the segments of the recordings. */
+    ProtocolScheduler scheduler(sequence, edlSamplingRateHz(SAMPLING_RATE_RADIO_ID));
+    for (unsigned int deviceIdx = 0; deviceIdx < devices.getDevicesNum(); deviceIdx++) {
+        scheduler.addDevice(devices.getEdl(deviceIdx), devices.getAcquisition(deviceIdx), &outputs[deviceIdx]->getRecording());
+    }
 
-	/*! If the EDL::purgeData returns an error code output an error and return. */
-    if (res != EdlSuccess) {
-        std::cout << "failed to purge data" << std::endl;
-        return res;
+    interrupted = 0;
+    std::signal(SIGINT, onInterrupt);
+    std::signal(SIGTERM, onInterrupt);
+    devices.start();
+    if (sequence.getStepsNum() > 1) {
+        scheduler.start(devices.getStartSteadyTime());
+    }
+
+    /*! Collect data until a limit of the #RunConfig_t is reached or the program is interrupted,
+     * unless a reader thread stops because of an error. Report the progress of long collections. */
+    std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+    std::chrono::steady_clock::time_point progressTime = startTime+std::chrono::milliseconds(PROGRESS_INTERVAL_MS);
+    bool limitReached = false;
+    while (devices.isRunning() && !interrupted && !limitReached) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        double seconds = std::chrono::duration <double> (now-startTime).count();
+        limitReached = run.durationSeconds > 0.0 && seconds >= run.durationSeconds;
+
+        bool packetsReached = run.packetsNum > 0;
+        for (unsigned int deviceIdx = 0; deviceIdx < devices.getDevicesNum() && packetsReached; deviceIdx++) {
+            packetsReached = devices.getStats(deviceIdx).readPackets >= run.packetsNum;
+        }
+        limitReached = limitReached || packetsReached;
+
+        if (now >= progressTime) {
+            progressTime += std::chrono::milliseconds(PROGRESS_INTERVAL_MS);
+            for (unsigned int deviceIdx = 0; deviceIdx < devices.getDevicesNum(); deviceIdx++) {
+                AcquisitionStats_t stats = devices.getStats(deviceIdx);
+                std::cout << "  " << (unsigned long long)seconds << " s, " << devices.getDeviceId(deviceIdx) << ": "
+                          << stats.readPackets << " packets read, " << stats.droppedPackets << " dropped, "
+                          << outputs[deviceIdx]->getFilesNum() << " files" << std::endl;
+            }
+        }
     }
 
-	/*! Start collecting data. */
+    /*! Stop reading and wait for the pending data packets to be written. */
+    scheduler.stop();
+    res = devices.stop();
+    for (unsigned int deviceIdx = 0; deviceIdx < devices.getDevicesNum(); deviceIdx++) {
+        outputs[deviceIdx]->stop();
+    }
+    exporter.stop();
+    std::signal(SIGINT, SIG_DFL);
+    std::signal(SIGTERM, SIG_DFL);
+	std::cout << (interrupted ? "interrupted" : "done") << std::endl;
+
+    /*! Report the counters of each device and the aggregate throughput. */
+    double seconds = devices.getElapsedSeconds();
+    unsigned long long totalReadPackets = 0;
+    unsigned long long totalDroppedPackets = 0;
+    for (unsigned int deviceIdx = 0; deviceIdx < devices.getDevicesNum(); deviceIdx++) {
+        AcquisitionStats_t stats = devices.getStats(deviceIdx);
+        totalReadPackets += stats.readPackets;
+        totalDroppedPackets += stats.droppedPackets;
+
+        std::cout << devices.getDeviceId(deviceIdx) << ": " << stats.readPackets << " packets read ("
+                  << stats.readPackets/seconds << " packets/s, reader on core " << stats.readerCore << "), "
+                  << devices.getAlignmentPackets(deviceIdx) << " discarded for alignment, "
+                  << stats.consumedPackets << " packets written, " << stats.droppedPackets << " dropped, "
+                  << outputs[deviceIdx]->getEventsNum() << " events detected" << std::endl;
+        std::cout << "  " << stats.reads << " reads in " << stats.statusChecks << " status checks, read threshold "
+                  << stats.readThreshold << " packets at " << stats.packetRate << " packets/s, "
+                  << stats.maxBlocksInUse << " buffer blocks in use at most" << std::endl;
+
+        const StatisticsSink * statistics = outputs[deviceIdx]->getStatistics();
+        if (statistics != NULL && statistics->getUpdatesNum() > 0) {
+            const ChannelStatisticsUpdate_t &update = statistics->getLastUpdate();
+            std::cout << "  last " << update.packetsNum << " packets, mean/RMS noise of the current channels:";
+            for (unsigned int channelIdx = 0; channelIdx < STATISTICS_CURRENT_CHANNELS; channelIdx++) {
+                std::cout << " " << update.mean[channelIdx] << "/" << update.rms[channelIdx];
+            }
+            std::cout << std::endl;
+        }
 
-    std::cout << "collecting data... ";
-	unsigned int c;
-    for (c = 0; c < 1e3; c++) {
-		/*! Get current status to know the number of available data packets EdlDeviceStatus_t::availableDataPackets. */
-        res = edl.getDeviceStatus(status);
+        if (stats.bufferOverflows > 0) {
+            std::cout << "  lost some data due to buffer overflow " << stats.bufferOverflows << " times; decrease ReadControllerConfig_t::targetLatency to improve performance" << std::endl;
+        }
 
-        /*! If the EDL::getDeviceStatus returns an error code output an error and return. */
-        if (res != EdlSuccess) {
-            std::cout << "failed to get device status" << std::endl;
-            return res;
-        }
-
-		if (status.bufferOverflowFlag) {
-			std::cout << std::endl << "lost some data due to buffer overflow; increase MINIMUM_DATA_PACKETS_TO_READ to improve performance" << std::endl;
-		}
-
-		if (status.lostDataFlag) {
-			std::cout << std::endl << "lost some data from the device; decrease sampling frequency or close unused applications to improve performance" << std::endl;
-			std::cout << "data loss may also occur immediately after sending a command to the device" << std::endl;
-		}
-
-        if (status.availableDataPackets >= MINIMUM_DATA_PACKETS_TO_READ) {
-		    /*! If at least MINIMUM_DATA_PACKETS_TO_READ data packet are available read them. */
-			res = edl.readData(status.availableDataPackets, readPacketsNum, data);
-
-	        /*! If the device is not connected output an error, close the file for data storage and return. */
-            if (res == EdlDeviceNotConnectedError) {
-				std::cout << "the device is not connected" << std::endl;
-                fclose(f);
-				return res;
-
-			} else {
-	            /*! If the number of available data packets is lower than the number of required packets output an error, but the read is performed nonetheless
-				 * with the available data. */
-				if (res == EdlNotEnoughAvailableDataError) {
-					std::cout << "not enough available data, only "  << readPacketsNum << " packets have been read" << std::endl;
-				}
-
-	            /*! The output vector consists of \a readPacketsNum data packets of #EDL_CHANNEL_NUM floating point data each.
-				 * The first item in each data packet is the value voltage channel [mV];
-				 * the following items are the values of the current channels either in pA or nA, depending on value assigned to #EdlCommandSamplingRate. */
-                for (unsigned int readPacketsIdx = 0; readPacketsIdx < readPacketsNum; readPacketsIdx++) {
-                    for (unsigned int channelIdx = 0; channelIdx < EDL_CHANNEL_NUM; channelIdx++) {
-                        fwrite((unsigned char *)&data.at(readPacketsIdx*EDL_CHANNEL_NUM+channelIdx), sizeof(float), 1, f);
-                    }
-                }
+        if (stats.lostPackets > 0) {
+            std::cout << "  about " << stats.lostPackets << " packets lost by the device, marked as gaps in the recordings to keep the timing exact" << std::endl;
+        }
 
-			}
+        if (stats.lostDataEvents > 0) {
+            std::cout << "  lost some data from the device " << stats.lostDataEvents << " times; decrease sampling frequency or close unused applications to improve performance" << std::endl;
+            std::cout << "  data loss may also occur immediately after sending a command to the device" << std::endl;
+        }
 
-        } else {
-		    /*! If the read was not performed wait 1 ms before trying to read again. */
-            Sleep(1);
-		}
+        if (stats.droppedPackets > 0) {
+            std::cout << "  dropped " << stats.droppedPackets << " packets because the files could not be written fast enough" << std::endl;
+        }
+    }
+
+    if (sequence.getStepsNum() > 1) {
+        std::cout << scheduler.getAppliedStepsNum()+1 << " of " << sequence.getStepsNum() << " protocol steps applied, at most "
+                  << scheduler.getMaxDelayPackets() << " packets after schedule";
+        if (scheduler.getError() != EdlSuccess) {
+            std::cout << ", some failed (error " << scheduler.getError() << ")";
+        }
+        std::cout << std::endl;
+    }
+
+    std::cout << "total: " << totalReadPackets << " packets read (" << totalReadPackets*EDL_CHANNEL_NUM*sizeof(float)/seconds/1.0e6
+              << " MB/s), " << totalDroppedPackets << " dropped" << std::endl;
+
+    /*! If a device is not connected output an error. */
+    if (res == EdlDeviceNotConnectedError) {
+        std::cout << "a device is not connected" << std::endl;
+
+    } else if (res == EdlNotEnoughAvailableDataError) {
+        /*! If the number of available data packets was lower than the number of required packets the read was performed nonetheless
+         * with the available data. */
+        res = EdlSuccess;
     }
-	std::cout << "done" << std::endl;
 
     return res;
 }
 
 /*! \fn main
- * \brief Application entry point.
+ * \brief Application entry point. See #parseArguments for the command line.
  */
-int main() {
-	/*! Initialize an #EDL object. */
-    EDL edl;
+int main(int argc, char ** argv) {
+    /*! Read when to stop and how to split the recordings. */
+    RunConfig_t run;
+    if (!parseArguments(argc, argv, run)) {
+        std::cout << "usage: caller [-d seconds] [-n packets] [-r rotation seconds] [-s rotation MB] [-m metrics file or unix:socket path]"
+                     " [-p protocol sequence file]" << std::endl;
+        return -1;
+    }
+
+    /*! Load and check the protocols before connecting, so that a mistake in the sequence file costs nothing. */
+    ProtocolSequence sequence;
+    if (!loadProtocolSequence(run, sequence)) {
+        return -1;
+    }
+
+	/*! Initialize a #DeviceManager to handle all of the plugged in devices. */
+    DeviceManager devices;
 
 	/*! Declare an #EdlErrorCode_t to be returned from #EDL methods. */
     EdlErrorCode_t res;
 
-	/*! Initialize a vector of strings to collect the detected devices. */
-    std::vector <std::string> devices;
-
     std::ios::sync_with_stdio(true);
 
-	/*! Detect plugged in devices. */
-    res = edl.detectDevices(devices);
+	/*! Detect plugged in devices and connect to all of them, each one through its own #EDL object. */
+    std::cout << "connecting... ";
+    res = devices.connectAll();
 
-	/*! If none is found output an error and return. */
+	/*! If the DeviceManager::connectAll returns an error code or no device is found output an error and return. */
     if (res != EdlSuccess) {
+        std::cout << "connection error" << std::endl;
+        return -1;
+    }
+
+    if (devices.getDevicesNum() == 0) {
         std::cout << "could not detect devices" << std::endl;
         return -1;
     }
+	std::cout << "done" << std::endl;
 
-    std::cout << "first device found " << devices.at(0) << std::endl;
+    for (unsigned int deviceIdx = 0; deviceIdx < devices.getDevicesNum(); deviceIdx++) {
+        std::cout << "device found " << devices.getDeviceId(deviceIdx) << std::endl;
+    }
 
-	/*! If at list one device is found connect to the first one. */
-    res = edl.connectDevice(devices.at(0));
+	/*! Collect the working modality of each device: it is sent together with the protocol of the offset compensation. */
+    std::cout << "configuring working modality" << std::endl;
+    std::vector <CommandTransaction *> transactions;
+    for (unsigned int deviceIdx = 0; deviceIdx < devices.getDevicesNum(); deviceIdx++) {
+        transactions.push_back(new CommandTransaction(devices.getEdl(deviceIdx)));
+        configureWorkingModality(*transactions.back());
+    }
 
-    std::cout << "connecting... ";
-	/*! If the EDL::connectDevice returns an error code output an error and return. */
+	/*! Compensate for digital offset on all of the devices at the same time: each one stops as soon as its offsets have settled. */
+	std::cout << "performing digital offset compensation..." << std::endl;
+    OffsetCompensationConfig_t compensationConfig = offsetCompensationDefaultConfig(SAMPLING_RATE_RADIO_ID, RANGE_RADIO_ID);
+    std::vector <OffsetCompensation *> compensations;
+    for (unsigned int deviceIdx = 0; deviceIdx < devices.getDevicesNum() && res == EdlSuccess; deviceIdx++) {
+        compensations.push_back(new OffsetCompensation(devices.getSource(deviceIdx), *transactions[deviceIdx], compensationConfig));
+        res = compensateDigitalOffset(*transactions[deviceIdx], *compensations.back());
+    }
+    /*! The compensations already started are waited for also on a failure, before aborting. */
+    for (unsigned int deviceIdx = 0; deviceIdx < devices.getDevicesNum(); deviceIdx++) {
+        if (deviceIdx < compensations.size()) {
+            const OffsetCompensationResult_t &result = compensations[deviceIdx]->wait();
+            if (res == EdlSuccess) {
+                printCompensation(devices.getDeviceId(deviceIdx), result);
+            }
+            delete compensations[deviceIdx];
+        }
+        delete transactions[deviceIdx];
+    }
     if (res != EdlSuccess) {
-        std::cout << "connection error" << std::endl;
         return -1;
     }
-	std::cout << "done" << std::endl;
 
-	/*! Configure the device working modality. */
-    std::cout << "configuring working modality" << std::endl;
-    configureWorkingModality(edl);
+    std::cout << "applying protocol step 1 of " << sequence.getStepsNum() << std::endl;
+    /*! Apply the first protocol step; the next ones are applied while the data are collected. */
+    for (unsigned int deviceIdx = 0; deviceIdx < devices.getDevicesNum(); deviceIdx++) {
+        res = applyProtocolStep(devices.getEdl(deviceIdx), sequence.getStep(0));
+        if (res != EdlSuccess) {
+            std::cout << "protocol failed (error " << res << ")" << std::endl;
+            return -1;
+        }
+    }
 
-	/*! Compensate for digital offset. */
-	std::cout << "performing digital offset compensation... ";
-    compensateDigitalOffset(edl);
-	std::cout << "done" << std::endl;
+    /*! Purge old data and align the streams of the devices, so that all of the recordings start at the same time. */
+    std::this_thread::sleep_for(std::chrono::milliseconds(500));
 
-    std::cout << "applying triangular test protocol" << std::endl;
-    /*! Apply a triangular test protocol. */
-    setTriangularProtocol(edl);
+    std::cout << "purge old data" << std::endl;
+    res = devices.align(edlSamplingRateHz(SAMPLING_RATE_RADIO_ID));
+    if (res != EdlSuccess) {
+        std::cout << "failed to purge data" << std::endl;
+        return -1;
+    }
 
-	/*! Initialize a file descriptor to store the read data packets. */
-    FILE * f;
-    f = fopen("data.dat", "wb+");
+	/*! Initialize the files of each device to store the read data packets together with the settings used to acquire them. */
+    RecordingHeader_t header;
+    recordingHeaderInit(header, SAMPLING_RATE_RADIO_ID, RANGE_RADIO_ID, FINAL_BANDWIDTH_RADIO_ID);
+    header.startTime = devices.getStartTime();
+    for (unsigned int commandIdx = 0; commandIdx < EdlCommandIdNum; commandIdx++) {
+        header.commandValues[commandIdx] = sequence.getStep(0).commandValues[commandIdx];
+    }
+
+    std::vector <DeviceOutputs *> outputs;
+    bool opened = true;
+    for (unsigned int deviceIdx = 0; deviceIdx < devices.getDevicesNum(); deviceIdx++) {
+        outputs.push_back(new DeviceOutputs(run.rotation, devices.getAcquisition(deviceIdx).getInstrumentation()));
+        opened = opened && outputs.back()->open(devices.getDeviceId(deviceIdx), header);
+    }
+
+    if (opened) {
+        res = readAndSaveSomeData(devices, outputs, run, sequence);
+    }
+
+	/*! Close the files for data storage. */
+    for (size_t deviceIdx = 0; deviceIdx < outputs.size(); deviceIdx++) {
+        outputs[deviceIdx]->close();
+        delete outputs[deviceIdx];
+    }
+
+    if (!opened) {
+        return -1;
+    }
 
-    res = readAndSaveSomeData(edl, f);
     if (res != EdlSuccess) {
         std::cout << "failed to read data" << std::endl;
         return -1;
     }
 
-	/*! Close the file for data storage. */
-    fclose(f);
-
-	/*! Try to disconnect the device.
+	/*! Try to disconnect the devices.
 	 * \note Data reading is performed in a separate thread started by EDL::connectDevice.
-	 * The while loop may be useful in case few operations are performed between before calling EDL::disconnectDevice,
+	 * DeviceManager::disconnectAll retries for up to 1 second per device,
 	 * to ensure that the connection is fully established before trying to disconnect. */
-
 	std::cout << "disconnecting... ";
-    unsigned int c = 0;
-    while (c++ < 1e3) {
-		res = edl.disconnectDevice();
-		if (res == EdlSuccess) {
-            std::cout << "done" << std::endl;
-			break;
-		}
-
-		/*! If the disconnection was unsuccessful wait 1 ms before trying to disconnect again. */
-        Sleep(1);
-    }
+    res = devices.disconnectAll();
 
-	/*! If the EDL::disconnectDevice returns an error code after trying for 1 second (1e3 * 1ms) output an error and return. */
+	/*! If the DeviceManager::disconnectAll returns an error code output an error and return. */
     if (res != EdlSuccess) {
         std::cout << "disconnection error" << std::endl;
         return -1;
     }
+    std::cout << "done" << std::endl;
 
     return 0;
 }
@@ -0,0 +1,332 @@
+/*! \file channel_statistics.cpp
+ * \brief Defines class ChannelStatistics.
+ */
+#include "channel_statistics.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(__AVX__) || defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(_M_X64)
+#include <immintrin.h>
+#define STATISTICS_SSE
+#endif
+
+#if defined(__AVX__)
+#define STATISTICS_AVX
+#endif
+
+static const double pi = 3.14159265358979323846;
+
+ChannelStatisticsConfig_t channelStatisticsDefaultConfig(double samplingRate) {
+    ChannelStatisticsConfig_t config;
+    config.samplingRate = samplingRate;
+    config.updatePackets = (unsigned int)std::max(1.0, std::floor(samplingRate+0.5));
+
+    /*! Segments overlapping by half: an update of n data packets averages about 2 n / fftSize of them. */
+    config.fftSize = STATISTICS_MIN_FFT_SIZE;
+    while (config.fftSize < STATISTICS_MAX_FFT_SIZE && 2*config.fftSize <= config.updatePackets/4) {
+        config.fftSize *= 2;
+    }
+    return config;
+}
+
+/*! \fn bitReverse
+ * \brief Moves sample k of each signal to the index with the bits of k reversed, as the butterflies of #fftChannels expect.
+ */
+static void bitReverse(double * re, double * im, unsigned int size) {
+    for (unsigned int i = 1, j = 0; i < size; i++) {
+        unsigned int bit = size >> 1;
+        for (; j & bit; bit >>= 1) {
+            j ^= bit;
+        }
+        j ^= bit;
+
+        if (i < j) {
+            for (unsigned int channelIdx = 0; channelIdx < STATISTICS_CURRENT_CHANNELS; channelIdx++) {
+                std::swap(re[i*STATISTICS_CURRENT_CHANNELS+channelIdx], re[j*STATISTICS_CURRENT_CHANNELS+channelIdx]);
+                std::swap(im[i*STATISTICS_CURRENT_CHANNELS+channelIdx], im[j*STATISTICS_CURRENT_CHANNELS+channelIdx]);
+            }
+        }
+    }
+}
+
+void fftChannelsScalar(double * re, double * im, unsigned int size, const double * cosTable, const double * sinTable) {
+    bitReverse(re, im, size);
+    for (unsigned int half = 1; half < size; half *= 2) {
+        unsigned int tableStep = size/(2*half);
+        for (unsigned int start = 0; start < size; start += 2*half) {
+            for (unsigned int k = 0; k < half; k++) {
+                /*! Twiddle factor exp(-2 pi i k / (2 half)). */
+                double wr = cosTable[k*tableStep];
+                double wi = -sinTable[k*tableStep];
+                double * re0 = re+(size_t)(start+k)*STATISTICS_CURRENT_CHANNELS;
+                double * im0 = im+(size_t)(start+k)*STATISTICS_CURRENT_CHANNELS;
+                double * re1 = re0+(size_t)half*STATISTICS_CURRENT_CHANNELS;
+                double * im1 = im0+(size_t)half*STATISTICS_CURRENT_CHANNELS;
+                for (unsigned int channelIdx = 0; channelIdx < STATISTICS_CURRENT_CHANNELS; channelIdx++) {
+                    double tr = re1[channelIdx]*wr-im1[channelIdx]*wi;
+                    double ti = re1[channelIdx]*wi+im1[channelIdx]*wr;
+                    re1[channelIdx] = re0[channelIdx]-tr;
+                    im1[channelIdx] = im0[channelIdx]-ti;
+                    re0[channelIdx] += tr;
+                    im0[channelIdx] += ti;
+                }
+            }
+        }
+    }
+}
+
+void fftChannels(double * re, double * im, unsigned int size, const double * cosTable, const double * sinTable) {
+#if EDL_CHANNEL_NUM == 5 && defined(STATISTICS_AVX)
+    /*! Sample k of the 4 signals is one vector of doubles: each butterfly transforms the 4 of them at once. */
+    bitReverse(re, im, size);
+    for (unsigned int half = 1; half < size; half *= 2) {
+        unsigned int tableStep = size/(2*half);
+        for (unsigned int start = 0; start < size; start += 2*half) {
+            for (unsigned int k = 0; k < half; k++) {
+                __m256d wr = _mm256_set1_pd(cosTable[k*tableStep]);
+                __m256d wi = _mm256_set1_pd(-sinTable[k*tableStep]);
+                double * re0 = re+(size_t)(start+k)*4;
+                double * im0 = im+(size_t)(start+k)*4;
+                double * re1 = re0+(size_t)half*4;
+                double * im1 = im0+(size_t)half*4;
+                __m256d xr = _mm256_loadu_pd(re1);
+                __m256d xi = _mm256_loadu_pd(im1);
+                __m256d tr = _mm256_sub_pd(_mm256_mul_pd(xr, wr), _mm256_mul_pd(xi, wi));
+                __m256d ti = _mm256_add_pd(_mm256_mul_pd(xr, wi), _mm256_mul_pd(xi, wr));
+                __m256d ur = _mm256_loadu_pd(re0);
+                __m256d ui = _mm256_loadu_pd(im0);
+                _mm256_storeu_pd(re1, _mm256_sub_pd(ur, tr));
+                _mm256_storeu_pd(im1, _mm256_sub_pd(ui, ti));
+                _mm256_storeu_pd(re0, _mm256_add_pd(ur, tr));
+                _mm256_storeu_pd(im0, _mm256_add_pd(ui, ti));
+            }
+        }
+    }
+#elif EDL_CHANNEL_NUM == 5 && defined(STATISTICS_SSE)
+    /*! Sample k of the 4 signals is two vectors of doubles, signals 1-2 and 3-4. */
+    bitReverse(re, im, size);
+    for (unsigned int half = 1; half < size; half *= 2) {
+        unsigned int tableStep = size/(2*half);
+        for (unsigned int start = 0; start < size; start += 2*half) {
+            for (unsigned int k = 0; k < half; k++) {
+                __m128d wr = _mm_set1_pd(cosTable[k*tableStep]);
+                __m128d wi = _mm_set1_pd(-sinTable[k*tableStep]);
+                double * re0 = re+(size_t)(start+k)*4;
+                double * im0 = im+(size_t)(start+k)*4;
+                double * re1 = re0+(size_t)half*4;
+                double * im1 = im0+(size_t)half*4;
+                for (unsigned int halfIdx = 0; halfIdx < 4; halfIdx += 2) {
+                    __m128d xr = _mm_loadu_pd(re1+halfIdx);
+                    __m128d xi = _mm_loadu_pd(im1+halfIdx);
+                    __m128d tr = _mm_sub_pd(_mm_mul_pd(xr, wr), _mm_mul_pd(xi, wi));
+                    __m128d ti = _mm_add_pd(_mm_mul_pd(xr, wi), _mm_mul_pd(xi, wr));
+                    __m128d ur = _mm_loadu_pd(re0+halfIdx);
+                    __m128d ui = _mm_loadu_pd(im0+halfIdx);
+                    _mm_storeu_pd(re1+halfIdx, _mm_sub_pd(ur, tr));
+                    _mm_storeu_pd(im1+halfIdx, _mm_sub_pd(ui, ti));
+                    _mm_storeu_pd(re0+halfIdx, _mm_add_pd(ur, tr));
+                    _mm_storeu_pd(im0+halfIdx, _mm_add_pd(ui, ti));
+                }
+            }
+        }
+    }
+#else
+    fftChannelsScalar(re, im, size, cosTable, sinTable);
+#endif
+}
+
+ChannelStatistics::ChannelStatistics(const ChannelStatisticsConfig_t &config) :
+    config(config),
+    valid(false),
+    binsNum(0),
+    psdScale(0.0) {
+    valid = config.samplingRate > 0.0 && config.updatePackets > 0 &&
+            config.fftSize >= STATISTICS_MIN_FFT_SIZE && config.fftSize <= STATISTICS_MAX_FFT_SIZE &&
+            (config.fftSize & (config.fftSize-1)) == 0;
+    if (valid) {
+        unsigned int size = config.fftSize;
+        binsNum = size/2+1;
+        window.resize(size);
+        double windowPower = 0.0;
+        for (unsigned int k = 0; k < size; k++) {
+            window[k] = 0.5-0.5*std::cos(2.0*pi*k/size);
+            windowPower += window[k]*window[k];
+        }
+        psdScale = 1.0/(config.samplingRate*windowPower);
+
+        cosTable.resize(size/2);
+        sinTable.resize(size/2);
+        for (unsigned int k = 0; k < size/2; k++) {
+            cosTable[k] = std::cos(2.0*pi*k/size);
+            sinTable[k] = std::sin(2.0*pi*k/size);
+        }
+
+        segment.resize((size_t)size*STATISTICS_CURRENT_CHANNELS);
+        re.resize((size_t)size*STATISTICS_CURRENT_CHANNELS);
+        im.resize((size_t)size*STATISTICS_CURRENT_CHANNELS);
+        periodogramSums.resize((size_t)binsNum*STATISTICS_CURRENT_CHANNELS);
+        psd.resize((size_t)binsNum*STATISTICS_CURRENT_CHANNELS);
+    }
+    reset();
+}
+
+bool ChannelStatistics::isValid() const {
+    return valid;
+}
+
+void ChannelStatistics::reset() {
+    std::fill(periodogramSums.begin(), periodogramSums.end(), 0.0);
+    std::fill(psd.begin(), psd.end(), 0.0);
+    segmentPackets = 0;
+    segmentsNum = 0;
+    streamPacket = 0;
+    updateProgress = 0;
+    updateFirstPacket = 0;
+    updateReady = false;
+    memset(&update, 0, sizeof(update));
+}
+
+void ChannelStatistics::skip(unsigned long long packetsNum) {
+    segmentPackets = 0;
+    streamPacket += packetsNum;
+    if (updateProgress == 0) {
+        updateFirstPacket = streamPacket;
+    }
+}
+
+unsigned int ChannelStatistics::process(const float * packets, unsigned int packetsNum) {
+    updateReady = false;
+    if (!valid) {
+        streamPacket += packetsNum;
+        return packetsNum;
+    }
+
+    unsigned int processedNum = std::min(packetsNum, config.updatePackets-updateProgress);
+    for (unsigned int packetIdx = 0; packetIdx < processedNum;) {
+        if (updateProgress == 0) {
+            /*! Sum relative to the first sample of the update. */
+            updateFirstPacket = streamPacket;
+            for (unsigned int channelIdx = 0; channelIdx < STATISTICS_CURRENT_CHANNELS; channelIdx++) {
+                offsets[channelIdx] = packets[(size_t)packetIdx*EDL_CHANNEL_NUM+1+channelIdx];
+                sums[channelIdx] = 0.0;
+                squareSums[channelIdx] = 0.0;
+                mins[channelIdx] = packets[(size_t)packetIdx*EDL_CHANNEL_NUM+1+channelIdx];
+                maxs[channelIdx] = mins[channelIdx];
+            }
+        }
+
+        /*! Go up to the end of the segment under way, then transform it. */
+        unsigned int runNum = std::min(processedNum-packetIdx, config.fftSize-segmentPackets);
+        double * segmentSamples = &segment[(size_t)segmentPackets*STATISTICS_CURRENT_CHANNELS];
+        for (unsigned int runIdx = 0; runIdx < runNum; runIdx++) {
+            const float * currents = packets+(size_t)(packetIdx+runIdx)*EDL_CHANNEL_NUM+1;
+            for (unsigned int channelIdx = 0; channelIdx < STATISTICS_CURRENT_CHANNELS; channelIdx++) {
+                double deviation = currents[channelIdx]-offsets[channelIdx];
+                sums[channelIdx] += deviation;
+                squareSums[channelIdx] += deviation*deviation;
+                mins[channelIdx] = std::min(mins[channelIdx], currents[channelIdx]);
+                maxs[channelIdx] = std::max(maxs[channelIdx], currents[channelIdx]);
+                segmentSamples[(size_t)runIdx*STATISTICS_CURRENT_CHANNELS+channelIdx] = currents[channelIdx];
+            }
+        }
+
+        packetIdx += runNum;
+        streamPacket += runNum;
+        updateProgress += runNum;
+        segmentPackets += runNum;
+        if (segmentPackets == config.fftSize) {
+            processSegment();
+        }
+    }
+
+    if (updateProgress == config.updatePackets) {
+        completeUpdate();
+    }
+    return processedNum;
+}
+
+bool ChannelStatistics::hasUpdate() const {
+    return updateReady;
+}
+
+const ChannelStatisticsUpdate_t &ChannelStatistics::getUpdate() const {
+    return update;
+}
+
+unsigned int ChannelStatistics::getBinsNum() const {
+    return binsNum;
+}
+
+double ChannelStatistics::getBinFrequency(unsigned int binIdx) const {
+    return valid ? binIdx*config.samplingRate/config.fftSize : 0.0;
+}
+
+double ChannelStatistics::getPsd(unsigned int binIdx, unsigned int channelIdx) const {
+    return psd[(size_t)binIdx*STATISTICS_CURRENT_CHANNELS+channelIdx];
+}
+
+void ChannelStatistics::processSegment() {
+    unsigned int size = config.fftSize;
+
+    /*! Detrend the segment by its mean and apply the window. */
+    double means[STATISTICS_CURRENT_CHANNELS] = {0.0};
+    for (unsigned int k = 0; k < size; k++) {
+        for (unsigned int channelIdx = 0; channelIdx < STATISTICS_CURRENT_CHANNELS; channelIdx++) {
+            means[channelIdx] += segment[(size_t)k*STATISTICS_CURRENT_CHANNELS+channelIdx];
+        }
+    }
+
+    for (unsigned int channelIdx = 0; channelIdx < STATISTICS_CURRENT_CHANNELS; channelIdx++) {
+        means[channelIdx] /= size;
+    }
+
+    for (unsigned int k = 0; k < size; k++) {
+        for (unsigned int channelIdx = 0; channelIdx < STATISTICS_CURRENT_CHANNELS; channelIdx++) {
+            size_t sampleIdx = (size_t)k*STATISTICS_CURRENT_CHANNELS+channelIdx;
+            re[sampleIdx] = (segment[sampleIdx]-means[channelIdx])*window[k];
+            im[sampleIdx] = 0.0;
+        }
+    }
+
+    fftChannels(re.data(), im.data(), size, cosTable.data(), sinTable.data());
+    for (size_t sampleIdx = 0; sampleIdx < periodogramSums.size(); sampleIdx++) {
+        periodogramSums[sampleIdx] += re[sampleIdx]*re[sampleIdx]+im[sampleIdx]*im[sampleIdx];
+    }
+    segmentsNum++;
+
+    /*! The second half of this segment is the first half of the next one. */
+    memmove(segment.data(), &segment[(size_t)(size/2)*STATISTICS_CURRENT_CHANNELS], (size_t)(size/2)*STATISTICS_CURRENT_CHANNELS*sizeof(double));
+    segmentPackets = size/2;
+}
+
+void ChannelStatistics::completeUpdate() {
+    update.firstPacket = updateFirstPacket;
+    update.packetsNum = updateProgress;
+    for (unsigned int channelIdx = 0; channelIdx < STATISTICS_CURRENT_CHANNELS; channelIdx++) {
+        double meanDeviation = sums[channelIdx]/updateProgress;
+        update.mean[channelIdx] = offsets[channelIdx]+meanDeviation;
+        update.rms[channelIdx] = std::sqrt(std::max(0.0, squareSums[channelIdx]/updateProgress-meanDeviation*meanDeviation));
+        update.min[channelIdx] = mins[channelIdx];
+        update.max[channelIdx] = maxs[channelIdx];
+    }
+
+    /*! One-sided density: the bins but DC and Nyquist also hold the power of the negative frequencies. */
+    update.segmentsNum = segmentsNum;
+    if (segmentsNum > 0) {
+        double scale = psdScale/segmentsNum;
+        for (unsigned int binIdx = 0; binIdx < binsNum; binIdx++) {
+            double binScale = (binIdx == 0 || binIdx == binsNum-1) ? scale : 2.0*scale;
+            for (unsigned int channelIdx = 0; channelIdx < STATISTICS_CURRENT_CHANNELS; channelIdx++) {
+                size_t sampleIdx = (size_t)binIdx*STATISTICS_CURRENT_CHANNELS+channelIdx;
+                psd[sampleIdx] = periodogramSums[sampleIdx]*binScale;
+                periodogramSums[sampleIdx] = 0.0;
+            }
+        }
+        segmentsNum = 0;
+    }
+
+    updateProgress = 0;
+    updateReady = true;
+}
@@ -0,0 +1,175 @@
+/*! \file channel_statistics.h
+ * \brief Declares class ChannelStatistics, which computes the statistics and the power spectral density of the current channels
+ * while data are collected.
+ */
+#ifndef CHANNEL_STATISTICS_H
+#define CHANNEL_STATISTICS_H
+
+#include <vector>
+#include <stdint.h>
+
+#include "edl.h"
+
+/*! \def STATISTICS_CURRENT_CHANNELS
+ * \brief Number of channels followed by a #ChannelStatistics: all of the channels but the voltage one.
+ */
+#define STATISTICS_CURRENT_CHANNELS (EDL_CHANNEL_NUM-1)
+
+/*! \def STATISTICS_MIN_FFT_SIZE
+ * \brief Smallest number of data packets of a Welch segment.
+ */
+#define STATISTICS_MIN_FFT_SIZE 16
+
+/*! \def STATISTICS_MAX_FFT_SIZE
+ * \brief Largest number of data packets of a Welch segment.
+ */
+#define STATISTICS_MAX_FFT_SIZE 65536
+
+/*! \struct ChannelStatisticsConfig_t
+ * \brief Configuration of a #ChannelStatistics.
+ */
+typedef struct {
+    double samplingRate; /*!< Sampling rate of the processed data packets [Hz]. */
+    unsigned int updatePackets; /*!< Data packets summarized by each update. */
+    unsigned int fftSize; /*!< Data packets of each Welch segment, a power of 2 from #STATISTICS_MIN_FFT_SIZE to
+                           * #STATISTICS_MAX_FFT_SIZE; consecutive segments overlap by half. The frequency resolution of the
+                           * power spectral density is \a samplingRate / \a fftSize. */
+} ChannelStatisticsConfig_t;
+
+/*! \struct ChannelStatisticsUpdate_t
+ * \brief Statistics of the current channels over the data packets of an update of a #ChannelStatistics.
+ * Currents are expressed in the unit of the current channels (pA or nA, depending on the range);
+ * index i refers to channel i + 1 of the data packets.
+ */
+typedef struct {
+    uint64_t firstPacket; /*!< Index of the first data packet of the update since the last ChannelStatistics::reset,
+                           * counting the missing ones. */
+    unsigned int packetsNum; /*!< Data packets summarized, ChannelStatisticsConfig_t::updatePackets. */
+    unsigned int segmentsNum; /*!< Welch segments averaged in the power spectral density; 0 if the data packets
+                               * following a gap were too few for a segment, in which case it is the one of the last update. */
+    double mean[STATISTICS_CURRENT_CHANNELS]; /*!< Mean current. */
+    double rms[STATISTICS_CURRENT_CHANNELS]; /*!< RMS of the deviation from the mean: the noise of the channel. */
+    float min[STATISTICS_CURRENT_CHANNELS]; /*!< Lowest current. */
+    float max[STATISTICS_CURRENT_CHANNELS]; /*!< Highest current. */
+} ChannelStatisticsUpdate_t;
+
+/*! \fn channelStatisticsDefaultConfig
+ * \brief Returns updates every second, with the largest Welch segments of which about 8 are averaged in each update.
+ */
+ChannelStatisticsConfig_t channelStatisticsDefaultConfig(double samplingRate);
+
+/*! \fn fftChannels
+ * \brief Computes in place the discrete Fourier transform of #STATISTICS_CURRENT_CHANNELS complex signals with the radix-2
+ * Cooley-Tukey algorithm. Sample k of signal c is at k * #STATISTICS_CURRENT_CHANNELS + c, so the signals are transformed
+ * together: each butterfly works on one AVX vector or two SSE2 vectors of doubles.
+ *
+ * \param re [in/out] Real parts.
+ * \param im [in/out] Imaginary parts.
+ * \param size [in] Samples of each signal, a power of 2.
+ * \param cosTable [in] cos(2 pi k / \a size), for k lower than \a size / 2.
+ * \param sinTable [in] sin(2 pi k / \a size), for k lower than \a size / 2.
+ */
+void fftChannels(double * re, double * im, EDL_IN unsigned int size, EDL_IN const double * cosTable, EDL_IN const double * sinTable);
+
+/*! \fn fftChannelsScalar
+ * \brief Reference implementation of #fftChannels without vector instructions.
+ */
+void fftChannelsScalar(double * re, double * im, EDL_IN unsigned int size, EDL_IN const double * cosTable, EDL_IN const double * sinTable);
+
+/*! \class ChannelStatistics
+ * \brief Streaming statistics of the #STATISTICS_CURRENT_CHANNELS current channels: every ChannelStatisticsConfig_t::updatePackets
+ * data packets it publishes their mean, RMS noise, minimum and maximum, and their one-sided power spectral density estimated
+ * with the Welch method: Hann windowed segments overlapping by half, each one detrended by its mean, whose periodograms
+ * are averaged over the update. The sums are kept relative to the first sample of the update, so that the noise of a
+ * channel is not lost in the rounding of a large offset. The cost per data packet is constant; the periodograms take
+ * O(log2(ChannelStatisticsConfig_t::fftSize)) operations per data packet, see #fftChannels.
+ * Nothing is allocated after construction.
+ */
+class ChannelStatistics {
+public:
+    /*! \brief ChannelStatistics constructor.
+     * An invalid configuration gives an object that never publishes an update, see #isValid.
+     */
+    explicit ChannelStatistics(const ChannelStatisticsConfig_t &config);
+
+    /*! \brief Returns false if the configuration given to the constructor is invalid.
+     */
+    bool isValid(EDL_VOID) const;
+
+    /*! \brief Discards the update under way and the power spectral density, and restarts counting data packets from 0.
+     */
+    void reset(EDL_VOID);
+
+    /*! \brief Accounts for missing data packets: the Welch segment under way is discarded, since it would no longer be
+     * contiguous, and the count of data packets advances. The missing data packets do not count towards the update.
+     *
+     * \param packetsNum [in] Number of missing data packets.
+     */
+    void skip(EDL_IN unsigned long long packetsNum);
+
+    /*! \brief Processes consecutive data packets, as returned by EDL::readData, up to the end of the update under way.
+     *
+     * \param packets [in] \a packetsNum data packets of #EDL_CHANNEL_NUM samples each.
+     * \param packetsNum [in] Number of data packets.
+     * \return Number of data packets processed, at least 1 if \a packetsNum is not 0. If an update has been completed,
+     * see #hasUpdate, it can be lower than \a packetsNum: call again with the remaining data packets after reading the update.
+     */
+    unsigned int process(EDL_IN const float * packets, EDL_IN unsigned int packetsNum);
+
+    /*! \brief Returns true if the last call to #process has completed an update.
+     */
+    bool hasUpdate(EDL_VOID) const;
+
+    /*! \brief Returns the last update completed.
+     */
+    const ChannelStatisticsUpdate_t &getUpdate(EDL_VOID) const;
+
+    /*! \brief Returns the number of frequency bins of the power spectral density, ChannelStatisticsConfig_t::fftSize / 2 + 1.
+     */
+    unsigned int getBinsNum(EDL_VOID) const;
+
+    /*! \brief Returns the frequency of a bin of the power spectral density [Hz].
+     */
+    double getBinFrequency(EDL_IN unsigned int binIdx) const;
+
+    /*! \brief Returns the power spectral density of the last update that averaged at least one segment, 0 before it,
+     * in squared units of the current channel per Hz.
+     *
+     * \param binIdx [in] Index of the frequency bin, lower than #getBinsNum.
+     * \param channelIdx [in] Index of the current channel, lower than #STATISTICS_CURRENT_CHANNELS.
+     */
+    double getPsd(EDL_IN unsigned int binIdx, EDL_IN unsigned int channelIdx) const;
+
+private:
+    void processSegment();
+    void completeUpdate();
+
+    ChannelStatisticsConfig_t config;
+    bool valid;
+    unsigned int binsNum;
+    double psdScale; /*!< Converts the squared magnitudes of a periodogram into a power spectral density. */
+    std::vector <double> window; /*!< Hann window of a segment. */
+    std::vector <double> cosTable;
+    std::vector <double> sinTable;
+    /*! The segment under way and the spectra, with the channels interleaved as #fftChannels expects. */
+    std::vector <double> segment;
+    std::vector <double> re;
+    std::vector <double> im;
+    std::vector <double> periodogramSums;
+    std::vector <double> psd;
+    unsigned int segmentPackets; /*!< Data packets in the segment under way. */
+    unsigned int segmentsNum; /*!< Segments in \a periodogramSums. */
+
+    unsigned long long streamPacket; /*!< Data packets since the last #reset, counting the missing ones. */
+    unsigned int updateProgress; /*!< Data packets in the update under way. */
+    uint64_t updateFirstPacket;
+    double offsets[STATISTICS_CURRENT_CHANNELS]; /*!< First sample of the update, subtracted before summing. */
+    double sums[STATISTICS_CURRENT_CHANNELS];
+    double squareSums[STATISTICS_CURRENT_CHANNELS];
+    float mins[STATISTICS_CURRENT_CHANNELS];
+    float maxs[STATISTICS_CURRENT_CHANNELS];
+    bool updateReady;
+    ChannelStatisticsUpdate_t update;
+};
+
+#endif // CHANNEL_STATISTICS_H
@@ -0,0 +1,208 @@
+/*! \file command_transaction.cpp
+ * \brief Defines class CommandTransaction.
+ */
+#include "command_transaction.h"
+
+#include <cmath>
+
+CommandTransaction::CommandTransaction(EDL &edl) :
+    edl(edl) {
+    clear();
+}
+
+void CommandTransaction::clear() {
+    for (unsigned int commandIdx = 0; commandIdx < EdlCommandIdNum; commandIdx++) {
+        commandFlags[commandIdx] = false;
+        commands[commandIdx].radioId = 0;
+        commands[commandIdx].checkboxChecked = EDL_CHECKBOX_UNCHECKED;
+        commands[commandIdx].buttonPressed = EDL_BUTTON_RELEASED;
+        commands[commandIdx].value = 0.0;
+    }
+    buttonId = -1;
+    button = commands[0];
+    setError = EdlSuccess;
+    setViolation.clear();
+    violation.clear();
+}
+
+bool CommandTransaction::accept(EdlCommandId_t commandId, EdlCommandType_t type, EdlCommandType_t otherType, const char * setter) {
+    if (commandId < 0 || commandId >= EdlCommandIdNum) {
+        if (setError == EdlSuccess) {
+            setError = EdlCommandIdOutOfRangeError;
+            setViolation = std::string(setter)+": command "+std::to_string((int)commandId)+" out of range";
+        }
+        return false;
+    }
+
+    if (edlCommandType(commandId) != type && edlCommandType(commandId) != otherType) {
+        if (setError == EdlSuccess) {
+            setError = EdlCommandIdOutOfRangeError;
+            setViolation = std::string(setter)+": command "+std::to_string((int)commandId)+" has another type";
+        }
+        return false;
+    }
+    return true;
+}
+
+void CommandTransaction::addViolation(const std::string &description) {
+    if (violation.empty()) {
+        violation = description;
+    }
+}
+
+void CommandTransaction::setRadio(EdlCommandId_t commandId, unsigned int radioId) {
+    if (accept(commandId, EdlCommandTypeRadio, EdlCommandTypeRadio, "setRadio")) {
+        commandFlags[commandId] = true;
+        commands[commandId].radioId = radioId;
+    }
+}
+
+void CommandTransaction::setCheckbox(EdlCommandId_t commandId, bool checked) {
+    if (accept(commandId, EdlCommandTypeCheckbox, EdlCommandTypeCheckbox, "setCheckbox")) {
+        commandFlags[commandId] = true;
+        commands[commandId].checkboxChecked = checked;
+    }
+}
+
+void CommandTransaction::setValue(EdlCommandId_t commandId, double value) {
+    if (accept(commandId, EdlCommandTypeValue, EdlCommandTypeProtocolValue, "setValue")) {
+        commandFlags[commandId] = true;
+        commands[commandId].value = value;
+    }
+}
+
+void CommandTransaction::setButton(EdlCommandId_t commandId, bool pressed) {
+    if (!accept(commandId, EdlCommandTypePushButton, EdlCommandTypeCheckButton, "setButton")) {
+        return;
+    }
+
+    /*! Only one button can be sent by a write. */
+    if (buttonId >= 0 && buttonId != (int)commandId) {
+        if (setError == EdlSuccess) {
+            setError = EdlCommandIdOutOfRangeError;
+            setViolation = "setButton: command "+std::to_string((int)commandId)+" after button "+std::to_string(buttonId)+
+                    ", a transaction sends one button";
+        }
+        return;
+    }
+    buttonId = (int)commandId;
+    button.buttonPressed = pressed;
+}
+
+EdlErrorCode_t CommandTransaction::validate() {
+    violation = setViolation;
+    if (setError != EdlSuccess) {
+        return setError;
+    }
+
+    for (unsigned int commandIdx = 0; commandIdx < EdlCommandIdNum; commandIdx++) {
+        EdlCommandId_t commandId = (EdlCommandId_t)commandIdx;
+        if (!commandFlags[commandIdx]) {
+            continue;
+        }
+
+        EdlCommandType_t type = edlCommandType(commandId);
+        if (type == EdlCommandTypeRadio && commands[commandIdx].radioId >= edlRadiosNum(commandId)) {
+            addViolation("command "+std::to_string(commandIdx)+": radio "+
+                         std::to_string(commands[commandIdx].radioId)+" out of range");
+            return EdlCommandIdOutOfRangeError;
+        }
+
+        if ((type == EdlCommandTypeValue || type == EdlCommandTypeProtocolValue) && !std::isfinite(commands[commandIdx].value)) {
+            addViolation("command "+std::to_string(commandIdx)+": value not finite");
+            return EdlCommandIdOutOfRangeError;
+        }
+    }
+
+    /*! Protocol parameters are only applied by #EdlCommandApplyProtocol: no other button may take its place. */
+    bool protocolSet = false;
+    for (unsigned int commandIdx = 0; commandIdx < EdlCommandIdNum; commandIdx++) {
+        protocolSet = protocolSet || (commandFlags[commandIdx] && edlCommandType((EdlCommandId_t)commandIdx) == EdlCommandTypeProtocolValue);
+    }
+
+    if (protocolSet && buttonId >= 0 && buttonId != EdlCommandApplyProtocol) {
+        addViolation("protocol parameters need EdlCommandApplyProtocol, not button "+std::to_string(buttonId));
+        return EdlViolatedTrialRuleError;
+    }
+
+    /*! A new protocol must come with all of its parameters, and all of the protocol parameters must obey the rules. */
+    if (protocolSet || buttonId == EdlCommandApplyProtocol) {
+        if (!commandFlags[EdlCommandMainTrial]) {
+            addViolation("protocol parameters set without EdlCommandMainTrial");
+            return EdlViolatedTrialRuleError;
+        }
+
+        double values[EdlCommandIdNum];
+        double protocol = commands[EdlCommandMainTrial].value;
+        for (unsigned int commandIdx = 0; commandIdx < EdlCommandIdNum; commandIdx++) {
+            values[commandIdx] = commands[commandIdx].value;
+            if (edlProtocolUsesCommand(protocol, (EdlCommandId_t)commandIdx) && !commandFlags[commandIdx]) {
+                addViolation("protocol "+std::to_string((int)protocol)+" needs command "+std::to_string(commandIdx));
+                return EdlViolatedTrialRuleError;
+            }
+        }
+
+        if (edlCheckProtocol(values) != EdlSuccess) {
+            addViolation("protocol parameters out of the limits of the protocol rules, see edlCheckProtocol");
+            return EdlViolatedTrialRuleError;
+        }
+    }
+    return EdlSuccess;
+}
+
+EdlErrorCode_t CommandTransaction::commit() {
+    EdlErrorCode_t res = validate();
+    if (res != EdlSuccess) {
+        return res;
+    }
+
+    /*! Protocol parameters without a button are applied; otherwise the last stacked command that may be sent is sent. */
+    int sentId = buttonId;
+    if (sentId < 0) {
+        for (unsigned int commandIdx = 0; commandIdx < EdlCommandIdNum; commandIdx++) {
+            if (commandFlags[commandIdx] && edlCommandType((EdlCommandId_t)commandIdx) == EdlCommandTypeProtocolValue) {
+                sentId = EdlCommandApplyProtocol;
+                button.buttonPressed = EDL_BUTTON_PRESSED;
+                break;
+
+            } else if (commandFlags[commandIdx]) {
+                sentId = (int)commandIdx;
+            }
+        }
+    }
+
+    if (sentId < 0) {
+        return EdlSuccess;
+    }
+
+    for (unsigned int commandIdx = 0; commandIdx < EdlCommandIdNum; commandIdx++) {
+        if (commandFlags[commandIdx] && (int)commandIdx != sentId) {
+            res = edl.setCommand((EdlCommandId_t)commandIdx, commands[commandIdx], false);
+            if (res != EdlSuccess) {
+                return res;
+            }
+        }
+    }
+
+    res = edl.setCommand((EdlCommandId_t)sentId, sentId == buttonId || !commandFlags[sentId] ? button : commands[sentId], true);
+    if (res == EdlSuccess) {
+        clear();
+    }
+    return res;
+}
+
+unsigned int CommandTransaction::getCommandsNum() const {
+    unsigned int commandsNum = buttonId >= 0 ? 1 : 0;
+    bool protocolSet = false;
+    for (unsigned int commandIdx = 0; commandIdx < EdlCommandIdNum; commandIdx++) {
+        if (commandFlags[commandIdx]) {
+            commandsNum++;
+            protocolSet = protocolSet || edlCommandType((EdlCommandId_t)commandIdx) == EdlCommandTypeProtocolValue;
+        }
+    }
+    return commandsNum+(protocolSet && buttonId < 0 ? 1 : 0);
+}
+
+const std::string &CommandTransaction::getViolation() const {
+    return violation;
+}
@@ -0,0 +1,97 @@
+/*! \file command_transaction.h
+ * \brief Declares class CommandTransaction, which collects the settings of a device, validates them and sends them together.
+ */
+#ifndef COMMAND_TRANSACTION_H
+#define COMMAND_TRANSACTION_H
+
+#include <string>
+
+#include "edl.h"
+#include "edl_settings.h"
+
+/*! \class CommandTransaction
+ * \brief Collects commands for EDL::setCommand, checks them before anything is sent and sends them in a single write.
+ *
+ * EDL::setCommand stacks the commands sent with \a sendFlag false and sends all of them with the first one sent with
+ * \a sendFlag true, and every write may cost some data from the device. The transaction stacks all of its commands and sends
+ * the last one, so each #commit is one write. A push button or check button can only be sent, not stacked, so a transaction
+ * holds at most one of them and sends it last; protocol parameters can only be stacked and are only applied by
+ * #EdlCommandApplyProtocol, which is added when they are set without another button.
+ * A command set twice is sent once, with the last value.
+ *
+ * The checks, done by #validate, are those that would otherwise only surface as errors of EDL::setCommand:
+ * the command types, the radio IDs, and the protocol rules of #edlCheckProtocol, which the device only enforces at
+ * #EdlCommandApplyProtocol, after the other commands have been sent. A transaction that sets #EdlCommandMainTrial must
+ * also set every parameter used by that protocol, so that nothing depends on values stacked by earlier writes.
+ */
+class CommandTransaction {
+public:
+    /*! \brief CommandTransaction constructor.
+     *
+     * \param edl [in] Connected device the commands are sent to; it must outlive this object.
+     */
+    explicit CommandTransaction(EDL &edl);
+
+    /*! \brief Selects a radio button of a command of type #EdlCommandTypeRadio, e.g. EDL_RADIO_SAMPLING_RATE_5_KHZ.
+     */
+    void setRadio(EDL_IN EdlCommandId_t commandId, EDL_IN unsigned int radioId);
+
+    /*! \brief Sets a command of type #EdlCommandTypeCheckbox.
+     */
+    void setCheckbox(EDL_IN EdlCommandId_t commandId, EDL_IN bool checked);
+
+    /*! \brief Sets a command of type #EdlCommandTypeValue or #EdlCommandTypeProtocolValue.
+     */
+    void setValue(EDL_IN EdlCommandId_t commandId, EDL_IN double value);
+
+    /*! \brief Sets the push button or check button sent by the transaction.
+     *
+     * \param commandId [in] Command of type #EdlCommandTypePushButton or #EdlCommandTypeCheckButton.
+     * \param pressed [in] State of a check button, e.g. #EDL_BUTTON_PRESSED; ignored for push buttons.
+     */
+    void setButton(EDL_IN EdlCommandId_t commandId, EDL_IN bool pressed = EDL_BUTTON_PRESSED);
+
+    /*! \brief Checks the commands without sending them.
+     *
+     * \return #EdlSuccess, #EdlCommandIdOutOfRangeError for an invalid command, a command used with the wrong type
+     * or a second button, or #EdlViolatedTrialRuleError for invalid protocol parameters; see #getViolation.
+     */
+    EdlErrorCode_t validate(EDL_VOID);
+
+    /*! \brief Validates the commands and, if they are valid, sends them in a single write and empties the transaction.
+     * If EDL::setCommand fails, the commands stacked before the failure stay stacked in the library until the next write.
+     *
+     * \return #EdlErrorCode_t Error code: that of #validate, or the first one returned by EDL::setCommand.
+     */
+    EdlErrorCode_t commit(EDL_VOID);
+
+    /*! \brief Discards the commands.
+     */
+    void clear(EDL_VOID);
+
+    /*! \brief Returns the number of commands that #commit would pass to EDL::setCommand.
+     */
+    unsigned int getCommandsNum(EDL_VOID) const;
+
+    /*! \brief Returns the description of the first problem found by #validate, empty if none.
+     */
+    const std::string &getViolation(EDL_VOID) const;
+
+private:
+    CommandTransaction(const CommandTransaction &);
+    CommandTransaction &operator=(const CommandTransaction &);
+
+    bool accept(EdlCommandId_t commandId, EdlCommandType_t type, EdlCommandType_t otherType, const char * setter);
+    void addViolation(const std::string &description);
+
+    EDL &edl;
+    bool commandFlags[EdlCommandIdNum]; /*!< Commands set, other than the button. */
+    EdlCommandStruct_t commands[EdlCommandIdNum];
+    int buttonId; /*!< Button sent last, -1 if none. */
+    EdlCommandStruct_t button;
+    EdlErrorCode_t setError; /*!< First problem found while the commands were set. */
+    std::string setViolation;
+    std::string violation;
+};
+
+#endif // COMMAND_TRANSACTION_H
@@ -0,0 +1,229 @@
+/*! \file data_writer.cpp
+ * \brief Defines class DataWriter.
+ */
+#include "data_writer.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/stat.h>
+
+#ifdef _WIN32
+#include <io.h>
+#include <malloc.h>
+#define DATA_WRITER_OPEN_FLAGS (O_WRONLY | O_CREAT | O_TRUNC | O_BINARY)
+#define ftruncate _chsize_s
+#else
+#include <unistd.h>
+#define DATA_WRITER_OPEN_FLAGS (O_WRONLY | O_CREAT | O_TRUNC)
+#endif
+
+static char * allocateAligned(size_t size) {
+#ifdef _WIN32
+    return (char *)_aligned_malloc(size, DATA_WRITER_ALIGNMENT);
+#else
+    void * ptr;
+    if (posix_memalign(&ptr, DATA_WRITER_ALIGNMENT, size) != 0) {
+        return NULL;
+    }
+    return (char *)ptr;
+#endif
+}
+
+static void freeAligned(char * ptr) {
+#ifdef _WIN32
+    _aligned_free(ptr);
+#else
+    free(ptr);
+#endif
+}
+
+DataWriter::DataWriter(size_t blockSize) :
+    blockSize((blockSize+DATA_WRITER_ALIGNMENT-1)/DATA_WRITER_ALIGNMENT*DATA_WRITER_ALIGNMENT),
+    fillIdx(0),
+    fillSize(0),
+    fd(-1),
+    direct(false),
+    failed(false),
+    writtenBytes(0),
+    pending(false),
+    pendingIdx(0),
+    pendingSize(0),
+    stopping(false) {
+    blocks[0] = allocateAligned(this->blockSize);
+    blocks[1] = allocateAligned(this->blockSize);
+}
+
+DataWriter::~DataWriter() {
+    close();
+    freeAligned(blocks[0]);
+    freeAligned(blocks[1]);
+}
+
+bool DataWriter::open(const std::string &path, DataWriterMode_t mode) {
+    if (fd >= 0 || blocks[0] == NULL || blocks[1] == NULL) {
+        return false;
+    }
+
+    direct = false;
+#ifdef O_DIRECT
+    if (mode == DataWriterDirect) {
+        fd = ::open(path.c_str(), DATA_WRITER_OPEN_FLAGS | O_DIRECT, 0644);
+        direct = fd >= 0;
+    }
+#endif
+
+    /*! Fall back to buffered mode if direct mode is not supported by the system or by the file system. */
+    if (fd < 0) {
+        fd = ::open(path.c_str(), DATA_WRITER_OPEN_FLAGS, 0644);
+    }
+
+    if (fd < 0) {
+        return false;
+    }
+
+    fillIdx = 0;
+    fillSize = 0;
+    failed = false;
+    writtenBytes = 0;
+    pending = false;
+    stopping = false;
+    writerThread = std::thread(&DataWriter::writerLoop, this);
+    return true;
+}
+
+bool DataWriter::write(const void * data, size_t size) {
+    if (fd < 0) {
+        return false;
+    }
+
+    const char * src = (const char *)data;
+    writtenBytes += size;
+    while (size > 0) {
+        size_t chunk = blockSize-fillSize;
+        if (chunk > size) {
+            chunk = size;
+        }
+        std::memcpy(blocks[fillIdx]+fillSize, src, chunk);
+        fillSize += chunk;
+        src += chunk;
+        size -= chunk;
+
+        if (fillSize == blockSize && !submitFillBlock()) {
+            return false;
+        }
+    }
+
+    std::lock_guard <std::mutex> lock(mutex);
+    return !failed;
+}
+
+bool DataWriter::close() {
+    if (fd < 0) {
+        return true;
+    }
+
+    /*! In direct mode the last block must be padded to the alignment; the padding is truncated afterwards. */
+    bool padded = false;
+    if (direct && fillSize%DATA_WRITER_ALIGNMENT != 0) {
+        size_t alignedSize = (fillSize+DATA_WRITER_ALIGNMENT-1)/DATA_WRITER_ALIGNMENT*DATA_WRITER_ALIGNMENT;
+        std::memset(blocks[fillIdx]+fillSize, 0, alignedSize-fillSize);
+        fillSize = alignedSize;
+        padded = true;
+    }
+
+    if (fillSize > 0) {
+        submitFillBlock();
+    }
+
+    {
+        std::lock_guard <std::mutex> lock(mutex);
+        stopping = true;
+    }
+    condition.notify_all();
+    writerThread.join();
+
+    bool res = !failed;
+    if (padded && ftruncate(fd, (off_t)writtenBytes) != 0) {
+        res = false;
+    }
+
+    if (::close(fd) != 0) {
+        res = false;
+    }
+    fd = -1;
+    return res;
+}
+
+bool DataWriter::isOpen() const {
+    return fd >= 0;
+}
+
+bool DataWriter::isDirect() const {
+    return fd >= 0 && direct;
+}
+
+unsigned long long DataWriter::getWrittenBytes() const {
+    return writtenBytes;
+}
+
+bool DataWriter::submitFillBlock() {
+    std::unique_lock <std::mutex> lock(mutex);
+
+    /*! Wait for the writer thread to release the other block. */
+    while (pending) {
+        condition.wait(lock);
+    }
+
+    if (failed) {
+        return false;
+    }
+
+    pending = true;
+    pendingIdx = fillIdx;
+    pendingSize = fillSize;
+    lock.unlock();
+    condition.notify_all();
+
+    fillIdx ^= 1;
+    fillSize = 0;
+    return true;
+}
+
+void DataWriter::writerLoop() {
+    std::unique_lock <std::mutex> lock(mutex);
+    for (;;) {
+        while (!pending && !stopping) {
+            condition.wait(lock);
+        }
+
+        if (!pending) {
+            break;
+        }
+
+        /*! Write the block without holding the lock, so that the other block can be filled meanwhile. */
+        const char * block = blocks[pendingIdx];
+        size_t size = pendingSize;
+        lock.unlock();
+        bool res = writeBlock(block, size);
+        lock.lock();
+
+        if (!res) {
+            failed = true;
+        }
+        pending = false;
+        condition.notify_all();
+    }
+}
+
+bool DataWriter::writeBlock(const char * block, size_t size) {
+    while (size > 0) {
+        long res = (long)::write(fd, block, (unsigned int)size);
+        if (res <= 0) {
+            return false;
+        }
+        block += res;
+        size -= (size_t)res;
+    }
+    return true;
+}
@@ -0,0 +1,109 @@
+/*! \file data_writer.h
+ * \brief Declares class DataWriter, which stores the acquired data in large blocks.
+ */
+#ifndef DATA_WRITER_H
+#define DATA_WRITER_H
+
+#include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+/*! \def DATA_WRITER_BLOCK_SIZE
+ * \brief Default size in bytes of the blocks written with a single call.
+ */
+#define DATA_WRITER_BLOCK_SIZE (1 << 20)
+
+/*! \def DATA_WRITER_ALIGNMENT
+ * \brief Alignment in bytes of the block buffers, of their size and of the file offsets in direct mode.
+ */
+#define DATA_WRITER_ALIGNMENT 4096
+
+/*! \enum DataWriterMode_t
+ * \brief Enumerates the ways a #DataWriter can access the file.
+ */
+typedef enum {
+    DataWriterBuffered, /*!< Blocks are written through the operating system page cache. */
+    DataWriterDirect /*!< Blocks are written bypassing the page cache (O_DIRECT), where supported.
+                      * Otherwise the file is written as in #DataWriterBuffered mode. */
+} DataWriterMode_t;
+
+/*! \class DataWriter
+ * \brief Coalesces small writes into aligned blocks and writes each full block with a single call.
+ * Two blocks are used in turn: while a background thread writes one of them to the file,
+ * the other one is filled by #write, which only waits if both blocks are full.
+ */
+class DataWriter {
+public:
+    /*! \brief DataWriter constructor.
+     *
+     * \param blockSize [in] Size in bytes of each block; rounded up to a multiple of #DATA_WRITER_ALIGNMENT.
+     */
+    explicit DataWriter(size_t blockSize = DATA_WRITER_BLOCK_SIZE);
+
+    /*! \brief DataWriter destructor. Closes the file if still open.
+     */
+    ~DataWriter();
+
+    /*! \brief Creates or truncates a file and starts the background writer thread.
+     *
+     * \param path [in] Path of the file.
+     * \param mode [in] File access mode.
+     * \return True on success.
+     */
+    bool open(const std::string &path, DataWriterMode_t mode = DataWriterBuffered);
+
+    /*! \brief Appends data to the file.
+     *
+     * \param data [in] Data to append.
+     * \param size [in] Size of \a data in bytes.
+     * \return False if the file is not open or a previous block could not be written.
+     */
+    bool write(const void * data, size_t size);
+
+    /*! \brief Writes the pending data, pads the file if needed by the direct mode, and closes it.
+     *
+     * \return True if all of the data has been written.
+     */
+    bool close();
+
+    /*! \brief Returns true if the file is open.
+     */
+    bool isOpen() const;
+
+    /*! \brief Returns true if the file is open in direct mode and the page cache is actually bypassed.
+     */
+    bool isDirect() const;
+
+    /*! \brief Returns the number of bytes passed to #write since the file was opened.
+     */
+    unsigned long long getWrittenBytes() const;
+
+private:
+    DataWriter(const DataWriter &);
+    DataWriter &operator=(const DataWriter &);
+
+    void writerLoop();
+    bool writeBlock(const char * block, size_t size);
+    bool submitFillBlock();
+
+    size_t blockSize;
+    char * blocks[2]; /*!< Aligned block buffers, used in turn. */
+    int fillIdx; /*!< Index of the block being filled by #write. */
+    size_t fillSize; /*!< Bytes stored in the block being filled. */
+
+    int fd;
+    bool direct;
+    bool failed;
+    unsigned long long writtenBytes;
+
+    std::thread writerThread;
+    std::mutex mutex;
+    std::condition_variable condition;
+    bool pending; /*!< True while a block is waiting to be written by the writer thread. */
+    int pendingIdx;
+    size_t pendingSize;
+    bool stopping;
+};
+
+#endif // DATA_WRITER_H
@@ -0,0 +1,210 @@
+/*! \file decimator.cpp
+ * \brief Defines classes Decimator and DecimatorSink.
+ */
+#include "decimator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "deinterleave.h"
+
+#if defined(__AVX__) || defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(_M_X64)
+#include <immintrin.h>
+#define DECIMATOR_SSE
+#endif
+
+#if defined(__AVX__)
+#define DECIMATOR_AVX
+#endif
+
+static const double pi = 3.14159265358979323846;
+
+/*! \fn besselI0
+ * \brief Returns the modified Bessel function of the first kind of order 0, used by the Kaiser window.
+ */
+static double besselI0(double x) {
+    double sum = 1.0;
+    double term = 1.0;
+    for (unsigned int k = 1; k < 100 && term > 1.0e-12*sum; k++) {
+        term *= (0.5*x/k)*(0.5*x/k);
+        sum += term;
+    }
+    return sum;
+}
+
+/*! \fn dotProduct
+ * \brief Returns the dot product of two arrays of \a n floats, with two AVX or SSE accumulators when available.
+ */
+static float dotProduct(const float * a, const float * b, unsigned int n) {
+    unsigned int i = 0;
+    float sum = 0.0f;
+
+#if defined(DECIMATOR_AVX)
+    __m256 acc0 = _mm256_setzero_ps();
+    __m256 acc1 = _mm256_setzero_ps();
+    for (; i+16 <= n; i += 16) {
+        acc0 = _mm256_add_ps(acc0, _mm256_mul_ps(_mm256_loadu_ps(a+i), _mm256_loadu_ps(b+i)));
+        acc1 = _mm256_add_ps(acc1, _mm256_mul_ps(_mm256_loadu_ps(a+i+8), _mm256_loadu_ps(b+i+8)));
+    }
+    acc0 = _mm256_add_ps(acc0, acc1);
+    __m128 acc = _mm_add_ps(_mm256_castps256_ps128(acc0), _mm256_extractf128_ps(acc0, 1));
+    acc = _mm_add_ps(acc, _mm_movehl_ps(acc, acc));
+    acc = _mm_add_ss(acc, _mm_shuffle_ps(acc, acc, 1));
+    sum = _mm_cvtss_f32(acc);
+#elif defined(DECIMATOR_SSE)
+    __m128 acc0 = _mm_setzero_ps();
+    __m128 acc1 = _mm_setzero_ps();
+    for (; i+8 <= n; i += 8) {
+        acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_loadu_ps(a+i), _mm_loadu_ps(b+i)));
+        acc1 = _mm_add_ps(acc1, _mm_mul_ps(_mm_loadu_ps(a+i+4), _mm_loadu_ps(b+i+4)));
+    }
+    __m128 acc = _mm_add_ps(acc0, acc1);
+    acc = _mm_add_ps(acc, _mm_movehl_ps(acc, acc));
+    acc = _mm_add_ss(acc, _mm_shuffle_ps(acc, acc, 1));
+    sum = _mm_cvtss_f32(acc);
+#endif
+
+    for (; i < n; i++) {
+        sum += a[i]*b[i];
+    }
+    return sum;
+}
+
+Decimator::Decimator(unsigned int factor, unsigned int tapsPerPhase) :
+    factor(factor > 0 ? factor : 1),
+    halfTapsNum(0),
+    historySize(0),
+    historyFirst(0),
+    nextCenter(0),
+    firstInput(0),
+    primed(false) {
+    if (tapsPerPhase == 0) {
+        tapsPerPhase = 1;
+    }
+
+    /*! A factor of 1 keeps a single unity tap. */
+    if (this->factor > 1) {
+        halfTapsNum = this->factor*tapsPerPhase/2;
+    }
+
+    /*! Kaiser windowed sinc, normalized to unity gain at DC. */
+    double cutoff = getCutoff();
+    taps.resize(2*halfTapsNum+1);
+    double sum = 0.0;
+    for (unsigned int tapIdx = 0; tapIdx < taps.size(); tapIdx++) {
+        double offset = (double)tapIdx-(double)halfTapsNum;
+        double sinc = offset == 0.0 ? 1.0 : std::sin(2.0*pi*cutoff*offset)/(2.0*pi*cutoff*offset);
+        double ratio = halfTapsNum > 0 ? offset/halfTapsNum : 0.0;
+        double window = besselI0(DECIMATOR_KAISER_BETA*std::sqrt(1.0-ratio*ratio))/besselI0(DECIMATOR_KAISER_BETA);
+        taps[tapIdx] = (float)(sinc*window);
+        sum += taps[tapIdx];
+    }
+
+    for (unsigned int tapIdx = 0; tapIdx < taps.size(); tapIdx++) {
+        taps[tapIdx] = (float)(taps[tapIdx]/sum);
+    }
+}
+
+void Decimator::reset() {
+    restart(0);
+}
+
+void Decimator::restart(uint64_t firstPacket) {
+    firstInput = (int64_t)firstPacket;
+    nextCenter = (firstInput+factor-1)/factor*factor;
+    primed = false;
+}
+
+uint64_t Decimator::getNextOutput() const {
+    return (uint64_t)(nextCenter/factor);
+}
+
+unsigned int Decimator::process(const float * packets, unsigned int packetsNum, std::vector <float> &decimated) {
+    decimated.clear();
+    if (packetsNum == 0) {
+        return 0;
+    }
+
+    /*! Take the input before the first data packet equal to it. */
+    if (!primed) {
+        for (unsigned int channelIdx = 0; channelIdx < EDL_CHANNEL_NUM; channelIdx++) {
+            if (history[channelIdx].size() < halfTapsNum) {
+                history[channelIdx].resize(halfTapsNum);
+            }
+            std::fill(history[channelIdx].begin(), history[channelIdx].begin()+halfTapsNum, packets[channelIdx]);
+        }
+        historySize = halfTapsNum;
+        historyFirst = firstInput-(int64_t)halfTapsNum;
+        primed = true;
+    }
+
+    /*! Append the new data packets to the history, one array per channel. */
+    float * channels[EDL_CHANNEL_NUM];
+    for (unsigned int channelIdx = 0; channelIdx < EDL_CHANNEL_NUM; channelIdx++) {
+        if (history[channelIdx].size() < historySize+packetsNum) {
+            history[channelIdx].resize(historySize+packetsNum);
+        }
+        channels[channelIdx] = history[channelIdx].data()+historySize;
+    }
+    deinterleavePackets(packets, packetsNum, channels);
+    historySize += packetsNum;
+
+    /*! Compute the outputs whose window is complete. */
+    unsigned int outputsNum = 0;
+    int64_t lastSample = historyFirst+(int64_t)historySize-1;
+    unsigned int tapsNum = (unsigned int)taps.size();
+    while (nextCenter+(int64_t)halfTapsNum <= lastSample) {
+        size_t windowIdx = (size_t)(nextCenter-(int64_t)halfTapsNum-historyFirst);
+        for (unsigned int channelIdx = 0; channelIdx < EDL_CHANNEL_NUM; channelIdx++) {
+            decimated.push_back(dotProduct(taps.data(), history[channelIdx].data()+windowIdx, tapsNum));
+        }
+        nextCenter += factor;
+        outputsNum++;
+    }
+
+    /*! Discard the samples before the window of the next output. */
+    int64_t keepFirst = nextCenter-(int64_t)halfTapsNum;
+    if (keepFirst > historyFirst) {
+        size_t dropNum = (size_t)(keepFirst-historyFirst) < historySize ? (size_t)(keepFirst-historyFirst) : historySize;
+        for (unsigned int channelIdx = 0; channelIdx < EDL_CHANNEL_NUM; channelIdx++) {
+            std::memmove(history[channelIdx].data(), history[channelIdx].data()+dropNum, (historySize-dropNum)*sizeof(float));
+        }
+        historySize -= dropNum;
+        historyFirst += (int64_t)dropNum;
+    }
+    return outputsNum;
+}
+
+unsigned int Decimator::getFactor() const {
+    return factor;
+}
+
+unsigned int Decimator::getTapsNum() const {
+    return (unsigned int)taps.size();
+}
+
+double Decimator::getCutoff() const {
+    return factor > 1 ? DECIMATOR_CUTOFF_RATIO/factor : 0.5;
+}
+
+DecimatorSink::DecimatorSink(unsigned int factor, AcquisitionSink * sink) :
+    decimator(factor),
+    sink(sink) {
+}
+
+void DecimatorSink::consumePackets(const float * packets, unsigned int packetsNum) {
+    unsigned int decimatedNum = decimator.process(packets, packetsNum, decimated);
+    if (decimatedNum > 0) {
+        sink->consumePackets(decimated.data(), decimatedNum);
+    }
+}
+
+void DecimatorSink::consumeGap(uint64_t firstPacket, unsigned long long packetsNum) {
+    /*! The outputs whose window was not complete before the gap are missing too. */
+    uint64_t firstOutput = decimator.getNextOutput();
+    decimator.restart(firstPacket+packetsNum);
+    if (decimator.getNextOutput() > firstOutput) {
+        sink->consumeGap(firstOutput, decimator.getNextOutput()-firstOutput);
+    }
+}
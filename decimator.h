@@ -0,0 +1,125 @@
+/*! \file decimator.h
+ * \brief Declares class Decimator, which reduces the sampling rate of the data packets by an integer factor while data are collected,
+ * and class DecimatorSink, which applies it in front of another #AcquisitionSink.
+ */
+#ifndef DECIMATOR_H
+#define DECIMATOR_H
+
+#include <vector>
+#include <stdint.h>
+
+#include "edl.h"
+#include "acquisition.h"
+
+/*! \def DECIMATOR_TAPS_PER_PHASE
+ * \brief Default number of taps of the anti-aliasing filter per unit of the decimation factor.
+ */
+#define DECIMATOR_TAPS_PER_PHASE 32
+
+/*! \def DECIMATOR_KAISER_BETA
+ * \brief Shape of the Kaiser window of the anti-aliasing filter: about 80 dB of stop band attenuation.
+ */
+#define DECIMATOR_KAISER_BETA 8.0
+
+/*! \def DECIMATOR_CUTOFF_RATIO
+ * \brief Cut-off of the anti-aliasing filter relative to the output sampling rate, where the gain is -6 dB.
+ * With the default taps the transition band is about 0.16 of the output sampling rate wide, centered on the cut-off:
+ * the gain is within 0.1 dB up to 0.34 and -3 dB at 0.38, and the stop band, at least 80 dB down, starts at 0.48,
+ * below the output Nyquist frequency.
+ */
+#define DECIMATOR_CUTOFF_RATIO 0.4
+
+/*! \class Decimator
+ * \brief Streaming FIR decimator of all of the channels by an integer factor.
+ * The anti-aliasing filter is a Kaiser windowed sinc of factor * tapsPerPhase + 1 taps with unity gain at DC.
+ * Only the retained outputs are computed, so, as with a polyphase structure, the cost is tapsPerPhase multiply-adds
+ * per channel and input data packet. Each output is the dot product of the taps with a channel stored contiguously,
+ * computed with AVX or SSE when the compiler targets them.
+ *
+ * Output data packet m is centered on input data packet m * factor, so the decimated stream starts at the same time as the
+ * input stream, without delay; the input before the first data packet is taken equal to it. The last outputs are produced
+ * once the input reaches half the filter length past their center.
+ */
+class Decimator {
+public:
+    /*! \brief Decimator constructor.
+     *
+     * \param factor [in] Decimation factor, at least 1; 1 copies the data packets.
+     * \param tapsPerPhase [in] Taps of the anti-aliasing filter per unit of the factor, at least 1.
+     */
+    explicit Decimator(unsigned int factor, unsigned int tapsPerPhase = DECIMATOR_TAPS_PER_PHASE);
+
+    /*! \brief Forgets the past data packets: the next one is the first input again.
+     */
+    void reset(EDL_VOID);
+
+    /*! \brief Forgets the past data packets after a gap in the input: the next one has index \a firstPacket.
+     * The next output is the first one centered at or after it, so the outputs keep their index m, centered on input m * factor.
+     *
+     * \param firstPacket [in] Index of the next input data packet.
+     */
+    void restart(EDL_IN uint64_t firstPacket);
+
+    /*! \brief Returns the index of the next output data packet.
+     */
+    uint64_t getNextOutput(EDL_VOID) const;
+
+    /*! \brief Decimates consecutive data packets.
+     *
+     * \param packets [in] \a packetsNum data packets of #EDL_CHANNEL_NUM samples each.
+     * \param packetsNum [in] Number of data packets.
+     * \param decimated [out] Decimated data packets completed by these input ones, replacing the previous content.
+     * Its capacity is reused, so once it fits the largest output nothing is allocated.
+     * \return Number of decimated data packets.
+     */
+    unsigned int process(EDL_IN const float * packets, EDL_IN unsigned int packetsNum, EDL_OUT std::vector <float> &decimated);
+
+    /*! \brief Returns the decimation factor.
+     */
+    unsigned int getFactor(EDL_VOID) const;
+
+    /*! \brief Returns the number of taps of the anti-aliasing filter.
+     */
+    unsigned int getTapsNum(EDL_VOID) const;
+
+    /*! \brief Returns the cut-off of the anti-aliasing filter relative to the input sampling rate.
+     */
+    double getCutoff(EDL_VOID) const;
+
+private:
+    unsigned int factor;
+    unsigned int halfTapsNum; /*!< Taps on each side of the central one. */
+    std::vector <float> taps;
+    std::vector <float> history[EDL_CHANNEL_NUM]; /*!< Input samples still needed, one array per channel; only grows. */
+    size_t historySize; /*!< Samples stored in each array of \a history. */
+    int64_t historyFirst; /*!< Index of the first sample of \a history in the input stream. */
+    int64_t nextCenter; /*!< Index in the input stream of the center of the next output. */
+    int64_t firstInput; /*!< Index of the first input data packet after #reset or #restart. */
+    bool primed;
+};
+
+/*! \class DecimatorSink
+ * \brief #AcquisitionSink that decimates the data packets with a #Decimator and hands them to another sink.
+ */
+class DecimatorSink : public AcquisitionSink {
+public:
+    /*! \brief DecimatorSink constructor.
+     *
+     * \param factor [in] Decimation factor.
+     * \param sink [in] Sink of the decimated data packets; it must outlive this object.
+     */
+    DecimatorSink(unsigned int factor, AcquisitionSink * sink);
+
+    void consumePackets(const float * packets, unsigned int packetsNum);
+
+    /*! \brief Restarts the decimator after the missing data packets and tells the sink about the missing decimated ones.
+     */
+    void consumeGap(uint64_t firstPacket, unsigned long long packetsNum);
+
+private:
+    Decimator decimator;
+    AcquisitionSink * sink;
+    std::vector <float> decimated;
+};
+
+#endif // DECIMATOR_H
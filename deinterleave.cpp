@@ -0,0 +1,208 @@
+/*! \file deinterleave.cpp
+ * \brief Defines the conversions between interleaved data packets and per-channel arrays.
+ * The vectorized paths are specialized for 5 channels: 4 channels are transposed in registers
+ * 4 (SSE) or 8 (AVX) packets at a time, the 5th one is gathered with scalar loads.
+ */
+#include "deinterleave.h"
+
+#include <cstdint>
+
+#if defined(__AVX__) || defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(_M_X64)
+#include <immintrin.h>
+#define DEINTERLEAVE_SSE
+#endif
+
+#if defined(__AVX__)
+#define DEINTERLEAVE_AVX
+#endif
+
+void deinterleavePacketsScalar(const float * packets, unsigned int packetsNum, float * const * channels) {
+    for (unsigned int packetIdx = 0; packetIdx < packetsNum; packetIdx++) {
+        for (unsigned int channelIdx = 0; channelIdx < EDL_CHANNEL_NUM; channelIdx++) {
+            channels[channelIdx][packetIdx] = packets[packetIdx*EDL_CHANNEL_NUM+channelIdx];
+        }
+    }
+}
+
+void interleavePacketsScalar(const float * const * channels, unsigned int packetsNum, float * packets) {
+    for (unsigned int packetIdx = 0; packetIdx < packetsNum; packetIdx++) {
+        for (unsigned int channelIdx = 0; channelIdx < EDL_CHANNEL_NUM; channelIdx++) {
+            packets[packetIdx*EDL_CHANNEL_NUM+channelIdx] = channels[channelIdx][packetIdx];
+        }
+    }
+}
+
+#if EDL_CHANNEL_NUM == 5 && defined(DEINTERLEAVE_SSE)
+
+void deinterleavePackets(const float * packets, unsigned int packetsNum, float * const * channels) {
+    unsigned int packetIdx = 0;
+
+#ifdef DEINTERLEAVE_AVX
+    for (; packetIdx+8 <= packetsNum; packetIdx += 8) {
+        const float * p = packets+packetIdx*5;
+
+        /*! Each 256 bit register holds the first 4 samples of packet k in the low lane and of packet k+4 in the high lane. */
+        __m256 v0 = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(p)), _mm_loadu_ps(p+20), 1);
+        __m256 v1 = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(p+5)), _mm_loadu_ps(p+25), 1);
+        __m256 v2 = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(p+10)), _mm_loadu_ps(p+30), 1);
+        __m256 v3 = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(p+15)), _mm_loadu_ps(p+35), 1);
+
+        /*! 4x4 transpose within each lane. */
+        __m256 t0 = _mm256_unpacklo_ps(v0, v1);
+        __m256 t1 = _mm256_unpacklo_ps(v2, v3);
+        __m256 t2 = _mm256_unpackhi_ps(v0, v1);
+        __m256 t3 = _mm256_unpackhi_ps(v2, v3);
+        _mm256_storeu_ps(channels[0]+packetIdx, _mm256_shuffle_ps(t0, t1, _MM_SHUFFLE(1, 0, 1, 0)));
+        _mm256_storeu_ps(channels[1]+packetIdx, _mm256_shuffle_ps(t0, t1, _MM_SHUFFLE(3, 2, 3, 2)));
+        _mm256_storeu_ps(channels[2]+packetIdx, _mm256_shuffle_ps(t2, t3, _MM_SHUFFLE(1, 0, 1, 0)));
+        _mm256_storeu_ps(channels[3]+packetIdx, _mm256_shuffle_ps(t2, t3, _MM_SHUFFLE(3, 2, 3, 2)));
+        _mm256_storeu_ps(channels[4]+packetIdx, _mm256_setr_ps(p[4], p[9], p[14], p[19], p[24], p[29], p[34], p[39]));
+    }
+#endif
+
+    for (; packetIdx+4 <= packetsNum; packetIdx += 4) {
+        const float * p = packets+packetIdx*5;
+        __m128 r0 = _mm_loadu_ps(p);
+        __m128 r1 = _mm_loadu_ps(p+5);
+        __m128 r2 = _mm_loadu_ps(p+10);
+        __m128 r3 = _mm_loadu_ps(p+15);
+        _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+        _mm_storeu_ps(channels[0]+packetIdx, r0);
+        _mm_storeu_ps(channels[1]+packetIdx, r1);
+        _mm_storeu_ps(channels[2]+packetIdx, r2);
+        _mm_storeu_ps(channels[3]+packetIdx, r3);
+        _mm_storeu_ps(channels[4]+packetIdx, _mm_setr_ps(p[4], p[9], p[14], p[19]));
+    }
+
+    for (; packetIdx < packetsNum; packetIdx++) {
+        for (unsigned int channelIdx = 0; channelIdx < 5; channelIdx++) {
+            channels[channelIdx][packetIdx] = packets[packetIdx*5+channelIdx];
+        }
+    }
+}
+
+void interleavePackets(const float * const * channels, unsigned int packetsNum, float * packets) {
+    unsigned int packetIdx = 0;
+
+#ifdef DEINTERLEAVE_AVX
+    for (; packetIdx+8 <= packetsNum; packetIdx += 8) {
+        float * p = packets+packetIdx*5;
+        __m256 c0 = _mm256_loadu_ps(channels[0]+packetIdx);
+        __m256 c1 = _mm256_loadu_ps(channels[1]+packetIdx);
+        __m256 c2 = _mm256_loadu_ps(channels[2]+packetIdx);
+        __m256 c3 = _mm256_loadu_ps(channels[3]+packetIdx);
+
+        /*! 4x4 transpose within each lane: the low lanes hold packets 0 to 3, the high lanes packets 4 to 7. */
+        __m256 t0 = _mm256_unpacklo_ps(c0, c1);
+        __m256 t1 = _mm256_unpacklo_ps(c2, c3);
+        __m256 t2 = _mm256_unpackhi_ps(c0, c1);
+        __m256 t3 = _mm256_unpackhi_ps(c2, c3);
+        __m256 r0 = _mm256_shuffle_ps(t0, t1, _MM_SHUFFLE(1, 0, 1, 0));
+        __m256 r1 = _mm256_shuffle_ps(t0, t1, _MM_SHUFFLE(3, 2, 3, 2));
+        __m256 r2 = _mm256_shuffle_ps(t2, t3, _MM_SHUFFLE(1, 0, 1, 0));
+        __m256 r3 = _mm256_shuffle_ps(t2, t3, _MM_SHUFFLE(3, 2, 3, 2));
+        _mm_storeu_ps(p, _mm256_castps256_ps128(r0));
+        _mm_storeu_ps(p+5, _mm256_castps256_ps128(r1));
+        _mm_storeu_ps(p+10, _mm256_castps256_ps128(r2));
+        _mm_storeu_ps(p+15, _mm256_castps256_ps128(r3));
+        _mm_storeu_ps(p+20, _mm256_extractf128_ps(r0, 1));
+        _mm_storeu_ps(p+25, _mm256_extractf128_ps(r1, 1));
+        _mm_storeu_ps(p+30, _mm256_extractf128_ps(r2, 1));
+        _mm_storeu_ps(p+35, _mm256_extractf128_ps(r3, 1));
+
+        const float * c4 = channels[4]+packetIdx;
+        for (unsigned int k = 0; k < 8; k++) {
+            p[k*5+4] = c4[k];
+        }
+    }
+#endif
+
+    for (; packetIdx+4 <= packetsNum; packetIdx += 4) {
+        float * p = packets+packetIdx*5;
+        __m128 r0 = _mm_loadu_ps(channels[0]+packetIdx);
+        __m128 r1 = _mm_loadu_ps(channels[1]+packetIdx);
+        __m128 r2 = _mm_loadu_ps(channels[2]+packetIdx);
+        __m128 r3 = _mm_loadu_ps(channels[3]+packetIdx);
+        _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+        _mm_storeu_ps(p, r0);
+        _mm_storeu_ps(p+5, r1);
+        _mm_storeu_ps(p+10, r2);
+        _mm_storeu_ps(p+15, r3);
+
+        const float * c4 = channels[4]+packetIdx;
+        p[4] = c4[0];
+        p[9] = c4[1];
+        p[14] = c4[2];
+        p[19] = c4[3];
+    }
+
+    for (; packetIdx < packetsNum; packetIdx++) {
+        for (unsigned int channelIdx = 0; channelIdx < 5; channelIdx++) {
+            packets[packetIdx*5+channelIdx] = channels[channelIdx][packetIdx];
+        }
+    }
+}
+
+#else
+
+void deinterleavePackets(const float * packets, unsigned int packetsNum, float * const * channels) {
+    deinterleavePacketsScalar(packets, packetsNum, channels);
+}
+
+void interleavePackets(const float * const * channels, unsigned int packetsNum, float * packets) {
+    interleavePacketsScalar(channels, packetsNum, packets);
+}
+
+#endif
+
+ChannelBlock::ChannelBlock(unsigned int capacity) :
+    capacity(0),
+    packetsNum(0) {
+    for (unsigned int channelIdx = 0; channelIdx < EDL_CHANNEL_NUM; channelIdx++) {
+        channelPtrs[channelIdx] = NULL;
+    }
+    resize(capacity);
+    packetsNum = 0;
+}
+
+void ChannelBlock::deinterleave(const float * packets, unsigned int packetsNum) {
+    resize(packetsNum);
+    deinterleavePackets(packets, packetsNum, channelPtrs);
+}
+
+void ChannelBlock::interleave(float * packets) const {
+    interleavePackets(channels(), packetsNum, packets);
+}
+
+void ChannelBlock::resize(unsigned int packetsNum) {
+    this->packetsNum = packetsNum;
+    if (packetsNum <= capacity && !storage.empty()) {
+        return;
+    }
+
+    /*! Round the channel stride up to the alignment, so that every channel array is aligned. */
+    const unsigned int alignmentFloats = CHANNEL_BLOCK_ALIGNMENT/sizeof(float);
+    capacity = (packetsNum+alignmentFloats-1)/alignmentFloats*alignmentFloats;
+    storage.resize(capacity*EDL_CHANNEL_NUM+alignmentFloats);
+
+    uintptr_t base = ((uintptr_t)storage.data()+CHANNEL_BLOCK_ALIGNMENT-1)/CHANNEL_BLOCK_ALIGNMENT*CHANNEL_BLOCK_ALIGNMENT;
+    for (unsigned int channelIdx = 0; channelIdx < EDL_CHANNEL_NUM; channelIdx++) {
+        channelPtrs[channelIdx] = (float *)base+channelIdx*capacity;
+    }
+}
+
+unsigned int ChannelBlock::size() const {
+    return packetsNum;
+}
+
+float * ChannelBlock::channel(unsigned int channelIdx) {
+    return channelPtrs[channelIdx];
+}
+
+const float * ChannelBlock::channel(unsigned int channelIdx) const {
+    return channelPtrs[channelIdx];
+}
+
+const float * const * ChannelBlock::channels() const {
+    return channelPtrs;
+}
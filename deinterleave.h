@@ -0,0 +1,95 @@
+/*! \file deinterleave.h
+ * \brief Declares the conversions between interleaved data packets and per-channel arrays.
+ */
+#ifndef DEINTERLEAVE_H
+#define DEINTERLEAVE_H
+
+#include <vector>
+
+#include "edl.h"
+
+/*! \def CHANNEL_BLOCK_ALIGNMENT
+ * \brief Alignment in bytes of each channel array of a #ChannelBlock.
+ */
+#define CHANNEL_BLOCK_ALIGNMENT 32
+
+/*! \fn deinterleavePackets
+ * \brief Splits data packets, as returned by EDL::readData, into one array per channel.
+ * Uses AVX or SSE when the compiler targets them (e.g. -mavx2, -msse2), otherwise #deinterleavePacketsScalar.
+ *
+ * \param packets [in] \a packetsNum data packets of #EDL_CHANNEL_NUM samples each.
+ * \param packetsNum [in] Number of data packets.
+ * \param channels [out] #EDL_CHANNEL_NUM arrays of at least \a packetsNum samples each.
+ */
+void deinterleavePackets(EDL_IN const float * packets, EDL_IN unsigned int packetsNum, EDL_OUT float * const * channels);
+
+/*! \fn interleavePackets
+ * \brief Merges one array per channel into data packets, as returned by EDL::readData. Inverse of #deinterleavePackets.
+ *
+ * \param channels [in] #EDL_CHANNEL_NUM arrays of at least \a packetsNum samples each.
+ * \param packetsNum [in] Number of data packets.
+ * \param packets [out] \a packetsNum data packets of #EDL_CHANNEL_NUM samples each.
+ */
+void interleavePackets(EDL_IN const float * const * channels, EDL_IN unsigned int packetsNum, EDL_OUT float * packets);
+
+/*! \fn deinterleavePacketsScalar
+ * \brief Reference implementation of #deinterleavePackets, one sample at a time.
+ */
+void deinterleavePacketsScalar(EDL_IN const float * packets, EDL_IN unsigned int packetsNum, EDL_OUT float * const * channels);
+
+/*! \fn interleavePacketsScalar
+ * \brief Reference implementation of #interleavePackets, one sample at a time.
+ */
+void interleavePacketsScalar(EDL_IN const float * const * channels, EDL_IN unsigned int packetsNum, EDL_OUT float * packets);
+
+/*! \class ChannelBlock
+ * \brief Block of data packets stored as one aligned array per channel (structure of arrays).
+ * The storage only grows, so a block reused for batches of similar size stops allocating.
+ */
+class ChannelBlock {
+public:
+    /*! \brief ChannelBlock constructor.
+     *
+     * \param capacity [in] Initial capacity in data packets.
+     */
+    explicit ChannelBlock(unsigned int capacity = 0);
+
+    /*! \brief Stores data packets, as returned by EDL::readData, replacing the previous content.
+     */
+    void deinterleave(EDL_IN const float * packets, EDL_IN unsigned int packetsNum);
+
+    /*! \brief Writes the content as data packets, as returned by EDL::readData.
+     *
+     * \param packets [out] Destination of #size data packets.
+     */
+    void interleave(EDL_OUT float * packets) const;
+
+    /*! \brief Sets the number of data packets in the block, growing the storage if needed.
+     * The content is undefined after a growth.
+     */
+    void resize(unsigned int packetsNum);
+
+    /*! \brief Returns the number of data packets in the block.
+     */
+    unsigned int size() const;
+
+    /*! \brief Returns the array of a channel.
+     */
+    float * channel(unsigned int channelIdx);
+
+    /*! \brief Returns the array of a channel.
+     */
+    const float * channel(unsigned int channelIdx) const;
+
+    /*! \brief Returns the #EDL_CHANNEL_NUM channel arrays.
+     */
+    const float * const * channels() const;
+
+private:
+    std::vector <float> storage;
+    float * channelPtrs[EDL_CHANNEL_NUM];
+    unsigned int capacity;
+    unsigned int packetsNum;
+};
+
+#endif // DEINTERLEAVE_H
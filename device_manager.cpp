@@ -0,0 +1,227 @@
+/*! \file device_manager.cpp
+ * \brief Defines class DeviceManager.
+ */
+#include "device_manager.h"
+
+#include <cmath>
+#include <new>
+#include <thread>
+
+#include "packet_source.h"
+#include "packet_pool.h"
+#include "thread_affinity.h"
+
+/*! \class ManagedDevice
+ * \brief Connection and acquisition of one device.
+ */
+class ManagedDevice {
+public:
+    explicit ManagedDevice(const std::string &id) :
+        id(id),
+        source(edl),
+        acquisition(source),
+        alignmentPackets(0) {
+    }
+
+    /*! The ring buffer of the acquisition is aligned to the cache lines, which plain new does not guarantee before C++17. */
+    static void * operator new(size_t size) {
+        void * ptr = cacheAlignedAlloc(size);
+        if (ptr == NULL) {
+            throw std::bad_alloc();
+        }
+        return ptr;
+    }
+
+    static void operator delete(void * ptr) {
+        cacheAlignedFree(ptr);
+    }
+
+    std::string id;
+    EDL edl;
+    EdlPacketSource source;
+    Acquisition acquisition;
+    unsigned long long alignmentPackets;
+    std::chrono::steady_clock::time_point purgeTime;
+};
+
+DeviceManager::DeviceManager() :
+    readConfig(readControllerDefaultConfig()),
+    aligned(false),
+    running(false),
+    startTime(0) {
+}
+
+DeviceManager::~DeviceManager() {
+    stop();
+    disconnectAll();
+}
+
+EdlErrorCode_t DeviceManager::connectAll() {
+    EDL detector;
+    std::vector <std::string> deviceIds;
+    EdlErrorCode_t res = detector.detectDevices(deviceIds);
+    if (res != EdlSuccess) {
+        return res;
+    }
+
+    for (size_t deviceIdx = 0; deviceIdx < deviceIds.size(); deviceIdx++) {
+        ManagedDevice * device = new ManagedDevice(deviceIds[deviceIdx]);
+        res = device->edl.connectDevice(deviceIds[deviceIdx]);
+        if (res != EdlSuccess) {
+            delete device;
+            return res;
+        }
+        devices.push_back(device);
+    }
+    return EdlSuccess;
+}
+
+EdlErrorCode_t DeviceManager::disconnectAll() {
+    EdlErrorCode_t res = EdlSuccess;
+    for (size_t deviceIdx = 0; deviceIdx < devices.size(); deviceIdx++) {
+        /*! Retry every 1 ms for up to 1 second, in case the connection is not fully established yet. */
+        EdlErrorCode_t deviceRes = EdlSuccess;
+        for (unsigned int attemptIdx = 0; attemptIdx < 1000; attemptIdx++) {
+            deviceRes = devices[deviceIdx]->edl.disconnectDevice();
+            if (deviceRes == EdlSuccess) {
+                break;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+
+        if (deviceRes != EdlSuccess) {
+            res = deviceRes;
+        }
+        delete devices[deviceIdx];
+    }
+    devices.clear();
+    return res;
+}
+
+unsigned int DeviceManager::getDevicesNum() const {
+    return (unsigned int)devices.size();
+}
+
+EDL &DeviceManager::getEdl(unsigned int deviceIdx) {
+    return devices[deviceIdx]->edl;
+}
+
+Acquisition &DeviceManager::getAcquisition(unsigned int deviceIdx) {
+    return devices[deviceIdx]->acquisition;
+}
+
+PacketSource &DeviceManager::getSource(unsigned int deviceIdx) {
+    return devices[deviceIdx]->source;
+}
+
+const std::string &DeviceManager::getDeviceId(unsigned int deviceIdx) const {
+    return devices[deviceIdx]->id;
+}
+
+void DeviceManager::addSink(unsigned int deviceIdx, AcquisitionSink * sink) {
+    devices[deviceIdx]->acquisition.addSink(sink);
+}
+
+void DeviceManager::setReadController(const ReadControllerConfig_t &config) {
+    readConfig = config;
+}
+
+EdlErrorCode_t DeviceManager::align(double samplingRate) {
+    if (running || devices.empty()) {
+        return EdlUnknownError;
+    }
+
+    /*! Purge the devices back to back, taking the middle of each purge as the time of its first data packet. */
+    std::chrono::steady_clock::time_point lastPurgeTime;
+    for (size_t deviceIdx = 0; deviceIdx < devices.size(); deviceIdx++) {
+        std::chrono::steady_clock::time_point before = std::chrono::steady_clock::now();
+        EdlErrorCode_t res = devices[deviceIdx]->source.purgeData();
+        if (res != EdlSuccess) {
+            return res;
+        }
+        std::chrono::steady_clock::time_point after = std::chrono::steady_clock::now();
+        devices[deviceIdx]->purgeTime = before+(after-before)/2;
+        lastPurgeTime = devices[deviceIdx]->purgeTime;
+    }
+
+    /*! Discard what each device acquired before the last purge. */
+    for (size_t deviceIdx = 0; deviceIdx < devices.size(); deviceIdx++) {
+        ManagedDevice * device = devices[deviceIdx];
+        double lead = std::chrono::duration <double> (lastPurgeTime-device->purgeTime).count();
+        device->alignmentPackets = (unsigned long long)std::floor(lead*samplingRate+0.5);
+        device->acquisition.setSkippedPackets(device->alignmentPackets);
+        device->acquisition.setReaderCore((int)(deviceIdx%processorCoresNum()));
+        device->acquisition.setReadController(readConfig, samplingRate);
+    }
+
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    startTime = std::chrono::duration_cast <std::chrono::nanoseconds> (std::chrono::system_clock::now().time_since_epoch()).count()-
+            std::chrono::duration_cast <std::chrono::nanoseconds> (now-lastPurgeTime).count();
+    startSteadyTime = lastPurgeTime;
+    aligned = true;
+    return EdlSuccess;
+}
+
+EdlErrorCode_t DeviceManager::start() {
+    if (running || !aligned) {
+        return EdlUnknownError;
+    }
+
+    for (size_t deviceIdx = 0; deviceIdx < devices.size(); deviceIdx++) {
+        devices[deviceIdx]->acquisition.start();
+    }
+    aligned = false;
+    running = true;
+    return EdlSuccess;
+}
+
+EdlErrorCode_t DeviceManager::stop() {
+    if (!running) {
+        return EdlSuccess;
+    }
+
+    EdlErrorCode_t res = EdlSuccess;
+    for (size_t deviceIdx = 0; deviceIdx < devices.size(); deviceIdx++) {
+        EdlErrorCode_t deviceRes = devices[deviceIdx]->acquisition.stop();
+        if (res == EdlSuccess) {
+            res = deviceRes;
+        }
+    }
+    stopSteadyTime = std::chrono::steady_clock::now();
+    running = false;
+    return res;
+}
+
+bool DeviceManager::isRunning() const {
+    if (!running) {
+        return false;
+    }
+
+    for (size_t deviceIdx = 0; deviceIdx < devices.size(); deviceIdx++) {
+        if (!devices[deviceIdx]->acquisition.isRunning()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+int64_t DeviceManager::getStartTime() const {
+    return startTime;
+}
+
+std::chrono::steady_clock::time_point DeviceManager::getStartSteadyTime() const {
+    return startSteadyTime;
+}
+
+double DeviceManager::getElapsedSeconds() const {
+    std::chrono::steady_clock::time_point endTime = running ? std::chrono::steady_clock::now() : stopSteadyTime;
+    return std::chrono::duration <double> (endTime-startSteadyTime).count();
+}
+
+unsigned long long DeviceManager::getAlignmentPackets(unsigned int deviceIdx) const {
+    return devices[deviceIdx]->alignmentPackets;
+}
+
+AcquisitionStats_t DeviceManager::getStats(unsigned int deviceIdx) const {
+    return devices[deviceIdx]->acquisition.getStats();
+}
@@ -0,0 +1,138 @@
+/*! \file device_manager.h
+ * \brief Declares class DeviceManager, which acquires data from all of the connected devices at the same time.
+ */
+#ifndef DEVICE_MANAGER_H
+#define DEVICE_MANAGER_H
+
+#include <string>
+#include <vector>
+#include <chrono>
+#include <stdint.h>
+
+#include "edl.h"
+#include "acquisition.h"
+#include "packet_source.h"
+
+class ManagedDevice;
+
+/*! \class DeviceManager
+ * \brief Connects to every detected device through its own #EDL object and runs one #Acquisition per device,
+ * with each reader thread pinned to a different core.
+ *
+ * The streams are aligned before the acquisition starts: the devices are purged one after the other and,
+ * knowing the sampling rate, the data packets acquired by each device before the last purge are discarded,
+ * so that the first data packet handed to the sinks of every device was acquired at the same time,
+ * within one sampling period plus the duration of a purge.
+ */
+class DeviceManager {
+public:
+    /*! \brief DeviceManager constructor.
+     */
+    DeviceManager();
+
+    /*! \brief DeviceManager destructor. Stops the acquisition and disconnects the devices.
+     */
+    ~DeviceManager();
+
+    /*! \brief Detects the devices and connects to all of them.
+     *
+     * \return #EdlErrorCode_t Error code: the first error met; the devices connected up to that point stay connected.
+     */
+    EdlErrorCode_t connectAll(EDL_VOID);
+
+    /*! \brief Disconnects all of the devices, retrying for up to 1 second each.
+     *
+     * \return #EdlErrorCode_t Error code: the last error met.
+     */
+    EdlErrorCode_t disconnectAll(EDL_VOID);
+
+    /*! \brief Returns the number of connected devices.
+     */
+    unsigned int getDevicesNum() const;
+
+    /*! \brief Returns the #EDL object of a device, e.g. to configure it.
+     */
+    EDL &getEdl(unsigned int deviceIdx);
+
+    /*! \brief Returns the #PacketSource of a device, e.g. to follow its data packets before the acquisition is started.
+     */
+    PacketSource &getSource(unsigned int deviceIdx);
+
+    /*! \brief Returns the ID of a device as returned by EDL::detectDevices.
+     */
+    const std::string &getDeviceId(unsigned int deviceIdx) const;
+
+    /*! \brief Returns the #Acquisition of a device, e.g. to export its #Instrumentation.
+     */
+    Acquisition &getAcquisition(unsigned int deviceIdx);
+
+    /*! \brief Adds a sink to the acquisition of a device. Sinks must be added before #start and must outlive the acquisition.
+     */
+    void addSink(unsigned int deviceIdx, AcquisitionSink * sink);
+
+    /*! \brief Sets the parameters that decide when the reader threads read. Must be called before #align.
+     * The sampling rate given to #align is used as the expected packet rate.
+     */
+    void setReadController(const ReadControllerConfig_t &config);
+
+    /*! \brief Purges the devices and computes how to align their streams.
+     * Call right before #start: the data packets acquired in between are kept in the device buffers.
+     * After this call #getStartTime returns the time of the first data packet that will be handed to the sinks.
+     *
+     * \param samplingRate [in] Sampling rate set on all of the devices [Hz].
+     * \return #EdlErrorCode_t Error code.
+     */
+    EdlErrorCode_t align(EDL_IN double samplingRate);
+
+    /*! \brief Starts the acquisitions; #align must have been called.
+     *
+     * \return #EdlErrorCode_t Error code.
+     */
+    EdlErrorCode_t start(EDL_VOID);
+
+    /*! \brief Stops the acquisitions and waits for the sinks to consume the pending packets.
+     *
+     * \return #EdlErrorCode_t Error code: the first error returned by Acquisition::stop.
+     */
+    EdlErrorCode_t stop(EDL_VOID);
+
+    /*! \brief Returns false as soon as the reader thread of any device stops.
+     */
+    bool isRunning() const;
+
+    /*! \brief Returns the time of the first aligned data packet, in ns since 1970-01-01 00:00:00 UTC,
+     * e.g. for RecordingHeader_t::startTime.
+     */
+    int64_t getStartTime() const;
+
+    /*! \brief Returns the time of the first aligned data packet on the steady clock, e.g. to schedule commands on the index
+     * of the data packets.
+     */
+    std::chrono::steady_clock::time_point getStartSteadyTime() const;
+
+    /*! \brief Returns the seconds elapsed from #start to #stop, or to now if still running.
+     */
+    double getElapsedSeconds() const;
+
+    /*! \brief Returns the number of data packets of a device discarded to align it with the others.
+     */
+    unsigned long long getAlignmentPackets(unsigned int deviceIdx) const;
+
+    /*! \brief Returns a snapshot of the counters of a device.
+     */
+    AcquisitionStats_t getStats(unsigned int deviceIdx) const;
+
+private:
+    DeviceManager(const DeviceManager &);
+    DeviceManager &operator=(const DeviceManager &);
+
+    std::vector <ManagedDevice *> devices;
+    ReadControllerConfig_t readConfig;
+    bool aligned;
+    bool running;
+    int64_t startTime;
+    std::chrono::steady_clock::time_point startSteadyTime;
+    std::chrono::steady_clock::time_point stopSteadyTime;
+};
+
+#endif // DEVICE_MANAGER_H
@@ -0,0 +1,115 @@
+/*! \file edl_settings.cpp
+ * \brief Defines helpers to interpret the radio IDs and command IDs of edl_devicespecs.h.
+ */
+#include "edl_settings.h"
+
+#include <cmath>
+
+static const double samplingRatesHz[] = {1250.0, 5000.0, 10000.0, 20000.0, 50000.0, 100000.0, 200000.0};
+static const double rangesFullScale[] = {200.0, 2.0, 20.0, 200.0};
+static const double finalBandwidthDividers[] = {2.0, 8.0, 10.0, 20.0};
+
+EdlCommandType_t edlCommandType(EdlCommandId_t commandId) {
+    switch (commandId) {
+    case EdlCommandRange:
+    case EdlCommandSamplingRate:
+    case EdlCommandFinalBandwidth:
+        return EdlCommandTypeRadio;
+
+    case EdlCommandReset:
+        return EdlCommandTypeCheckbox;
+
+    case EdlCommandZAPAllChannels:
+    case EdlCommandResetComp:
+    case EdlCommandPulse:
+    case EdlCommandApplyProtocol:
+        return EdlCommandTypePushButton;
+
+    case EdlCommandCompAll:
+        return EdlCommandTypeCheckButton;
+
+    case EdlCommandPulseAmplitude:
+    case EdlCommandPulseDuration:
+    case EdlCommandVoffsetCH1:
+    case EdlCommandVoffsetCH2:
+    case EdlCommandVoffsetCH3:
+    case EdlCommandVoffsetCH4:
+        return EdlCommandTypeValue;
+
+    default:
+        return EdlCommandTypeProtocolValue;
+    }
+}
+
+unsigned int edlRadiosNum(EdlCommandId_t commandId) {
+    switch (commandId) {
+    case EdlCommandRange:
+        return sizeof(rangesFullScale)/sizeof(rangesFullScale[0]);
+
+    case EdlCommandSamplingRate:
+        return sizeof(samplingRatesHz)/sizeof(samplingRatesHz[0]);
+
+    case EdlCommandFinalBandwidth:
+        return sizeof(finalBandwidthDividers)/sizeof(finalBandwidthDividers[0]);
+
+    default:
+        return 0;
+    }
+}
+
+double edlSamplingRateHz(unsigned int radioId) {
+    if (radioId >= edlRadiosNum(EdlCommandSamplingRate)) {
+        return 0.0;
+    }
+    return samplingRatesHz[radioId];
+}
+
+double edlRangeFullScale(unsigned int radioId) {
+    if (radioId >= edlRadiosNum(EdlCommandRange)) {
+        return 0.0;
+    }
+    return rangesFullScale[radioId];
+}
+
+const char * edlRangeUnit(unsigned int radioId) {
+    return radioId == EDL_RADIO_RANGE_200_PA ? "pA" : "nA";
+}
+
+double edlRangeLsb(unsigned int radioId) {
+    return edlRangeFullScale(radioId)/EDL_ADC_CODES;
+}
+
+double edlFinalBandwidthHz(unsigned int samplingRateRadioId, unsigned int finalBandwidthRadioId) {
+    if (finalBandwidthRadioId >= edlRadiosNum(EdlCommandFinalBandwidth)) {
+        return 0.0;
+    }
+    return edlSamplingRateHz(samplingRateRadioId)/finalBandwidthDividers[finalBandwidthRadioId];
+}
+
+bool edlProtocolUsesCommand(double protocol, EdlCommandId_t commandId) {
+    if (protocol == EDL_PROTOCOL_CONSTANT) {
+        return commandId == EdlCommandMainTrial || commandId == EdlCommandVhold;
+    }
+
+    if (protocol == EDL_PROTOCOL_TRIANGULAR) {
+        return commandId == EdlCommandMainTrial || commandId == EdlCommandVhold || commandId == EdlCommandVamp || commandId == EdlCommandTPeriod;
+    }
+    return false;
+}
+
+EdlErrorCode_t edlCheckProtocol(const double values[EdlCommandIdNum]) {
+    double protocol = values[EdlCommandMainTrial];
+    double vHold = values[EdlCommandVhold];
+    if (!(protocol >= 0.0) || protocol != std::floor(protocol) || !(std::fabs(vHold) <= EDL_PROTOCOL_MAX_VOLTAGE_MV)) {
+        return EdlViolatedTrialRuleError;
+    }
+
+    if (protocol == EDL_PROTOCOL_TRIANGULAR) {
+        double vAmp = values[EdlCommandVamp];
+        double tPeriod = values[EdlCommandTPeriod];
+        if (!(vAmp > 0.0) || !(tPeriod > 0.0) || !(std::fabs(vHold)+vAmp <= EDL_PROTOCOL_MAX_VOLTAGE_MV)) {
+            return EdlViolatedTrialRuleError;
+        }
+    }
+    return EdlSuccess;
+}
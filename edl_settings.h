@@ -0,0 +1,100 @@
+/*! \file edl_settings.h
+ * \brief Declares helpers to interpret the radio IDs and command IDs of edl_devicespecs.h.
+ */
+#ifndef EDL_SETTINGS_H
+#define EDL_SETTINGS_H
+
+#include "edl.h"
+
+/*! \def EDL_ADC_CODES
+ * \brief Number of positive codes of the current channels ADC: the range full scale corresponds to this code.
+ */
+#define EDL_ADC_CODES 32768
+
+/*! \def EDL_VOLTAGE_LSB_MV
+ * \brief Resolution of the voltage channel [mV].
+ */
+#define EDL_VOLTAGE_LSB_MV 0.0625
+
+/*! \def EDL_PROTOCOL_MAX_VOLTAGE_MV
+ * \brief Maximum absolute voltage a protocol may apply [mV]; larger values violate the protocol rules.
+ */
+#define EDL_PROTOCOL_MAX_VOLTAGE_MV 500.0
+
+/*! \def EDL_PROTOCOL_CONSTANT
+ * \brief Value of #EdlCommandMainTrial selecting the constant protocol: #EdlCommandVhold.
+ */
+#define EDL_PROTOCOL_CONSTANT 0
+
+/*! \def EDL_PROTOCOL_TRIANGULAR
+ * \brief Value of #EdlCommandMainTrial selecting the triangular protocol: #EdlCommandVhold, #EdlCommandVamp and #EdlCommandTPeriod [ms].
+ */
+#define EDL_PROTOCOL_TRIANGULAR 1
+
+/*! \enum EdlCommandType_t
+ * \brief Enumerates the command types listed in edl_devicespecs.h.
+ */
+typedef enum {
+    EdlCommandTypeRadio, /*!< Selects one of the EDL_RADIO_* values through EdlCommandStruct_t::radioId. */
+    EdlCommandTypeCheckbox, /*!< Sets a flag through EdlCommandStruct_t::checkboxChecked. */
+    EdlCommandTypePushButton, /*!< Causes an event; must be sent immediately. */
+    EdlCommandTypeCheckButton, /*!< Starts or stops an activity through EdlCommandStruct_t::buttonPressed; must be sent immediately. */
+    EdlCommandTypeValue, /*!< Sets a numeric field through EdlCommandStruct_t::value. */
+    EdlCommandTypeProtocolValue /*!< Sets a protocol parameter through EdlCommandStruct_t::value; must be stacked. */
+} EdlCommandType_t;
+
+/*! \fn edlCommandType
+ * \brief Returns the type of a command.
+ */
+EdlCommandType_t edlCommandType(EdlCommandId_t commandId);
+
+/*! \fn edlRadiosNum
+ * \brief Returns the number of valid radio IDs of a radio type command, 0 for other command types.
+ */
+unsigned int edlRadiosNum(EdlCommandId_t commandId);
+
+/*! \fn edlSamplingRateHz
+ * \brief Returns the sampling rate [Hz] selected by an EDL_RADIO_SAMPLING_RATE_* value, 0 if invalid.
+ */
+double edlSamplingRateHz(unsigned int radioId);
+
+/*! \fn edlRangeFullScale
+ * \brief Returns the full scale of the current channels selected by an EDL_RADIO_RANGE_* value,
+ * expressed in the unit returned by #edlRangeUnit, 0 if invalid.
+ */
+double edlRangeFullScale(unsigned int radioId);
+
+/*! \fn edlRangeUnit
+ * \brief Returns the unit of the current channels ("pA" or "nA") for an EDL_RADIO_RANGE_* value.
+ */
+const char * edlRangeUnit(unsigned int radioId);
+
+/*! \fn edlRangeLsb
+ * \brief Returns the resolution of the current channels for an EDL_RADIO_RANGE_* value, in the unit returned by #edlRangeUnit.
+ */
+double edlRangeLsb(unsigned int radioId);
+
+/*! \fn edlFinalBandwidthHz
+ * \brief Returns the final bandwidth [Hz] for an EDL_RADIO_SAMPLING_RATE_* value and an EDL_RADIO_FINAL_BANDWIDTH_* value, 0 if invalid.
+ */
+double edlFinalBandwidthHz(unsigned int samplingRateRadioId, unsigned int finalBandwidthRadioId);
+
+/*! \fn edlProtocolUsesCommand
+ * \brief Returns true if a protocol parameter is used by a protocol, false if it is not or if the protocol is not known here.
+ *
+ * \param protocol [in] Value of #EdlCommandMainTrial, e.g. #EDL_PROTOCOL_TRIANGULAR.
+ * \param commandId [in] Command of type #EdlCommandTypeProtocolValue.
+ */
+bool edlProtocolUsesCommand(double protocol, EdlCommandId_t commandId);
+
+/*! \fn edlCheckProtocol
+ * \brief Checks protocol parameters against the rules that the device enforces when #EdlCommandApplyProtocol is sent:
+ * the protocol is a non-negative integer and the voltage stays within #EDL_PROTOCOL_MAX_VOLTAGE_MV; the triangular protocol
+ * also needs a positive amplitude and period.
+ *
+ * \param values [in] Value of each command of type #EdlCommandTypeProtocolValue, indexed by #EdlCommandId_t.
+ * \return #EdlSuccess, or #EdlViolatedTrialRuleError if a rule is violated.
+ */
+EdlErrorCode_t edlCheckProtocol(const double values[EdlCommandIdNum]);
+
+#endif // EDL_SETTINGS_H
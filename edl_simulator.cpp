@@ -0,0 +1,392 @@
+/*! \file edl_simulator.cpp
+ * \brief Defines the methods of class EDL on top of in-process simulated devices.
+ * Link this file instead of edl.lib to run without the Elements library.
+ */
+#include "edl_simulator.h"
+
+#include <map>
+#include <mutex>
+#include <cmath>
+#include <cstdio>
+
+#include "edl_settings.h"
+#include "packet_source.h"
+
+/*! \class SimulatedDevice
+ * \brief Simulated e4 device: a #SyntheticPacketSource driven by the commands received through EDL::setCommand.
+ */
+class SimulatedDevice : public SyntheticPacketSource {
+public:
+    SimulatedDevice(const EdlSimulatorConfig_t &config, unsigned int seed);
+
+    EdlErrorCode_t getDeviceStatus(EdlDeviceStatus_t &status);
+    EdlErrorCode_t setCommand(EdlCommandId_t commandId, const EdlCommandStruct_t &commandStruct, bool sendFlag);
+
+protected:
+    void generatePacket(unsigned long long packetIdx, float * packet);
+
+private:
+    EdlErrorCode_t applyProtocol();
+    double compensatedOffset(unsigned int channelIdx, double seconds) const;
+
+    EdlSimulatorConfig_t config;
+
+    unsigned int stackedRadios[EdlCommandIdNum]; /*!< Radio values waiting to be sent. */
+    bool stackedRadioFlags[EdlCommandIdNum]; /*!< Radio commands waiting to be sent. */
+    double stackedValues[EdlCommandIdNum]; /*!< Protocol parameters waiting for #EdlCommandApplyProtocol. */
+
+    unsigned int rangeRadio;
+    unsigned int samplingRateRadio;
+    unsigned int finalBandwidthRadio;
+
+    int protocol; /*!< Applied #EdlCommandMainTrial. */
+    double vHold; /*!< Applied holding voltage [mV]. */
+    double vAmp; /*!< Applied triangular amplitude [mV]. */
+    double tPeriod; /*!< Applied triangular period [s]. */
+
+    double offsets[EDL_CHANNEL_NUM]; /*!< Current offsets before the ongoing compensation [pA]. */
+    double compensationStart; /*!< Time the compensation button was pressed [s], negative if never. */
+    double compensationEnd; /*!< Time the compensation button was released [s], infinity while pressed. */
+
+    unsigned long long eventPackets[EDL_CHANNEL_NUM]; /*!< Remaining packets of the ongoing events. */
+    unsigned long long lossEndPacket; /*!< Packets before this index are lost because of a sent command. */
+    std::chrono::steady_clock::time_point lastStatusTime;
+};
+
+SimulatedDevice::SimulatedDevice(const EdlSimulatorConfig_t &config, unsigned int seed) :
+    SyntheticPacketSource(edlSamplingRateHz(EDL_RADIO_SAMPLING_RATE_1_25_KHZ), config.bufferPackets),
+    config(config),
+    rangeRadio(EDL_RADIO_RANGE_200_PA),
+    samplingRateRadio(EDL_RADIO_SAMPLING_RATE_1_25_KHZ),
+    finalBandwidthRadio(EDL_RADIO_FINAL_BANDWIDTH_SR_2),
+    protocol(EDL_PROTOCOL_CONSTANT),
+    vHold(0.0),
+    vAmp(0.0),
+    tPeriod(0.0),
+    compensationStart(-1.0),
+    compensationEnd(-1.0),
+    lossEndPacket(0),
+    lastStatusTime(std::chrono::steady_clock::now()) {
+    noiseState ^= seed*0x9E3779B9u;
+
+    for (unsigned int commandIdx = 0; commandIdx < EdlCommandIdNum; commandIdx++) {
+        stackedRadios[commandIdx] = 0;
+        stackedRadioFlags[commandIdx] = false;
+        stackedValues[commandIdx] = 0.0;
+    }
+
+    /*! Every current channel starts with a random offset to be compensated. */
+    for (unsigned int channelIdx = 0; channelIdx < EDL_CHANNEL_NUM; channelIdx++) {
+        offsets[channelIdx] = channelIdx == 0 ? 0.0 : config.offsetMax*(2.0*uniformNoise()-1.0);
+        eventPackets[channelIdx] = 0;
+    }
+}
+
+EdlErrorCode_t SimulatedDevice::getDeviceStatus(EdlDeviceStatus_t &status) {
+    update();
+
+    /*! Data sent by the device right after a command is lost. */
+    if (readPackets < lossEndPacket) {
+        losePackets((lossEndPacket < generatedPackets ? lossEndPacket : generatedPackets)-readPackets);
+    }
+
+    /*! Random losses emulate an overloaded host. */
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    double elapsed = std::chrono::duration <double> (now-lastStatusTime).count();
+    lastStatusTime = now;
+    if (config.lostDataRate > 0.0 && uniformNoise() < config.lostDataRate*elapsed) {
+        losePackets((unsigned long long)(config.lostDataMs*1.0e-3*packetRate));
+    }
+
+    return SyntheticPacketSource::getDeviceStatus(status);
+}
+
+EdlErrorCode_t SimulatedDevice::setCommand(EdlCommandId_t commandId, const EdlCommandStruct_t &commandStruct, bool sendFlag) {
+    if (commandId < 0 || commandId >= EdlCommandIdNum) {
+        return EdlCommandIdOutOfRangeError;
+    }
+
+    EdlErrorCode_t res = EdlSuccess;
+    switch (edlCommandType(commandId)) {
+    case EdlCommandTypeRadio:
+        stackedRadios[commandId] = commandStruct.radioId;
+        stackedRadioFlags[commandId] = true;
+        break;
+
+    case EdlCommandTypeProtocolValue:
+        if (sendFlag) {
+            return EdlTrialValueSendNotDisabledError;
+        }
+        stackedValues[commandId] = commandStruct.value;
+        break;
+
+    case EdlCommandTypePushButton:
+    case EdlCommandTypeCheckButton:
+        if (!sendFlag) {
+            return EdlPushButtonSendDisabledError;
+        }
+        break;
+
+    default:
+        break;
+    }
+
+    if (!sendFlag) {
+        return EdlSuccess;
+    }
+
+    /*! Send the stacked radio commands together with this one. */
+    update();
+    if (stackedRadioFlags[EdlCommandRange] && stackedRadios[EdlCommandRange] < edlRadiosNum(EdlCommandRange)) {
+        rangeRadio = stackedRadios[EdlCommandRange];
+    }
+
+    if (stackedRadioFlags[EdlCommandFinalBandwidth] && stackedRadios[EdlCommandFinalBandwidth] < edlRadiosNum(EdlCommandFinalBandwidth)) {
+        finalBandwidthRadio = stackedRadios[EdlCommandFinalBandwidth];
+    }
+
+    if (stackedRadioFlags[EdlCommandSamplingRate] && stackedRadios[EdlCommandSamplingRate] < edlRadiosNum(EdlCommandSamplingRate) &&
+            stackedRadios[EdlCommandSamplingRate] != samplingRateRadio) {
+        samplingRateRadio = stackedRadios[EdlCommandSamplingRate];
+        setPacketRate(edlSamplingRateHz(samplingRateRadio));
+    }
+
+    for (unsigned int commandIdx = 0; commandIdx < EdlCommandIdNum; commandIdx++) {
+        stackedRadioFlags[commandIdx] = false;
+    }
+
+    double now = packetSeconds(generatedPackets);
+    switch (commandId) {
+    case EdlCommandApplyProtocol:
+        res = applyProtocol();
+        break;
+
+    case EdlCommandCompAll:
+        if (commandStruct.buttonPressed == EDL_BUTTON_PRESSED && compensationEnd < now) {
+            for (unsigned int channelIdx = 1; channelIdx < EDL_CHANNEL_NUM; channelIdx++) {
+                offsets[channelIdx] = compensatedOffset(channelIdx, now);
+            }
+            compensationStart = now;
+            compensationEnd = HUGE_VAL;
+
+        } else if (commandStruct.buttonPressed == EDL_BUTTON_RELEASED && compensationEnd > now) {
+            compensationEnd = now;
+        }
+        break;
+
+    case EdlCommandResetComp:
+        compensationStart = -1.0;
+        compensationEnd = -1.0;
+        break;
+
+    default:
+        break;
+    }
+
+    lossEndPacket = generatedPackets+(unsigned long long)(config.commandLossMs*1.0e-3*packetRate);
+    return res;
+}
+
+EdlErrorCode_t SimulatedDevice::applyProtocol() {
+    EdlErrorCode_t res = edlCheckProtocol(stackedValues);
+    if (res != EdlSuccess) {
+        return res;
+    }
+
+    /*! Protocols other than constant and triangular are accepted, but simulated as a constant holding voltage. */
+    protocol = (int)stackedValues[EdlCommandMainTrial];
+    vHold = stackedValues[EdlCommandVhold];
+    vAmp = stackedValues[EdlCommandVamp];
+    tPeriod = stackedValues[EdlCommandTPeriod]*1.0e-3;
+    return EdlSuccess;
+}
+
+double SimulatedDevice::compensatedOffset(unsigned int channelIdx, double seconds) const {
+    if (compensationStart < 0.0 || seconds <= compensationStart) {
+        return offsets[channelIdx];
+    }
+
+    if (seconds > compensationEnd) {
+        seconds = compensationEnd;
+    }
+    return offsets[channelIdx]*std::exp(-(seconds-compensationStart)/config.compensationTau);
+}
+
+void SimulatedDevice::generatePacket(unsigned long long packetIdx, float * packet) {
+    double seconds = packetSeconds(packetIdx);
+
+    double voltage = vHold;
+    if (protocol == EDL_PROTOCOL_TRIANGULAR) {
+        double phase = std::fmod(seconds, tPeriod)/tPeriod;
+        voltage += phase < 0.5 ? -vAmp+4.0*vAmp*phase : 3.0*vAmp-4.0*vAmp*phase;
+    }
+    packet[0] = (float)(std::floor(voltage/EDL_VOLTAGE_LSB_MV+0.5)*EDL_VOLTAGE_LSB_MV);
+
+    double lsb = edlRangeLsb(rangeRadio);
+    double unitScale = rangeRadio == EDL_RADIO_RANGE_200_PA ? 1.0 : 1.0e-3;
+    double eventProbability = config.eventRate/packetRate;
+    for (unsigned int channelIdx = 1; channelIdx < EDL_CHANNEL_NUM; channelIdx++) {
+        double current = config.conductance*voltage;
+
+        /*! Translocation events start with a constant probability and last an exponentially distributed time. */
+        if (eventPackets[channelIdx] > 0) {
+            eventPackets[channelIdx]--;
+            current *= 1.0-config.eventBlockade;
+
+        } else if (uniformNoise() < eventProbability) {
+            eventPackets[channelIdx] = (unsigned long long)(-std::log(1.0-uniformNoise())*config.eventDwell*packetRate);
+        }
+
+        /*! Approximately gaussian noise from the sum of 4 uniform numbers. */
+        double noise = (uniformNoise()+uniformNoise()+uniformNoise()+uniformNoise()-2.0)*1.7320508;
+        current += compensatedOffset(channelIdx, seconds)+noise*config.noiseRms;
+
+        /*! Quantize as the ADC does. */
+        double code = std::floor(current*unitScale/lsb+0.5);
+        if (code > EDL_ADC_CODES-1) {
+            code = EDL_ADC_CODES-1;
+
+        } else if (code < -EDL_ADC_CODES) {
+            code = -EDL_ADC_CODES;
+        }
+        packet[channelIdx] = (float)(code*lsb);
+    }
+}
+
+static std::mutex simulatorMutex;
+static EdlSimulatorConfig_t simulatorConfig = edlSimulatorDefaultConfig();
+
+/*! The #EDL class has no data members, so the simulated device connected by each #EDL object is kept here. */
+static std::map <const EDL *, std::pair <std::string, SimulatedDevice *> > connectedDevices;
+
+EdlSimulatorConfig_t edlSimulatorDefaultConfig() {
+    EdlSimulatorConfig_t config;
+    config.devicesNum = 1;
+    config.bufferPackets = 1 << 20;
+    config.lostDataRate = 0.0;
+    config.lostDataMs = 10.0;
+    config.commandLossMs = 5.0;
+    config.conductance = 1.0;
+    config.noiseRms = 1.0;
+    config.offsetMax = 20.0;
+    config.compensationTau = 0.5;
+    config.eventRate = 2.0;
+    config.eventDwell = 1.0e-3;
+    config.eventBlockade = 0.6;
+    return config;
+}
+
+void edlSimulatorSetConfig(const EdlSimulatorConfig_t &config) {
+    std::lock_guard <std::mutex> lock(simulatorMutex);
+    simulatorConfig = config;
+}
+
+EdlSimulatorConfig_t edlSimulatorGetConfig() {
+    std::lock_guard <std::mutex> lock(simulatorMutex);
+    return simulatorConfig;
+}
+
+static SimulatedDevice * connectedDevice(const EDL * edl) {
+    std::map <const EDL *, std::pair <std::string, SimulatedDevice *> >::iterator it = connectedDevices.find(edl);
+    return it == connectedDevices.end() ? NULL : it->second.second;
+}
+
+static std::string simulatedDeviceId(unsigned int deviceIdx) {
+    char deviceId[16];
+    snprintf(deviceId, sizeof(deviceId), "SIM%05u", deviceIdx);
+    return deviceId;
+}
+
+EDL::EDL() {
+}
+
+EDL::~EDL() {
+    disconnectDevice();
+}
+
+EdlErrorCode_t EDL::detectDevices(std::vector <std::string> &deviceIds) {
+    std::lock_guard <std::mutex> lock(simulatorMutex);
+    deviceIds.clear();
+    for (unsigned int deviceIdx = 0; deviceIdx < simulatorConfig.devicesNum; deviceIdx++) {
+        deviceIds.push_back(simulatedDeviceId(deviceIdx));
+    }
+    return deviceIds.empty() ? EdlNoDevicesError : EdlSuccess;
+}
+
+EdlErrorCode_t EDL::connectDevice(std::string deviceId) {
+    std::lock_guard <std::mutex> lock(simulatorMutex);
+    if (connectedDevice(this) != NULL) {
+        return EdlDeviceAlreadyConnectedError;
+    }
+
+    unsigned int deviceIdx;
+    for (deviceIdx = 0; deviceIdx < simulatorConfig.devicesNum; deviceIdx++) {
+        if (simulatedDeviceId(deviceIdx) == deviceId) {
+            break;
+        }
+    }
+
+    if (deviceIdx == simulatorConfig.devicesNum) {
+        return EdlDeviceConnectionError;
+    }
+
+    /*! A device can be connected to one #EDL object only. */
+    std::map <const EDL *, std::pair <std::string, SimulatedDevice *> >::iterator it;
+    for (it = connectedDevices.begin(); it != connectedDevices.end(); it++) {
+        if (it->second.first == deviceId) {
+            return EdlDeviceConnectionError;
+        }
+    }
+
+    connectedDevices[this] = std::make_pair(deviceId, new SimulatedDevice(simulatorConfig, deviceIdx+1));
+    return EdlSuccess;
+}
+
+EdlErrorCode_t EDL::disconnectDevice() {
+    std::lock_guard <std::mutex> lock(simulatorMutex);
+    SimulatedDevice * device = connectedDevice(this);
+    if (device == NULL) {
+        return EdlDeviceNotConnectedError;
+    }
+
+    delete device;
+    connectedDevices.erase(this);
+    return EdlSuccess;
+}
+
+EdlErrorCode_t EDL::getDeviceStatus(EdlDeviceStatus_t &status) {
+    std::lock_guard <std::mutex> lock(simulatorMutex);
+    SimulatedDevice * device = connectedDevice(this);
+    if (device == NULL) {
+        return EdlDeviceNotConnectedError;
+    }
+    return device->getDeviceStatus(status);
+}
+
+EdlErrorCode_t EDL::readData(unsigned int dataToRead, unsigned int &dataRead, std::vector <float> &buffer) {
+    std::lock_guard <std::mutex> lock(simulatorMutex);
+    SimulatedDevice * device = connectedDevice(this);
+    if (device == NULL) {
+        dataRead = 0;
+        return EdlDeviceNotConnectedError;
+    }
+    return device->readData(dataToRead, dataRead, buffer);
+}
+
+EdlErrorCode_t EDL::purgeData() {
+    std::lock_guard <std::mutex> lock(simulatorMutex);
+    SimulatedDevice * device = connectedDevice(this);
+    if (device == NULL) {
+        return EdlDeviceNotConnectedError;
+    }
+    return device->purgeData();
+}
+
+EdlErrorCode_t EDL::setCommand(EdlCommandId_t commandId, EdlCommandStruct_t &commandStruct, bool sendFlag) {
+    std::lock_guard <std::mutex> lock(simulatorMutex);
+    SimulatedDevice * device = connectedDevice(this);
+    if (device == NULL) {
+        return EdlDeviceNotConnectedError;
+    }
+    return device->setCommand(commandId, commandStruct, sendFlag);
+}
@@ -0,0 +1,46 @@
+/*! \file edl_simulator.h
+ * \brief Declares the configuration of the simulated EDL backend.
+ * edl_simulator.cpp defines the methods of class #EDL and replaces edl.lib on systems where the
+ * Elements library is not available: linking it instead of edl.lib runs the unmodified caller code
+ * against in-process simulated devices.
+ */
+#ifndef EDL_SIMULATOR_H
+#define EDL_SIMULATOR_H
+
+#include "edl.h"
+
+/*! \struct EdlSimulatorConfig_t
+ * \brief Configuration of the simulated devices.
+ * Changes apply to the devices connected afterwards.
+ */
+typedef struct {
+    unsigned int devicesNum; /*!< Number of devices returned by EDL::detectDevices. */
+    unsigned int bufferPackets; /*!< Data packets buffered by the library before raising EdlDeviceStatus_t::bufferOverflowFlag. */
+    double lostDataRate; /*!< Average number of data loss events per second, to emulate an overloaded host [Hz]. */
+    double lostDataMs; /*!< Duration of the data lost in each loss event [ms]. */
+    double commandLossMs; /*!< Duration of the data lost after each command sent to the device [ms]. */
+    double conductance; /*!< Open pore conductance of every current channel [nS]. */
+    double noiseRms; /*!< Standard deviation of the current noise [pA]. */
+    double offsetMax; /*!< Maximum absolute current offset before digital compensation [pA]. */
+    double compensationTau; /*!< Time constant of the digital offset compensation [s]. */
+    double eventRate; /*!< Average number of translocation events per second on each current channel [Hz]. */
+    double eventDwell; /*!< Average duration of the translocation events [s]. */
+    double eventBlockade; /*!< Fraction of the open pore current blocked during the translocation events. */
+} EdlSimulatorConfig_t;
+
+/*! \fn edlSimulatorDefaultConfig
+ * \brief Returns the default configuration of the simulated devices.
+ */
+EdlSimulatorConfig_t edlSimulatorDefaultConfig();
+
+/*! \fn edlSimulatorSetConfig
+ * \brief Sets the configuration of the simulated devices.
+ */
+void edlSimulatorSetConfig(const EdlSimulatorConfig_t &config);
+
+/*! \fn edlSimulatorGetConfig
+ * \brief Returns the current configuration of the simulated devices.
+ */
+EdlSimulatorConfig_t edlSimulatorGetConfig();
+
+#endif // EDL_SIMULATOR_H
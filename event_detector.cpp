@@ -0,0 +1,144 @@
+/*! \file event_detector.cpp
+ * \brief Defines class EventDetector.
+ */
+#include "event_detector.h"
+
+#include <cmath>
+
+EventDetectorConfig_t eventDetectorDefaultConfig(double samplingRate) {
+    EventDetectorConfig_t config;
+    config.samplingRate = samplingRate;
+    config.baselineTau = 1.0e-3;
+    config.noiseTau = 0.01;
+    config.startSigmas = 5.0;
+    config.endSigmas = 2.0;
+    config.minDwell = 5.0/samplingRate;
+    config.maxDwell = 0.1;
+    return config;
+}
+
+EventDetector::EventDetector(const EventDetectorConfig_t &config) :
+    config(config) {
+    alpha = 1.0/(1.0+config.baselineTau*config.samplingRate);
+    noiseAlpha = 1.0/(1.0+config.noiseTau*config.samplingRate);
+    warmupPackets = (unsigned long long)(5.0*(config.baselineTau+config.noiseTau)*config.samplingRate);
+    minDwellSamples = (unsigned int)std::ceil(config.minDwell*config.samplingRate);
+    maxDwellSamples = (unsigned int)(config.maxDwell*config.samplingRate);
+    reset();
+}
+
+void EventDetector::reset() {
+    processedPackets = 0;
+    seedPacket = 0;
+    for (unsigned int channelIdx = 0; channelIdx < EDL_CHANNEL_NUM; channelIdx++) {
+        channels[channelIdx].smoothed = 0.0;
+        channels[channelIdx].smoothedTwice = 0.0;
+        channels[channelIdx].variance = 0.0;
+        channels[channelIdx].inEvent = false;
+        channels[channelIdx].eventStart = 0;
+        channels[channelIdx].eventSamples = 0;
+        channels[channelIdx].eventMean = 0.0;
+        channels[channelIdx].eventM2 = 0.0;
+    }
+}
+
+void EventDetector::skip(unsigned long long packetsNum) {
+    processedPackets += packetsNum;
+    seedPacket = processedPackets;
+    for (unsigned int channelIdx = 0; channelIdx < EDL_CHANNEL_NUM; channelIdx++) {
+        channels[channelIdx].inEvent = false;
+        channels[channelIdx].eventSamples = 0;
+    }
+}
+
+void EventDetector::process(const float * packets, unsigned int packetsNum, std::vector <NanoporeEvent_t> &events) {
+    for (unsigned int packetIdx = 0; packetIdx < packetsNum; packetIdx++) {
+        /*! Channel 0 is the voltage channel: only the current channels are processed. */
+        for (unsigned int channelIdx = 1; channelIdx < EDL_CHANNEL_NUM; channelIdx++) {
+            processSample(channelIdx, processedPackets, packets[packetIdx*EDL_CHANNEL_NUM+channelIdx], events);
+        }
+        processedPackets++;
+    }
+}
+
+void EventDetector::processChannels(const float * const * channels, unsigned int packetsNum, std::vector <NanoporeEvent_t> &events) {
+    for (unsigned int channelIdx = 1; channelIdx < EDL_CHANNEL_NUM; channelIdx++) {
+        const float * samples = channels[channelIdx];
+        for (unsigned int packetIdx = 0; packetIdx < packetsNum; packetIdx++) {
+            processSample(channelIdx, processedPackets+packetIdx, samples[packetIdx], events);
+        }
+    }
+    processedPackets += packetsNum;
+}
+
+unsigned long long EventDetector::getProcessedPackets() const {
+    return processedPackets;
+}
+
+void EventDetector::processSample(unsigned int channelIdx, unsigned long long packetIdx, double sample, std::vector <NanoporeEvent_t> &events) {
+    ChannelState_t &state = channels[channelIdx];
+
+    /*! Initialize the baseline with the first sample, also after a gap, and measure the noise again. */
+    if (packetIdx == seedPacket) {
+        state.smoothed = sample;
+        state.smoothedTwice = sample;
+        state.variance = 0.0;
+    }
+
+    /*! Brown's double exponential smoothing: one step ahead forecast of the baseline. */
+    double baseline = 2.0*state.smoothed-state.smoothedTwice+alpha/(1.0-alpha)*(state.smoothed-state.smoothedTwice);
+
+    /*! A blockade reduces the magnitude of the current, whatever its sign. */
+    double blockade = baseline >= 0.0 ? baseline-sample : sample-baseline;
+
+    if (!state.inEvent) {
+        double threshold = config.startSigmas*std::sqrt(state.variance);
+        if (packetIdx >= seedPacket+warmupPackets && blockade > threshold) {
+            state.inEvent = true;
+            state.eventStart = packetIdx;
+            state.eventSamples = 0;
+            state.eventMean = 0.0;
+            state.eventM2 = 0.0;
+
+        } else {
+            double error = sample-baseline;
+            state.variance += noiseAlpha*(error*error-state.variance);
+            state.smoothed += alpha*(sample-state.smoothed);
+            state.smoothedTwice += alpha*(state.smoothed-state.smoothedTwice);
+            return;
+        }
+
+    } else if (blockade <= config.endSigmas*std::sqrt(state.variance)) {
+        /*! The current is back to the baseline: the event ends. */
+        state.inEvent = false;
+        if (state.eventSamples >= minDwellSamples) {
+            NanoporeEvent_t event;
+            event.channel = channelIdx;
+            event.startSample = state.eventStart;
+            event.duration = state.eventSamples;
+            event.baseline = (float)baseline;
+            event.meanBlockade = (float)(baseline >= 0.0 ? baseline-state.eventMean : state.eventMean-baseline);
+            event.stdBlockade = (float)std::sqrt(state.eventM2/state.eventSamples);
+            events.push_back(event);
+        }
+
+        state.smoothed += alpha*(sample-state.smoothed);
+        state.smoothedTwice += alpha*(state.smoothed-state.smoothedTwice);
+        return;
+    }
+
+    /*! During the event the baseline is extrapolated. */
+    state.eventSamples++;
+    double delta = sample-state.eventMean;
+    state.eventMean += delta/state.eventSamples;
+    state.eventM2 += delta*(sample-state.eventMean);
+    state.smoothed += alpha*(baseline-state.smoothed);
+    state.smoothedTwice += alpha*(state.smoothed-state.smoothedTwice);
+
+    /*! Too long a blockade is a baseline change: restart the baseline from the current level. */
+    if (state.eventSamples > maxDwellSamples) {
+        state.inEvent = false;
+        state.smoothed = sample;
+        state.smoothedTwice = sample;
+    }
+}
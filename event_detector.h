@@ -0,0 +1,115 @@
+/*! \file event_detector.h
+ * \brief Declares class EventDetector, which detects translocation events on the current channels while data are collected.
+ */
+#ifndef EVENT_DETECTOR_H
+#define EVENT_DETECTOR_H
+
+#include <vector>
+
+#include "edl.h"
+
+/*! \struct EventDetectorConfig_t
+ * \brief Configuration of an #EventDetector.
+ */
+typedef struct {
+    double samplingRate; /*!< Sampling rate of the processed data packets [Hz]. */
+    double baselineTau; /*!< Time constant of the moving baseline [s]. */
+    double noiseTau; /*!< Time constant of the moving noise estimate [s]. */
+    double startSigmas; /*!< An event starts when the blockade exceeds this many noise standard deviations. */
+    double endSigmas; /*!< An event ends when the blockade falls below this many noise standard deviations.
+                       * Lower than \a startSigmas to provide hysteresis. */
+    double minDwell; /*!< Events shorter than this are discarded [s]. */
+    double maxDwell; /*!< Events longer than this are considered a baseline change and discarded [s]. */
+} EventDetectorConfig_t;
+
+/*! \struct NanoporeEvent_t
+ * \brief Translocation event detected on a current channel.
+ * Currents are expressed in the unit of the current channels (pA or nA, depending on the range).
+ */
+typedef struct {
+    unsigned int channel; /*!< Index of the current channel in the data packets, from 1 to #EDL_CHANNEL_NUM - 1. */
+    unsigned long long startSample; /*!< Index of the first data packet of the event. */
+    unsigned int duration; /*!< Duration of the event in data packets. */
+    float baseline; /*!< Open pore current before the event. */
+    float meanBlockade; /*!< Mean reduction of the current magnitude with respect to the baseline. */
+    float stdBlockade; /*!< Standard deviation of the current during the event. */
+} NanoporeEvent_t;
+
+/*! \fn eventDetectorDefaultConfig
+ * \brief Returns a default #EventDetectorConfig_t for a sampling rate.
+ */
+EventDetectorConfig_t eventDetectorDefaultConfig(double samplingRate);
+
+/*! \class EventDetector
+ * \brief Streaming detector of translocation events on the #EDL_CHANNEL_NUM - 1 current channels.
+ * Each channel tracks a moving baseline with double exponential smoothing, which follows voltage ramps without lag,
+ * and a noise level with an exponential average of the squared prediction error. During events the baseline is
+ * extrapolated and the noise level is frozen. An event is a reduction of the current magnitude that crosses the
+ * start threshold and lasts until the current comes back within the end threshold. The cost per sample is constant.
+ */
+class EventDetector {
+public:
+    /*! \brief EventDetector constructor.
+     */
+    explicit EventDetector(const EventDetectorConfig_t &config);
+
+    /*! \brief Forgets baselines and ongoing events, and restarts counting data packets from 0.
+     */
+    void reset(EDL_VOID);
+
+    /*! \brief Accounts for missing data packets: the ongoing events are discarded, as their end is unknown,
+     * and the count of data packets advances, so that the following events keep their exact position.
+     * The baselines and the noise levels are seeded again from the next data packet and settle as after #reset.
+     *
+     * \param packetsNum [in] Number of missing data packets.
+     */
+    void skip(EDL_IN unsigned long long packetsNum);
+
+    /*! \brief Processes consecutive data packets, as returned by EDL::readData.
+     *
+     * \param packets [in] \a packetsNum data packets of #EDL_CHANNEL_NUM samples each.
+     * \param packetsNum [in] Number of data packets.
+     * \param events [out] Vector the events ended in these packets are appended to.
+     */
+    void process(EDL_IN const float * packets, EDL_IN unsigned int packetsNum, EDL_OUT std::vector <NanoporeEvent_t> &events);
+
+    /*! \brief Processes consecutive data packets stored as one array per channel, e.g. by a #ChannelBlock.
+     * Equivalent to #process, but faster because each channel is processed in a single pass;
+     * the events are appended channel by channel.
+     *
+     * \param channels [in] #EDL_CHANNEL_NUM arrays of \a packetsNum samples each.
+     * \param packetsNum [in] Number of data packets.
+     * \param events [out] Vector the events ended in these packets are appended to.
+     */
+    void processChannels(EDL_IN const float * const * channels, EDL_IN unsigned int packetsNum, EDL_OUT std::vector <NanoporeEvent_t> &events);
+
+    /*! \brief Returns the number of data packets processed since the last #reset.
+     */
+    unsigned long long getProcessedPackets(EDL_VOID) const;
+
+private:
+    typedef struct {
+        double smoothed; /*!< First exponential average of the open pore current. */
+        double smoothedTwice; /*!< Exponential average of \a smoothed. */
+        double variance; /*!< Moving average of the squared deviation from the baseline. */
+        bool inEvent; /*!< True during an event. */
+        unsigned long long eventStart; /*!< First data packet of the ongoing event. */
+        unsigned int eventSamples; /*!< Samples of the ongoing event. */
+        double eventMean; /*!< Running mean of the ongoing event (Welford). */
+        double eventM2; /*!< Running sum of squared deviations of the ongoing event (Welford). */
+    } ChannelState_t;
+
+    void processSample(unsigned int channelIdx, unsigned long long packetIdx, double sample, std::vector <NanoporeEvent_t> &events);
+
+    EventDetectorConfig_t config;
+    double alpha; /*!< Weight of each sample in the baseline. */
+    double noiseAlpha; /*!< Weight of each sample in the noise estimate. */
+    unsigned long long warmupPackets; /*!< Packets used only to settle the baseline after #reset or #skip. */
+    unsigned int minDwellSamples;
+    unsigned int maxDwellSamples;
+    unsigned long long processedPackets;
+    unsigned long long seedPacket; /*!< Packet that seeds the baselines: the first one after #reset or #skip. */
+    ChannelState_t channels[EDL_CHANNEL_NUM];
+};
+
+#endif // EVENT_DETECTOR_H
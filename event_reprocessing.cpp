@@ -0,0 +1,235 @@
+/*! \file event_reprocessing.cpp
+ * \brief Defines class EventReprocessor.
+ */
+#include "event_reprocessing.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+
+#include "deinterleave.h"
+#include "recording_reader.h"
+
+ReprocessingConfig_t reprocessingDefaultConfig(double samplingRate) {
+    ReprocessingConfig_t config;
+    config.chunkSeconds = REPROCESSING_CHUNK_SECONDS;
+    config.filtered = true;
+    config.filter = lowPassDefaultConfig(samplingRate);
+    config.filter.type = LowPassBessel;
+    config.filter.order = 4;
+    config.filter.cutoff = 0.2*samplingRate;
+    config.detector = eventDetectorDefaultConfig(samplingRate);
+    return config;
+}
+
+/*! \struct ReprocessingRun_t
+ * \brief What the tasks of one EventReprocessor::run share; only \a readers is written, each element by its own worker.
+ */
+typedef struct {
+    std::string path;
+    ReprocessingConfig_t config;
+    uint64_t packetsNum; /*!< Data packets in the recording. */
+    uint64_t chunkPackets;
+    uint64_t warmupPackets;
+    uint64_t tailPackets;
+    std::vector <uint64_t> gapPackets; /*!< Index of the data packet following each gap. */
+    std::vector <uint64_t> gapMissingPackets; /*!< Data packets missing up to each gap, included. */
+    std::vector <RecordingReader *> readers; /*!< One per worker, opened by the first task the worker runs. */
+} ReprocessingRun_t;
+
+/*! \fn streamPacket
+ * \brief Returns the index of a data packet of the recording counting the missing ones.
+ */
+static uint64_t streamPacket(const ReprocessingRun_t &run, uint64_t packetIdx) {
+    size_t gapsNum = std::upper_bound(run.gapPackets.begin(), run.gapPackets.end(), packetIdx)-run.gapPackets.begin();
+    return packetIdx+(gapsNum > 0 ? run.gapMissingPackets[gapsNum-1] : 0);
+}
+
+/*! \fn compareEvents
+ * \brief Orders the events by start, then by channel.
+ */
+static bool compareEvents(const NanoporeEvent_t &a, const NanoporeEvent_t &b) {
+    return a.startSample != b.startSample ? a.startSample < b.startSample : a.channel < b.channel;
+}
+
+/*! \class ChunkTask
+ * \brief Detects the events that start in one chunk of the recording.
+ */
+class ChunkTask : public PoolTask {
+public:
+    ChunkTask(const ReprocessingRun_t &shared, unsigned int chunkIdx) :
+        shared(shared),
+        chunkIdx(chunkIdx),
+        processedPackets(0),
+        success(false) {
+    }
+
+    void run(unsigned int workerIdx) {
+        RecordingReader &reader = *shared.readers[workerIdx];
+        if (!reader.isOpen() && !reader.open(shared.path)) {
+            return;
+        }
+
+        uint64_t ownedStart = (uint64_t)chunkIdx*shared.chunkPackets;
+        uint64_t ownedEnd = std::min(ownedStart+shared.chunkPackets, shared.packetsNum);
+        uint64_t firstPacket = ownedStart > shared.warmupPackets ? ownedStart-shared.warmupPackets : 0;
+        uint64_t endPacket = std::min(ownedEnd+shared.tailPackets, shared.packetsNum);
+
+        /*! The detector counts the data packets from the first one read, the missing ones included. */
+        uint64_t basePacket = streamPacket(shared, firstPacket);
+        uint64_t ownedStreamStart = streamPacket(shared, ownedStart);
+        uint64_t ownedStreamEnd = ownedEnd < shared.packetsNum ? streamPacket(shared, ownedEnd) : UINT64_MAX;
+        size_t gapIdx = std::upper_bound(shared.gapPackets.begin(), shared.gapPackets.end(), firstPacket)-shared.gapPackets.begin();
+
+        LowPassFilter filter(shared.config.filter);
+        EventDetector detector(shared.config.detector);
+        std::vector <float> filtered;
+        ChannelBlock block;
+        std::vector <NanoporeEvent_t> found;
+        for (uint64_t packetIdx = firstPacket; packetIdx < endPacket;) {
+            RecordingBlock_t recorded;
+            unsigned int maxPacketsNum = (unsigned int)std::min <uint64_t> (endPacket-packetIdx, RECORDING_READER_BLOCK_PACKETS);
+            if (!reader.readBlock(packetIdx, maxPacketsNum, recorded)) {
+                return;
+            }
+
+            /*! Blocks end at the chunks of the file, hence at the gaps. */
+            for (; gapIdx < shared.gapPackets.size() && shared.gapPackets[gapIdx] <= packetIdx; gapIdx++) {
+                detector.skip(shared.gapMissingPackets[gapIdx]-(gapIdx > 0 ? shared.gapMissingPackets[gapIdx-1] : 0));
+                filter.reset();
+            }
+
+            const float * packets = recorded.packets;
+            if (shared.config.filtered) {
+                filtered.resize((size_t)recorded.packetsNum*EDL_CHANNEL_NUM);
+                filter.process(recorded.packets, recorded.packetsNum, filtered.data());
+                packets = filtered.data();
+            }
+            block.deinterleave(packets, recorded.packetsNum);
+            detector.processChannels(block.channels(), recorded.packetsNum, found);
+            packetIdx += recorded.packetsNum;
+            processedPackets += recorded.packetsNum;
+        }
+
+        /*! Keep the events that start in the chunk: the others belong to the neighbouring chunks. */
+        for (size_t eventIdx = 0; eventIdx < found.size(); eventIdx++) {
+            NanoporeEvent_t event = found[eventIdx];
+            event.startSample += basePacket;
+            if (event.startSample >= ownedStreamStart && event.startSample < ownedStreamEnd) {
+                events.push_back(event);
+            }
+        }
+        std::sort(events.begin(), events.end(), compareEvents);
+        success = true;
+    }
+
+    const ReprocessingRun_t &shared;
+    unsigned int chunkIdx;
+    std::vector <NanoporeEvent_t> events;
+    unsigned long long processedPackets;
+    bool success;
+};
+
+EventReprocessor::EventReprocessor(WorkStealingPool &pool) :
+    pool(pool) {
+    memset(&stats, 0, sizeof(stats));
+}
+
+EventReprocessor::~EventReprocessor() {
+}
+
+bool EventReprocessor::run(const std::string &path, const ReprocessingConfig_t &config, std::vector <NanoporeEvent_t> &events) {
+    std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+    memset(&stats, 0, sizeof(stats));
+    error.clear();
+    events.clear();
+
+    RecordingReader reader;
+    if (!reader.open(path)) {
+        error = "cannot read "+path;
+        return false;
+    }
+
+    const RecordingHeader_t &header = reader.getHeader();
+    if (header.samplingRate <= 0.0 || config.chunkSeconds <= 0.0 ||
+            config.detector.samplingRate != header.samplingRate || (config.filtered && config.filter.samplingRate != header.samplingRate)) {
+        error = "the configuration does not match the sampling rate of "+path;
+        return false;
+    }
+
+    /*! An event under way at the start of a chunk started at most one longest event earlier, and the detector must settle before it. */
+    ReprocessingRun_t run;
+    run.path = path;
+    run.config = config;
+    run.packetsNum = reader.getPacketsNum();
+    run.chunkPackets = std::max <uint64_t> (1, (uint64_t)std::ceil(config.chunkSeconds*header.samplingRate));
+    run.warmupPackets = (uint64_t)std::ceil((config.detector.maxDwell+
+            REPROCESSING_SETTLE_TAUS*(config.detector.baselineTau+config.detector.noiseTau))*header.samplingRate);
+    if (config.filtered && config.filter.cutoff > 0.0) {
+        run.warmupPackets += (uint64_t)std::ceil(REPROCESSING_SETTLE_TAUS/(2.0*3.14159265358979323846*config.filter.cutoff)*header.samplingRate);
+    }
+    run.tailPackets = (uint64_t)std::ceil(config.detector.maxDwell*header.samplingRate)+2;
+
+    uint64_t missingPacketsNum = 0;
+    for (unsigned int gapIdx = 0; gapIdx < reader.getGapsNum(); gapIdx++) {
+        missingPacketsNum += reader.getGap(gapIdx).packetsNum;
+        run.gapPackets.push_back(reader.getGapPacket(gapIdx));
+        run.gapMissingPackets.push_back(missingPacketsNum);
+    }
+    reader.close();
+
+    for (unsigned int workerIdx = 0; workerIdx < pool.getWorkersNum(); workerIdx++) {
+        run.readers.push_back(new RecordingReader);
+    }
+
+    /*! Give each worker a contiguous range of chunks, which it reads forward from the start of its region of the file;
+     * a worker that runs out of chunks steals the last ones of the range of another worker. */
+    unsigned int chunksNum = (unsigned int)((run.packetsNum+run.chunkPackets-1)/run.chunkPackets);
+    std::vector <ChunkTask *> tasks;
+    for (unsigned int chunkIdx = 0; chunkIdx < chunksNum; chunkIdx++) {
+        tasks.push_back(new ChunkTask(run, chunkIdx));
+    }
+
+    unsigned long long stolenTasksNum = pool.getStolenTasksNum();
+    for (unsigned int chunkIdx = 0; chunkIdx < chunksNum; chunkIdx++) {
+        pool.submit(tasks[chunkIdx], (unsigned int)((uint64_t)chunkIdx*pool.getWorkersNum()/chunksNum));
+    }
+    pool.wait();
+
+    /*! Stitch the events in the order of the chunks: each chunk holds the events that start in it, sorted. */
+    bool success = true;
+    for (unsigned int chunkIdx = 0; chunkIdx < chunksNum; chunkIdx++) {
+        ChunkTask * task = tasks[chunkIdx];
+        if (!task->success && success) {
+            error = "cannot read chunk "+std::to_string(chunkIdx)+" of "+path;
+            success = false;
+        }
+        events.insert(events.end(), task->events.begin(), task->events.end());
+        stats.processedPackets += task->processedPackets;
+        delete task;
+    }
+
+    for (size_t readerIdx = 0; readerIdx < run.readers.size(); readerIdx++) {
+        delete run.readers[readerIdx];
+    }
+
+    if (!success) {
+        events.clear();
+    }
+
+    stats.chunksNum = chunksNum;
+    stats.warmupPackets = run.warmupPackets;
+    stats.tailPackets = run.tailPackets;
+    stats.stolenTasksNum = pool.getStolenTasksNum()-stolenTasksNum;
+    stats.seconds = std::chrono::duration <double> (std::chrono::steady_clock::now()-startTime).count();
+    return success;
+}
+
+const ReprocessingStats_t &EventReprocessor::getStats() const {
+    return stats;
+}
+
+const std::string &EventReprocessor::getError() const {
+    return error;
+}
@@ -0,0 +1,106 @@
+/*! \file event_reprocessing.h
+ * \brief Declares class EventReprocessor, which filters a recording and detects its events again on all of the cores.
+ */
+#ifndef EVENT_REPROCESSING_H
+#define EVENT_REPROCESSING_H
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+#include "edl.h"
+#include "event_detector.h"
+#include "lowpass_filter.h"
+#include "work_stealing_pool.h"
+
+/*! \def REPROCESSING_CHUNK_SECONDS
+ * \brief Default duration of the chunks processed by each task of an #EventReprocessor [s].
+ */
+#define REPROCESSING_CHUNK_SECONDS 10.0
+
+/*! \def REPROCESSING_SETTLE_TAUS
+ * \brief Time constants of the event detector, and of the filter, left to a task to forget its initial state before the
+ * chunk it owns: after e^-30 the state matches that of a sequential pass to the rounding of doubles.
+ */
+#define REPROCESSING_SETTLE_TAUS 30.0
+
+/*! \struct ReprocessingConfig_t
+ * \brief Configuration of an #EventReprocessor.
+ */
+typedef struct {
+    double chunkSeconds; /*!< Duration of the chunk of the recording owned by each task [s]. */
+    bool filtered; /*!< True to filter the current channels before the event detection. */
+    LowPassConfig_t filter; /*!< Filter applied to the current channels if \a filtered. */
+    EventDetectorConfig_t detector; /*!< Configuration of the event detection. */
+} ReprocessingConfig_t;
+
+/*! \fn reprocessingDefaultConfig
+ * \brief Returns chunks of #REPROCESSING_CHUNK_SECONDS, the default event detection and the filter applied by the caller
+ * before it: a 4th order Bessel filter with the cut-off at a fifth of the sampling rate.
+ */
+ReprocessingConfig_t reprocessingDefaultConfig(double samplingRate);
+
+/*! \struct ReprocessingStats_t
+ * \brief Counters of the last EventReprocessor::run.
+ */
+typedef struct {
+    unsigned int chunksNum; /*!< Chunks the recording was split in, one task each. */
+    unsigned long long warmupPackets; /*!< Data packets read before each chunk to settle the filter and the detector. */
+    unsigned long long tailPackets; /*!< Data packets read after each chunk to end the events started in it. */
+    unsigned long long processedPackets; /*!< Data packets processed by all of the tasks, overlaps included. */
+    unsigned long long stolenTasksNum; /*!< Tasks stolen by a worker from the queue of another one, see #WorkStealingPool. */
+    double seconds; /*!< Time taken [s]. */
+} ReprocessingStats_t;
+
+/*! \class EventReprocessor
+ * \brief Detects the events of a recording again, possibly with another filter or detector configuration, running one task
+ * per chunk of the recording on a #WorkStealingPool.
+ *
+ * Each task owns the data packets of its chunk and the events that start in it. It reads the data packets from
+ * ReprocessingStats_t::warmupPackets before the chunk, so that its filter and its detector reach the state they would have
+ * in a sequential pass, including an event under way across the start of the chunk, which is then not reported twice.
+ * It reads on for ReprocessingStats_t::tailPackets after the chunk, the longest event the detector keeps, so that the
+ * events started near its end are complete. The events of the chunks are concatenated in the order of the chunks and sorted
+ * by start and channel: the result depends on the chunk duration alone, not on the number of workers nor on which one ran
+ * which chunk. Gaps in the recording are handled as by EventDetector::skip, and the filter is primed again after them.
+ */
+class EventReprocessor {
+public:
+    /*! \brief EventReprocessor constructor.
+     *
+     * \param pool [in] Pool running the tasks; it must outlive this object.
+     */
+    explicit EventReprocessor(WorkStealingPool &pool);
+
+    /*! \brief EventReprocessor destructor.
+     */
+    ~EventReprocessor();
+
+    /*! \brief Detects the events of a recording file.
+     *
+     * \param path [in] Path of the recording file.
+     * \param config [in] Configuration; its sampling rates must be the one of the recording.
+     * \param events [out] Events of the recording, sorted by start and channel. NanoporeEvent_t::startSample counts the data
+     * packets since the start of the file, including the missing ones.
+     * \return False if the file cannot be read or a chunk is corrupted; see #getError.
+     */
+    bool run(const std::string &path, EDL_IN const ReprocessingConfig_t &config, EDL_OUT std::vector <NanoporeEvent_t> &events);
+
+    /*! \brief Returns the counters of the last #run.
+     */
+    const ReprocessingStats_t &getStats(EDL_VOID) const;
+
+    /*! \brief Returns the description of the problem met by the last #run.
+     */
+    const std::string &getError(EDL_VOID) const;
+
+private:
+    EventReprocessor(const EventReprocessor &);
+    EventReprocessor &operator=(const EventReprocessor &);
+
+    WorkStealingPool &pool;
+    ReprocessingStats_t stats;
+    std::string error;
+};
+
+#endif // EVENT_REPROCESSING_H
@@ -0,0 +1,134 @@
+/*! \file instrumentation.cpp
+ * \brief Defines classes LatencyHistogram and Instrumentation.
+ */
+#include "instrumentation.h"
+
+#include <chrono>
+
+const char * instrumentationProbeName(InstrumentationProbe_t probe) {
+    switch (probe) {
+    case ProbeStatus:
+        return "status";
+
+    case ProbeRead:
+        return "read";
+
+    case ProbePublish:
+        return "publish";
+
+    case ProbeConsume:
+        return "consume";
+
+    case ProbeProcess:
+        return "process";
+
+    case ProbeWrite:
+        return "write";
+
+    default:
+        return "unknown";
+    }
+}
+
+uint64_t instrumentationNow() {
+    return (uint64_t)std::chrono::duration_cast <std::chrono::nanoseconds> (std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+LatencyHistogram::LatencyHistogram() :
+    totalNs(0),
+    maxNs(0),
+    packets(0) {
+    for (unsigned int bucketIdx = 0; bucketIdx < HISTOGRAM_BUCKETS; bucketIdx++) {
+        counts[bucketIdx] = 0;
+    }
+}
+
+unsigned int LatencyHistogram::bucketIdx(uint64_t ns) {
+    const uint64_t subBucketsNum = (uint64_t)1 << HISTOGRAM_SUB_BUCKET_BITS;
+    if (ns < subBucketsNum) {
+        return (unsigned int)ns;
+    }
+
+    if (ns >= ((uint64_t)1 << HISTOGRAM_MAX_BITS)) {
+        return HISTOGRAM_BUCKETS-1;
+    }
+
+    /*! Index of the most significant bit, then the next #HISTOGRAM_SUB_BUCKET_BITS bits select the sub-bucket. */
+    unsigned int msb;
+#if defined(__GNUC__)
+    msb = 63-(unsigned int)__builtin_clzll(ns);
+#else
+    msb = 0;
+    while ((ns >> (msb+1)) != 0) {
+        msb++;
+    }
+#endif
+    unsigned int shift = msb-HISTOGRAM_SUB_BUCKET_BITS;
+    return ((shift+1) << HISTOGRAM_SUB_BUCKET_BITS)+(unsigned int)((ns >> shift)-subBucketsNum);
+}
+
+uint64_t LatencyHistogram::bucketUpperNs(unsigned int bucketIdx) {
+    const unsigned int subBucketsNum = 1 << HISTOGRAM_SUB_BUCKET_BITS;
+    if (bucketIdx < 2*subBucketsNum) {
+        return bucketIdx;
+    }
+
+    unsigned int shift = (bucketIdx >> HISTOGRAM_SUB_BUCKET_BITS)-1;
+    uint64_t lower = (uint64_t)((bucketIdx & (subBucketsNum-1))+subBucketsNum) << shift;
+    return lower+((uint64_t)1 << shift)-1;
+}
+
+void LatencyHistogram::record(uint64_t ns, unsigned long long packetsNum) {
+    counts[bucketIdx(ns)].fetch_add(1, std::memory_order_relaxed);
+    totalNs.fetch_add(ns, std::memory_order_relaxed);
+    if (packetsNum > 0) {
+        packets.fetch_add(packetsNum, std::memory_order_relaxed);
+    }
+
+    unsigned long long prevMaxNs = maxNs.load(std::memory_order_relaxed);
+    while (ns > prevMaxNs && !maxNs.compare_exchange_weak(prevMaxNs, ns, std::memory_order_relaxed)) {
+    }
+}
+
+void LatencyHistogram::drain(HistogramSummary_t &summary) {
+    /*! Take the counts and clear them bucket by bucket, then walk the cumulative distribution once for all of the percentiles. */
+    unsigned long long intervalCounts[HISTOGRAM_BUCKETS];
+    unsigned long long count = 0;
+    for (unsigned int bucketIdx = 0; bucketIdx < HISTOGRAM_BUCKETS; bucketIdx++) {
+        intervalCounts[bucketIdx] = counts[bucketIdx].exchange(0, std::memory_order_relaxed);
+        count += intervalCounts[bucketIdx];
+    }
+    unsigned long long intervalNs = totalNs.exchange(0, std::memory_order_relaxed);
+    unsigned long long intervalMaxNs = maxNs.exchange(0, std::memory_order_relaxed);
+
+    summary.count = count;
+    summary.packets = packets.exchange(0, std::memory_order_relaxed);
+    summary.meanUs = count > 0 ? 1.0e-3*intervalNs/count : 0.0;
+    summary.maxUs = 1.0e-3*intervalMaxNs;
+
+    const double fractions[4] = {0.5, 0.9, 0.99, 0.999};
+    double * percentiles[4] = {&summary.p50Us, &summary.p90Us, &summary.p99Us, &summary.p999Us};
+    unsigned int percentileIdx = 0;
+    unsigned long long cumulative = 0;
+    for (unsigned int bucketIdx = 0; bucketIdx < HISTOGRAM_BUCKETS && percentileIdx < 4; bucketIdx++) {
+        cumulative += intervalCounts[bucketIdx];
+        while (percentileIdx < 4 && count > 0 && (double)cumulative >= fractions[percentileIdx]*count) {
+            uint64_t upperNs = bucketUpperNs(bucketIdx);
+            *percentiles[percentileIdx] = 1.0e-3*(upperNs < intervalMaxNs ? upperNs : intervalMaxNs);
+            percentileIdx++;
+        }
+    }
+    for (; percentileIdx < 4; percentileIdx++) {
+        *percentiles[percentileIdx] = 0.0;
+    }
+}
+
+uint64_t Instrumentation::record(InstrumentationProbe_t probe, uint64_t startNs, unsigned long long packetsNum) {
+    uint64_t endNs = instrumentationNow();
+    histograms[probe].record(endNs > startNs ? endNs-startNs : 0, packetsNum);
+    return endNs;
+}
+
+void Instrumentation::drain(InstrumentationProbe_t probe, HistogramSummary_t &summary) {
+    histograms[probe].drain(summary);
+}
@@ -0,0 +1,135 @@
+/*! \file instrumentation.h
+ * \brief Declares class LatencyHistogram, which records durations without locks, and class Instrumentation,
+ * which holds one of them for each timed step of the acquisition.
+ */
+#ifndef INSTRUMENTATION_H
+#define INSTRUMENTATION_H
+
+#include <atomic>
+#include <stdint.h>
+
+#include "edl.h"
+
+/*! \def HISTOGRAM_SUB_BUCKET_BITS
+ * \brief Each power of two is split in 2^#HISTOGRAM_SUB_BUCKET_BITS buckets, so a recorded duration is known within 6.25%.
+ */
+#define HISTOGRAM_SUB_BUCKET_BITS 4
+
+/*! \def HISTOGRAM_MAX_BITS
+ * \brief Durations are recorded up to 2^#HISTOGRAM_MAX_BITS ns, about 18 minutes; longer ones fall in the last bucket.
+ */
+#define HISTOGRAM_MAX_BITS 40
+
+/*! \def HISTOGRAM_BUCKETS
+ * \brief Number of buckets of a #LatencyHistogram.
+ */
+#define HISTOGRAM_BUCKETS ((HISTOGRAM_MAX_BITS-HISTOGRAM_SUB_BUCKET_BITS+1) << HISTOGRAM_SUB_BUCKET_BITS)
+
+/*! \enum InstrumentationProbe_t
+ * \brief Enumerates the steps timed by an #Instrumentation.
+ */
+typedef enum {
+    ProbeStatus, /*!< PacketSource::getDeviceStatus, on the reader thread. */
+    ProbeRead, /*!< PacketSource::readData, on the reader thread. */
+    ProbePublish, /*!< Copy of a read in the blocks of the pool, on the reader thread. */
+    ProbeConsume, /*!< Hand-over of a block to all of the sinks, on the consumer thread. */
+    ProbeProcess, /*!< Processing of a block by a sink wrapped in an #InstrumentedSink, e.g. filtering and event detection. */
+    ProbeWrite, /*!< Storage of a block by a sink wrapped in an #InstrumentedSink, e.g. a recording. */
+    ProbesNum /*!< Number of probes. */
+} InstrumentationProbe_t;
+
+/*! \fn instrumentationProbeName
+ * \brief Returns the name of a probe in the exported metrics, e.g. "read".
+ */
+const char * instrumentationProbeName(InstrumentationProbe_t probe);
+
+/*! \fn instrumentationNow
+ * \brief Returns the time of a monotonic clock [ns], to be passed to Instrumentation::record.
+ */
+uint64_t instrumentationNow(EDL_VOID);
+
+/*! \struct HistogramSummary_t
+ * \brief Statistics of the durations recorded by a #LatencyHistogram in an interval.
+ * The percentiles are the upper bounds of their buckets, so they overestimate by less than 6.25%.
+ */
+typedef struct {
+    unsigned long long count; /*!< Recorded durations. */
+    unsigned long long packets; /*!< Data packets handled in the recorded durations. */
+    double meanUs; /*!< Mean duration [us]. */
+    double p50Us; /*!< Median duration [us]. */
+    double p90Us; /*!< 90th percentile of the durations [us]. */
+    double p99Us; /*!< 99th percentile of the durations [us]. */
+    double p999Us; /*!< 99.9th percentile of the durations [us]. */
+    double maxUs; /*!< Longest duration [us]. */
+} HistogramSummary_t;
+
+/*! \class LatencyHistogram
+ * \brief Histogram of durations with logarithmic buckets, each power of two split in linear sub-buckets as in HDR histograms,
+ * so that the relative resolution is the same from nanoseconds to minutes in a fixed amount of memory.
+ * Recording is lock-free and allocation-free: a few relaxed atomic additions, so any thread may record while another
+ * one drains the histogram.
+ */
+class LatencyHistogram {
+public:
+    /*! \brief LatencyHistogram constructor.
+     */
+    LatencyHistogram();
+
+    /*! \brief Records a duration.
+     *
+     * \param ns [in] Duration [ns].
+     * \param packetsNum [in] Data packets handled in the duration, 0 if not applicable.
+     */
+    void record(EDL_IN uint64_t ns, EDL_IN unsigned long long packetsNum = 0);
+
+    /*! \brief Computes the statistics of the durations recorded since the previous call and clears the histogram.
+     * Each bucket is cleared atomically, so no duration is lost, although one recorded during the call may be counted
+     * in the next interval while its data packets or its contribution to the mean are counted in this one.
+     *
+     * \param summary [out] Statistics of the interval.
+     */
+    void drain(EDL_OUT HistogramSummary_t &summary);
+
+    /*! \brief Returns the bucket of a duration.
+     */
+    static unsigned int bucketIdx(EDL_IN uint64_t ns);
+
+    /*! \brief Returns the longest duration that falls in a bucket [ns].
+     */
+    static uint64_t bucketUpperNs(EDL_IN unsigned int bucketIdx);
+
+private:
+    LatencyHistogram(const LatencyHistogram &);
+    LatencyHistogram &operator=(const LatencyHistogram &);
+
+    std::atomic <unsigned long long> counts[HISTOGRAM_BUCKETS];
+    std::atomic <unsigned long long> totalNs;
+    std::atomic <unsigned long long> maxNs;
+    std::atomic <unsigned long long> packets;
+};
+
+/*! \class Instrumentation
+ * \brief One #LatencyHistogram for each #InstrumentationProbe_t: the duration of each call of the hot path of an
+ * #Acquisition, and of its sinks if they are wrapped in an #InstrumentedSink, with the data packets it handled.
+ * Each probe costs two clock readings and a few atomic additions, tens of ns, once per read or block, not per data packet.
+ */
+class Instrumentation {
+public:
+    /*! \brief Records the duration of a step that started at \a startNs and ends now.
+     *
+     * \param probe [in] Timed step.
+     * \param startNs [in] Start of the step, see #instrumentationNow.
+     * \param packetsNum [in] Data packets handled by the step.
+     * \return The end of the step, to be used as the start of the next one.
+     */
+    uint64_t record(EDL_IN InstrumentationProbe_t probe, EDL_IN uint64_t startNs, EDL_IN unsigned long long packetsNum = 0);
+
+    /*! \brief Computes the statistics of a probe since the previous call and clears them, see LatencyHistogram::drain.
+     */
+    void drain(EDL_IN InstrumentationProbe_t probe, EDL_OUT HistogramSummary_t &summary);
+
+private:
+    LatencyHistogram histograms[ProbesNum];
+};
+
+#endif // INSTRUMENTATION_H
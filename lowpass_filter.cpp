@@ -0,0 +1,346 @@
+/*! \file lowpass_filter.cpp
+ * \brief Defines classes LowPassFilter and LowPassSink.
+ */
+#include "lowpass_filter.h"
+
+#include <algorithm>
+#include <cmath>
+#include <complex>
+
+#if defined(__AVX__) || defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(_M_X64)
+#include <immintrin.h>
+#define LOWPASS_SSE
+#endif
+
+#if defined(__AVX__)
+#define LOWPASS_AVX
+#endif
+
+typedef std::complex <double> Complex_t;
+
+static const double pi = 3.14159265358979323846;
+
+/*! \fn besselPoles
+ * \brief Computes the poles of the Bessel analog prototype of an order with the -3 dB frequency at 1 rad/s.
+ * The poles are the roots of the reverse Bessel polynomial, found with the Durand-Kerner iteration,
+ * scaled to move the -3 dB frequency from the delay normalization to 1 rad/s.
+ */
+static void besselPoles(unsigned int order, std::vector <Complex_t> &poles) {
+    /*! Coefficients of the reverse Bessel polynomial, a_k = (2n-k)! / (2^(n-k) k! (n-k)!), a_n = 1. */
+    std::vector <double> factorials(2*order+1, 1.0);
+    for (unsigned int i = 1; i <= 2*order; i++) {
+        factorials[i] = factorials[i-1]*(double)i;
+    }
+
+    std::vector <double> coefficients(order+1);
+    for (unsigned int k = 0; k <= order; k++) {
+        coefficients[k] = factorials[2*order-k]/(std::ldexp(1.0, (int)(order-k))*factorials[k]*factorials[order-k]);
+    }
+
+    poles.resize(order);
+    for (unsigned int poleIdx = 0; poleIdx < order; poleIdx++) {
+        poles[poleIdx] = std::pow(Complex_t(0.4, 0.9), (double)poleIdx);
+    }
+
+    for (unsigned int iterationIdx = 0; iterationIdx < 500; iterationIdx++) {
+        double maxStep = 0.0;
+        for (unsigned int poleIdx = 0; poleIdx < order; poleIdx++) {
+            Complex_t value = coefficients[order];
+            for (unsigned int k = order; k-- > 0;) {
+                value = value*poles[poleIdx]+coefficients[k];
+            }
+
+            Complex_t denominator = 1.0;
+            for (unsigned int otherIdx = 0; otherIdx < order; otherIdx++) {
+                if (otherIdx != poleIdx) {
+                    denominator *= poles[poleIdx]-poles[otherIdx];
+                }
+            }
+
+            Complex_t step = value/denominator;
+            poles[poleIdx] -= step;
+            maxStep = std::max(maxStep, std::abs(step)/std::max(1.0, std::abs(poles[poleIdx])));
+        }
+
+        if (maxStep < 1.0e-14) {
+            break;
+        }
+    }
+
+    /*! |H(jw)|^2 = a_0^2 / |theta(jw)|^2 decreases monotonically: bisect the frequency at which it is 1/2. */
+    double low = 0.0;
+    double high = 2.0*order+2.0;
+    for (unsigned int iterationIdx = 0; iterationIdx < 100; iterationIdx++) {
+        double w = 0.5*(low+high);
+        Complex_t value = 1.0;
+        for (unsigned int poleIdx = 0; poleIdx < order; poleIdx++) {
+            value *= Complex_t(0.0, w)-poles[poleIdx];
+        }
+
+        if (std::norm(value) < 2.0*coefficients[0]*coefficients[0]) {
+            low = w;
+
+        } else {
+            high = w;
+        }
+    }
+
+    for (unsigned int poleIdx = 0; poleIdx < order; poleIdx++) {
+        poles[poleIdx] /= 0.5*(low+high);
+    }
+}
+
+/*! \fn butterworthPoles
+ * \brief Computes the poles of the Butterworth analog prototype of an order with the -3 dB frequency at 1 rad/s.
+ */
+static void butterworthPoles(unsigned int order, std::vector <Complex_t> &poles) {
+    poles.resize(order);
+    for (unsigned int poleIdx = 0; poleIdx < order; poleIdx++) {
+        poles[poleIdx] = std::polar(1.0, pi*(2.0*poleIdx+order+1.0)/(2.0*order));
+    }
+}
+
+/*! \fn lowerQuality
+ * \brief Orders the sections by increasing quality factor: real poles first.
+ */
+static bool lowerQuality(const Complex_t &a, const Complex_t &b) {
+    return std::abs(a)/std::fabs(a.real()) < std::abs(b)/std::fabs(b.real());
+}
+
+LowPassConfig_t lowPassDefaultConfig(double samplingRate) {
+    LowPassConfig_t config;
+    config.type = LowPassBessel;
+    config.order = 4;
+    config.cutoff = 0.1*samplingRate;
+    config.samplingRate = samplingRate;
+    return config;
+}
+
+bool lowPassDesign(const LowPassConfig_t &config, std::vector <Biquad_t> &sections) {
+    sections.clear();
+    if (config.order < 1 || config.order > LOWPASS_MAX_ORDER || config.samplingRate <= 0.0 ||
+            config.cutoff <= 0.0 || config.cutoff >= 0.5*config.samplingRate) {
+        return false;
+    }
+
+    std::vector <Complex_t> poles;
+    if (config.type == LowPassBessel) {
+        besselPoles(config.order, poles);
+
+    } else {
+        butterworthPoles(config.order, poles);
+    }
+
+    /*! Keep one pole per conjugate pair, plus the real pole of the odd orders. */
+    std::vector <Complex_t> sectionPoles;
+    for (unsigned int poleIdx = 0; poleIdx < poles.size(); poleIdx++) {
+        if (poles[poleIdx].imag() > 1.0e-9) {
+            sectionPoles.push_back(poles[poleIdx]);
+
+        } else if (std::fabs(poles[poleIdx].imag()) <= 1.0e-9) {
+            sectionPoles.push_back(Complex_t(poles[poleIdx].real(), 0.0));
+        }
+    }
+    std::sort(sectionPoles.begin(), sectionPoles.end(), lowerQuality);
+
+    /*! Bilinear transform prewarped at the cut-off: z = (2 fs + s) / (2 fs - s). */
+    double twiceRate = 2.0*config.samplingRate;
+    double warpedCutoff = twiceRate*std::tan(pi*config.cutoff/config.samplingRate);
+    for (unsigned int sectionIdx = 0; sectionIdx < sectionPoles.size(); sectionIdx++) {
+        Complex_t s = sectionPoles[sectionIdx]*warpedCutoff;
+        Complex_t z = (twiceRate+s)/(twiceRate-s);
+        Biquad_t section;
+        if (sectionPoles[sectionIdx].imag() == 0.0) {
+            /*! (1 + z^-1) / (1 - p z^-1), scaled to unity gain at DC. */
+            section.a1 = -z.real();
+            section.a2 = 0.0;
+            section.b0 = 0.5*(1.0+section.a1);
+            section.b1 = section.b0;
+            section.b2 = 0.0;
+
+        } else {
+            /*! (1 + z^-1)^2 / ((1 - p z^-1) (1 - p* z^-1)), scaled to unity gain at DC. */
+            section.a1 = -2.0*z.real();
+            section.a2 = std::norm(z);
+            section.b0 = 0.25*(1.0+section.a1+section.a2);
+            section.b1 = 2.0*section.b0;
+            section.b2 = section.b0;
+        }
+        sections.push_back(section);
+    }
+    return true;
+}
+
+LowPassFilter::LowPassFilter(const LowPassConfig_t &config) :
+    valid(false),
+    primed(false),
+    sectionsNum(0) {
+    std::vector <Biquad_t> sections;
+    valid = lowPassDesign(config, sections);
+    sectionsNum = (unsigned int)sections.size();
+    for (unsigned int sectionIdx = 0; sectionIdx < sectionsNum; sectionIdx++) {
+        for (unsigned int channelIdx = 0; channelIdx < LOWPASS_CURRENT_CHANNELS; channelIdx++) {
+            coefficients[sectionIdx][0][channelIdx] = sections[sectionIdx].b0;
+            coefficients[sectionIdx][1][channelIdx] = sections[sectionIdx].b1;
+            coefficients[sectionIdx][2][channelIdx] = sections[sectionIdx].b2;
+            coefficients[sectionIdx][3][channelIdx] = sections[sectionIdx].a1;
+            coefficients[sectionIdx][4][channelIdx] = sections[sectionIdx].a2;
+        }
+    }
+    reset();
+}
+
+bool LowPassFilter::isValid() const {
+    return valid;
+}
+
+void LowPassFilter::reset() {
+    primed = false;
+}
+
+unsigned int LowPassFilter::getSectionsNum() const {
+    return sectionsNum;
+}
+
+void LowPassFilter::prime(const float * packet) {
+    /*! With a constant input x every section outputs x: s2 = (b2 - a2) x, s1 = (b1 - a1) x + s2. */
+    for (unsigned int sectionIdx = 0; sectionIdx < sectionsNum; sectionIdx++) {
+        double (* c)[LOWPASS_CURRENT_CHANNELS] = coefficients[sectionIdx];
+        for (unsigned int channelIdx = 0; channelIdx < LOWPASS_CURRENT_CHANNELS; channelIdx++) {
+            double x = packet[channelIdx+1];
+            states[sectionIdx][1][channelIdx] = (c[2][channelIdx]-c[4][channelIdx])*x;
+            states[sectionIdx][0][channelIdx] = (c[1][channelIdx]-c[3][channelIdx])*x+states[sectionIdx][1][channelIdx];
+        }
+    }
+    primed = true;
+}
+
+void LowPassFilter::process(const float * packets, unsigned int packetsNum, float * filtered) {
+    if (!valid || packetsNum == 0) {
+        if (filtered != packets) {
+            std::copy(packets, packets+(size_t)packetsNum*EDL_CHANNEL_NUM, filtered);
+        }
+        return;
+    }
+
+    if (!primed) {
+        prime(packets);
+    }
+
+#if EDL_CHANNEL_NUM == 5 && defined(LOWPASS_AVX)
+    /*! The 4 current channels follow the voltage channel: filter them as one vector of doubles.
+     * Keep the coefficients and the states in registers for the whole block. */
+    __m256d b0[LOWPASS_MAX_SECTIONS], b1[LOWPASS_MAX_SECTIONS], b2[LOWPASS_MAX_SECTIONS];
+    __m256d a1[LOWPASS_MAX_SECTIONS], a2[LOWPASS_MAX_SECTIONS];
+    __m256d s1[LOWPASS_MAX_SECTIONS], s2[LOWPASS_MAX_SECTIONS];
+    for (unsigned int sectionIdx = 0; sectionIdx < sectionsNum; sectionIdx++) {
+        b0[sectionIdx] = _mm256_loadu_pd(coefficients[sectionIdx][0]);
+        b1[sectionIdx] = _mm256_loadu_pd(coefficients[sectionIdx][1]);
+        b2[sectionIdx] = _mm256_loadu_pd(coefficients[sectionIdx][2]);
+        a1[sectionIdx] = _mm256_loadu_pd(coefficients[sectionIdx][3]);
+        a2[sectionIdx] = _mm256_loadu_pd(coefficients[sectionIdx][4]);
+        s1[sectionIdx] = _mm256_loadu_pd(states[sectionIdx][0]);
+        s2[sectionIdx] = _mm256_loadu_pd(states[sectionIdx][1]);
+    }
+
+    for (unsigned int packetIdx = 0; packetIdx < packetsNum; packetIdx++) {
+        const float * packet = packets+(size_t)packetIdx*EDL_CHANNEL_NUM;
+        float * out = filtered+(size_t)packetIdx*EDL_CHANNEL_NUM;
+        float voltage = packet[0];
+        __m256d x = _mm256_cvtps_pd(_mm_loadu_ps(packet+1));
+        for (unsigned int sectionIdx = 0; sectionIdx < sectionsNum; sectionIdx++) {
+            __m256d y = _mm256_add_pd(_mm256_mul_pd(b0[sectionIdx], x), s1[sectionIdx]);
+            s1[sectionIdx] = _mm256_add_pd(_mm256_sub_pd(_mm256_mul_pd(b1[sectionIdx], x), _mm256_mul_pd(a1[sectionIdx], y)), s2[sectionIdx]);
+            s2[sectionIdx] = _mm256_sub_pd(_mm256_mul_pd(b2[sectionIdx], x), _mm256_mul_pd(a2[sectionIdx], y));
+            x = y;
+        }
+        _mm_storeu_ps(out+1, _mm256_cvtpd_ps(x));
+        out[0] = voltage;
+    }
+
+    for (unsigned int sectionIdx = 0; sectionIdx < sectionsNum; sectionIdx++) {
+        _mm256_storeu_pd(states[sectionIdx][0], s1[sectionIdx]);
+        _mm256_storeu_pd(states[sectionIdx][1], s2[sectionIdx]);
+    }
+#elif EDL_CHANNEL_NUM == 5 && defined(LOWPASS_SSE)
+    /*! The 4 current channels follow the voltage channel: filter them as two vectors of doubles, channels 1-2 and 3-4.
+     * Keep the coefficients and the states in registers for the whole block. */
+    __m128d b0[LOWPASS_MAX_SECTIONS][2], b1[LOWPASS_MAX_SECTIONS][2], b2[LOWPASS_MAX_SECTIONS][2];
+    __m128d a1[LOWPASS_MAX_SECTIONS][2], a2[LOWPASS_MAX_SECTIONS][2];
+    __m128d s1[LOWPASS_MAX_SECTIONS][2], s2[LOWPASS_MAX_SECTIONS][2];
+    for (unsigned int sectionIdx = 0; sectionIdx < sectionsNum; sectionIdx++) {
+        for (unsigned int halfIdx = 0; halfIdx < 2; halfIdx++) {
+            b0[sectionIdx][halfIdx] = _mm_loadu_pd(coefficients[sectionIdx][0]+2*halfIdx);
+            b1[sectionIdx][halfIdx] = _mm_loadu_pd(coefficients[sectionIdx][1]+2*halfIdx);
+            b2[sectionIdx][halfIdx] = _mm_loadu_pd(coefficients[sectionIdx][2]+2*halfIdx);
+            a1[sectionIdx][halfIdx] = _mm_loadu_pd(coefficients[sectionIdx][3]+2*halfIdx);
+            a2[sectionIdx][halfIdx] = _mm_loadu_pd(coefficients[sectionIdx][4]+2*halfIdx);
+            s1[sectionIdx][halfIdx] = _mm_loadu_pd(states[sectionIdx][0]+2*halfIdx);
+            s2[sectionIdx][halfIdx] = _mm_loadu_pd(states[sectionIdx][1]+2*halfIdx);
+        }
+    }
+
+    for (unsigned int packetIdx = 0; packetIdx < packetsNum; packetIdx++) {
+        const float * packet = packets+(size_t)packetIdx*EDL_CHANNEL_NUM;
+        float * out = filtered+(size_t)packetIdx*EDL_CHANNEL_NUM;
+        float voltage = packet[0];
+        __m128 currents = _mm_loadu_ps(packet+1);
+        __m128d x[2] = {_mm_cvtps_pd(currents), _mm_cvtps_pd(_mm_movehl_ps(currents, currents))};
+        for (unsigned int sectionIdx = 0; sectionIdx < sectionsNum; sectionIdx++) {
+            for (unsigned int halfIdx = 0; halfIdx < 2; halfIdx++) {
+                __m128d y = _mm_add_pd(_mm_mul_pd(b0[sectionIdx][halfIdx], x[halfIdx]), s1[sectionIdx][halfIdx]);
+                s1[sectionIdx][halfIdx] = _mm_add_pd(_mm_sub_pd(_mm_mul_pd(b1[sectionIdx][halfIdx], x[halfIdx]),
+                                                                _mm_mul_pd(a1[sectionIdx][halfIdx], y)), s2[sectionIdx][halfIdx]);
+                s2[sectionIdx][halfIdx] = _mm_sub_pd(_mm_mul_pd(b2[sectionIdx][halfIdx], x[halfIdx]), _mm_mul_pd(a2[sectionIdx][halfIdx], y));
+                x[halfIdx] = y;
+            }
+        }
+        _mm_storeu_ps(out+1, _mm_movelh_ps(_mm_cvtpd_ps(x[0]), _mm_cvtpd_ps(x[1])));
+        out[0] = voltage;
+    }
+
+    for (unsigned int sectionIdx = 0; sectionIdx < sectionsNum; sectionIdx++) {
+        for (unsigned int halfIdx = 0; halfIdx < 2; halfIdx++) {
+            _mm_storeu_pd(states[sectionIdx][0]+2*halfIdx, s1[sectionIdx][halfIdx]);
+            _mm_storeu_pd(states[sectionIdx][1]+2*halfIdx, s2[sectionIdx][halfIdx]);
+        }
+    }
+#else
+    for (unsigned int packetIdx = 0; packetIdx < packetsNum; packetIdx++) {
+        const float * packet = packets+(size_t)packetIdx*EDL_CHANNEL_NUM;
+        float * out = filtered+(size_t)packetIdx*EDL_CHANNEL_NUM;
+        out[0] = packet[0];
+        for (unsigned int channelIdx = 0; channelIdx < LOWPASS_CURRENT_CHANNELS; channelIdx++) {
+            double x = packet[channelIdx+1];
+            for (unsigned int sectionIdx = 0; sectionIdx < sectionsNum; sectionIdx++) {
+                double (* c)[LOWPASS_CURRENT_CHANNELS] = coefficients[sectionIdx];
+                double (* state)[LOWPASS_CURRENT_CHANNELS] = states[sectionIdx];
+                double y = c[0][channelIdx]*x+state[0][channelIdx];
+                state[0][channelIdx] = c[1][channelIdx]*x-c[3][channelIdx]*y+state[1][channelIdx];
+                state[1][channelIdx] = c[2][channelIdx]*x-c[4][channelIdx]*y;
+                x = y;
+            }
+            out[channelIdx+1] = (float)x;
+        }
+    }
+#endif
+}
+
+LowPassSink::LowPassSink(const LowPassConfig_t &config, AcquisitionSink * sink) :
+    filter(config),
+    sink(sink) {
+}
+
+void LowPassSink::consumePackets(const float * packets, unsigned int packetsNum) {
+    if (filtered.size() < (size_t)packetsNum*EDL_CHANNEL_NUM) {
+        filtered.resize((size_t)packetsNum*EDL_CHANNEL_NUM);
+    }
+    filter.process(packets, packetsNum, filtered.data());
+    sink->consumePackets(filtered.data(), packetsNum);
+}
+
+void LowPassSink::consumeGap(uint64_t firstPacket, unsigned long long packetsNum) {
+    /*! The state does not carry over missing data packets: restart from the next one. */
+    filter.reset();
+    sink->consumeGap(firstPacket, packetsNum);
+}
@@ -0,0 +1,144 @@
+/*! \file lowpass_filter.h
+ * \brief Declares class LowPassFilter, which filters the current channels while data are collected,
+ * and class LowPassSink, which applies it in front of another #AcquisitionSink.
+ */
+#ifndef LOWPASS_FILTER_H
+#define LOWPASS_FILTER_H
+
+#include <vector>
+
+#include "edl.h"
+#include "acquisition.h"
+
+/*! \def LOWPASS_MAX_ORDER
+ * \brief Highest order of a #LowPassFilter.
+ */
+#define LOWPASS_MAX_ORDER 8
+
+/*! \def LOWPASS_MAX_SECTIONS
+ * \brief Highest number of second order sections of a #LowPassFilter.
+ */
+#define LOWPASS_MAX_SECTIONS ((LOWPASS_MAX_ORDER+1)/2)
+
+/*! \def LOWPASS_CURRENT_CHANNELS
+ * \brief Number of channels filtered by a #LowPassFilter: all of the channels but the voltage one.
+ */
+#define LOWPASS_CURRENT_CHANNELS (EDL_CHANNEL_NUM-1)
+
+/*! \enum LowPassType_t
+ * \brief Enumerates the filter responses.
+ */
+typedef enum {
+    LowPassButterworth, /*!< Maximally flat pass band: the sharpest cut-off, with overshoot on steps. */
+    LowPassBessel /*!< Maximally flat group delay: steps are preserved without overshoot, as for translocation events. */
+} LowPassType_t;
+
+/*! \struct LowPassConfig_t
+ * \brief Configuration of a #LowPassFilter.
+ */
+typedef struct {
+    LowPassType_t type; /*!< Response. */
+    unsigned int order; /*!< Order, from 1 to #LOWPASS_MAX_ORDER. */
+    double cutoff; /*!< Frequency at which the gain is -3 dB [Hz]; lower than half the sampling rate. */
+    double samplingRate; /*!< Sampling rate of the filtered data packets [Hz]. */
+} LowPassConfig_t;
+
+/*! \struct Biquad_t
+ * \brief Coefficients of a second order section: H(z) = (b0 + b1 z^-1 + b2 z^-2) / (1 + a1 z^-1 + a2 z^-2).
+ */
+typedef struct {
+    double b0;
+    double b1;
+    double b2;
+    double a1;
+    double a2;
+} Biquad_t;
+
+/*! \fn lowPassDefaultConfig
+ * \brief Returns a 4th order Bessel filter with the cut-off at a tenth of the sampling rate.
+ */
+LowPassConfig_t lowPassDefaultConfig(double samplingRate);
+
+/*! \fn lowPassDesign
+ * \brief Computes the second order sections of a filter: the poles of the analog prototype are mapped with the bilinear
+ * transform, prewarped at the cut-off, and all of the zeros are at the Nyquist frequency. Odd orders end with a first order
+ * section (b2 = a2 = 0). Each section has unity gain at DC; the sections are sorted by increasing quality factor.
+ *
+ * \param config [in] Configuration of the filter.
+ * \param sections [out] Second order sections, in the order in which they must be applied.
+ * \return False if the configuration is invalid.
+ */
+bool lowPassDesign(EDL_IN const LowPassConfig_t &config, EDL_OUT std::vector <Biquad_t> &sections);
+
+/*! \class LowPassFilter
+ * \brief Streaming low pass filter of the #LOWPASS_CURRENT_CHANNELS current channels, as a cascade of second order sections.
+ * The current channels of a data packet are contiguous, so they are filtered together straight from the interleaved
+ * data packets, as one AVX vector or two SSE2 vectors of doubles; the voltage channel is copied unchanged.
+ * Double precision keeps the sections stable down to cut-offs of a ten-thousandth of the sampling rate.
+ * The state is primed with the first data packet, so the filter starts without a transient.
+ */
+class LowPassFilter {
+public:
+    /*! \brief LowPassFilter constructor.
+     * An invalid configuration gives a filter that copies the data packets, see #isValid.
+     */
+    explicit LowPassFilter(const LowPassConfig_t &config);
+
+    /*! \brief Returns false if the configuration given to the constructor is invalid.
+     */
+    bool isValid(EDL_VOID) const;
+
+    /*! \brief Forgets the past data packets: the next one primes the state again.
+     */
+    void reset(EDL_VOID);
+
+    /*! \brief Filters consecutive data packets.
+     *
+     * \param packets [in] \a packetsNum data packets of #EDL_CHANNEL_NUM samples each.
+     * \param packetsNum [in] Number of data packets.
+     * \param filtered [out] \a packetsNum filtered data packets; may be equal to \a packets.
+     */
+    void process(EDL_IN const float * packets, EDL_IN unsigned int packetsNum, EDL_OUT float * filtered);
+
+    /*! \brief Returns the number of second order sections.
+     */
+    unsigned int getSectionsNum(EDL_VOID) const;
+
+private:
+    void prime(const float * packet);
+
+    bool valid;
+    bool primed;
+    unsigned int sectionsNum;
+    /*! Coefficients b0, b1, b2, a1, a2 of each section, repeated for each current channel. */
+    double coefficients[LOWPASS_MAX_SECTIONS][5][LOWPASS_CURRENT_CHANNELS];
+    /*! State of the transposed direct form II of each section and current channel. */
+    double states[LOWPASS_MAX_SECTIONS][2][LOWPASS_CURRENT_CHANNELS];
+};
+
+/*! \class LowPassSink
+ * \brief #AcquisitionSink that filters the data packets with a #LowPassFilter and hands them to another sink.
+ * The filtered data packets are written in a buffer that only grows, so once it fits the largest block nothing is allocated.
+ */
+class LowPassSink : public AcquisitionSink {
+public:
+    /*! \brief LowPassSink constructor.
+     *
+     * \param config [in] Configuration of the filter.
+     * \param sink [in] Sink of the filtered data packets; it must outlive this object.
+     */
+    LowPassSink(const LowPassConfig_t &config, AcquisitionSink * sink);
+
+    void consumePackets(const float * packets, unsigned int packetsNum);
+
+    /*! \brief Primes the filter again with the data packet following the missing ones and forwards the notice.
+     */
+    void consumeGap(uint64_t firstPacket, unsigned long long packetsNum);
+
+private:
+    LowPassFilter filter;
+    AcquisitionSink * sink;
+    std::vector <float> filtered;
+};
+
+#endif // LOWPASS_FILTER_H
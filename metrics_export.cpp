@@ -0,0 +1,195 @@
+/*! \file metrics_export.cpp
+ * \brief Defines classes InstrumentedSink and MetricsExporter.
+ */
+#include "metrics_export.h"
+
+#include <chrono>
+#include <cstring>
+
+#ifndef _WIN32
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+InstrumentedSink::InstrumentedSink(Instrumentation &instrumentation, InstrumentationProbe_t probe, AcquisitionSink * sink) :
+    instrumentation(instrumentation),
+    probe(probe),
+    sink(sink) {
+}
+
+void InstrumentedSink::consumePackets(const float * packets, unsigned int packetsNum) {
+    uint64_t startNs = instrumentationNow();
+    sink->consumePackets(packets, packetsNum);
+    instrumentation.record(probe, startNs, packetsNum);
+}
+
+void InstrumentedSink::consumeBlock(PacketBlock * block) {
+    uint64_t startNs = instrumentationNow();
+    sink->consumeBlock(block);
+    instrumentation.record(probe, startNs, block->getPacketsNum());
+}
+
+void InstrumentedSink::consumeGap(uint64_t firstPacket, unsigned long long packetsNum) {
+    sink->consumeGap(firstPacket, packetsNum);
+}
+
+MetricsExporter::MetricsExporter(unsigned int intervalMs) :
+    intervalMs(intervalMs > 0 ? intervalMs : 1),
+    file(NULL),
+    socketFd(-1),
+    failedExportsNum(0),
+    stopping(false) {
+}
+
+MetricsExporter::~MetricsExporter() {
+    stop();
+}
+
+void MetricsExporter::addAcquisition(const std::string &name, Acquisition &acquisition) {
+    names.push_back(name);
+    acquisitions.push_back(&acquisition);
+    previousStats.push_back(acquisition.getStats());
+}
+
+bool MetricsExporter::open(const std::string &path) {
+    if (file != NULL || socketFd >= 0) {
+        return false;
+    }
+
+    const size_t prefixSize = strlen(METRICS_SOCKET_PREFIX);
+    if (path.compare(0, prefixSize, METRICS_SOCKET_PREFIX) != 0) {
+        file = fopen(path.c_str(), "w");
+        return file != NULL;
+    }
+
+#ifdef _WIN32
+    return false;
+#else
+    /*! The socket is not connected: each line is sent to the path, so the monitor may start, stop and restart at any time. */
+    socketPath = path.substr(prefixSize);
+    if (socketPath.empty() || socketPath.size() >= sizeof(((struct sockaddr_un *)NULL)->sun_path)) {
+        return false;
+    }
+    socketFd = socket(AF_UNIX, SOCK_DGRAM, 0);
+    return socketFd >= 0;
+#endif
+}
+
+bool MetricsExporter::start() {
+    if ((file == NULL && socketFd < 0) || exporterThread.joinable()) {
+        return false;
+    }
+
+    stopping = false;
+    exporterThread = std::thread(&MetricsExporter::exporterLoop, this);
+    return true;
+}
+
+void MetricsExporter::stop() {
+    {
+        std::lock_guard <std::mutex> lock(mutex);
+        stopping = true;
+    }
+    condition.notify_all();
+    if (exporterThread.joinable()) {
+        exporterThread.join();
+    }
+
+    if (file != NULL) {
+        fclose(file);
+        file = NULL;
+    }
+
+#ifndef _WIN32
+    if (socketFd >= 0) {
+        close(socketFd);
+        socketFd = -1;
+    }
+#endif
+}
+
+unsigned long long MetricsExporter::getFailedExportsNum() const {
+    return failedExportsNum;
+}
+
+void MetricsExporter::exporterLoop() {
+    std::chrono::steady_clock::time_point exportTime = std::chrono::steady_clock::now();
+    std::chrono::steady_clock::time_point nextTime = exportTime+std::chrono::milliseconds(intervalMs);
+    bool running = true;
+    while (running) {
+        /*! Wait for the next interval, or for #stop, which exports the last partial one. */
+        {
+            std::unique_lock <std::mutex> lock(mutex);
+            condition.wait_until(lock, nextTime, [this] { return stopping; });
+            running = !stopping;
+        }
+
+        std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        exportAll(std::chrono::duration <double> (now-exportTime).count());
+        exportTime = now;
+        while (nextTime <= now) {
+            nextTime += std::chrono::milliseconds(intervalMs);
+        }
+    }
+}
+
+void MetricsExporter::exportAll(double intervalSeconds) {
+    int64_t timeNs = (int64_t)std::chrono::duration_cast <std::chrono::nanoseconds> (std::chrono::system_clock::now().time_since_epoch()).count();
+    char field[256];
+    for (size_t acquisitionIdx = 0; acquisitionIdx < acquisitions.size(); acquisitionIdx++) {
+        /*! Counters are reported for the interval, as the statistics of the probes, except those that are levels or maxima. */
+        AcquisitionStats_t stats = acquisitions[acquisitionIdx]->getStats();
+        const AcquisitionStats_t &prev = previousStats[acquisitionIdx];
+        std::string line = "{\"time_ns\":"+std::to_string((long long)timeNs);
+        snprintf(field, sizeof(field), ",\"interval_s\":%.3f", intervalSeconds);
+        line += field;
+        line += ",\"acquisition\":\""+names[acquisitionIdx]+"\"";
+        snprintf(field, sizeof(field), ",\"read_packets\":%llu,\"consumed_packets\":%llu,\"dropped_packets\":%llu,\"lost_packets\":%llu"
+                 ",\"buffer_overflows\":%u,\"lost_data_events\":%u,\"status_checks\":%llu,\"reads\":%llu",
+                 stats.readPackets-prev.readPackets, stats.consumedPackets-prev.consumedPackets,
+                 stats.droppedPackets-prev.droppedPackets, stats.lostPackets-prev.lostPackets,
+                 stats.bufferOverflows-prev.bufferOverflows, stats.lostDataEvents-prev.lostDataEvents,
+                 stats.statusChecks-prev.statusChecks, stats.reads-prev.reads);
+        line += field;
+        snprintf(field, sizeof(field), ",\"stream_packets\":%llu,\"read_threshold\":%u,\"packet_rate\":%.1f,\"max_blocks_in_use\":%u",
+                 stats.streamPackets, stats.readThreshold, stats.packetRate, stats.maxBlocksInUse);
+        line += field;
+        previousStats[acquisitionIdx] = stats;
+
+        line += ",\"probes\":{";
+        Instrumentation &instrumentation = acquisitions[acquisitionIdx]->getInstrumentation();
+        for (int probe = 0; probe < ProbesNum; probe++) {
+            HistogramSummary_t summary;
+            instrumentation.drain((InstrumentationProbe_t)probe, summary);
+            snprintf(field, sizeof(field), "%s\"%s\":{\"count\":%llu,\"packets\":%llu,\"mean_us\":%.3f,\"p50_us\":%.3f,"
+                     "\"p90_us\":%.3f,\"p99_us\":%.3f,\"p999_us\":%.3f,\"max_us\":%.3f}", probe > 0 ? "," : "",
+                     instrumentationProbeName((InstrumentationProbe_t)probe), summary.count, summary.packets, summary.meanUs,
+                     summary.p50Us, summary.p90Us, summary.p99Us, summary.p999Us, summary.maxUs);
+            line += field;
+        }
+        line += "}}\n";
+
+        if (!send(line)) {
+            failedExportsNum++;
+        }
+    }
+}
+
+bool MetricsExporter::send(const std::string &line) {
+    if (file != NULL) {
+        bool success = fwrite(line.data(), 1, line.size(), file) == line.size();
+        return fflush(file) == 0 && success;
+    }
+
+#ifdef _WIN32
+    return false;
+#else
+    /*! Never block: a line that the monitor is not ready to receive is lost, and so is one sent before it binds the socket. */
+    struct sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    memcpy(address.sun_path, socketPath.c_str(), socketPath.size());
+    return sendto(socketFd, line.data(), line.size(), MSG_DONTWAIT, (struct sockaddr *)&address, sizeof(address)) == (ssize_t)line.size();
+#endif
+}
@@ -0,0 +1,124 @@
+/*! \file metrics_export.h
+ * \brief Declares class InstrumentedSink, which times another #AcquisitionSink, and class MetricsExporter,
+ * which periodically writes the #Instrumentation and the counters of acquisitions to a file or a Unix socket.
+ */
+#ifndef METRICS_EXPORT_H
+#define METRICS_EXPORT_H
+
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <cstdio>
+
+#include "acquisition.h"
+#include "instrumentation.h"
+
+/*! \def METRICS_EXPORT_INTERVAL_MS
+ * \brief Default interval between two exports of a #MetricsExporter [ms].
+ */
+#define METRICS_EXPORT_INTERVAL_MS 1000
+
+/*! \def METRICS_SOCKET_PREFIX
+ * \brief Prefix of the paths given to MetricsExporter::open that name a Unix datagram socket instead of a file.
+ */
+#define METRICS_SOCKET_PREFIX "unix:"
+
+/*! \class InstrumentedSink
+ * \brief #AcquisitionSink that hands everything to another sink and records in an #Instrumentation how long it takes
+ * for each block, so that the cost of processing and storage appears next to the one of the reads.
+ */
+class InstrumentedSink : public AcquisitionSink {
+public:
+    /*! \brief InstrumentedSink constructor.
+     *
+     * \param instrumentation [in] Instrumentation to record in; it must outlive this object.
+     * \param probe [in] Probe the durations are recorded in, e.g. #ProbeWrite.
+     * \param sink [in] Timed sink; it must outlive this object.
+     */
+    InstrumentedSink(Instrumentation &instrumentation, InstrumentationProbe_t probe, AcquisitionSink * sink);
+
+    void consumePackets(const float * packets, unsigned int packetsNum);
+
+    void consumeBlock(PacketBlock * block);
+
+    void consumeGap(uint64_t firstPacket, unsigned long long packetsNum);
+
+private:
+    Instrumentation &instrumentation;
+    InstrumentationProbe_t probe;
+    AcquisitionSink * sink;
+};
+
+/*! \class MetricsExporter
+ * \brief Writes, at regular intervals from its own thread, one line of JSON per acquisition with the counters of
+ * #AcquisitionStats_t and the statistics of each probe of its #Instrumentation in the interval, see HistogramSummary_t.
+ * The lines are appended to a file, e.g. to be followed with tail -f, or sent as datagrams to a Unix socket, where they
+ * are discarded if nobody is listening, so a missing or slow monitor never delays the acquisition.
+ */
+class MetricsExporter {
+public:
+    /*! \brief MetricsExporter constructor.
+     *
+     * \param intervalMs [in] Interval between two exports [ms].
+     */
+    explicit MetricsExporter(unsigned int intervalMs = METRICS_EXPORT_INTERVAL_MS);
+
+    /*! \brief MetricsExporter destructor. Stops the exports and closes the output.
+     */
+    ~MetricsExporter();
+
+    /*! \brief Adds an acquisition to export. Must be called before #start; the acquisition must outlive this object.
+     *
+     * \param name [in] Name of the acquisition in the exported lines, e.g. the device ID.
+     * \param acquisition [in] Acquisition to export.
+     */
+    void addAcquisition(const std::string &name, Acquisition &acquisition);
+
+    /*! \brief Opens the output: a file, created or truncated, or, if \a path starts with #METRICS_SOCKET_PREFIX,
+     * the Unix datagram socket bound at the rest of the path by the monitor.
+     *
+     * \return False if the output cannot be opened, or if Unix sockets are not supported.
+     */
+    bool open(const std::string &path);
+
+    /*! \brief Starts the export thread. The statistics recorded before this call are part of the first interval.
+     *
+     * \return False if the output is not open or the thread is already running.
+     */
+    bool start();
+
+    /*! \brief Exports the last interval, stops the export thread and closes the output.
+     */
+    void stop();
+
+    /*! \brief Returns the number of lines that could not be written or sent.
+     */
+    unsigned long long getFailedExportsNum() const;
+
+private:
+    MetricsExporter(const MetricsExporter &);
+    MetricsExporter &operator=(const MetricsExporter &);
+
+    void exporterLoop();
+    void exportAll(double intervalSeconds);
+    bool send(const std::string &line);
+
+    unsigned int intervalMs;
+    std::vector <std::string> names;
+    std::vector <Acquisition *> acquisitions;
+    std::vector <AcquisitionStats_t> previousStats; /*!< Counters at the previous export, to report those of the interval. */
+    FILE * file;
+    int socketFd; /*!< Unix datagram socket, -1 if not used. */
+    std::string socketPath;
+    std::atomic <unsigned long long> failedExportsNum;
+
+    std::thread exporterThread;
+    std::mutex mutex;
+    std::condition_variable condition;
+    bool stopping;
+};
+
+#endif // METRICS_EXPORT_H
@@ -0,0 +1,55 @@
+/*! \file notifier.cpp
+ * \brief Defines class Notifier.
+ */
+#include "notifier.h"
+
+Notifier::Notifier(unsigned long long thresholdPackets) :
+    sequence(0),
+    waitersNum(0),
+    thresholdPackets(thresholdPackets > 0 ? thresholdPackets : 1),
+    pendingPackets(0) {
+}
+
+void Notifier::setThreshold(unsigned long long thresholdPackets) {
+    this->thresholdPackets = thresholdPackets > 0 ? thresholdPackets : 1;
+}
+
+void Notifier::add(unsigned long long packetsNum) {
+    pendingPackets += packetsNum;
+    if (pendingPackets >= thresholdPackets.load(std::memory_order_relaxed)) {
+        pendingPackets = 0;
+        notify();
+    }
+}
+
+void Notifier::notify() {
+    /*! The sequence is advanced before the waiters are counted, and a waiter is counted before it checks the sequence under
+     * the mutex: either the waiter sees the new sequence, or the producer sees the waiter and takes the mutex, which the
+     * waiter only releases once it is blocked on the condition variable, so no signal is lost. */
+    sequence.fetch_add(1);
+    if (waitersNum.load() > 0) {
+        {
+            std::lock_guard <std::mutex> lock(mutex);
+        }
+        condition.notify_all();
+    }
+}
+
+uint64_t Notifier::prepare() const {
+    return sequence.load();
+}
+
+bool Notifier::wait(uint64_t ticket, std::chrono::microseconds timeout) {
+    waitersNum.fetch_add(1);
+    bool signalled;
+    {
+        std::unique_lock <std::mutex> lock(mutex);
+        signalled = condition.wait_for(lock, timeout, [this, ticket] { return sequence.load() != ticket; });
+    }
+    waitersNum.fetch_sub(1);
+    return signalled;
+}
+
+uint64_t Notifier::getSignalsNum() const {
+    return sequence.load();
+}
@@ -0,0 +1,75 @@
+/*! \file notifier.h
+ * \brief Declares class Notifier, which wakes up a thread waiting for data as soon as another thread produces them.
+ */
+#ifndef NOTIFIER_H
+#define NOTIFIER_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <stdint.h>
+
+#include "edl.h"
+
+/*! \class Notifier
+ * \brief Wakeup primitive between a producer and consumers that otherwise share data without locks, e.g. a #SpscRingBuffer.
+ * The producer signals after publishing; a consumer takes a ticket with #prepare before checking for data and, if there
+ * are none, blocks in #wait until a signal newer than the ticket, so that a signal sent between the check and the wait
+ * is not missed. Data are signalled once #setThreshold data packets have accumulated since the previous signal.
+ * The mutex and the condition variable are only touched when a consumer is actually waiting,
+ * so signalling costs the producer two atomic operations while the consumers are busy.
+ */
+class Notifier {
+public:
+    /*! \brief Notifier constructor.
+     *
+     * \param thresholdPackets [in] Data packets that must accumulate before a signal, see #setThreshold.
+     */
+    explicit Notifier(unsigned long long thresholdPackets = 1);
+
+    /*! \brief Sets how many data packets must accumulate before #add signals them: 1 wakes up the consumers at each
+     * publication, larger values let them handle larger batches, at the cost of latency.
+     */
+    void setThreshold(EDL_IN unsigned long long thresholdPackets);
+
+    /*! \brief Counts published data packets and signals them once the threshold is reached. Producer side.
+     *
+     * \param packetsNum [in] Data packets just published.
+     */
+    void add(EDL_IN unsigned long long packetsNum);
+
+    /*! \brief Wakes up the consumers regardless of the threshold, e.g. to flush the last data packets or to stop.
+     * Any thread may call it; the data packets counted by #add keep counting towards the next signal.
+     */
+    void notify(EDL_VOID);
+
+    /*! \brief Returns the ticket to pass to #wait. Consumer side: call it before checking for data.
+     */
+    uint64_t prepare(EDL_VOID) const;
+
+    /*! \brief Blocks until a signal is sent after the ticket was taken, or until the timeout expires. Consumer side.
+     *
+     * \param ticket [in] Value returned by #prepare before checking for data.
+     * \param timeout [in] Longest wait.
+     * \return True if signalled, false on timeout.
+     */
+    bool wait(EDL_IN uint64_t ticket, EDL_IN std::chrono::microseconds timeout);
+
+    /*! \brief Returns the number of signals sent.
+     */
+    uint64_t getSignalsNum(EDL_VOID) const;
+
+private:
+    Notifier(const Notifier &);
+    Notifier &operator=(const Notifier &);
+
+    std::mutex mutex;
+    std::condition_variable condition;
+    std::atomic <uint64_t> sequence; /*!< Number of signals sent. */
+    std::atomic <unsigned int> waitersNum;
+    std::atomic <unsigned long long> thresholdPackets;
+    unsigned long long pendingPackets; /*!< Data packets added since the previous signal; producer side only. */
+};
+
+#endif // NOTIFIER_H
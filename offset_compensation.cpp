@@ -0,0 +1,153 @@
+/*! \file offset_compensation.cpp
+ * \brief Defines class OffsetCompensation.
+ */
+#include "offset_compensation.h"
+
+#include <chrono>
+#include <cmath>
+
+#include "edl_settings.h"
+
+OffsetCompensationConfig_t offsetCompensationDefaultConfig(unsigned int samplingRateRadioId, unsigned int rangeRadioId) {
+    OffsetCompensationConfig_t config;
+    config.packetRate = edlSamplingRateHz(samplingRateRadioId);
+    config.tolerance = edlRangeFullScale(rangeRadioId)*OFFSET_COMPENSATION_TOLERANCE_RATIO;
+    config.windowSeconds = 0.05;
+    config.settledWindowsNum = 4;
+    config.timeoutSeconds = 5.0;
+    config.pollSeconds = 5.0e-3;
+    return config;
+}
+
+OffsetCompensation::OffsetCompensation(PacketSource &source, CommandTransaction &transaction, const OffsetCompensationConfig_t &config) :
+    source(source),
+    transaction(transaction),
+    config(config),
+    done(true) {
+    double packets = std::floor(config.packetRate*config.windowSeconds);
+    windowPackets = packets >= 1.0 ? (unsigned int)packets : 1;
+
+    result.error = EdlSuccess;
+    result.converged = false;
+    result.seconds = 0.0;
+    result.readPackets = 0;
+    for (unsigned int channelIdx = 0; channelIdx < EDL_CHANNEL_NUM; channelIdx++) {
+        result.offsets[channelIdx] = 0.0;
+        result.settled[channelIdx] = false;
+        sums[channelIdx] = 0.0;
+        settledWindows[channelIdx] = 0;
+    }
+    windowPacketsNum = 0;
+}
+
+OffsetCompensation::~OffsetCompensation() {
+    wait();
+}
+
+EdlErrorCode_t OffsetCompensation::start() {
+    if (compensationThread.joinable()) {
+        return EdlSuccess;
+    }
+
+    /*! The commands already in the transaction are sent with the press. */
+    transaction.setButton(EdlCommandCompAll, EDL_BUTTON_PRESSED);
+    EdlErrorCode_t res = transaction.commit();
+    if (res != EdlSuccess) {
+        result.error = res;
+        return res;
+    }
+
+    /*! Only the data packets acquired after the press tell how the compensation proceeds. */
+    source.purgeData();
+
+    done = false;
+    compensationThread = std::thread(&OffsetCompensation::compensationLoop, this);
+    return EdlSuccess;
+}
+
+bool OffsetCompensation::isDone() const {
+    return done;
+}
+
+const OffsetCompensationResult_t &OffsetCompensation::wait() {
+    if (compensationThread.joinable()) {
+        compensationThread.join();
+    }
+    return result;
+}
+
+void OffsetCompensation::compensationLoop() {
+    std::chrono::steady_clock::time_point pressTime = std::chrono::steady_clock::now();
+    std::chrono::microseconds pollWait((long long)(config.pollSeconds*1.0e6));
+    EdlDeviceStatus_t status;
+    EdlErrorCode_t res = EdlSuccess;
+    while (true) {
+        /*! Read whatever the device has acquired: the wait between the reads is short enough for the buffer never to overflow. */
+        res = source.getDeviceStatus(status);
+        if (res != EdlSuccess) {
+            break;
+        }
+
+        if (status.availableDataPackets > 0) {
+            unsigned int readPacketsNum = 0;
+            res = source.readData(status.availableDataPackets, readPacketsNum, data);
+            if (res != EdlSuccess) {
+                break;
+            }
+            result.readPackets += readPacketsNum;
+
+            if (consumePackets(data.data(), readPacketsNum)) {
+                result.converged = true;
+                break;
+            }
+        }
+
+        if (std::chrono::duration <double> (std::chrono::steady_clock::now()-pressTime).count() >= config.timeoutSeconds) {
+            break;
+        }
+        std::this_thread::sleep_for(pollWait);
+    }
+    result.error = res;
+
+    /*! Release the button whatever happened, so that the device is not left compensating. */
+    transaction.setButton(EdlCommandCompAll, EDL_BUTTON_RELEASED);
+    res = transaction.commit();
+    if (result.error == EdlSuccess) {
+        result.error = res;
+    }
+    result.seconds = std::chrono::duration <double> (std::chrono::steady_clock::now()-pressTime).count();
+    done = true;
+}
+
+bool OffsetCompensation::consumePackets(const float * packets, unsigned int packetsNum) {
+    for (unsigned int packetIdx = 0; packetIdx < packetsNum; packetIdx++) {
+        const float * packet = packets+packetIdx*EDL_CHANNEL_NUM;
+        for (unsigned int channelIdx = 0; channelIdx < EDL_CHANNEL_NUM; channelIdx++) {
+            sums[channelIdx] += packet[channelIdx];
+        }
+
+        if (++windowPacketsNum < windowPackets) {
+            continue;
+        }
+
+        /*! A window is complete: update the offsets and how long each current channel has been within the tolerance. */
+        bool allSettled = true;
+        for (unsigned int channelIdx = 0; channelIdx < EDL_CHANNEL_NUM; channelIdx++) {
+            result.offsets[channelIdx] = sums[channelIdx]/windowPacketsNum;
+            sums[channelIdx] = 0.0;
+            if (channelIdx == 0) {
+                continue;
+            }
+
+            settledWindows[channelIdx] = std::fabs(result.offsets[channelIdx]) <= config.tolerance ? settledWindows[channelIdx]+1 : 0;
+            result.settled[channelIdx] = settledWindows[channelIdx] >= config.settledWindowsNum;
+            allSettled = allSettled && result.settled[channelIdx];
+        }
+        windowPacketsNum = 0;
+
+        if (allSettled) {
+            return true;
+        }
+    }
+    return false;
+}
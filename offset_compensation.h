@@ -0,0 +1,114 @@
+/*! \file offset_compensation.h
+ * \brief Declares class OffsetCompensation, which runs the digital offset compensation of a device until its current channels settle.
+ */
+#ifndef OFFSET_COMPENSATION_H
+#define OFFSET_COMPENSATION_H
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "edl.h"
+#include "packet_source.h"
+#include "command_transaction.h"
+
+/*! \def OFFSET_COMPENSATION_TOLERANCE_RATIO
+ * \brief Default largest residual offset of a settled current channel, relative to the full scale of the current range.
+ */
+#define OFFSET_COMPENSATION_TOLERANCE_RATIO 0.0025
+
+/*! \struct OffsetCompensationConfig_t
+ * \brief Parameters of an #OffsetCompensation.
+ */
+typedef struct {
+    double packetRate; /*!< Data packets produced per second by the device [Hz], e.g. from #edlSamplingRateHz. */
+    double tolerance; /*!< Largest residual offset of a settled current channel, in the unit of the current channels. */
+    double windowSeconds; /*!< Duration of the windows over which the offsets are averaged [s]. */
+    unsigned int settledWindowsNum; /*!< Consecutive windows within the tolerance after which a channel is settled. */
+    double timeoutSeconds; /*!< Longest compensation: the button is released even if some channels have not settled [s]. */
+    double pollSeconds; /*!< Wait between two reads of the data packets [s]. */
+} OffsetCompensationConfig_t;
+
+/*! \fn offsetCompensationDefaultConfig
+ * \brief Returns the default parameters for a sampling rate and a current range: tolerance of
+ * #OFFSET_COMPENSATION_TOLERANCE_RATIO of the full scale, 50 ms windows, settled after 4 windows, 5 s timeout,
+ * reads every 5 ms.
+ *
+ * \param samplingRateRadioId [in] EDL_RADIO_SAMPLING_RATE_* value set on the device.
+ * \param rangeRadioId [in] EDL_RADIO_RANGE_* value set on the device.
+ */
+OffsetCompensationConfig_t offsetCompensationDefaultConfig(unsigned int samplingRateRadioId, unsigned int rangeRadioId);
+
+/*! \struct OffsetCompensationResult_t
+ * \brief Outcome of an #OffsetCompensation.
+ */
+typedef struct {
+    EdlErrorCode_t error; /*!< First error of the commands or of the reads, #EdlSuccess if none. */
+    bool converged; /*!< True if all of the current channels settled before the timeout. */
+    double seconds; /*!< Time between the press and the release of #EdlCommandCompAll [s]. */
+    unsigned long long readPackets; /*!< Data packets read while compensating. */
+    double offsets[EDL_CHANNEL_NUM]; /*!< Mean of each channel over the last complete window; the voltage channel comes first. */
+    bool settled[EDL_CHANNEL_NUM]; /*!< Current channels that settled; false for the voltage channel. */
+} OffsetCompensationResult_t;
+
+/*! \class OffsetCompensation
+ * \brief Presses #EdlCommandCompAll and releases it as soon as the offset of every current channel has settled,
+ * rather than after a fixed time.
+ *
+ * A dedicated thread reads the data packets while the device compensates and averages each current channel over windows of
+ * OffsetCompensationConfig_t::windowSeconds. The compensation brings the current at 0 mV to zero, so a channel is settled once
+ * the magnitude of its mean stays within OffsetCompensationConfig_t::tolerance for OffsetCompensationConfig_t::settledWindowsNum
+ * consecutive windows, and the button is released once all of them are, or at OffsetCompensationConfig_t::timeoutSeconds.
+ * The data packets are only used to follow the offsets: the acquisition purges them anyway.
+ */
+class OffsetCompensation {
+public:
+    /*! \brief OffsetCompensation constructor.
+     *
+     * \param source [in] Source of the data packets of the device; it must outlive this object.
+     * \param transaction [in] Transaction of the device the buttons are sent with; it must outlive this object and must not
+     * be used by other threads between #start and #wait. The commands it already holds are sent with the press.
+     * \param config [in] Parameters.
+     */
+    OffsetCompensation(PacketSource &source, CommandTransaction &transaction, const OffsetCompensationConfig_t &config);
+
+    /*! \brief OffsetCompensation destructor. Waits for the compensation to finish.
+     */
+    ~OffsetCompensation();
+
+    /*! \brief Presses #EdlCommandCompAll and starts following the offsets on a dedicated thread. Returns without waiting.
+     *
+     * \return #EdlErrorCode_t Error code of the press; nothing is started on errors.
+     */
+    EdlErrorCode_t start(EDL_VOID);
+
+    /*! \brief Returns true once #EdlCommandCompAll has been released, or if the compensation never started.
+     */
+    bool isDone(EDL_VOID) const;
+
+    /*! \brief Waits for the release of #EdlCommandCompAll and returns the outcome of the compensation.
+     */
+    const OffsetCompensationResult_t &wait(EDL_VOID);
+
+private:
+    OffsetCompensation(const OffsetCompensation &);
+    OffsetCompensation &operator=(const OffsetCompensation &);
+
+    void compensationLoop();
+    bool consumePackets(const float * packets, unsigned int packetsNum);
+
+    PacketSource &source;
+    CommandTransaction &transaction;
+    OffsetCompensationConfig_t config;
+    unsigned int windowPackets;
+    std::thread compensationThread;
+    std::atomic <bool> done;
+    OffsetCompensationResult_t result;
+
+    std::vector <float> data;
+    double sums[EDL_CHANNEL_NUM]; /*!< Sums of the samples of the ongoing window. */
+    unsigned int windowPacketsNum; /*!< Data packets in the ongoing window. */
+    unsigned int settledWindows[EDL_CHANNEL_NUM]; /*!< Consecutive windows within the tolerance. */
+};
+
+#endif // OFFSET_COMPENSATION_H
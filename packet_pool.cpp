@@ -0,0 +1,129 @@
+/*! \file packet_pool.cpp
+ * \brief Defines classes PacketBlock and PacketPool.
+ */
+#include "packet_pool.h"
+
+#include <cstdlib>
+#include <new>
+
+#ifdef _WIN32
+#include <malloc.h>
+#endif
+
+void * cacheAlignedAlloc(size_t size) {
+#ifdef _WIN32
+    return _aligned_malloc(size, CACHE_LINE_SIZE);
+#else
+    void * ptr = NULL;
+    if (posix_memalign(&ptr, CACHE_LINE_SIZE, size) != 0) {
+        return NULL;
+    }
+    return ptr;
+#endif
+}
+
+void cacheAlignedFree(void * ptr) {
+#ifdef _WIN32
+    _aligned_free(ptr);
+#else
+    free(ptr);
+#endif
+}
+
+PacketBlock::PacketBlock(PacketPool * pool, float * packets, unsigned int capacity) :
+    pool(pool),
+    packets(packets),
+    capacity(capacity),
+    packetsNum(0),
+    firstPacket(0),
+    refsNum(0) {
+}
+
+void PacketBlock::release() {
+    /*! The last holder must see the writes of the others before the block is reused. */
+    if (refsNum.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        pool->recycle(this);
+    }
+}
+
+PacketPool::PacketPool(unsigned int blocksNum, unsigned int blockPackets) :
+    blocksNum(blocksNum),
+    blockPackets(blockPackets),
+    blocks(NULL),
+    storage(NULL),
+    maxBlocksInUse(0),
+    exhaustions(0) {
+    /*! Round the blocks up to whole cache lines, so that each starts on its own. */
+    size_t blockFloats = (size_t)blockPackets*EDL_CHANNEL_NUM;
+    size_t lineFloats = CACHE_LINE_SIZE/sizeof(float);
+    blockFloats = (blockFloats+lineFloats-1)/lineFloats*lineFloats;
+
+    blocks = (PacketBlock *)cacheAlignedAlloc(blocksNum*sizeof(PacketBlock));
+    storage = (float *)cacheAlignedAlloc(blocksNum*blockFloats*sizeof(float));
+    if (blocks == NULL || storage == NULL) {
+        cacheAlignedFree(blocks);
+        cacheAlignedFree(storage);
+        blocks = NULL;
+        storage = NULL;
+        this->blocksNum = 0;
+        return;
+    }
+
+    freeBlocks.reserve(blocksNum);
+    for (unsigned int blockIdx = 0; blockIdx < blocksNum; blockIdx++) {
+        new (&blocks[blockIdx]) PacketBlock(this, storage+blockIdx*blockFloats, blockPackets);
+        freeBlocks.push_back(&blocks[blockIdx]);
+    }
+}
+
+PacketPool::~PacketPool() {
+    for (unsigned int blockIdx = 0; blockIdx < blocksNum; blockIdx++) {
+        blocks[blockIdx].~PacketBlock();
+    }
+    cacheAlignedFree(blocks);
+    cacheAlignedFree(storage);
+}
+
+PacketBlock * PacketPool::acquire() {
+    PacketBlock * block;
+    {
+        std::lock_guard <std::mutex> lock(freeMutex);
+        if (freeBlocks.empty()) {
+            exhaustions++;
+            return NULL;
+        }
+        block = freeBlocks.back();
+        freeBlocks.pop_back();
+
+        unsigned int blocksInUse = blocksNum-(unsigned int)freeBlocks.size();
+        if (blocksInUse > maxBlocksInUse) {
+            maxBlocksInUse = blocksInUse;
+        }
+    }
+
+    block->packetsNum = 0;
+    block->firstPacket = 0;
+    block->refsNum.store(1, std::memory_order_relaxed);
+    return block;
+}
+
+unsigned int PacketPool::getBlocksNum() const {
+    return blocksNum;
+}
+
+unsigned int PacketPool::getBlockPackets() const {
+    return blockPackets;
+}
+
+unsigned int PacketPool::getMaxBlocksInUse() const {
+    return maxBlocksInUse;
+}
+
+unsigned long long PacketPool::getExhaustions() const {
+    return exhaustions;
+}
+
+void PacketPool::recycle(PacketBlock * block) {
+    std::lock_guard <std::mutex> lock(freeMutex);
+    freeBlocks.push_back(block);
+}
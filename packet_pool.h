@@ -0,0 +1,164 @@
+/*! \file packet_pool.h
+ * \brief Declares classes PacketBlock and PacketPool, which hand blocks of data packets from the reader thread
+ * to the processing stages without copying or allocating them.
+ */
+#ifndef PACKET_POOL_H
+#define PACKET_POOL_H
+
+#include <atomic>
+#include <mutex>
+#include <vector>
+#include <cstddef>
+#include <stdint.h>
+
+#include "edl.h"
+#include "ring_buffer.h"
+
+/*! \fn cacheAlignedAlloc
+ * \brief Allocates \a size bytes aligned to #CACHE_LINE_SIZE.
+ *
+ * \return The allocated memory, NULL on failure.
+ */
+void * cacheAlignedAlloc(size_t size);
+
+/*! \fn cacheAlignedFree
+ * \brief Frees memory allocated by #cacheAlignedAlloc.
+ */
+void cacheAlignedFree(void * ptr);
+
+class PacketPool;
+
+/*! \class PacketBlock
+ * \brief Consecutive data packets stored in a #PacketPool, with a reference count.
+ * The block returns to its pool when the last reference is released, so a stage that needs the data packets
+ * after returning from AcquisitionSink::consumeBlock calls #addRef and later #release instead of copying them.
+ */
+class PacketBlock {
+public:
+    /*! \brief Returns the data packets, #EDL_CHANNEL_NUM samples each, aligned to #CACHE_LINE_SIZE.
+     */
+    float * getPackets() {
+        return packets;
+    }
+
+    /*! \brief Returns the data packets, #EDL_CHANNEL_NUM samples each, aligned to #CACHE_LINE_SIZE.
+     */
+    const float * getPackets() const {
+        return packets;
+    }
+
+    /*! \brief Returns the number of data packets stored.
+     */
+    unsigned int getPacketsNum() const {
+        return packetsNum;
+    }
+
+    /*! \brief Sets the number of data packets stored, up to #getCapacity. Only the owner of the single reference may call it.
+     */
+    void setPacketsNum(unsigned int packetsNum) {
+        this->packetsNum = packetsNum;
+    }
+
+    /*! \brief Returns the index of the first data packet since the start of the acquisition.
+     * Consecutive blocks are contiguous unless data packets were dropped in between.
+     */
+    uint64_t getFirstPacket() const {
+        return firstPacket;
+    }
+
+    /*! \brief Sets the index of the first data packet. Only the owner of the single reference may call it.
+     */
+    void setFirstPacket(uint64_t firstPacket) {
+        this->firstPacket = firstPacket;
+    }
+
+    /*! \brief Returns the number of data packets the block can store.
+     */
+    unsigned int getCapacity() const {
+        return capacity;
+    }
+
+    /*! \brief Adds a reference. The caller must already hold one.
+     */
+    void addRef() {
+        refsNum.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    /*! \brief Releases a reference, returning the block to its pool if it was the last one.
+     */
+    void release();
+
+private:
+    friend class PacketPool;
+
+    PacketBlock(PacketPool * pool, float * packets, unsigned int capacity);
+    PacketBlock(const PacketBlock &);
+    PacketBlock &operator=(const PacketBlock &);
+
+    PacketPool * pool;
+    float * packets;
+    unsigned int capacity;
+    unsigned int packetsNum;
+    uint64_t firstPacket;
+    alignas(CACHE_LINE_SIZE) std::atomic <unsigned int> refsNum; /*!< Alone on its cache line, as it is written by several threads. */
+};
+
+/*! \class PacketPool
+ * \brief Fixed set of #PacketBlock allocated once by the constructor.
+ * #acquire and the release of the blocks never allocate, so the acquisition runs without heap allocations once started.
+ * Blocks may be acquired and released by any thread.
+ */
+class PacketPool {
+public:
+    /*! \brief PacketPool constructor.
+     *
+     * \param blocksNum [in] Number of blocks.
+     * \param blockPackets [in] Data packets per block.
+     */
+    PacketPool(unsigned int blocksNum, unsigned int blockPackets);
+
+    /*! \brief PacketPool destructor. All of the blocks must have been released.
+     */
+    ~PacketPool();
+
+    /*! \brief Takes a free block, with one reference and no data packets.
+     *
+     * \return The block, NULL if all of the blocks are in use.
+     */
+    PacketBlock * acquire(EDL_VOID);
+
+    /*! \brief Returns the number of blocks.
+     */
+    unsigned int getBlocksNum(EDL_VOID) const;
+
+    /*! \brief Returns the data packets per block.
+     */
+    unsigned int getBlockPackets(EDL_VOID) const;
+
+    /*! \brief Returns the highest number of blocks in use at the same time.
+     */
+    unsigned int getMaxBlocksInUse(EDL_VOID) const;
+
+    /*! \brief Returns the number of calls to #acquire that found no free block.
+     */
+    unsigned long long getExhaustions(EDL_VOID) const;
+
+private:
+    friend class PacketBlock;
+
+    PacketPool(const PacketPool &);
+    PacketPool &operator=(const PacketPool &);
+
+    void recycle(PacketBlock * block);
+
+    unsigned int blocksNum;
+    unsigned int blockPackets;
+    PacketBlock * blocks; /*!< Block descriptors, one per cache line. */
+    float * storage; /*!< Data packets of all of the blocks. */
+    std::mutex freeMutex;
+    std::vector <PacketBlock *> freeBlocks; /*!< Reserved for all of the blocks, so it never reallocates. */
+    std::atomic <unsigned int> maxBlocksInUse;
+    std::atomic <unsigned long long> exhaustions;
+};
+
+#endif // PACKET_POOL_H
@@ -0,0 +1,127 @@
+/*! \file packet_source.cpp
+ * \brief Defines the data packet sources used by the acquisition threads.
+ */
+#include "packet_source.h"
+
+#include <cmath>
+
+EdlPacketSource::EdlPacketSource(EDL &edl) :
+    edl(edl) {
+}
+
+EdlErrorCode_t EdlPacketSource::getDeviceStatus(EdlDeviceStatus_t &status) {
+    return edl.getDeviceStatus(status);
+}
+
+EdlErrorCode_t EdlPacketSource::readData(unsigned int dataToRead, unsigned int &dataRead, std::vector <float> &buffer) {
+    return edl.readData(dataToRead, dataRead, buffer);
+}
+
+EdlErrorCode_t EdlPacketSource::purgeData() {
+    return edl.purgeData();
+}
+
+SyntheticPacketSource::SyntheticPacketSource(double packetRate, unsigned int bufferPackets) :
+    packetRate(packetRate),
+    bufferPackets(bufferPackets),
+    startTime(std::chrono::steady_clock::now()),
+    startPackets(0),
+    startSeconds(0.0),
+    generatedPackets(0),
+    readPackets(0),
+    bufferOverflowFlag(false),
+    lostDataFlag(false),
+    noiseState(0x12345678) {
+}
+
+void SyntheticPacketSource::update() {
+    std::chrono::duration <double> elapsed = std::chrono::steady_clock::now()-startTime;
+    generatedPackets = startPackets+(unsigned long long)(elapsed.count()*packetRate);
+
+    /*! Discard the oldest packets if the buffer is full. */
+    if (generatedPackets-readPackets > bufferPackets) {
+        readPackets = generatedPackets-bufferPackets;
+        bufferOverflowFlag = true;
+    }
+}
+
+EdlErrorCode_t SyntheticPacketSource::getDeviceStatus(EdlDeviceStatus_t &status) {
+    update();
+    status.availableDataPackets = (unsigned int)(generatedPackets-readPackets);
+    status.bufferOverflowFlag = bufferOverflowFlag;
+    status.lostDataFlag = lostDataFlag;
+    bufferOverflowFlag = false;
+    lostDataFlag = false;
+    return EdlSuccess;
+}
+
+EdlErrorCode_t SyntheticPacketSource::readData(unsigned int dataToRead, unsigned int &dataRead, std::vector <float> &buffer) {
+    EdlErrorCode_t res = EdlSuccess;
+    update();
+
+    unsigned long long available = generatedPackets-readPackets;
+    dataRead = dataToRead;
+    if (dataToRead > available) {
+        dataRead = (unsigned int)available;
+        res = EdlNotEnoughAvailableDataError;
+    }
+
+    buffer.resize(dataRead*EDL_CHANNEL_NUM);
+    for (unsigned int packetIdx = 0; packetIdx < dataRead; packetIdx++) {
+        generatePacket(readPackets+packetIdx, &buffer[packetIdx*EDL_CHANNEL_NUM]);
+    }
+    readPackets += dataRead;
+    return res;
+}
+
+EdlErrorCode_t SyntheticPacketSource::purgeData() {
+    update();
+    readPackets = generatedPackets;
+    return EdlSuccess;
+}
+
+unsigned long long SyntheticPacketSource::getGeneratedPackets() {
+    update();
+    return generatedPackets;
+}
+
+void SyntheticPacketSource::setPacketRate(double packetRate) {
+    update();
+    startSeconds = packetSeconds(generatedPackets);
+    startPackets = generatedPackets;
+    startTime = std::chrono::steady_clock::now();
+    readPackets = generatedPackets;
+    this->packetRate = packetRate;
+}
+
+void SyntheticPacketSource::losePackets(unsigned long long packetsNum) {
+    update();
+    if (packetsNum > generatedPackets-readPackets) {
+        packetsNum = generatedPackets-readPackets;
+    }
+    readPackets += packetsNum;
+    lostDataFlag = true;
+}
+
+double SyntheticPacketSource::packetSeconds(unsigned long long packetIdx) const {
+    return startSeconds+((double)packetIdx-(double)startPackets)/packetRate;
+}
+
+float SyntheticPacketSource::uniformNoise() {
+    noiseState ^= noiseState << 13;
+    noiseState ^= noiseState >> 17;
+    noiseState ^= noiseState << 5;
+    return (float)(noiseState >> 8)*(1.0f/16777216.0f);
+}
+
+void SyntheticPacketSource::generatePacket(unsigned long long packetIdx, float * packet) {
+    /*! Triangular wave of 50mV amplitude and 100ms period on the voltage channel. */
+    double phase = std::fmod(packetSeconds(packetIdx), 0.1)/0.1;
+    float voltage = (float)(phase < 0.5 ? -50.0+200.0*phase : 150.0-200.0*phase);
+    packet[0] = voltage;
+
+    /*! 1nS conductance and some uniform noise on the current channels [pA]. */
+    for (unsigned int channelIdx = 1; channelIdx < EDL_CHANNEL_NUM; channelIdx++) {
+        packet[channelIdx] = voltage+uniformNoise()-0.5f;
+    }
+}
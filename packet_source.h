@@ -0,0 +1,124 @@
+/*! \file packet_source.h
+ * \brief Declares the data packet sources used by the acquisition threads.
+ */
+#ifndef PACKET_SOURCE_H
+#define PACKET_SOURCE_H
+
+#include <vector>
+#include <chrono>
+
+#include "edl.h"
+
+/*! \def SYNTHETIC_BUFFER_PACKETS
+ * \brief Default number of data packets buffered by a #SyntheticPacketSource before overflowing.
+ */
+#define SYNTHETIC_BUFFER_PACKETS (1 << 20)
+
+/*! \class PacketSource
+ * \brief Interface to the subset of #EDL methods used to collect data packets.
+ * Methods have the same semantics as the homonymous #EDL methods.
+ */
+class PacketSource {
+public:
+    virtual ~PacketSource() {}
+
+    /*! \brief See EDL::getDeviceStatus. */
+    virtual EdlErrorCode_t getDeviceStatus(EDL_OUT EdlDeviceStatus_t &status) = 0;
+
+    /*! \brief See EDL::readData. */
+    virtual EdlErrorCode_t readData(EDL_IN unsigned int dataToRead,
+                                    EDL_OUT unsigned int &dataRead,
+                                    EDL_OUT std::vector <float> &buffer) = 0;
+
+    /*! \brief See EDL::purgeData. */
+    virtual EdlErrorCode_t purgeData(EDL_VOID) = 0;
+};
+
+/*! \class EdlPacketSource
+ * \brief #PacketSource that forwards to a connected #EDL object.
+ */
+class EdlPacketSource : public PacketSource {
+public:
+    /*! \brief EdlPacketSource constructor.
+     *
+     * \param edl [in] Connected #EDL object; it must outlive this object.
+     */
+    explicit EdlPacketSource(EDL &edl);
+
+    EdlErrorCode_t getDeviceStatus(EDL_OUT EdlDeviceStatus_t &status);
+    EdlErrorCode_t readData(EDL_IN unsigned int dataToRead,
+                            EDL_OUT unsigned int &dataRead,
+                            EDL_OUT std::vector <float> &buffer);
+    EdlErrorCode_t purgeData(EDL_VOID);
+
+private:
+    EDL &edl;
+};
+
+/*! \class SyntheticPacketSource
+ * \brief #PacketSource that emits synthetic data packets at a fixed rate, to run the acquisition without a device.
+ * Packets are generated lazily from the elapsed time, so no thread is needed.
+ * The voltage channel carries a triangular wave and the current channels a proportional current plus noise.
+ * When more than \a bufferPackets packets are pending the oldest ones are discarded and
+ * EdlDeviceStatus_t::bufferOverflowFlag is raised, as the device does.
+ */
+class SyntheticPacketSource : public PacketSource {
+public:
+    /*! \brief SyntheticPacketSource constructor.
+     *
+     * \param packetRate [in] Number of data packets generated per second.
+     * \param bufferPackets [in] Number of packets buffered before overflowing.
+     */
+    SyntheticPacketSource(double packetRate, unsigned int bufferPackets = SYNTHETIC_BUFFER_PACKETS);
+
+    EdlErrorCode_t getDeviceStatus(EDL_OUT EdlDeviceStatus_t &status);
+    EdlErrorCode_t readData(EDL_IN unsigned int dataToRead,
+                            EDL_OUT unsigned int &dataRead,
+                            EDL_OUT std::vector <float> &buffer);
+    EdlErrorCode_t purgeData(EDL_VOID);
+
+    /*! \brief Returns the total number of packets generated so far, including the discarded ones.
+     */
+    unsigned long long getGeneratedPackets(EDL_VOID);
+
+    /*! \brief Changes the packet rate from now on. Pending packets are discarded.
+     */
+    void setPacketRate(double packetRate);
+
+    /*! \brief Discards up to \a packetsNum of the oldest pending packets and raises EdlDeviceStatus_t::lostDataFlag.
+     */
+    void losePackets(unsigned long long packetsNum);
+
+protected:
+    /*! \brief Fills one data packet of #EDL_CHANNEL_NUM samples.
+     *
+     * \param packetIdx [in] Index of the packet since the source was created.
+     * \param packet [out] Destination of the #EDL_CHANNEL_NUM samples.
+     */
+    virtual void generatePacket(unsigned long long packetIdx, float * packet);
+
+    /*! \brief Brings the number of generated packets up to date with the elapsed time.
+     */
+    void update(EDL_VOID);
+
+    /*! \brief Returns the time in seconds of a packet since the source was created.
+     */
+    double packetSeconds(unsigned long long packetIdx) const;
+
+    /*! \brief Returns a uniformly distributed random number in [0, 1).
+     */
+    float uniformNoise(EDL_VOID);
+
+    double packetRate; /*!< Packets generated per second. */
+    unsigned int bufferPackets; /*!< Packets buffered before overflowing. */
+    std::chrono::steady_clock::time_point startTime; /*!< Time of the last rate change. */
+    unsigned long long startPackets; /*!< Packets generated before the last rate change. */
+    double startSeconds; /*!< Time in seconds of the last rate change since the source was created. */
+    unsigned long long generatedPackets; /*!< Packets generated since the source was created. */
+    unsigned long long readPackets; /*!< Index of the oldest packet not yet read. */
+    bool bufferOverflowFlag; /*!< Set when packets are discarded because of a full buffer, reset by #getDeviceStatus. */
+    bool lostDataFlag; /*!< Set by #losePackets, reset by #getDeviceStatus. */
+    unsigned int noiseState; /*!< State of the xorshift noise generator. */
+};
+
+#endif // PACKET_SOURCE_H
@@ -0,0 +1,436 @@
+/*! \file protocol_scheduler.cpp
+ * \brief Defines classes ProtocolSequence and ProtocolScheduler.
+ */
+#include "protocol_scheduler.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "edl_settings.h"
+#include "command_transaction.h"
+
+/*! \def PROTOCOL_LINE_SIZE
+ * \brief Longest line of a sequence file, in characters.
+ */
+#define PROTOCOL_LINE_SIZE 1024
+
+/*! \struct ProtocolName_t
+ * \brief Name used in the sequence files for a value.
+ */
+typedef struct {
+    const char * name;
+    int value;
+} ProtocolName_t;
+
+/*! Protocols of the sequence files, other than the ramp. */
+static const ProtocolName_t protocolNames[] = {
+    {"constant", EDL_PROTOCOL_CONSTANT},
+    {"triangular", EDL_PROTOCOL_TRIANGULAR}
+};
+
+/*! Protocol parameters of the sequence files. */
+static const ProtocolName_t parameterNames[] = {
+    {"vhold", EdlCommandVhold},
+    {"vamp", EdlCommandVamp},
+    {"period", EdlCommandTPeriod}
+};
+
+/*! \fn splitWords
+ * \brief Splits a line in words separated by blanks, dropping the comment.
+ */
+static std::vector <std::string> splitWords(const std::string &line) {
+    std::vector <std::string> words;
+    std::string word;
+    for (size_t charIdx = 0; charIdx < line.size() && line[charIdx] != '#'; charIdx++) {
+        if (line[charIdx] == ' ' || line[charIdx] == '\t' || line[charIdx] == '\r' || line[charIdx] == '\n') {
+            if (!word.empty()) {
+                words.push_back(word);
+                word.clear();
+            }
+
+        } else {
+            word += line[charIdx];
+        }
+    }
+
+    if (!word.empty()) {
+        words.push_back(word);
+    }
+    return words;
+}
+
+/*! \fn parseNumber
+ * \brief Converts a whole word to a finite number.
+ */
+static bool parseNumber(const std::string &word, double &value) {
+    char * end;
+    value = strtod(word.c_str(), &end);
+    return !word.empty() && *end == '\0' && std::isfinite(value);
+}
+
+ProtocolSequence::ProtocolSequence() {
+}
+
+bool ProtocolSequence::load(const std::string &path) {
+    steps.clear();
+    startSeconds.clear();
+    error.clear();
+
+    FILE * file = fopen(path.c_str(), "r");
+    if (file == NULL) {
+        error = "cannot open "+path;
+        return false;
+    }
+
+    char line[PROTOCOL_LINE_SIZE];
+    unsigned int lineNum = 0;
+    bool success = true;
+    while (success && fgets(line, sizeof(line), file) != NULL) {
+        lineNum++;
+        if (strlen(line) == sizeof(line)-1 && line[sizeof(line)-2] != '\n' && !feof(file)) {
+            error = "line "+std::to_string(lineNum)+": too long";
+            success = false;
+
+        } else {
+            success = parseLine(line, lineNum);
+        }
+    }
+    fclose(file);
+
+    if (success && steps.empty()) {
+        error = path+": no steps";
+        success = false;
+    }
+
+    if (!success) {
+        steps.clear();
+        startSeconds.clear();
+    }
+    return success;
+}
+
+bool ProtocolSequence::parseLine(const std::string &line, unsigned int lineNum) {
+    std::vector <std::string> words = splitWords(line);
+    if (words.empty()) {
+        return true;
+    }
+
+    std::string location = "line "+std::to_string(lineNum)+": ";
+    double durationSeconds;
+    if (words.size() < 2 || !parseNumber(words[0], durationSeconds)) {
+        error = location+"expected <seconds> <protocol> [parameter=value ...]";
+        return false;
+    }
+
+    /*! Collect the parameters; the ramp has its own, the other protocols name their commands. */
+    bool ramp = words[1] == "ramp";
+    std::vector <std::string> names;
+    std::vector <double> values;
+    for (size_t wordIdx = 2; wordIdx < words.size(); wordIdx++) {
+        size_t equalIdx = words[wordIdx].find('=');
+        double value;
+        if (equalIdx == std::string::npos || !parseNumber(words[wordIdx].substr(equalIdx+1), value)) {
+            error = location+"expected parameter=value, not "+words[wordIdx];
+            return false;
+        }
+        names.push_back(words[wordIdx].substr(0, equalIdx));
+        values.push_back(value);
+    }
+
+    ProtocolStep_t step;
+    std::memset(&step, 0, sizeof(step));
+    step.durationSeconds = durationSeconds;
+    step.lineNum = lineNum;
+    if (ramp) {
+        double from = NAN;
+        double to = NAN;
+        double stepsNum = NAN;
+        for (size_t paramIdx = 0; paramIdx < names.size(); paramIdx++) {
+            if (names[paramIdx] == "from") {
+                from = values[paramIdx];
+
+            } else if (names[paramIdx] == "to") {
+                to = values[paramIdx];
+
+            } else if (names[paramIdx] == "steps") {
+                stepsNum = values[paramIdx];
+
+            } else {
+                error = location+"unknown ramp parameter "+names[paramIdx];
+                return false;
+            }
+        }
+
+        if (std::isnan(from) || std::isnan(to) || !(stepsNum >= 2.0) || stepsNum != std::floor(stepsNum)) {
+            error = location+"a ramp needs from=<mV> to=<mV> steps=<2 or more>";
+            return false;
+        }
+
+        /*! The ramp is a staircase of constant protocols: each step is checked on its own. */
+        step.durationSeconds = durationSeconds/stepsNum;
+        step.commandValues[EdlCommandMainTrial] = EDL_PROTOCOL_CONSTANT;
+        for (unsigned int rampIdx = 0; rampIdx < (unsigned int)stepsNum; rampIdx++) {
+            step.commandValues[EdlCommandVhold] = from+(to-from)*rampIdx/(stepsNum-1.0);
+            if (!addStep(step)) {
+                error = location+error;
+                return false;
+            }
+        }
+        return true;
+    }
+
+    int protocol = -1;
+    for (size_t nameIdx = 0; nameIdx < sizeof(protocolNames)/sizeof(protocolNames[0]); nameIdx++) {
+        if (words[1] == protocolNames[nameIdx].name) {
+            protocol = protocolNames[nameIdx].value;
+        }
+    }
+
+    if (protocol < 0) {
+        error = location+"unknown protocol "+words[1];
+        return false;
+    }
+    step.commandValues[EdlCommandMainTrial] = protocol;
+
+    for (size_t paramIdx = 0; paramIdx < names.size(); paramIdx++) {
+        int commandId = -1;
+        for (size_t nameIdx = 0; nameIdx < sizeof(parameterNames)/sizeof(parameterNames[0]); nameIdx++) {
+            if (names[paramIdx] == parameterNames[nameIdx].name) {
+                commandId = parameterNames[nameIdx].value;
+            }
+        }
+
+        if (commandId < 0 || !edlProtocolUsesCommand(protocol, (EdlCommandId_t)commandId)) {
+            error = location+"protocol "+words[1]+" has no parameter "+names[paramIdx];
+            return false;
+        }
+        step.commandValues[commandId] = values[paramIdx];
+    }
+
+    /*! Every parameter of the protocol must be given, so that no step depends on the previous ones. */
+    for (size_t nameIdx = 0; nameIdx < sizeof(parameterNames)/sizeof(parameterNames[0]); nameIdx++) {
+        bool given = false;
+        for (size_t paramIdx = 0; paramIdx < names.size(); paramIdx++) {
+            given = given || names[paramIdx] == parameterNames[nameIdx].name;
+        }
+
+        if (!given && edlProtocolUsesCommand(protocol, (EdlCommandId_t)parameterNames[nameIdx].value)) {
+            error = location+"protocol "+words[1]+" needs "+parameterNames[nameIdx].name;
+            return false;
+        }
+    }
+
+    if (!addStep(step)) {
+        error = location+error;
+        return false;
+    }
+    return true;
+}
+
+bool ProtocolSequence::addStep(const ProtocolStep_t &step) {
+    if (!(step.durationSeconds > 0.0)) {
+        error = "the duration must be positive";
+        return false;
+    }
+
+    if (edlCheckProtocol(step.commandValues) != EdlSuccess) {
+        error = "parameters out of the limits of the protocol rules, see edlCheckProtocol";
+        return false;
+    }
+
+    startSeconds.push_back(steps.empty() ? 0.0 : startSeconds.back()+steps.back().durationSeconds);
+    steps.push_back(step);
+    return true;
+}
+
+unsigned int ProtocolSequence::getStepsNum() const {
+    return (unsigned int)steps.size();
+}
+
+const ProtocolStep_t &ProtocolSequence::getStep(unsigned int stepIdx) const {
+    return steps[stepIdx];
+}
+
+uint64_t ProtocolSequence::getStartPacket(unsigned int stepIdx, double samplingRate) const {
+    return (uint64_t)std::llround(startSeconds[stepIdx]*samplingRate);
+}
+
+const std::string &ProtocolSequence::getError() const {
+    return error;
+}
+
+EdlErrorCode_t applyProtocolStep(EDL &edl, const ProtocolStep_t &step) {
+    /*! All of the parameters of the protocol are sent, so that the step does not depend on the previous ones. */
+    CommandTransaction transaction(edl);
+    double protocol = step.commandValues[EdlCommandMainTrial];
+    for (unsigned int commandIdx = 0; commandIdx < EdlCommandIdNum; commandIdx++) {
+        if (commandIdx == EdlCommandMainTrial || edlProtocolUsesCommand(protocol, (EdlCommandId_t)commandIdx)) {
+            transaction.setValue((EdlCommandId_t)commandIdx, step.commandValues[commandIdx]);
+        }
+    }
+    return transaction.commit();
+}
+
+/*! \class StepCommand
+ * \brief Sends the protocol of a step to a device from the reader thread of its #Acquisition, timing the write.
+ */
+class StepCommand : public AcquisitionCommand {
+public:
+    StepCommand(EDL &edl, const ProtocolStep_t &step, std::mutex &mutex, std::condition_variable &condition) :
+        edl(edl),
+        step(step),
+        mutex(mutex),
+        condition(condition),
+        result(EdlSuccess),
+        done(false) {
+    }
+
+    void run() {
+        before = std::chrono::steady_clock::now();
+        result = applyProtocolStep(edl, step);
+        after = std::chrono::steady_clock::now();
+
+        std::lock_guard <std::mutex> lock(mutex);
+        done = true;
+        condition.notify_all();
+    }
+
+    EDL &edl;
+    const ProtocolStep_t &step;
+    std::mutex &mutex; /*!< Of the #ProtocolScheduler, guards \a done. */
+    std::condition_variable &condition;
+    std::chrono::steady_clock::time_point before;
+    std::chrono::steady_clock::time_point after;
+    EdlErrorCode_t result;
+    bool done;
+};
+
+ProtocolScheduler::ProtocolScheduler(const ProtocolSequence &sequence, double samplingRate) :
+    sequence(sequence),
+    samplingRate(samplingRate),
+    stopping(false),
+    appliedStepsNum(0),
+    maxDelayPackets(0),
+    error(EdlSuccess) {
+}
+
+ProtocolScheduler::~ProtocolScheduler() {
+    stop();
+}
+
+void ProtocolScheduler::addDevice(EDL &edl, Acquisition &acquisition, RotatingRecording * recording) {
+    edls.push_back(&edl);
+    acquisitions.push_back(&acquisition);
+    recordings.push_back(recording);
+}
+
+bool ProtocolScheduler::start(std::chrono::steady_clock::time_point streamStart) {
+    if (schedulerThread.joinable()) {
+        return false;
+    }
+
+    this->streamStart = streamStart;
+    stopping = false;
+    schedulerThread = std::thread(&ProtocolScheduler::schedulerLoop, this);
+    return true;
+}
+
+void ProtocolScheduler::stop() {
+    {
+        std::lock_guard <std::mutex> lock(mutex);
+        stopping = true;
+    }
+    condition.notify_all();
+    if (schedulerThread.joinable()) {
+        schedulerThread.join();
+    }
+}
+
+unsigned int ProtocolScheduler::getAppliedStepsNum() const {
+    return appliedStepsNum;
+}
+
+unsigned long long ProtocolScheduler::getMaxDelayPackets() const {
+    return maxDelayPackets;
+}
+
+EdlErrorCode_t ProtocolScheduler::getError() const {
+    return (EdlErrorCode_t)error.load();
+}
+
+void ProtocolScheduler::applyStep(unsigned int stepIdx) {
+    RecordingSegment_t segment;
+    std::memset(&segment, 0, sizeof(segment));
+    segment.scheduledPacket = sequence.getStartPacket(stepIdx, samplingRate);
+    segment.stepIdx = stepIdx;
+    for (unsigned int commandIdx = 0; commandIdx < EdlCommandIdNum; commandIdx++) {
+        segment.commandValues[commandIdx] = sequence.getStep(stepIdx).commandValues[commandIdx];
+    }
+
+    std::vector <StepCommand *> commands;
+    for (size_t deviceIdx = 0; deviceIdx < edls.size(); deviceIdx++) {
+        commands.push_back(new StepCommand(*edls[deviceIdx], sequence.getStep(stepIdx), mutex, condition));
+        acquisitions[deviceIdx]->postCommand(commands.back());
+    }
+
+    /*! Wait for the reader threads to send the step, unless stopped; the commands they have not run yet are then withdrawn. */
+    {
+        std::unique_lock <std::mutex> lock(mutex);
+        condition.wait(lock, [this, &commands] {
+            for (size_t deviceIdx = 0; deviceIdx < commands.size(); deviceIdx++) {
+                if (!commands[deviceIdx]->done) {
+                    return stopping;
+                }
+            }
+            return true;
+        });
+    }
+
+    bool applied = true;
+    for (size_t deviceIdx = 0; deviceIdx < edls.size(); deviceIdx++) {
+        StepCommand * command = commands[deviceIdx];
+        acquisitions[deviceIdx]->cancelCommand(command);
+        if (!command->done) {
+            applied = false;
+
+        } else if (command->result != EdlSuccess) {
+            int noError = EdlSuccess;
+            error.compare_exchange_strong(noError, command->result);
+
+        } else {
+            /*! The protocol takes effect with the data packet acquired in the middle of the write. */
+            double seconds = std::chrono::duration <double> ((command->before-streamStart)+(command->after-command->before)/2).count();
+            segment.streamPacket = seconds > 0.0 ? (uint64_t)std::llround(seconds*samplingRate) : 0;
+            if (segment.streamPacket > segment.scheduledPacket && segment.streamPacket-segment.scheduledPacket > maxDelayPackets) {
+                maxDelayPackets = segment.streamPacket-segment.scheduledPacket;
+            }
+
+            if (recordings[deviceIdx] != NULL) {
+                recordings[deviceIdx]->markSegment(segment);
+            }
+        }
+        delete command;
+    }
+
+    if (applied) {
+        appliedStepsNum++;
+    }
+}
+
+void ProtocolScheduler::schedulerLoop() {
+    for (unsigned int stepIdx = 1; stepIdx < sequence.getStepsNum(); stepIdx++) {
+        /*! Sleep until the devices acquire the first data packet of the step, unless stopped. */
+        double startSeconds = (double)sequence.getStartPacket(stepIdx, samplingRate)/samplingRate;
+        std::chrono::steady_clock::time_point startTime = streamStart+
+                std::chrono::duration_cast <std::chrono::steady_clock::duration> (std::chrono::duration <double> (startSeconds));
+        {
+            std::unique_lock <std::mutex> lock(mutex);
+            if (condition.wait_until(lock, startTime, [this] { return stopping; })) {
+                return;
+            }
+        }
+        applyStep(stepIdx);
+    }
+}
@@ -0,0 +1,184 @@
+/*! \file protocol_scheduler.h
+ * \brief Declares class ProtocolSequence, which loads and checks a sequence of protocol steps, and class ProtocolScheduler,
+ * which applies them to the devices during the acquisition.
+ */
+#ifndef PROTOCOL_SCHEDULER_H
+#define PROTOCOL_SCHEDULER_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "edl.h"
+#include "acquisition.h"
+#include "recording_rotation.h"
+
+/*! \struct ProtocolStep_t
+ * \brief Step of a #ProtocolSequence: a protocol applied for some time.
+ */
+typedef struct {
+    double durationSeconds; /*!< Duration of the step [s]; the last step lasts until the end of the acquisition. */
+    double commandValues[EdlCommandIdNum]; /*!< Protocol parameters, indexed by #EdlCommandId_t: #EdlCommandMainTrial and the
+                                             * parameters it uses, see #edlProtocolUsesCommand; the others are 0. */
+    unsigned int lineNum; /*!< Line of the sequence file the step comes from, 0 if added by #ProtocolSequence::addStep. */
+} ProtocolStep_t;
+
+/*! \class ProtocolSequence
+ * \brief Sequence of protocol steps, each one checked against the protocol rules before the acquisition starts.
+ *
+ * A sequence file holds one step per line: its duration in seconds, the protocol and its parameters as name=value pairs,
+ * in mV and ms. Everything after a '#' is a comment. The protocols are:
+ * - constant vhold=<mV>: a holding voltage, e.g. for voltage steps;
+ * - triangular vhold=<mV> vamp=<mV> period=<ms>: a triangular sweep around the holding voltage;
+ * - ramp from=<mV> to=<mV> steps=<n>: a staircase of \a n constant steps of equal duration from \a from to \a to,
+ *   since the devices have no ramp protocol; each step costs the data lost after a command.
+ *
+ * \code
+ * # seconds  protocol    parameters
+ * 10         constant    vhold=0
+ * 60         triangular  vhold=0 vamp=50 period=100
+ * 30         ramp        from=0 to=100 steps=10
+ * \endcode
+ */
+class ProtocolSequence {
+public:
+    /*! \brief ProtocolSequence constructor. The sequence is empty.
+     */
+    ProtocolSequence();
+
+    /*! \brief Loads a sequence file, replacing the steps. On errors the sequence is left empty.
+     *
+     * \param path [in] Path of the sequence file.
+     * \return True if every step has been read and obeys the protocol rules; see #getError otherwise.
+     */
+    bool load(const std::string &path);
+
+    /*! \brief Appends a step after checking it against the protocol rules.
+     *
+     * \return True if the step has been added; see #getError otherwise.
+     */
+    bool addStep(const ProtocolStep_t &step);
+
+    /*! \brief Returns the number of steps.
+     */
+    unsigned int getStepsNum(EDL_VOID) const;
+
+    /*! \brief Returns a step.
+     *
+     * \param stepIdx [in] Index of the step, lower than #getStepsNum.
+     */
+    const ProtocolStep_t &getStep(EDL_IN unsigned int stepIdx) const;
+
+    /*! \brief Returns the index since the start of the acquisition of the data packet at which a step starts.
+     *
+     * \param stepIdx [in] Index of the step, lower than #getStepsNum.
+     * \param samplingRate [in] Sampling rate of the devices [Hz].
+     */
+    uint64_t getStartPacket(EDL_IN unsigned int stepIdx, EDL_IN double samplingRate) const;
+
+    /*! \brief Returns the description of the last problem met by #load or #addStep.
+     */
+    const std::string &getError(EDL_VOID) const;
+
+private:
+    bool parseLine(const std::string &line, unsigned int lineNum);
+
+    std::vector <ProtocolStep_t> steps;
+    std::vector <double> startSeconds; /*!< Time of the start of each step since the start of the acquisition [s]. */
+    std::string error;
+};
+
+/*! \fn applyProtocolStep
+ * \brief Sends the protocol of a step to a device with a #CommandTransaction, e.g. the first step before the acquisition starts.
+ *
+ * \return #EdlErrorCode_t Error code of CommandTransaction::commit.
+ */
+EdlErrorCode_t applyProtocolStep(EDL &edl, EDL_IN const ProtocolStep_t &step);
+
+/*! \class ProtocolScheduler
+ * \brief Applies the steps of a #ProtocolSequence to all of the devices, while the acquisition goes on.
+ *
+ * The transitions are scheduled on the index of the data packets: step i starts with data packet
+ * ProtocolSequence::getStartPacket(i), which the devices acquire at a known time since they have been aligned by
+ * DeviceManager::align. A dedicated thread sleeps until that time and then has each device send the protocol.
+ * An #EDL object is used by one thread at a time: while the acquisition runs, the reader thread of the #Acquisition of the
+ * device owns it, so the scheduler does not use the device itself but posts an #AcquisitionCommand that the reader thread
+ * runs between two reads, sending the protocol with a #CommandTransaction, and waits for all of the devices to have sent it.
+ * The data packet acquired when the protocol is actually sent, the middle of the write, starts the segment of the step,
+ * which is announced to the recording of the device by RotatingRecording::markSegment together with the scheduled one.
+ * The first step is applied before the acquisition starts, see #applyProtocolStep, and is recorded in
+ * RecordingHeader_t::commandValues; the scheduler applies the following ones.
+ */
+class ProtocolScheduler {
+public:
+    /*! \brief ProtocolScheduler constructor.
+     *
+     * \param sequence [in] Steps to apply; it must outlive this object.
+     * \param samplingRate [in] Sampling rate of the devices [Hz].
+     */
+    ProtocolScheduler(const ProtocolSequence &sequence, double samplingRate);
+
+    /*! \brief ProtocolScheduler destructor. Stops applying the steps.
+     */
+    ~ProtocolScheduler();
+
+    /*! \brief Adds a device. Devices must be added before #start.
+     *
+     * \param edl [in] Connected device; it must outlive this object.
+     * \param acquisition [in] Acquisition reading \a edl, whose reader thread sends the steps; it must outlive this object.
+     * \param recording [in] Recording whose segments are tagged with the steps, NULL for none; it must outlive this object.
+     */
+    void addDevice(EDL &edl, Acquisition &acquisition, RotatingRecording * recording);
+
+    /*! \brief Starts applying the steps after the first one on a dedicated thread. Returns without waiting.
+     *
+     * \param streamStart [in] Time of the first data packet of the acquisition, see DeviceManager::getStartSteadyTime.
+     * \return False if already started.
+     */
+    bool start(EDL_IN std::chrono::steady_clock::time_point streamStart);
+
+    /*! \brief Stops applying the steps; the protocol of the last step applied stays on the devices.
+     * Must be called before the acquisitions are stopped, otherwise a step posted to a stopped one is waited for until then.
+     */
+    void stop(EDL_VOID);
+
+    /*! \brief Returns the number of steps applied so far by the scheduler, i.e. not counting the first one.
+     */
+    unsigned int getAppliedStepsNum(EDL_VOID) const;
+
+    /*! \brief Returns the largest delay between the scheduled and the actual start of a step, in data packets.
+     */
+    unsigned long long getMaxDelayPackets(EDL_VOID) const;
+
+    /*! \brief Returns the first error returned while applying a step, #EdlSuccess if none.
+     * The scheduler goes on with the next steps after an error.
+     */
+    EdlErrorCode_t getError(EDL_VOID) const;
+
+private:
+    ProtocolScheduler(const ProtocolScheduler &);
+    ProtocolScheduler &operator=(const ProtocolScheduler &);
+
+    void applyStep(unsigned int stepIdx);
+    void schedulerLoop();
+
+    const ProtocolSequence &sequence;
+    double samplingRate;
+    std::vector <EDL *> edls;
+    std::vector <Acquisition *> acquisitions;
+    std::vector <RotatingRecording *> recordings;
+    std::chrono::steady_clock::time_point streamStart;
+    std::thread schedulerThread;
+    std::mutex mutex;
+    std::condition_variable condition; /*!< Signalled by #stop and by the reader threads when they have sent a step. */
+    bool stopping;
+    std::atomic <unsigned int> appliedStepsNum;
+    std::atomic <unsigned long long> maxDelayPackets;
+    std::atomic <int> error; /*!< First #EdlErrorCode_t met. */
+};
+
+#endif // PROTOCOL_SCHEDULER_H
@@ -0,0 +1,98 @@
+/*! \file read_controller.cpp
+ * \brief Defines class ReadController.
+ */
+#include "read_controller.h"
+
+#include <cmath>
+
+ReadControllerConfig_t readControllerDefaultConfig() {
+    ReadControllerConfig_t config;
+    config.targetLatency = 5.0e-3;
+    config.minLatency = 0.5e-3;
+    config.rateTau = 0.1;
+    config.minPackets = 1;
+    config.maxPackets = 65536;
+    config.minWait = 0.1e-3;
+    config.maxWait = 20.0e-3;
+    return config;
+}
+
+ReadController::ReadController(const ReadControllerConfig_t &config) :
+    config(config) {
+    reset();
+}
+
+void ReadController::reset(double expectedRate) {
+    rate = expectedRate > 0.0 ? expectedRate : 0.0;
+    latency = config.targetLatency;
+    started = false;
+    producedPackets = 0;
+    lastProducedPackets = 0;
+    readPackets = 0;
+}
+
+void ReadController::update(unsigned int availableDataPackets, bool bufferOverflow, std::chrono::steady_clock::time_point now) {
+    if (bufferOverflow) {
+        latency = latency*0.5 > config.minLatency ? latency*0.5 : config.minLatency;
+    }
+
+    producedPackets = readPackets+availableDataPackets;
+    if (!started) {
+        started = true;
+        lastTime = now;
+        lastProducedPackets = producedPackets;
+        return;
+    }
+
+    /*! Skip intervals too short to measure and those in which the buffer was purged. */
+    double interval = std::chrono::duration <double> (now-lastTime).count();
+    if (interval < config.minWait) {
+        return;
+    }
+
+    if (producedPackets >= lastProducedPackets) {
+        double instantRate = (double)(producedPackets-lastProducedPackets)/interval;
+        if (rate > 0.0) {
+            rate += (1.0-std::exp(-interval/config.rateTau))*(instantRate-rate);
+
+        } else {
+            rate = instantRate;
+        }
+    }
+    lastTime = now;
+    lastProducedPackets = producedPackets;
+}
+
+void ReadController::consumed(unsigned int readPacketsNum) {
+    readPackets += readPacketsNum;
+    latency = latency*1.01 < config.targetLatency ? latency*1.01 : config.targetLatency;
+}
+
+unsigned int ReadController::getThreshold() const {
+    double threshold = std::floor(rate*latency+0.5);
+    if (threshold < config.minPackets) {
+        return config.minPackets;
+    }
+    return threshold > config.maxPackets ? config.maxPackets : (unsigned int)threshold;
+}
+
+std::chrono::microseconds ReadController::getWait(unsigned int availableDataPackets) const {
+    /*! Without a rate estimate, check a few times per target latency. */
+    double wait = latency*0.25;
+    if (rate > 0.0) {
+        unsigned int threshold = getThreshold();
+        wait = availableDataPackets < threshold ? (double)(threshold-availableDataPackets)/rate : 0.0;
+    }
+
+    if (wait < config.minWait) {
+        wait = config.minWait;
+
+    } else if (wait > config.maxWait) {
+        wait = config.maxWait;
+    }
+    return std::chrono::microseconds((long long)(wait*1.0e6));
+}
+
+double ReadController::getRate() const {
+    return rate;
+}
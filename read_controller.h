@@ -0,0 +1,87 @@
+/*! \file read_controller.h
+ * \brief Declares class ReadController, which decides when the acquisition reader thread reads from the device.
+ */
+#ifndef READ_CONTROLLER_H
+#define READ_CONTROLLER_H
+
+#include <chrono>
+
+/*! \struct ReadControllerConfig_t
+ * \brief Parameters of a #ReadController.
+ */
+typedef struct {
+    double targetLatency; /*!< Time the data packets are left in the device buffer before being read [s]:
+                            * longer values mean fewer, larger reads. */
+    double minLatency; /*!< Lowest target latency reached after repeated buffer overflows [s]. */
+    double rateTau; /*!< Time constant of the estimate of the packet rate [s]. */
+    unsigned int minPackets; /*!< Lowest read threshold [data packets]. */
+    unsigned int maxPackets; /*!< Highest read threshold [data packets]. */
+    double minWait; /*!< Shortest wait between two status checks [s]. */
+    double maxWait; /*!< Longest wait between two status checks [s]. */
+} ReadControllerConfig_t;
+
+/*! \fn readControllerDefaultConfig
+ * \brief Returns the default parameters: 5 ms target latency, thresholds from 1 to 65536 data packets,
+ * waits from 0.1 to 20 ms.
+ */
+ReadControllerConfig_t readControllerDefaultConfig();
+
+/*! \class ReadController
+ * \brief Adapts the read threshold and the wait between status checks to the rate at which the device produces data packets,
+ * so that each read collects about ReadControllerConfig_t::targetLatency worth of data packets at any sampling rate.
+ *
+ * The packet rate is estimated from the growth of the available data packets between status checks.
+ * Until the first estimate is available, the expected rate given to #reset is used.
+ * Each buffer overflow halves the target latency, down to ReadControllerConfig_t::minLatency;
+ * it then recovers by 1% per read.
+ */
+class ReadController {
+public:
+    /*! \brief ReadController constructor.
+     *
+     * \param config [in] Parameters.
+     */
+    explicit ReadController(const ReadControllerConfig_t &config = readControllerDefaultConfig());
+
+    /*! \brief Restarts the rate estimate.
+     *
+     * \param expectedRate [in] Expected packet rate [Hz], e.g. the sampling rate; 0 if unknown.
+     */
+    void reset(double expectedRate = 0.0);
+
+    /*! \brief Updates the rate estimate with a device status.
+     *
+     * \param availableDataPackets [in] EdlDeviceStatus_t::availableDataPackets.
+     * \param bufferOverflow [in] EdlDeviceStatus_t::bufferOverflowFlag.
+     * \param now [in] Time of the status check.
+     */
+    void update(unsigned int availableDataPackets, bool bufferOverflow, std::chrono::steady_clock::time_point now);
+
+    /*! \brief Accounts for data packets removed from the device buffer by a read.
+     */
+    void consumed(unsigned int readPacketsNum);
+
+    /*! \brief Returns the number of available data packets from which a read should be performed.
+     */
+    unsigned int getThreshold() const;
+
+    /*! \brief Returns how long to wait for the threshold to be reached, given the data packets available now.
+     */
+    std::chrono::microseconds getWait(unsigned int availableDataPackets) const;
+
+    /*! \brief Returns the estimated packet rate [Hz], 0 if unknown.
+     */
+    double getRate() const;
+
+private:
+    ReadControllerConfig_t config;
+    double rate;
+    double latency; /*!< Current target latency, lowered by the buffer overflows. */
+    bool started;
+    std::chrono::steady_clock::time_point lastTime;
+    unsigned long long producedPackets; /*!< Data packets read plus available at the last status check. */
+    unsigned long long lastProducedPackets;
+    unsigned long long readPackets;
+};
+
+#endif // READ_CONTROLLER_H
@@ -0,0 +1,189 @@
+/*! \file recording_format.h
+ * \brief Defines the layout of the recording files.
+ *
+ * A recording file consists of:
+ * - a #RecordingHeader_t with the settings used for the acquisition;
+ * - a sequence of chunks, each one made of a #RecordingChunkHeader_t followed by the data packets of the chunk;
+ * - a seek index: one #RecordingIndexEntry_t per chunk;
+ * - a #RecordingFooter_t pointing to the seek index.
+ *
+ * All of the chunks but the last one hold RecordingHeader_t::chunkPackets data packets, except those followed by a gap chunk.
+ * The data packets of a chunk are stored as floats (#RecordingEncodingFloat32) or, from version 2, compressed
+ * (#RecordingEncodingPacked). A reader rejects a file of a later version than its own, and stops at a chunk of an encoding it
+ * does not know, as at a corrupted one.
+ * A gap chunk (#RecordingEncodingGap, version 2) marks data packets missing from the acquisition, lost by the device
+ * or dropped by the caller: it holds no data packets, RecordingChunkHeader_t::firstPacket is the index of the data packet
+ * following the gap and the payload is a #RecordingGap_t. Data packet i was thus acquired
+ * (i + missing data packets before it) / RecordingHeader_t::samplingRate seconds after the first one.
+ * A segment chunk (#RecordingEncodingSegment, version 3) marks the start of a step of a protocol sequence: it holds no data
+ * packets, RecordingChunkHeader_t::firstPacket is the index of the first data packet acquired with the step and the payload is
+ * a #RecordingSegment_t. The data packets before the first segment chunk were acquired with RecordingHeader_t::commandValues.
+ * Chunks are self-delimiting, so the index of a file whose footer was never written can be rebuilt by
+ * walking the chunk headers. All fields are little-endian.
+ *
+ * A recording may be accompanied by pyramid files, one per level, named after the recording (see trace_pyramid.h).
+ * The pyramid file of level L consists of a #PyramidHeader_t followed by one entry per
+ * #PYRAMID_FACTOR^L data packets; each entry is made of one #RecordingSummary_t per channel.
+ */
+#ifndef RECORDING_FORMAT_H
+#define RECORDING_FORMAT_H
+
+#include <stdint.h>
+
+#include "edl.h"
+
+/*! \def RECORDING_MAGIC
+ * \brief First 8 bytes of a recording file.
+ */
+#define RECORDING_MAGIC "EDLREC\r\n"
+
+/*! \def RECORDING_VERSION
+ * \brief Version of the recording format: 2 added the compressed and the gap chunks, 3 the segment chunks.
+ */
+#define RECORDING_VERSION 3
+
+/*! \def RECORDING_CHUNK_MAGIC
+ * \brief First 4 bytes of each chunk ("CHNK").
+ */
+#define RECORDING_CHUNK_MAGIC 0x4B4E4843
+
+/*! \def RECORDING_FOOTER_MAGIC
+ * \brief Last 4 bytes of a recording file ("EDLF").
+ */
+#define RECORDING_FOOTER_MAGIC 0x464C4445
+
+/*! \def RECORDING_CHUNK_PACKETS
+ * \brief Default number of data packets per chunk.
+ */
+#define RECORDING_CHUNK_PACKETS 65536
+
+/*! \def RECORDING_COMMAND_VALUES_NUM
+ * \brief Number of command values stored in the header; at least #EdlCommandIdNum.
+ */
+#define RECORDING_COMMAND_VALUES_NUM 32
+
+/*! \def PYRAMID_MAGIC
+ * \brief First 8 bytes of a pyramid file.
+ */
+#define PYRAMID_MAGIC "EDLPYR\r\n"
+
+/*! \def PYRAMID_VERSION
+ * \brief Version of the pyramid format.
+ */
+#define PYRAMID_VERSION 1
+
+/*! \def PYRAMID_FACTOR
+ * \brief Ratio between the data packets summarized by the entries of consecutive pyramid levels.
+ */
+#define PYRAMID_FACTOR 16
+
+/*! \enum RecordingEncoding_t
+ * \brief Enumerates the encodings of the chunk payloads.
+ */
+typedef enum {
+    RecordingEncodingFloat32 = 0, /*!< Data packets as returned by EDL::readData: #EDL_CHANNEL_NUM floats each. */
+    RecordingEncodingPacked = 1, /*!< Data packets compressed losslessly by TraceCompressor, see trace_compression.h; version 2. */
+    RecordingEncodingGap = 2, /*!< No data packets: the chunk marks missing data packets and its payload is a #RecordingGap_t. */
+    RecordingEncodingSegment = 3 /*!< No data packets: the chunk marks the start of a protocol step and its payload is a #RecordingSegment_t. */
+} RecordingEncoding_t;
+
+#pragma pack(push, 1)
+
+/*! \struct RecordingHeader_t
+ * \brief Header at the beginning of a recording file.
+ */
+typedef struct {
+    char magic[8]; /*!< #RECORDING_MAGIC. */
+    uint32_t version; /*!< #RECORDING_VERSION. */
+    uint32_t headerSize; /*!< Size of this header in bytes; the first chunk starts right after it. */
+    uint32_t channelsNum; /*!< Number of channels per data packet, #EDL_CHANNEL_NUM. */
+    uint32_t chunkPackets; /*!< Number of data packets of each chunk but the last one. */
+    uint32_t samplingRateRadioId; /*!< EDL_RADIO_SAMPLING_RATE_* value of the device, also for decimated recordings. */
+    uint32_t rangeRadioId; /*!< EDL_RADIO_RANGE_* value. */
+    uint32_t finalBandwidthRadioId; /*!< EDL_RADIO_FINAL_BANDWIDTH_* value. */
+    char currentUnit[4]; /*!< Unit of the current channels, "pA" or "nA". */
+    double samplingRate; /*!< Sampling rate of the recorded data packets [Hz]; lower than the device one in decimated recordings. */
+    double rangeFullScale; /*!< Full scale of the current channels, in \a currentUnit. */
+    double finalBandwidth; /*!< Final bandwidth [Hz]; the cut-off of the anti-aliasing filter in decimated recordings. */
+    int64_t startTime; /*!< Time of the first data packet, in ns since 1970-01-01 00:00:00 UTC. */
+    double commandValues[RECORDING_COMMAND_VALUES_NUM]; /*!< Protocol parameters applied at the start of the acquisition,
+                                                          * indexed by #EdlCommandId_t (e.g. EdlCommandMainTrial, EdlCommandVhold). */
+} RecordingHeader_t;
+
+/*! \struct RecordingSummary_t
+ * \brief Summary of the samples of one channel in a chunk.
+ */
+typedef struct {
+    float min; /*!< Minimum sample. */
+    float max; /*!< Maximum sample. */
+    float mean; /*!< Mean of the samples. */
+} RecordingSummary_t;
+
+/*! \struct RecordingChunkHeader_t
+ * \brief Header at the beginning of each chunk.
+ */
+typedef struct {
+    uint32_t magic; /*!< #RECORDING_CHUNK_MAGIC. */
+    uint32_t encoding; /*!< #RecordingEncoding_t of the payload. */
+    uint64_t firstPacket; /*!< Index of the first data packet of the chunk since the beginning of the recording. */
+    uint32_t packetsNum; /*!< Number of data packets in the chunk. */
+    uint32_t payloadSize; /*!< Size in bytes of the payload following this header. */
+    RecordingSummary_t summaries[EDL_CHANNEL_NUM]; /*!< Summary of each channel. */
+} RecordingChunkHeader_t;
+
+/*! \struct RecordingGap_t
+ * \brief Payload of a gap chunk.
+ */
+typedef struct {
+    uint64_t streamPacket; /*!< Index of the first missing data packet since the start of the acquisition. */
+    uint64_t packetsNum; /*!< Number of missing data packets; estimated when the device lost them. */
+} RecordingGap_t;
+
+/*! \struct RecordingSegment_t
+ * \brief Payload of a segment chunk.
+ */
+typedef struct {
+    uint64_t streamPacket; /*!< Index since the start of the acquisition of the first data packet acquired with the step. */
+    uint64_t scheduledPacket; /*!< Index since the start of the acquisition at which the step was scheduled to start. */
+    uint32_t stepIdx; /*!< Index of the step in the protocol sequence. */
+    uint32_t reserved; /*!< Zero. */
+    double commandValues[RECORDING_COMMAND_VALUES_NUM]; /*!< Protocol parameters of the step, indexed by #EdlCommandId_t. */
+} RecordingSegment_t;
+
+/*! \struct RecordingIndexEntry_t
+ * \brief Entry of the seek index.
+ */
+typedef struct {
+    uint64_t firstPacket; /*!< Index of the first data packet of the chunk. */
+    uint64_t offset; /*!< Offset in bytes of the chunk header from the beginning of the file. */
+} RecordingIndexEntry_t;
+
+/*! \struct RecordingFooter_t
+ * \brief Footer at the end of a recording file.
+ */
+typedef struct {
+    uint64_t indexOffset; /*!< Offset in bytes of the seek index from the beginning of the file. */
+    uint64_t chunksNum; /*!< Number of chunks including the gap chunks, i.e. of index entries. */
+    uint64_t packetsNum; /*!< Total number of data packets. */
+    uint32_t version; /*!< #RECORDING_VERSION. */
+    uint32_t magic; /*!< #RECORDING_FOOTER_MAGIC. */
+} RecordingFooter_t;
+
+/*! \struct PyramidHeader_t
+ * \brief Header at the beginning of a pyramid file.
+ */
+typedef struct {
+    char magic[8]; /*!< #PYRAMID_MAGIC. */
+    uint32_t version; /*!< #PYRAMID_VERSION. */
+    uint32_t headerSize; /*!< Size of this header in bytes; the first entry starts right after it. */
+    uint32_t channelsNum; /*!< Number of channels per entry, #EDL_CHANNEL_NUM. */
+    uint32_t level; /*!< Level of the pyramid, starting from 1. */
+    uint64_t entryPackets; /*!< Number of data packets summarized by each entry, #PYRAMID_FACTOR^level;
+                             * the last entry may summarize fewer data packets. */
+    uint64_t packetsNum; /*!< Total number of data packets summarized; 0 if the file was not closed properly,
+                           * in which case the number of entries follows from the file size. */
+} PyramidHeader_t;
+
+#pragma pack(pop)
+
+#endif // RECORDING_FORMAT_H
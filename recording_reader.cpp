@@ -0,0 +1,495 @@
+/*! \file recording_reader.cpp
+ * \brief Defines class RecordingReader.
+ */
+#include "recording_reader.h"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+#ifdef _WIN32
+#include "windows.h"
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+RecordingReader::RecordingReader() :
+    opened(false),
+    mapped(NULL),
+    mappedSize(0),
+#ifdef _WIN32
+    fileHandle(INVALID_HANDLE_VALUE),
+    mappingHandle(NULL),
+#endif
+    packetsNum(0),
+    indexRebuilt(false),
+    decompressor(NULL),
+    decodedChunkIdx(-1) {
+    std::memset(&header, 0, sizeof(header));
+}
+
+RecordingReader::~RecordingReader() {
+    close();
+    delete decompressor;
+}
+
+bool RecordingReader::open(const std::string &path, const RecordingHeader_t * rawHeader) {
+    if (isOpen() || !map(path)) {
+        return false;
+    }
+
+    chunks.clear();
+    payloadOffsets.clear();
+    gaps.clear();
+    gapPackets.clear();
+    gapStreamEnds.clear();
+    segments.clear();
+    segmentPackets.clear();
+    packetsNum = 0;
+    indexRebuilt = false;
+    decodedChunkIdx = -1;
+
+    if (mappedSize >= sizeof(RecordingHeader_t) && std::memcmp(mapped, RECORDING_MAGIC, sizeof(header.magic)) == 0) {
+        std::memcpy(&header, mapped, sizeof(header));
+        if (header.version > RECORDING_VERSION || header.headerSize < sizeof(RecordingHeader_t) ||
+                header.headerSize > mappedSize || header.channelsNum != EDL_CHANNEL_NUM) {
+            close();
+            return false;
+        }
+
+        if (!loadIndex()) {
+            rebuildIndex();
+        }
+
+    } else if (rawHeader != NULL) {
+        /*! Split the headerless file in chunks, so that it is accessed like the other recordings. */
+        header = *rawHeader;
+        header.headerSize = 0;
+        header.channelsNum = EDL_CHANNEL_NUM;
+        if (header.chunkPackets == 0) {
+            header.chunkPackets = RECORDING_CHUNK_PACKETS;
+        }
+
+        uint64_t rawPacketsNum = mappedSize/(EDL_CHANNEL_NUM*sizeof(float));
+        for (uint64_t firstPacket = 0; firstPacket < rawPacketsNum; firstPacket += header.chunkPackets) {
+            RecordingChunkHeader_t chunk;
+            std::memset(&chunk, 0, sizeof(chunk));
+            chunk.magic = RECORDING_CHUNK_MAGIC;
+            chunk.encoding = RecordingEncodingFloat32;
+            chunk.firstPacket = firstPacket;
+            chunk.packetsNum = (uint32_t)(rawPacketsNum-firstPacket < header.chunkPackets ? rawPacketsNum-firstPacket : header.chunkPackets);
+            chunk.payloadSize = chunk.packetsNum*EDL_CHANNEL_NUM*sizeof(float);
+            chunks.push_back(chunk);
+            payloadOffsets.push_back(firstPacket*EDL_CHANNEL_NUM*sizeof(float));
+        }
+        packetsNum = rawPacketsNum;
+
+    } else {
+        close();
+        return false;
+    }
+
+    return true;
+}
+
+void RecordingReader::close() {
+    unmap();
+    chunks.clear();
+    payloadOffsets.clear();
+    gaps.clear();
+    gapPackets.clear();
+    gapStreamEnds.clear();
+    segments.clear();
+    segmentPackets.clear();
+    packetsNum = 0;
+    decodedChunkIdx = -1;
+}
+
+bool RecordingReader::isOpen() const {
+    return opened;
+}
+
+const RecordingHeader_t &RecordingReader::getHeader() const {
+    return header;
+}
+
+uint64_t RecordingReader::getPacketsNum() const {
+    return packetsNum;
+}
+
+unsigned int RecordingReader::getChunksNum() const {
+    return (unsigned int)chunks.size();
+}
+
+bool RecordingReader::isIndexRebuilt() const {
+    return indexRebuilt;
+}
+
+const RecordingChunkHeader_t &RecordingReader::getChunkHeader(unsigned int chunkIdx) const {
+    return chunks[chunkIdx];
+}
+
+unsigned int RecordingReader::getGapsNum() const {
+    return (unsigned int)gaps.size();
+}
+
+const RecordingGap_t &RecordingReader::getGap(unsigned int gapIdx) const {
+    return gaps[gapIdx];
+}
+
+uint64_t RecordingReader::getGapPacket(unsigned int gapIdx) const {
+    return gapPackets[gapIdx];
+}
+
+unsigned int RecordingReader::getSegmentsNum() const {
+    return (unsigned int)segments.size();
+}
+
+const RecordingSegment_t &RecordingReader::getSegment(unsigned int segmentIdx) const {
+    return segments[segmentIdx];
+}
+
+uint64_t RecordingReader::getSegmentPacket(unsigned int segmentIdx) const {
+    return segmentPackets[segmentIdx];
+}
+
+uint64_t RecordingReader::getMissingPacketsNum() const {
+    return gaps.empty() ? 0 : gapStreamEnds.back()-gapPackets.back();
+}
+
+uint64_t RecordingReader::packetAtTime(double seconds) const {
+    double streamIdx = seconds*header.samplingRate;
+    if (packetsNum == 0 || !(streamIdx > 0.0)) {
+        return 0;
+    }
+
+    /*! Remove the data packets missing before that time; a time in a gap falls on the data packet following it. */
+    double packetIdx = streamIdx;
+    size_t gapsNum = std::upper_bound(gapStreamEnds.begin(), gapStreamEnds.end(), (uint64_t)streamIdx)-gapStreamEnds.begin();
+    if (gapsNum > 0) {
+        packetIdx -= (double)(gapStreamEnds[gapsNum-1]-gapPackets[gapsNum-1]);
+    }
+    if (gapsNum < gapPackets.size() && packetIdx > (double)gapPackets[gapsNum]) {
+        packetIdx = (double)gapPackets[gapsNum];
+    }
+    return packetIdx >= (double)(packetsNum-1) ? packetsNum-1 : (uint64_t)packetIdx;
+}
+
+double RecordingReader::packetTime(uint64_t packetIdx) const {
+    return header.samplingRate > 0.0 ? (double)(packetIdx+missingPacketsBefore(packetIdx))/header.samplingRate : 0.0;
+}
+
+bool RecordingReader::readBlock(uint64_t firstPacket, unsigned int maxPacketsNum, RecordingBlock_t &block) {
+    int chunkIdx = findChunk(firstPacket);
+    if (chunkIdx < 0 || maxPacketsNum == 0) {
+        return false;
+    }
+
+    const float * packets = chunkPackets(chunkIdx);
+    if (packets == NULL) {
+        return false;
+    }
+
+    const RecordingChunkHeader_t &chunk = chunks[chunkIdx];
+    unsigned int chunkOffset = (unsigned int)(firstPacket-chunk.firstPacket);
+    block.firstPacket = firstPacket;
+    block.packetsNum = chunk.packetsNum-chunkOffset < maxPacketsNum ? chunk.packetsNum-chunkOffset : maxPacketsNum;
+    block.packets = packets+(size_t)chunkOffset*EDL_CHANNEL_NUM;
+    return true;
+}
+
+unsigned int RecordingReader::readPackets(uint64_t firstPacket, unsigned int packetsNum, float * packets) {
+    unsigned int copiedPacketsNum = 0;
+    RecordingBlock_t block;
+    while (copiedPacketsNum < packetsNum && readBlock(firstPacket+copiedPacketsNum, packetsNum-copiedPacketsNum, block)) {
+        std::memcpy(packets+(size_t)copiedPacketsNum*EDL_CHANNEL_NUM, block.packets, (size_t)block.packetsNum*EDL_CHANNEL_NUM*sizeof(float));
+        copiedPacketsNum += block.packetsNum;
+    }
+    return copiedPacketsNum;
+}
+
+float RecordingReader::sample(uint64_t packetIdx, unsigned int channelIdx) {
+    RecordingBlock_t block;
+    if (channelIdx >= EDL_CHANNEL_NUM || !readBlock(packetIdx, 1, block)) {
+        return std::numeric_limits <float>::quiet_NaN();
+    }
+    return block.packets[channelIdx];
+}
+
+bool RecordingReader::map(const std::string &path) {
+#ifdef _WIN32
+    fileHandle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (fileHandle == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(fileHandle, &size) || (unsigned long long)size.QuadPart > (size_t)-1) {
+        unmap();
+        return false;
+    }
+    mappedSize = size.QuadPart;
+
+    /*! Empty files cannot be mapped: they are open with no data. */
+    if (mappedSize > 0) {
+        mappingHandle = CreateFileMappingA(fileHandle, NULL, PAGE_READONLY, 0, 0, NULL);
+        mapped = mappingHandle != NULL ? (const uint8_t *)MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0) : NULL;
+        if (mapped == NULL) {
+            unmap();
+            return false;
+        }
+    }
+    opened = true;
+    return true;
+#else
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+
+    struct stat fileStat;
+    if (fstat(fd, &fileStat) != 0 || (unsigned long long)fileStat.st_size > (size_t)-1) {
+        ::close(fd);
+        return false;
+    }
+    mappedSize = fileStat.st_size;
+
+    /*! Empty files cannot be mapped: they are open with no data. */
+    if (mappedSize > 0) {
+        void * address = mmap(NULL, (size_t)mappedSize, PROT_READ, MAP_SHARED, fd, 0);
+        if (address == MAP_FAILED) {
+            ::close(fd);
+            mappedSize = 0;
+            return false;
+        }
+        mapped = (const uint8_t *)address;
+    }
+    ::close(fd);
+    opened = true;
+    return true;
+#endif
+}
+
+void RecordingReader::unmap() {
+#ifdef _WIN32
+    if (mapped != NULL) {
+        UnmapViewOfFile((LPCVOID)mapped);
+    }
+    if (mappingHandle != NULL) {
+        CloseHandle(mappingHandle);
+        mappingHandle = NULL;
+    }
+    if (fileHandle != INVALID_HANDLE_VALUE) {
+        CloseHandle(fileHandle);
+        fileHandle = INVALID_HANDLE_VALUE;
+    }
+#else
+    if (mapped != NULL) {
+        munmap((void *)mapped, (size_t)mappedSize);
+    }
+#endif
+    opened = false;
+    mapped = NULL;
+    mappedSize = 0;
+}
+
+bool RecordingReader::loadIndex() {
+    if (mappedSize < (uint64_t)header.headerSize+sizeof(RecordingFooter_t)) {
+        return false;
+    }
+
+    RecordingFooter_t footer;
+    std::memcpy(&footer, mapped+mappedSize-sizeof(footer), sizeof(footer));
+    if (footer.magic != RECORDING_FOOTER_MAGIC || footer.indexOffset < header.headerSize ||
+            footer.indexOffset > mappedSize || footer.chunksNum > (mappedSize-footer.indexOffset)/sizeof(RecordingIndexEntry_t) ||
+            footer.indexOffset+footer.chunksNum*sizeof(RecordingIndexEntry_t)+sizeof(footer) != mappedSize) {
+        return false;
+    }
+
+    /*! Check every entry against the chunk it points to: any inconsistency means the index cannot be trusted. */
+    for (uint64_t chunkIdx = 0; chunkIdx < footer.chunksNum; chunkIdx++) {
+        RecordingIndexEntry_t entry;
+        std::memcpy(&entry, mapped+footer.indexOffset+chunkIdx*sizeof(entry), sizeof(entry));
+
+        RecordingChunkHeader_t chunk;
+        if (entry.offset < header.headerSize || entry.offset+sizeof(chunk) > footer.indexOffset) {
+            return false;
+        }
+        std::memcpy(&chunk, mapped+entry.offset, sizeof(chunk));
+        if (chunk.magic != RECORDING_CHUNK_MAGIC || chunk.firstPacket != packetsNum || entry.firstPacket != packetsNum ||
+                chunk.payloadSize > footer.indexOffset-entry.offset-sizeof(chunk)) {
+            return false;
+        }
+
+        if (chunk.encoding == RecordingEncodingGap) {
+            if (!addGap(chunk, entry.offset+sizeof(chunk))) {
+                return false;
+            }
+            continue;
+        }
+
+        if (chunk.encoding == RecordingEncodingSegment) {
+            if (!addSegment(chunk, entry.offset+sizeof(chunk))) {
+                return false;
+            }
+            continue;
+        }
+
+        /*! A chunk of an unknown encoding cannot be decoded, nor its data packets counted. */
+        if (chunk.encoding != RecordingEncodingFloat32 && chunk.encoding != RecordingEncodingPacked) {
+            return false;
+        }
+
+        chunks.push_back(chunk);
+        payloadOffsets.push_back(entry.offset+sizeof(chunk));
+        packetsNum += chunk.packetsNum;
+    }
+
+    if (packetsNum != footer.packetsNum) {
+        chunks.clear();
+        payloadOffsets.clear();
+        gaps.clear();
+        gapPackets.clear();
+        gapStreamEnds.clear();
+        segments.clear();
+        segmentPackets.clear();
+        packetsNum = 0;
+        return false;
+    }
+    return true;
+}
+
+void RecordingReader::rebuildIndex() {
+    chunks.clear();
+    payloadOffsets.clear();
+    gaps.clear();
+    gapPackets.clear();
+    gapStreamEnds.clear();
+    segments.clear();
+    segmentPackets.clear();
+    packetsNum = 0;
+    indexRebuilt = true;
+
+    uint64_t offset = header.headerSize;
+    RecordingChunkHeader_t chunk;
+    while (offset+sizeof(chunk) <= mappedSize) {
+        std::memcpy(&chunk, mapped+offset, sizeof(chunk));
+        if (chunk.magic != RECORDING_CHUNK_MAGIC || chunk.firstPacket != packetsNum || chunk.payloadSize > mappedSize-offset-sizeof(chunk)) {
+            break;
+        }
+
+        if (chunk.encoding == RecordingEncodingGap) {
+            if (!addGap(chunk, offset+sizeof(chunk))) {
+                break;
+            }
+
+        } else if (chunk.encoding == RecordingEncodingSegment) {
+            if (!addSegment(chunk, offset+sizeof(chunk))) {
+                break;
+            }
+
+        } else if (chunk.encoding == RecordingEncodingFloat32 || chunk.encoding == RecordingEncodingPacked) {
+            chunks.push_back(chunk);
+            payloadOffsets.push_back(offset+sizeof(chunk));
+            packetsNum += chunk.packetsNum;
+
+        } else {
+            break;
+        }
+        offset += sizeof(chunk)+chunk.payloadSize;
+    }
+}
+
+bool RecordingReader::addGap(const RecordingChunkHeader_t &chunk, uint64_t payloadOffset) {
+    if (chunk.payloadSize < sizeof(RecordingGap_t)) {
+        return false;
+    }
+
+    RecordingGap_t gap;
+    std::memcpy(&gap, mapped+payloadOffset, sizeof(gap));
+    uint64_t missingNum = getMissingPacketsNum();
+    gaps.push_back(gap);
+    gapPackets.push_back(chunk.firstPacket);
+    gapStreamEnds.push_back(chunk.firstPacket+missingNum+gap.packetsNum);
+    return true;
+}
+
+bool RecordingReader::addSegment(const RecordingChunkHeader_t &chunk, uint64_t payloadOffset) {
+    if (chunk.payloadSize < sizeof(RecordingSegment_t)) {
+        return false;
+    }
+
+    RecordingSegment_t segment;
+    std::memcpy(&segment, mapped+payloadOffset, sizeof(segment));
+    segments.push_back(segment);
+    segmentPackets.push_back(chunk.firstPacket);
+    return true;
+}
+
+uint64_t RecordingReader::missingPacketsBefore(uint64_t packetIdx) const {
+    size_t gapsNum = std::upper_bound(gapPackets.begin(), gapPackets.end(), packetIdx)-gapPackets.begin();
+    return gapsNum > 0 ? gapStreamEnds[gapsNum-1]-gapPackets[gapsNum-1] : 0;
+}
+
+int RecordingReader::findChunk(uint64_t packetIdx) const {
+    if (packetIdx >= packetsNum) {
+        return -1;
+    }
+
+    /*! Binary search of the last chunk starting at or before the data packet. */
+    unsigned int low = 0;
+    unsigned int high = (unsigned int)chunks.size();
+    while (high-low > 1) {
+        unsigned int middle = low+(high-low)/2;
+        if (chunks[middle].firstPacket <= packetIdx) {
+            low = middle;
+
+        } else {
+            high = middle;
+        }
+    }
+    return (int)low;
+}
+
+const float * RecordingReader::chunkPackets(unsigned int chunkIdx) {
+    const RecordingChunkHeader_t &chunk = chunks[chunkIdx];
+    const uint8_t * payload = mapped+payloadOffsets[chunkIdx];
+    if ((int)chunkIdx == decodedChunkIdx) {
+        return decodedPackets.data();
+    }
+
+    if (chunk.encoding == RecordingEncodingFloat32) {
+        if (chunk.payloadSize != (uint64_t)chunk.packetsNum*EDL_CHANNEL_NUM*sizeof(float)) {
+            return NULL;
+        }
+
+        /*! Chunks are accessed in place, unless they are misaligned because of a preceding compressed chunk. */
+        if ((uintptr_t)payload%sizeof(float) == 0) {
+            return (const float *)payload;
+        }
+        decodedPackets.resize((size_t)chunk.packetsNum*EDL_CHANNEL_NUM);
+        std::memcpy(decodedPackets.data(), payload, chunk.payloadSize);
+
+    } else if (chunk.encoding == RecordingEncodingPacked) {
+        if (decompressor == NULL) {
+            double resolutions[EDL_CHANNEL_NUM];
+            traceChannelResolutions(header.rangeRadioId, resolutions);
+            decompressor = new TraceCompressor(resolutions);
+        }
+
+        decodedPackets.resize((size_t)chunk.packetsNum*EDL_CHANNEL_NUM);
+        if (!decompressor->decompress(payload, chunk.payloadSize, chunk.packetsNum, decodedPackets.data())) {
+            decodedChunkIdx = -1;
+            return NULL;
+        }
+
+    } else {
+        return NULL;
+    }
+
+    decodedChunkIdx = chunkIdx;
+    return decodedPackets.data();
+}
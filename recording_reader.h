@@ -0,0 +1,250 @@
+/*! \file recording_reader.h
+ * \brief Declares class RecordingReader, which gives access to the recording files written by #RecordingWriter
+ * without loading them into memory.
+ */
+#ifndef RECORDING_READER_H
+#define RECORDING_READER_H
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+#include "edl.h"
+#include "recording_format.h"
+#include "trace_compression.h"
+
+/*! \def RECORDING_READER_BLOCK_PACKETS
+ * \brief Suggested number of data packets per block when iterating over a recording:
+ * 8192 packets are 160kB, which fit in the L2 cache of most processors.
+ */
+#define RECORDING_READER_BLOCK_PACKETS 8192
+
+/*! \class ChannelView
+ * \brief Read-only view of the samples of one channel within interleaved data packets.
+ */
+class ChannelView {
+public:
+    ChannelView() :
+        first(NULL),
+        samplesNum(0) {
+    }
+
+    ChannelView(const float * first, unsigned int samplesNum) :
+        first(first),
+        samplesNum(samplesNum) {
+    }
+
+    /*! \brief Returns the sample of the \a sampleIdx-th data packet of the view.
+     */
+    float operator[](unsigned int sampleIdx) const {
+        return first[(size_t)sampleIdx*EDL_CHANNEL_NUM];
+    }
+
+    /*! \brief Returns the number of samples in the view.
+     */
+    unsigned int size() const {
+        return samplesNum;
+    }
+
+    /*! \brief Returns the address of the first sample; consecutive samples are #EDL_CHANNEL_NUM floats apart.
+     */
+    const float * data() const {
+        return first;
+    }
+
+private:
+    const float * first;
+    unsigned int samplesNum;
+};
+
+/*! \struct RecordingBlock_t
+ * \brief Consecutive data packets of a recording, all belonging to the same chunk.
+ * The packets point into the mapped file, or into a buffer of the #RecordingReader for compressed chunks,
+ * and remain valid until the next call to RecordingReader::readBlock or RecordingReader::close.
+ */
+typedef struct {
+    uint64_t firstPacket; /*!< Index of the first data packet since the beginning of the recording. */
+    unsigned int packetsNum; /*!< Number of data packets. */
+    const float * packets; /*!< \a packetsNum data packets of #EDL_CHANNEL_NUM samples each. */
+} RecordingBlock_t;
+
+/*! \fn recordingBlockChannel
+ * \brief Returns the view of one channel of a #RecordingBlock_t.
+ */
+inline ChannelView recordingBlockChannel(const RecordingBlock_t &block, unsigned int channelIdx) {
+    return ChannelView(block.packets+channelIdx, block.packetsNum);
+}
+
+/*! \class RecordingReader
+ * \brief Reads a recording file through a read-only memory mapping of the whole file.
+ * Uncompressed chunks are accessed in place; compressed chunks are decompressed one at a time on access.
+ * Files whose footer was never written, e.g. because the acquisition was interrupted, are indexed by walking the chunks,
+ * and an incomplete last chunk is ignored.
+ * \note The whole file must fit in the address space of the process, which limits 32 bit builds to files of about 1GB.
+ */
+class RecordingReader {
+public:
+    /*! \brief RecordingReader constructor.
+     */
+    RecordingReader();
+
+    /*! \brief RecordingReader destructor. Closes the file if still open.
+     */
+    ~RecordingReader();
+
+    /*! \brief Maps a recording file.
+     *
+     * \param path [in] Path of the file.
+     * \param rawHeader [in] If not NULL, files that do not start with #RECORDING_MAGIC are read as headerless sequences of
+     * raw data packets, as written by the first versions of the caller, acquired with the settings described by \a rawHeader.
+     * \return True on success.
+     */
+    bool open(const std::string &path, const RecordingHeader_t * rawHeader = NULL);
+
+    /*! \brief Unmaps the file.
+     */
+    void close();
+
+    /*! \brief Returns true if a file is open.
+     */
+    bool isOpen() const;
+
+    /*! \brief Returns the header of the recording.
+     */
+    const RecordingHeader_t &getHeader() const;
+
+    /*! \brief Returns the number of data packets in the recording.
+     */
+    uint64_t getPacketsNum() const;
+
+    /*! \brief Returns the number of chunks in the recording.
+     */
+    unsigned int getChunksNum() const;
+
+    /*! \brief Returns true if the seek index has been rebuilt because the footer was missing or invalid.
+     */
+    bool isIndexRebuilt() const;
+
+    /*! \brief Returns the header of a chunk, with its per-channel summaries.
+     * Headerless files are split in chunks of RecordingHeader_t::chunkPackets data packets whose summaries are zeroed.
+     *
+     * \param chunkIdx [in] Index of the chunk.
+     */
+    const RecordingChunkHeader_t &getChunkHeader(unsigned int chunkIdx) const;
+
+    /*! \brief Returns the number of gaps, i.e. of places where data packets are missing from the acquisition.
+     */
+    unsigned int getGapsNum() const;
+
+    /*! \brief Returns a gap.
+     *
+     * \param gapIdx [in] Index of the gap, in order of position.
+     */
+    const RecordingGap_t &getGap(unsigned int gapIdx) const;
+
+    /*! \brief Returns the index of the data packet following a gap.
+     *
+     * \param gapIdx [in] Index of the gap, in order of position.
+     */
+    uint64_t getGapPacket(unsigned int gapIdx) const;
+
+    /*! \brief Returns the number of segments, i.e. of places where a step of a protocol sequence starts.
+     * The data packets before the first one were acquired with RecordingHeader_t::commandValues.
+     */
+    unsigned int getSegmentsNum() const;
+
+    /*! \brief Returns a segment.
+     *
+     * \param segmentIdx [in] Index of the segment, in order of position.
+     */
+    const RecordingSegment_t &getSegment(unsigned int segmentIdx) const;
+
+    /*! \brief Returns the index of the first data packet of a segment.
+     *
+     * \param segmentIdx [in] Index of the segment, in order of position.
+     */
+    uint64_t getSegmentPacket(unsigned int segmentIdx) const;
+
+    /*! \brief Returns the number of data packets missing from the recording.
+     */
+    uint64_t getMissingPacketsNum() const;
+
+    /*! \brief Returns the index of the data packet acquired at a given time, clamped to the recording.
+     * A time in a gap gives the data packet following it.
+     *
+     * \param seconds [in] Time since the first data packet [s].
+     */
+    uint64_t packetAtTime(double seconds) const;
+
+    /*! \brief Returns the time of a data packet since the first one [s], including the missing data packets before it.
+     */
+    double packetTime(uint64_t packetIdx) const;
+
+    /*! \brief Gives access to consecutive data packets without copying them.
+     * The block ends at most at the end of the chunk holding \a firstPacket, so it can be shorter than requested.
+     * To iterate over the recording, call this method with \a firstPacket increased by RecordingBlock_t::packetsNum
+     * each time, until it returns false.
+     *
+     * \param firstPacket [in] Index of the first data packet.
+     * \param maxPacketsNum [in] Maximum number of data packets, e.g. #RECORDING_READER_BLOCK_PACKETS.
+     * \param block [out] Data packets.
+     * \return False if \a firstPacket is beyond the end of the recording or the chunk is corrupted.
+     */
+    bool readBlock(EDL_IN uint64_t firstPacket, EDL_IN unsigned int maxPacketsNum, EDL_OUT RecordingBlock_t &block);
+
+    /*! \brief Copies consecutive data packets, possibly spanning several chunks.
+     *
+     * \param firstPacket [in] Index of the first data packet.
+     * \param packetsNum [in] Number of data packets.
+     * \param packets [out] Destination of the data packets.
+     * \return Number of data packets copied, lower than \a packetsNum at the end of the recording.
+     */
+    unsigned int readPackets(EDL_IN uint64_t firstPacket, EDL_IN unsigned int packetsNum, EDL_OUT float * packets);
+
+    /*! \brief Returns one sample; use #readBlock to access many samples.
+     *
+     * \param packetIdx [in] Index of the data packet.
+     * \param channelIdx [in] Channel index.
+     * \return The sample, NaN if out of the recording.
+     */
+    float sample(uint64_t packetIdx, unsigned int channelIdx);
+
+private:
+    RecordingReader(const RecordingReader &);
+    RecordingReader &operator=(const RecordingReader &);
+
+    bool map(const std::string &path);
+    void unmap();
+    bool loadIndex();
+    void rebuildIndex();
+    bool addGap(const RecordingChunkHeader_t &chunk, uint64_t payloadOffset);
+    bool addSegment(const RecordingChunkHeader_t &chunk, uint64_t payloadOffset);
+    uint64_t missingPacketsBefore(uint64_t packetIdx) const;
+    int findChunk(uint64_t packetIdx) const;
+    const float * chunkPackets(unsigned int chunkIdx);
+
+    bool opened;
+    const uint8_t * mapped; /*!< First byte of the mapped file, NULL for empty files. */
+    uint64_t mappedSize;
+#ifdef _WIN32
+    void * fileHandle;
+    void * mappingHandle;
+#endif
+
+    RecordingHeader_t header;
+    std::vector <RecordingChunkHeader_t> chunks;
+    std::vector <uint64_t> payloadOffsets; /*!< Offset of the payload of each chunk from the beginning of the file. */
+    std::vector <RecordingGap_t> gaps;
+    std::vector <uint64_t> gapPackets; /*!< Index of the data packet following each gap. */
+    std::vector <uint64_t> gapStreamEnds; /*!< Index since the start of the acquisition of the data packet following each gap. */
+    std::vector <RecordingSegment_t> segments;
+    std::vector <uint64_t> segmentPackets; /*!< Index of the first data packet of each segment. */
+    uint64_t packetsNum;
+    bool indexRebuilt;
+
+    TraceCompressor * decompressor; /*!< Allocated on the first compressed chunk. */
+    std::vector <float> decodedPackets; /*!< Data packets of the last decompressed chunk. */
+    int decodedChunkIdx; /*!< Chunk held in \a decodedPackets, -1 if none. */
+};
+
+#endif // RECORDING_READER_H
@@ -0,0 +1,193 @@
+/*! \file recording_rotation.cpp
+ * \brief Defines class RotatingRecording.
+ */
+#include "recording_rotation.h"
+
+#include <cmath>
+#include <cstdio>
+
+RotationConfig_t rotationDefaultConfig() {
+    RotationConfig_t config;
+    config.maxSeconds = ROTATION_MAX_SECONDS;
+    config.maxBytes = ROTATION_MAX_BYTES;
+    return config;
+}
+
+RotatingRecording::RotatingRecording(const RotationConfig_t &config, bool withPyramid) :
+    config(config),
+    withPyramid(withPyramid),
+    encoding(RecordingEncodingFloat32),
+    maxFilePackets(0),
+    filesNum(0),
+    closedPackets(0),
+    closedMissingPackets(0),
+    closedPayloadBytes(0),
+    failed(false),
+    segmentsPending(false),
+    segmentActive(false) {
+}
+
+RotatingRecording::~RotatingRecording() {
+    close();
+}
+
+bool RotatingRecording::open(const std::string &basePath, const RecordingHeader_t &header, RecordingEncoding_t encoding) {
+    if (isOpen()) {
+        return false;
+    }
+
+    this->basePath = basePath;
+    this->header = header;
+    this->encoding = encoding;
+    maxFilePackets = 0;
+    if (config.maxSeconds > 0.0) {
+        maxFilePackets = (unsigned long long)std::ceil(config.maxSeconds*header.samplingRate);
+        if (maxFilePackets == 0) {
+            maxFilePackets = 1;
+        }
+    }
+    filesNum = 0;
+    closedPackets = 0;
+    closedMissingPackets = 0;
+    closedPayloadBytes = 0;
+    {
+        std::lock_guard <std::mutex> lock(segmentsMutex);
+        pendingSegments.clear();
+        segmentsPending = false;
+        segmentActive = false;
+    }
+    failed = !openFile();
+    return !failed;
+}
+
+void RotatingRecording::consumePackets(const float * packets, unsigned int packetsNum) {
+    while (packetsNum > 0 && !failed) {
+        /*! Split the data packets at the duration limit of the current file. */
+        unsigned int writtenPacketsNum = packetsNum;
+        if (maxFilePackets > 0 && recording.getPacketsNum()+writtenPacketsNum > maxFilePackets) {
+            writtenPacketsNum = (unsigned int)(maxFilePackets-recording.getPacketsNum());
+        }
+
+        /*! Split them also at the start of the next protocol step. */
+        uint64_t segmentPacket = writeDueSegments();
+        if (failed) {
+            break;
+        }
+
+        if (segmentPacket-getStreamPacket() < writtenPacketsNum) {
+            writtenPacketsNum = (unsigned int)(segmentPacket-getStreamPacket());
+        }
+
+        failed = !recording.write(packets, writtenPacketsNum) || (withPyramid && !pyramid.write(packets, writtenPacketsNum));
+        packets += (size_t)writtenPacketsNum*EDL_CHANNEL_NUM;
+        packetsNum -= writtenPacketsNum;
+
+        bool full = (maxFilePackets > 0 && recording.getPacketsNum() >= maxFilePackets) ||
+                (config.maxBytes > 0 && recording.getPayloadBytes() >= config.maxBytes);
+        if (!failed && full) {
+            failed = !closeFile() || !openFile();
+        }
+    }
+}
+
+void RotatingRecording::consumeGap(uint64_t firstPacket, unsigned long long packetsNum) {
+    if (!failed) {
+        failed = !recording.writeGap(firstPacket, packetsNum);
+    }
+}
+
+void RotatingRecording::markSegment(const RecordingSegment_t &segment) {
+    std::lock_guard <std::mutex> lock(segmentsMutex);
+    pendingSegments.push_back(segment);
+    segmentsPending = true;
+}
+
+bool RotatingRecording::close() {
+    if (!isOpen()) {
+        return !failed;
+    }
+
+    failed = !closeFile() || failed;
+    return !failed;
+}
+
+bool RotatingRecording::isOpen() const {
+    return recording.isOpen();
+}
+
+std::string RotatingRecording::getPath(unsigned int fileIdx) const {
+    if (config.maxSeconds <= 0.0 && config.maxBytes == 0) {
+        return basePath+".edr";
+    }
+
+    char index[16];
+    snprintf(index, sizeof(index), "_%04u", fileIdx);
+    return basePath+index+".edr";
+}
+
+unsigned int RotatingRecording::getFilesNum() const {
+    return filesNum;
+}
+
+unsigned long long RotatingRecording::getPacketsNum() const {
+    return closedPackets+(recording.isOpen() ? recording.getPacketsNum() : 0);
+}
+
+unsigned long long RotatingRecording::getPayloadBytes() const {
+    return closedPayloadBytes+(recording.isOpen() ? recording.getPayloadBytes() : 0);
+}
+
+bool RotatingRecording::openFile() {
+    /*! The file starts at the time of its first data packet. */
+    RecordingHeader_t fileHeader = header;
+    fileHeader.startTime += (int64_t)std::llround((double)(closedPackets+closedMissingPackets)/header.samplingRate*1.0e9);
+
+    std::string path = getPath(filesNum);
+    if (!recording.open(path, fileHeader, DataWriterBuffered, encoding)) {
+        return false;
+    }
+
+    filesNum++;
+    if (withPyramid && !pyramid.open(path)) {
+        recording.close();
+        return false;
+    }
+    return !segmentActive || recording.writeSegment(activeSegment);
+}
+
+uint64_t RotatingRecording::getStreamPacket() const {
+    return closedPackets+closedMissingPackets+recording.getPacketsNum()+recording.getMissingPacketsNum();
+}
+
+uint64_t RotatingRecording::writeDueSegments() {
+    if (!segmentsPending) {
+        return UINT64_MAX;
+    }
+
+    /*! Write the segments that start at the next data packet, or that are late; the next files start with the last one. */
+    std::lock_guard <std::mutex> lock(segmentsMutex);
+    uint64_t streamPacket = getStreamPacket();
+    while (!pendingSegments.empty() && pendingSegments.front().streamPacket <= streamPacket && !failed) {
+        activeSegment = pendingSegments.front();
+        segmentActive = true;
+        pendingSegments.pop_front();
+        for (unsigned int commandIdx = 0; commandIdx < RECORDING_COMMAND_VALUES_NUM; commandIdx++) {
+            header.commandValues[commandIdx] = activeSegment.commandValues[commandIdx];
+        }
+        failed = !recording.writeSegment(activeSegment);
+    }
+    segmentsPending = !pendingSegments.empty();
+    return pendingSegments.empty() ? UINT64_MAX : pendingSegments.front().streamPacket;
+}
+
+bool RotatingRecording::closeFile() {
+    /*! Closing writes the last chunk, so count after it. */
+    bool success = recording.close();
+    closedPackets += recording.getPacketsNum();
+    closedMissingPackets += recording.getMissingPacketsNum();
+    closedPayloadBytes += recording.getPayloadBytes();
+    if (withPyramid && pyramid.isOpen()) {
+        success = pyramid.close() && success;
+    }
+    return success;
+}
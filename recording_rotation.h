@@ -0,0 +1,146 @@
+/*! \file recording_rotation.h
+ * \brief Declares class RotatingRecording, which splits a long acquisition into recording files of bounded duration and size.
+ */
+#ifndef RECORDING_ROTATION_H
+#define RECORDING_ROTATION_H
+
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <string>
+
+#include "edl.h"
+#include "acquisition.h"
+#include "recording_writer.h"
+#include "trace_pyramid.h"
+
+/*! \def ROTATION_MAX_SECONDS
+ * \brief Default duration of each recording file [s].
+ */
+#define ROTATION_MAX_SECONDS 3600.0
+
+/*! \def ROTATION_MAX_BYTES
+ * \brief Default payload size of each recording file [bytes].
+ */
+#define ROTATION_MAX_BYTES (1ULL << 30)
+
+/*! \struct RotationConfig_t
+ * \brief When a #RotatingRecording starts a new file.
+ */
+typedef struct {
+    double maxSeconds; /*!< Duration of each file [s]; 0 for no limit. */
+    unsigned long long maxBytes; /*!< Payload size of each file [bytes], checked after each write; 0 for no limit. */
+} RotationConfig_t;
+
+/*! \fn rotationDefaultConfig
+ * \brief Returns a rotation every #ROTATION_MAX_SECONDS or #ROTATION_MAX_BYTES, whichever comes first.
+ */
+RotationConfig_t rotationDefaultConfig(EDL_VOID);
+
+/*! \class RotatingRecording
+ * \brief #AcquisitionSink that writes the data packets in a sequence of recording files <base path>_<index>.edr,
+ * each with its own pyramid if requested. Each file is a complete recording whose RecordingHeader_t::startTime is the time
+ * of its first data packet, counting the data packets missing from the previous files, so the files can be read on their own while the acquisition goes on.
+ * The seek index of a recording grows with its length, so rotating also keeps the memory used over long acquisitions bounded.
+ * Without limits the single file is <base path>.edr.
+ * The steps of a protocol sequence announced by #markSegment are written as segment chunks in front of their first data packet;
+ * each new file starts with the step in progress, both in RecordingHeader_t::commandValues and as a segment chunk.
+ */
+class RotatingRecording : public AcquisitionSink {
+public:
+    /*! \brief RotatingRecording constructor.
+     *
+     * \param config [in] When to start a new file.
+     * \param withPyramid [in] True to build the pyramid of each file.
+     */
+    RotatingRecording(const RotationConfig_t &config, bool withPyramid);
+
+    /*! \brief RotatingRecording destructor. Closes the current file if still open.
+     */
+    ~RotatingRecording();
+
+    /*! \brief Opens the first file.
+     *
+     * \param basePath [in] Path of the files without the index and the extension.
+     * \param header [in] Header of the recording, see RecordingWriter::open.
+     * \param encoding [in] Encoding of the chunks.
+     * \return True on success.
+     */
+    bool open(const std::string &basePath, const RecordingHeader_t &header, RecordingEncoding_t encoding = RecordingEncodingFloat32);
+
+    /*! \brief Writes the data packets, starting new files as needed. After a failure the data packets are discarded.
+     */
+    void consumePackets(const float * packets, unsigned int packetsNum);
+
+    /*! \brief Writes a gap chunk in the current file, see RecordingWriter::writeGap. The pyramids only hold the data packets.
+     */
+    void consumeGap(uint64_t firstPacket, unsigned long long packetsNum);
+
+    /*! \brief Announces the start of a protocol step, to be written as a segment chunk before the data packet
+     * RecordingSegment_t::streamPacket, or before the next data packets if that one has already been written.
+     * May be called from any thread, in order of RecordingSegment_t::streamPacket;
+     * segments announced beyond the last data packet are discarded by #close.
+     *
+     * \param segment [in] Payload of the segment chunk.
+     */
+    void markSegment(const RecordingSegment_t &segment);
+
+    /*! \brief Closes the current file.
+     *
+     * \return True if all of the files have been written.
+     */
+    bool close(EDL_VOID);
+
+    /*! \brief Returns true if a file is open.
+     */
+    bool isOpen(EDL_VOID) const;
+
+    /*! \brief Returns the path of a file.
+     *
+     * \param fileIdx [in] Index of the file, lower than #getFilesNum.
+     */
+    std::string getPath(EDL_IN unsigned int fileIdx) const;
+
+    /*! \brief Returns the number of files opened so far.
+     */
+    unsigned int getFilesNum(EDL_VOID) const;
+
+    /*! \brief Returns the number of data packets written in all of the files.
+     */
+    unsigned long long getPacketsNum(EDL_VOID) const;
+
+    /*! \brief Returns the number of payload bytes written in all of the files.
+     */
+    unsigned long long getPayloadBytes(EDL_VOID) const;
+
+private:
+    RotatingRecording(const RotatingRecording &);
+    RotatingRecording &operator=(const RotatingRecording &);
+
+    bool openFile(EDL_VOID);
+    bool closeFile(EDL_VOID);
+    uint64_t getStreamPacket(EDL_VOID) const;
+    uint64_t writeDueSegments(EDL_VOID);
+
+    RotationConfig_t config;
+    bool withPyramid;
+    std::string basePath;
+    RecordingHeader_t header;
+    RecordingEncoding_t encoding;
+    RecordingWriter recording;
+    PyramidWriter pyramid;
+    unsigned long long maxFilePackets; /*!< Data packets of each file because of RotationConfig_t::maxSeconds, 0 for no limit. */
+    unsigned int filesNum;
+    unsigned long long closedPackets; /*!< Data packets written in the closed files. */
+    unsigned long long closedMissingPackets; /*!< Data packets marked as missing in the closed files. */
+    unsigned long long closedPayloadBytes; /*!< Payload bytes written in the closed files. */
+    bool failed;
+
+    std::mutex segmentsMutex;
+    std::deque <RecordingSegment_t> pendingSegments; /*!< Segments announced by #markSegment and not written yet. */
+    std::atomic <bool> segmentsPending; /*!< True while \a pendingSegments is not empty, to check it without locking. */
+    RecordingSegment_t activeSegment; /*!< Last segment written, repeated at the start of each new file. */
+    bool segmentActive;
+};
+
+#endif // RECORDING_ROTATION_H
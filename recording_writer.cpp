@@ -0,0 +1,249 @@
+/*! \file recording_writer.cpp
+ * \brief Defines class RecordingWriter.
+ */
+#include "recording_writer.h"
+
+#include <chrono>
+#include <cstring>
+
+#include "edl_settings.h"
+
+void recordingHeaderInit(RecordingHeader_t &header, unsigned int samplingRateRadioId,
+                         unsigned int rangeRadioId, unsigned int finalBandwidthRadioId) {
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, RECORDING_MAGIC, sizeof(header.magic));
+    header.version = RECORDING_VERSION;
+    header.headerSize = sizeof(RecordingHeader_t);
+    header.channelsNum = EDL_CHANNEL_NUM;
+    header.chunkPackets = RECORDING_CHUNK_PACKETS;
+    header.samplingRateRadioId = samplingRateRadioId;
+    header.rangeRadioId = rangeRadioId;
+    header.finalBandwidthRadioId = finalBandwidthRadioId;
+    std::strncpy(header.currentUnit, edlRangeUnit(rangeRadioId), sizeof(header.currentUnit)-1);
+    header.samplingRate = edlSamplingRateHz(samplingRateRadioId);
+    header.rangeFullScale = edlRangeFullScale(rangeRadioId);
+    header.finalBandwidth = edlFinalBandwidthHz(samplingRateRadioId, finalBandwidthRadioId);
+    header.startTime = std::chrono::duration_cast <std::chrono::nanoseconds> (std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+RecordingWriter::RecordingWriter() :
+    chunkPacketsNum(0),
+    encoding(RecordingEncodingFloat32),
+    compressor(NULL),
+    packetsNum(0),
+    missingPacketsNum(0),
+    payloadBytes(0),
+    failed(false) {
+    std::memset(&header, 0, sizeof(header));
+}
+
+RecordingWriter::~RecordingWriter() {
+    close();
+    delete compressor;
+}
+
+bool RecordingWriter::open(const std::string &path, const RecordingHeader_t &header, DataWriterMode_t mode, RecordingEncoding_t encoding) {
+    if (writer.isOpen() || header.chunkPackets == 0 || (encoding != RecordingEncodingFloat32 && encoding != RecordingEncodingPacked)) {
+        return false;
+    }
+
+    this->header = header;
+    std::memcpy(this->header.magic, RECORDING_MAGIC, sizeof(this->header.magic));
+    this->header.version = RECORDING_VERSION;
+    this->header.headerSize = sizeof(RecordingHeader_t);
+    this->header.channelsNum = EDL_CHANNEL_NUM;
+
+    if (!writer.open(path, mode)) {
+        return false;
+    }
+
+    delete compressor;
+    compressor = NULL;
+    this->encoding = encoding;
+    if (encoding == RecordingEncodingPacked) {
+        double resolutions[EDL_CHANNEL_NUM];
+        traceChannelResolutions(header.rangeRadioId, resolutions);
+        compressor = new TraceCompressor(resolutions);
+    }
+
+    chunk.resize((size_t)header.chunkPackets*EDL_CHANNEL_NUM);
+    chunkPacketsNum = 0;
+    index.clear();
+    packetsNum = 0;
+    missingPacketsNum = 0;
+    payloadBytes = 0;
+    failed = !writer.write(&this->header, sizeof(this->header));
+    return !failed;
+}
+
+bool RecordingWriter::write(const float * packets, unsigned int packetsNum) {
+    if (!writer.isOpen()) {
+        return false;
+    }
+
+    while (packetsNum > 0) {
+        unsigned int copiedPacketsNum = header.chunkPackets-chunkPacketsNum;
+        if (copiedPacketsNum > packetsNum) {
+            copiedPacketsNum = packetsNum;
+        }
+
+        std::memcpy(&chunk[(size_t)chunkPacketsNum*EDL_CHANNEL_NUM], packets, (size_t)copiedPacketsNum*EDL_CHANNEL_NUM*sizeof(float));
+        chunkPacketsNum += copiedPacketsNum;
+        this->packetsNum += copiedPacketsNum;
+        packets += (size_t)copiedPacketsNum*EDL_CHANNEL_NUM;
+        packetsNum -= copiedPacketsNum;
+
+        if (chunkPacketsNum == header.chunkPackets) {
+            writeChunk();
+        }
+    }
+
+    return !failed;
+}
+
+bool RecordingWriter::writeGap(uint64_t streamPacket, unsigned long long packetsNum) {
+    RecordingGap_t gap;
+    gap.streamPacket = streamPacket;
+    gap.packetsNum = packetsNum;
+    if (!writeMarker(RecordingEncodingGap, &gap, sizeof(gap))) {
+        return false;
+    }
+    missingPacketsNum += packetsNum;
+    return true;
+}
+
+bool RecordingWriter::writeSegment(const RecordingSegment_t &segment) {
+    return writeMarker(RecordingEncodingSegment, &segment, sizeof(segment));
+}
+
+bool RecordingWriter::writeMarker(RecordingEncoding_t markerEncoding, const void * payload, uint32_t payloadSize) {
+    if (!writer.isOpen()) {
+        return false;
+    }
+
+    /*! The marker falls between chunks, so the chunk being filled ends here. */
+    if (chunkPacketsNum > 0) {
+        writeChunk();
+    }
+
+    RecordingChunkHeader_t chunkHeader;
+    std::memset(&chunkHeader, 0, sizeof(chunkHeader));
+    chunkHeader.magic = RECORDING_CHUNK_MAGIC;
+    chunkHeader.encoding = markerEncoding;
+    chunkHeader.firstPacket = this->packetsNum;
+    chunkHeader.packetsNum = 0;
+    chunkHeader.payloadSize = payloadSize;
+
+    RecordingIndexEntry_t entry;
+    entry.firstPacket = chunkHeader.firstPacket;
+    entry.offset = writer.getWrittenBytes();
+    index.push_back(entry);
+
+    if (!writer.write(&chunkHeader, sizeof(chunkHeader)) || !writer.write(payload, payloadSize)) {
+        failed = true;
+    }
+    return !failed;
+}
+
+bool RecordingWriter::close() {
+    if (!writer.isOpen()) {
+        return true;
+    }
+
+    if (chunkPacketsNum > 0) {
+        writeChunk();
+    }
+
+    RecordingFooter_t footer;
+    footer.indexOffset = writer.getWrittenBytes();
+    footer.chunksNum = index.size();
+    footer.packetsNum = packetsNum;
+    footer.version = RECORDING_VERSION;
+    footer.magic = RECORDING_FOOTER_MAGIC;
+
+    if (!index.empty() && !writer.write(index.data(), index.size()*sizeof(RecordingIndexEntry_t))) {
+        failed = true;
+    }
+
+    if (!writer.write(&footer, sizeof(footer))) {
+        failed = true;
+    }
+
+    if (!writer.close()) {
+        failed = true;
+    }
+
+    return !failed;
+}
+
+bool RecordingWriter::isOpen() const {
+    return writer.isOpen();
+}
+
+unsigned long long RecordingWriter::getPacketsNum() const {
+    return packetsNum;
+}
+
+unsigned long long RecordingWriter::getMissingPacketsNum() const {
+    return missingPacketsNum;
+}
+
+unsigned long long RecordingWriter::getPayloadBytes() const {
+    return payloadBytes;
+}
+
+const RecordingHeader_t &RecordingWriter::getHeader() const {
+    return header;
+}
+
+bool RecordingWriter::writeChunk() {
+    RecordingChunkHeader_t chunkHeader;
+    chunkHeader.magic = RECORDING_CHUNK_MAGIC;
+    chunkHeader.encoding = encoding;
+    chunkHeader.firstPacket = packetsNum-chunkPacketsNum;
+    chunkHeader.packetsNum = chunkPacketsNum;
+
+    const void * payload = chunk.data();
+    chunkHeader.payloadSize = chunkPacketsNum*EDL_CHANNEL_NUM*sizeof(float);
+    if (compressor != NULL) {
+        compressor->compress(chunk.data(), chunkPacketsNum, compressedChunk);
+        payload = compressedChunk.data();
+        chunkHeader.payloadSize = (uint32_t)compressedChunk.size();
+    }
+
+    /*! Summarize all of the channels in a single pass over the data packets. */
+    double sums[EDL_CHANNEL_NUM];
+    for (unsigned int channelIdx = 0; channelIdx < EDL_CHANNEL_NUM; channelIdx++) {
+        chunkHeader.summaries[channelIdx].min = chunk[channelIdx];
+        chunkHeader.summaries[channelIdx].max = chunk[channelIdx];
+        sums[channelIdx] = 0.0;
+    }
+
+    const float * packet = chunk.data();
+    for (unsigned int packetIdx = 0; packetIdx < chunkPacketsNum; packetIdx++, packet += EDL_CHANNEL_NUM) {
+        for (unsigned int channelIdx = 0; channelIdx < EDL_CHANNEL_NUM; channelIdx++) {
+            float sample = packet[channelIdx];
+            RecordingSummary_t &summary = chunkHeader.summaries[channelIdx];
+            summary.min = sample < summary.min ? sample : summary.min;
+            summary.max = sample > summary.max ? sample : summary.max;
+            sums[channelIdx] += sample;
+        }
+    }
+
+    for (unsigned int channelIdx = 0; channelIdx < EDL_CHANNEL_NUM; channelIdx++) {
+        chunkHeader.summaries[channelIdx].mean = (float)(sums[channelIdx]/chunkPacketsNum);
+    }
+
+    RecordingIndexEntry_t entry;
+    entry.firstPacket = chunkHeader.firstPacket;
+    entry.offset = writer.getWrittenBytes();
+    index.push_back(entry);
+
+    if (!writer.write(&chunkHeader, sizeof(chunkHeader)) || !writer.write(payload, chunkHeader.payloadSize)) {
+        failed = true;
+    }
+    payloadBytes += chunkHeader.payloadSize;
+
+    chunkPacketsNum = 0;
+    return !failed;
+}
@@ -0,0 +1,127 @@
+/*! \file recording_writer.h
+ * \brief Declares class RecordingWriter, which stores the acquired data in the format of recording_format.h.
+ */
+#ifndef RECORDING_WRITER_H
+#define RECORDING_WRITER_H
+
+#include <string>
+#include <vector>
+
+#include "edl.h"
+#include "recording_format.h"
+#include "data_writer.h"
+#include "trace_compression.h"
+
+/*! \fn recordingHeaderInit
+ * \brief Fills a #RecordingHeader_t with the working modality set on the device and the current time.
+ * The protocol parameters are zeroed: set the relevant RecordingHeader_t::commandValues afterwards.
+ *
+ * \param header [out] Header to fill.
+ * \param samplingRateRadioId [in] EDL_RADIO_SAMPLING_RATE_* value.
+ * \param rangeRadioId [in] EDL_RADIO_RANGE_* value.
+ * \param finalBandwidthRadioId [in] EDL_RADIO_FINAL_BANDWIDTH_* value.
+ */
+void recordingHeaderInit(EDL_OUT RecordingHeader_t &header, EDL_IN unsigned int samplingRateRadioId,
+                         EDL_IN unsigned int rangeRadioId, EDL_IN unsigned int finalBandwidthRadioId);
+
+/*! \class RecordingWriter
+ * \brief Writes a recording file: the data packets are grouped in chunks with per-channel summaries,
+ * and the seek index is appended when the file is closed.
+ */
+class RecordingWriter {
+public:
+    /*! \brief RecordingWriter constructor.
+     */
+    RecordingWriter();
+
+    /*! \brief RecordingWriter destructor. Closes the file if still open.
+     */
+    ~RecordingWriter();
+
+    /*! \brief Creates or truncates a recording file and writes its header.
+     *
+     * \param path [in] Path of the file.
+     * \param header [in] Header of the recording; RecordingHeader_t::magic, RecordingHeader_t::version,
+     * RecordingHeader_t::headerSize and RecordingHeader_t::channelsNum are overwritten.
+     * \param mode [in] File access mode.
+     * \param encoding [in] Encoding of the chunks; with #RecordingEncodingPacked the chunks are compressed
+     * on the calling thread using the ADC resolutions of RecordingHeader_t::rangeRadioId.
+     * \return True on success.
+     */
+    bool open(const std::string &path, const RecordingHeader_t &header, DataWriterMode_t mode = DataWriterBuffered,
+              RecordingEncoding_t encoding = RecordingEncodingFloat32);
+
+    /*! \brief Appends data packets to the recording.
+     *
+     * \param packets [in] \a packetsNum data packets of #EDL_CHANNEL_NUM samples each.
+     * \param packetsNum [in] Number of data packets.
+     * \return False if the file is not open or could not be written.
+     */
+    bool write(const float * packets, unsigned int packetsNum);
+
+    /*! \brief Marks data packets missing between those written so far and the next ones with a gap chunk.
+     * The data packets written so far end their chunk.
+     *
+     * \param streamPacket [in] Index of the first missing data packet since the start of the acquisition.
+     * \param packetsNum [in] Number of missing data packets.
+     * \return False if the file is not open or could not be written.
+     */
+    bool writeGap(uint64_t streamPacket, unsigned long long packetsNum);
+
+    /*! \brief Marks the start of a protocol step before the next data packets with a segment chunk.
+     * The data packets written so far end their chunk.
+     *
+     * \param segment [in] Payload of the segment chunk.
+     * \return False if the file is not open or could not be written.
+     */
+    bool writeSegment(const RecordingSegment_t &segment);
+
+    /*! \brief Writes the last chunk, the seek index and the footer, and closes the file.
+     *
+     * \return True if the whole recording has been written.
+     */
+    bool close();
+
+    /*! \brief Returns true if the file is open.
+     */
+    bool isOpen() const;
+
+    /*! \brief Returns the number of data packets written since the file was opened.
+     */
+    unsigned long long getPacketsNum() const;
+
+    /*! \brief Returns the number of data packets marked as missing since the file was opened.
+     */
+    unsigned long long getMissingPacketsNum() const;
+
+    /*! \brief Returns the number of payload bytes written since the file was opened, i.e. the size of the chunks
+     * without their headers.
+     */
+    unsigned long long getPayloadBytes() const;
+
+    /*! \brief Returns the header of the recording.
+     */
+    const RecordingHeader_t &getHeader() const;
+
+private:
+    RecordingWriter(const RecordingWriter &);
+    RecordingWriter &operator=(const RecordingWriter &);
+
+    bool writeChunk();
+    bool writeMarker(RecordingEncoding_t markerEncoding, const void * payload, uint32_t payloadSize);
+
+    DataWriter writer;
+    RecordingHeader_t header;
+    std::vector <float> chunk; /*!< Data packets of the chunk being filled. */
+    unsigned int chunkPacketsNum; /*!< Data packets stored in \a chunk. */
+    RecordingEncoding_t encoding;
+    TraceCompressor * compressor; /*!< Allocated when the chunks are compressed. */
+    std::vector <uint8_t> compressedChunk;
+    std::vector <RecordingIndexEntry_t> index;
+    unsigned long long packetsNum;
+    unsigned long long missingPacketsNum;
+    unsigned long long payloadBytes;
+    bool failed;
+};
+
+#endif // RECORDING_WRITER_H
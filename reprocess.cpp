@@ -0,0 +1,150 @@
+/*! \file reprocess.cpp
+ * \brief Detects the events of recorded files again, splitting each file in chunks processed in parallel on all of the cores.
+ * Usage: reprocess [-j workers] [-k chunk seconds] [-f cut-off ratio] file.edr ...
+ * The events of data_<name>.edr are written on data_<name>_events.txt, in the format of the events files of the caller,
+ * with the times counted from the start of the file.
+ */
+#include <iostream>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "event_reprocessing.h"
+#include "recording_reader.h"
+#include "work_stealing_pool.h"
+
+/*! \struct ReprocessArgs_t
+ * \brief Options of the command line, set by #parseArguments.
+ */
+typedef struct {
+    unsigned int workersNum; /*!< Worker threads, 0 for one per core. */
+    double chunkSeconds; /*!< Duration of the chunks [s]. */
+    double cutoffRatio; /*!< Cut-off of the filter applied before the event detection relative to the sampling rate, 0 for none. */
+    std::vector <std::string> paths; /*!< Recording files. */
+} ReprocessArgs_t;
+
+/*! \fn parseArguments
+ * \brief Reads the #ReprocessArgs_t from the command line.
+ *
+ * \return False on an unknown option, an invalid value or no file.
+ */
+static bool parseArguments(int argc, char ** argv, ReprocessArgs_t &args) {
+    args.workersNum = 0;
+    args.chunkSeconds = REPROCESSING_CHUNK_SECONDS;
+    args.cutoffRatio = 0.2;
+    for (int argIdx = 1; argIdx < argc; argIdx++) {
+        if (argv[argIdx][0] != '-') {
+            args.paths.push_back(argv[argIdx]);
+            continue;
+        }
+
+        if (argIdx+1 >= argc) {
+            return false;
+        }
+
+        char * end = NULL;
+        double value = strtod(argv[argIdx+1], &end);
+        if (end == argv[argIdx+1] || *end != '\0' || value < 0.0) {
+            return false;
+        }
+
+        if (strcmp(argv[argIdx], "-j") == 0) {
+            args.workersNum = (unsigned int)value;
+
+        } else if (strcmp(argv[argIdx], "-k") == 0 && value > 0.0) {
+            args.chunkSeconds = value;
+
+        } else if (strcmp(argv[argIdx], "-f") == 0 && value < 0.5) {
+            args.cutoffRatio = value;
+
+        } else {
+            return false;
+        }
+        argIdx++;
+    }
+    return !args.paths.empty();
+}
+
+/*! \fn eventsPath
+ * \brief Returns the path of the events file of a recording: its path with _events.txt in place of the .edr extension.
+ */
+static std::string eventsPath(const std::string &path) {
+    std::string base = path;
+    if (base.size() > 4 && base.compare(base.size()-4, 4, ".edr") == 0) {
+        base.resize(base.size()-4);
+    }
+    return base+"_events.txt";
+}
+
+/*! \fn writeEvents
+ * \brief Writes the events of a recording in the format of the events files of the caller.
+ *
+ * \return False if the file cannot be written.
+ */
+static bool writeEvents(const std::string &path, const std::vector <NanoporeEvent_t> &events, double samplingRate) {
+    FILE * f = fopen(path.c_str(), "w");
+    if (f == NULL) {
+        return false;
+    }
+
+    fprintf(f, "channel\tstart [s]\tduration [ms]\tbaseline\tblockade\tstd\n");
+    for (size_t eventIdx = 0; eventIdx < events.size(); eventIdx++) {
+        const NanoporeEvent_t &event = events[eventIdx];
+        fprintf(f, "%u\t%.6f\t%.3f\t%g\t%g\t%g\n", event.channel, (double)event.startSample/samplingRate,
+                1.0e3*event.duration/samplingRate, event.baseline, event.meanBlockade, event.stdBlockade);
+    }
+    return fclose(f) == 0;
+}
+
+int main(int argc, char ** argv) {
+    ReprocessArgs_t args;
+    if (!parseArguments(argc, argv, args)) {
+        std::cout << "usage: reprocess [-j workers] [-k chunk seconds] [-f cut-off ratio] file.edr ..." << std::endl;
+        return 1;
+    }
+
+    WorkStealingPool pool(args.workersNum);
+    EventReprocessor reprocessor(pool);
+    std::cout << pool.getWorkersNum() << " workers, chunks of " << args.chunkSeconds << " s" << std::endl;
+
+    int result = 0;
+    for (size_t pathIdx = 0; pathIdx < args.paths.size(); pathIdx++) {
+        const std::string &path = args.paths[pathIdx];
+
+        /*! The configuration depends on the sampling rate of each file. */
+        RecordingReader reader;
+        if (!reader.open(path)) {
+            std::cout << "cannot read " << path << std::endl;
+            result = 1;
+            continue;
+        }
+        double samplingRate = reader.getHeader().samplingRate;
+        reader.close();
+
+        ReprocessingConfig_t config = reprocessingDefaultConfig(samplingRate);
+        config.chunkSeconds = args.chunkSeconds;
+        config.filtered = args.cutoffRatio > 0.0;
+        config.filter.cutoff = args.cutoffRatio*samplingRate;
+
+        std::vector <NanoporeEvent_t> events;
+        if (!reprocessor.run(path, config, events)) {
+            std::cout << reprocessor.getError() << std::endl;
+            result = 1;
+            continue;
+        }
+
+        std::string outputPath = eventsPath(path);
+        if (!writeEvents(outputPath, events, samplingRate)) {
+            std::cout << "failed to write " << outputPath << std::endl;
+            result = 1;
+            continue;
+        }
+
+        const ReprocessingStats_t &stats = reprocessor.getStats();
+        std::cout << path << ": " << events.size() << " events in " << outputPath << ", " << stats.chunksNum << " chunks ("
+                  << stats.stolenTasksNum << " stolen), " << stats.processedPackets << " packets processed in " << stats.seconds << " s ("
+                  << stats.processedPackets*(EDL_CHANNEL_NUM-1)/stats.seconds/1.0e6 << " Msamples/s)" << std::endl;
+    }
+    return result;
+}
@@ -0,0 +1,141 @@
+/*! \file ring_buffer.h
+ * \brief Declares class SpscRingBuffer.
+ */
+#ifndef RING_BUFFER_H
+#define RING_BUFFER_H
+
+#include <atomic>
+#include <vector>
+#include <cstring>
+#include <cstddef>
+
+/*! \def CACHE_LINE_SIZE
+ * \brief Size in bytes of a cache line.
+ * Used to keep data written by different threads on separate cache lines.
+ */
+#define CACHE_LINE_SIZE 64
+
+/*! \class SpscRingBuffer
+ * \brief Lock-free single-producer/single-consumer ring buffer of trivially copyable items.
+ * The storage is allocated once by the constructor, so #write and #read never allocate.
+ * Exactly one thread may call the producer methods (#writeAvailable, #write) and exactly one thread
+ * may call the consumer methods (#readAvailable, #read, #peek, #consume).
+ */
+template <typename T> class SpscRingBuffer {
+public:
+    /*! \brief SpscRingBuffer constructor.
+     *
+     * \param minCapacity [in] Minimum number of items the buffer can hold; rounded up to a power of 2.
+     */
+    explicit SpscRingBuffer(size_t minCapacity) :
+        writeIdx(0),
+        readIdx(0) {
+        size_t capacity = 1;
+        while (capacity < minCapacity) {
+            capacity <<= 1;
+        }
+        buffer.resize(capacity);
+        mask = capacity-1;
+    }
+
+    /*! \brief Returns the number of items the buffer can hold.
+     */
+    size_t capacity() const {
+        return mask+1;
+    }
+
+    /*! \brief Returns the number of items that can be written without overwriting unread ones.
+     * Producer side.
+     */
+    size_t writeAvailable() const {
+        return capacity()-(writeIdx.load(std::memory_order_relaxed)-readIdx.load(std::memory_order_acquire));
+    }
+
+    /*! \brief Copies up to \a itemsNum items into the buffer.
+     * Producer side.
+     *
+     * \param items [in] Items to write.
+     * \param itemsNum [in] Number of items to write.
+     * \return Number of items actually written, lower than \a itemsNum if the buffer is full.
+     */
+    size_t write(const T * items, size_t itemsNum) {
+        size_t w = writeIdx.load(std::memory_order_relaxed);
+        size_t free = capacity()-(w-readIdx.load(std::memory_order_acquire));
+        if (itemsNum > free) {
+            itemsNum = free;
+        }
+
+        size_t first = capacity()-(w & mask);
+        if (first > itemsNum) {
+            first = itemsNum;
+        }
+        std::memcpy(&buffer[w & mask], items, first*sizeof(T));
+        std::memcpy(&buffer[0], items+first, (itemsNum-first)*sizeof(T));
+
+        writeIdx.store(w+itemsNum, std::memory_order_release);
+        return itemsNum;
+    }
+
+    /*! \brief Returns the number of items available for read.
+     * Consumer side.
+     */
+    size_t readAvailable() const {
+        return writeIdx.load(std::memory_order_acquire)-readIdx.load(std::memory_order_relaxed);
+    }
+
+    /*! \brief Gives access to the oldest unread items without copying them.
+     * Consumer side. Items stay valid until #consume is called.
+     *
+     * \param items [out] Pointer to the oldest unread item.
+     * \return Number of contiguous items readable from \a items; it may be lower than #readAvailable
+     * when the unread items wrap around the end of the storage.
+     */
+    size_t peek(const T * &items) const {
+        size_t r = readIdx.load(std::memory_order_relaxed);
+        size_t available = writeIdx.load(std::memory_order_acquire)-r;
+        size_t contiguous = capacity()-(r & mask);
+        items = &buffer[r & mask];
+        return available < contiguous ? available : contiguous;
+    }
+
+    /*! \brief Releases \a itemsNum items previously obtained with #peek.
+     * Consumer side.
+     */
+    void consume(size_t itemsNum) {
+        readIdx.store(readIdx.load(std::memory_order_relaxed)+itemsNum, std::memory_order_release);
+    }
+
+    /*! \brief Copies up to \a itemsNum items out of the buffer.
+     * Consumer side.
+     *
+     * \param items [out] Destination of the read items.
+     * \param itemsNum [in] Maximum number of items to read.
+     * \return Number of items actually read.
+     */
+    size_t read(T * items, size_t itemsNum) {
+        size_t readNum = 0;
+        const T * src;
+        size_t n;
+        while (readNum < itemsNum && (n = peek(src)) > 0) {
+            if (n > itemsNum-readNum) {
+                n = itemsNum-readNum;
+            }
+            std::memcpy(items+readNum, src, n*sizeof(T));
+            consume(n);
+            readNum += n;
+        }
+        return readNum;
+    }
+
+private:
+    SpscRingBuffer(const SpscRingBuffer &);
+    SpscRingBuffer &operator=(const SpscRingBuffer &);
+
+    std::vector <T> buffer; /*!< Preallocated storage. */
+    size_t mask; /*!< Capacity minus 1, used to wrap the indexes. */
+    alignas(CACHE_LINE_SIZE) std::atomic <size_t> writeIdx; /*!< Total number of items written, owned by the producer. */
+    alignas(CACHE_LINE_SIZE) std::atomic <size_t> readIdx; /*!< Total number of items read, owned by the consumer. */
+    char padding[CACHE_LINE_SIZE-sizeof(std::atomic <size_t>)]; /*!< Keeps \a readIdx alone on its cache line. */
+};
+
+#endif // RING_BUFFER_H
@@ -0,0 +1,35 @@
+/*! \file thread_affinity.cpp
+ * \brief Defines the helpers to bind threads to processor cores.
+ */
+#include "thread_affinity.h"
+
+#include <thread>
+
+#ifdef _WIN32
+#include "windows.h"
+#elif defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+unsigned int processorCoresNum() {
+    unsigned int coresNum = std::thread::hardware_concurrency();
+    return coresNum > 0 ? coresNum : 1;
+}
+
+bool pinCurrentThread(unsigned int coreIdx) {
+    coreIdx %= processorCoresNum();
+#ifdef _WIN32
+    if (coreIdx >= sizeof(DWORD_PTR)*8) {
+        return false;
+    }
+    return SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR)1 << coreIdx) != 0;
+#elif defined(__linux__)
+    cpu_set_t cpuSet;
+    CPU_ZERO(&cpuSet);
+    CPU_SET(coreIdx, &cpuSet);
+    return pthread_setaffinity_np(pthread_self(), sizeof(cpuSet), &cpuSet) == 0;
+#else
+    return false;
+#endif
+}
@@ -0,0 +1,20 @@
+/*! \file thread_affinity.h
+ * \brief Declares helpers to bind threads to processor cores.
+ */
+#ifndef THREAD_AFFINITY_H
+#define THREAD_AFFINITY_H
+
+/*! \fn processorCoresNum
+ * \brief Returns the number of logical cores of the system, at least 1.
+ */
+unsigned int processorCoresNum();
+
+/*! \fn pinCurrentThread
+ * \brief Restricts the calling thread to run on one logical core.
+ *
+ * \param coreIdx [in] Index of the core, modulo #processorCoresNum.
+ * \return False if the system does not support thread affinity or refused it.
+ */
+bool pinCurrentThread(unsigned int coreIdx);
+
+#endif // THREAD_AFFINITY_H
@@ -0,0 +1,233 @@
+/*! \file trace_compression.cpp
+ * \brief Defines class TraceCompressor.
+ *
+ * Layout of a compressed block, channel after channel:
+ * - 1 byte: TRACE_CHANNEL_RAW or TRACE_CHANNEL_CODES;
+ * - raw: the samples of the channel as floats;
+ * - codes: the resolution (double) and the first code (int32), then for each group of up to
+ *   #TRACE_COMPRESSION_GROUP_SIZE code differences 1 byte with the bit width followed by the zigzag encoded
+ *   differences packed LSB first and padded to a whole byte.
+ */
+#include "trace_compression.h"
+
+#include <cmath>
+#include <cstring>
+
+#include "edl_settings.h"
+
+static const uint8_t TRACE_CHANNEL_RAW = 0;
+static const uint8_t TRACE_CHANNEL_CODES = 1;
+
+/*! Codes are limited to 31 bits, so that the difference of two codes always fits in an int32_t. */
+static const double TRACE_MAX_CODE = 1073741823.0;
+
+static inline uint32_t zigzagEncode(int32_t value) {
+    return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+}
+
+static inline int32_t zigzagDecode(uint32_t value) {
+    return (int32_t)(value >> 1) ^ -(int32_t)(value & 1);
+}
+
+static inline unsigned int bitWidth(uint32_t value) {
+    unsigned int width = 0;
+    while (value != 0) {
+        width++;
+        value >>= 1;
+    }
+    return width;
+}
+
+void traceChannelResolutions(unsigned int rangeRadioId, double * resolutions) {
+    resolutions[0] = EDL_VOLTAGE_LSB_MV;
+    for (unsigned int channelIdx = 1; channelIdx < EDL_CHANNEL_NUM; channelIdx++) {
+        resolutions[channelIdx] = edlRangeLsb(rangeRadioId);
+    }
+}
+
+TraceCompressor::TraceCompressor(const double * resolutions) :
+    block(0) {
+    for (unsigned int channelIdx = 0; channelIdx < EDL_CHANNEL_NUM; channelIdx++) {
+        this->resolutions[channelIdx] = resolutions[channelIdx];
+    }
+}
+
+void TraceCompressor::compress(const float * packets, unsigned int packetsNum, std::vector <uint8_t> &compressed) {
+    block.deinterleave(packets, packetsNum);
+    compressed.clear();
+
+    for (unsigned int channelIdx = 0; channelIdx < EDL_CHANNEL_NUM; channelIdx++) {
+        const float * samples = block.channel(channelIdx);
+        size_t offset = compressed.size();
+        if (packetsNum > 0 && quantize(samples, packetsNum, resolutions[channelIdx])) {
+            compressed.resize(offset+1+sizeof(double)+sizeof(int32_t));
+            compressed[offset] = TRACE_CHANNEL_CODES;
+            std::memcpy(&compressed[offset+1], &resolutions[channelIdx], sizeof(double));
+            std::memcpy(&compressed[offset+1+sizeof(double)], &codes[0], sizeof(int32_t));
+            packCodes(compressed);
+
+        } else {
+            compressed.resize(offset+1+(size_t)packetsNum*sizeof(float));
+            compressed[offset] = TRACE_CHANNEL_RAW;
+            std::memcpy(&compressed[offset+1], samples, (size_t)packetsNum*sizeof(float));
+        }
+    }
+}
+
+bool TraceCompressor::decompress(const uint8_t * compressed, size_t compressedSize, unsigned int packetsNum, float * packets) {
+    const uint8_t * data = compressed;
+    const uint8_t * end = compressed+compressedSize;
+    block.resize(packetsNum);
+
+    for (unsigned int channelIdx = 0; channelIdx < EDL_CHANNEL_NUM; channelIdx++) {
+        float * samples = block.channel(channelIdx);
+        if (data >= end) {
+            return false;
+        }
+
+        uint8_t channelEncoding = *data++;
+        if (channelEncoding == TRACE_CHANNEL_RAW) {
+            size_t size = (size_t)packetsNum*sizeof(float);
+            if ((size_t)(end-data) < size) {
+                return false;
+            }
+            std::memcpy(samples, data, size);
+            data += size;
+
+        } else if (channelEncoding == TRACE_CHANNEL_CODES) {
+            double resolution;
+            if ((size_t)(end-data) < sizeof(double)) {
+                return false;
+            }
+            std::memcpy(&resolution, data, sizeof(double));
+            data += sizeof(double);
+            if (!unpackCodes(data, end, packetsNum)) {
+                return false;
+            }
+
+            /*! Same conversion as the ADC model: the product is computed in double precision and then rounded. */
+            for (unsigned int sampleIdx = 0; sampleIdx < packetsNum; sampleIdx++) {
+                samples[sampleIdx] = (float)(codes[sampleIdx]*resolution);
+            }
+
+        } else {
+            return false;
+        }
+    }
+
+    block.interleave(packets);
+    return data == end;
+}
+
+bool TraceCompressor::quantize(const float * samples, unsigned int samplesNum, double resolution) {
+    if (!(resolution > 0.0)) {
+        return false;
+    }
+
+    codes.resize(samplesNum);
+    double inverse = 1.0/resolution;
+    for (unsigned int sampleIdx = 0; sampleIdx < samplesNum; sampleIdx++) {
+        double code = std::floor(samples[sampleIdx]*inverse+0.5);
+        if (!(std::fabs(code) <= TRACE_MAX_CODE)) {
+            return false;
+        }
+
+        /*! The compression must be lossless: the sample must be reproduced bit by bit, sign of zero included. */
+        float reconstructed = (float)(code*resolution);
+        if (std::memcmp(&reconstructed, &samples[sampleIdx], sizeof(float)) != 0) {
+            return false;
+        }
+        codes[sampleIdx] = (int32_t)code;
+    }
+    return true;
+}
+
+void TraceCompressor::packCodes(std::vector <uint8_t> &compressed) {
+    unsigned int diffsNum = (unsigned int)codes.size()-1;
+    uint32_t diffs[TRACE_COMPRESSION_GROUP_SIZE];
+
+    /*! Reserve room for the worst case, 4 bytes per difference plus the group widths, and trim at the end. */
+    size_t offset = compressed.size();
+    compressed.resize(offset+(size_t)diffsNum*sizeof(uint32_t)+diffsNum/TRACE_COMPRESSION_GROUP_SIZE+1);
+    uint8_t * out = &compressed[offset];
+
+    for (unsigned int groupStart = 0; groupStart < diffsNum; groupStart += TRACE_COMPRESSION_GROUP_SIZE) {
+        unsigned int groupSize = diffsNum-groupStart < TRACE_COMPRESSION_GROUP_SIZE ? diffsNum-groupStart : TRACE_COMPRESSION_GROUP_SIZE;
+        const int32_t * groupCodes = &codes[groupStart];
+
+        uint32_t bits = 0;
+        for (unsigned int diffIdx = 0; diffIdx < groupSize; diffIdx++) {
+            diffs[diffIdx] = zigzagEncode(groupCodes[diffIdx+1]-groupCodes[diffIdx]);
+            bits |= diffs[diffIdx];
+        }
+
+        unsigned int width = bitWidth(bits);
+        *out++ = (uint8_t)width;
+        if (width == 0) {
+            continue;
+        }
+
+        uint64_t accumulator = 0;
+        unsigned int accumulatedBits = 0;
+        for (unsigned int diffIdx = 0; diffIdx < groupSize; diffIdx++) {
+            accumulator |= (uint64_t)diffs[diffIdx] << accumulatedBits;
+            accumulatedBits += width;
+            while (accumulatedBits >= 8) {
+                *out++ = (uint8_t)accumulator;
+                accumulator >>= 8;
+                accumulatedBits -= 8;
+            }
+        }
+
+        if (accumulatedBits > 0) {
+            *out++ = (uint8_t)accumulator;
+        }
+    }
+
+    compressed.resize(out-compressed.data());
+}
+
+bool TraceCompressor::unpackCodes(const uint8_t * &data, const uint8_t * end, unsigned int samplesNum) {
+    if (samplesNum == 0 || (size_t)(end-data) < sizeof(int32_t)) {
+        return false;
+    }
+
+    codes.resize(samplesNum);
+    std::memcpy(&codes[0], data, sizeof(int32_t));
+    data += sizeof(int32_t);
+
+    unsigned int diffsNum = samplesNum-1;
+    for (unsigned int groupStart = 0; groupStart < diffsNum; groupStart += TRACE_COMPRESSION_GROUP_SIZE) {
+        unsigned int groupSize = diffsNum-groupStart < TRACE_COMPRESSION_GROUP_SIZE ? diffsNum-groupStart : TRACE_COMPRESSION_GROUP_SIZE;
+        int32_t * groupCodes = &codes[groupStart];
+        if (data >= end) {
+            return false;
+        }
+
+        unsigned int width = *data++;
+        if (width > 32 || (size_t)(end-data) < ((size_t)groupSize*width+7)/8) {
+            return false;
+        }
+
+        if (width == 0) {
+            for (unsigned int diffIdx = 0; diffIdx < groupSize; diffIdx++) {
+                groupCodes[diffIdx+1] = groupCodes[diffIdx];
+            }
+            continue;
+        }
+
+        uint64_t mask = ((uint64_t)1 << width)-1;
+        uint64_t accumulator = 0;
+        unsigned int accumulatedBits = 0;
+        for (unsigned int diffIdx = 0; diffIdx < groupSize; diffIdx++) {
+            while (accumulatedBits < width) {
+                accumulator |= (uint64_t)*data++ << accumulatedBits;
+                accumulatedBits += 8;
+            }
+            groupCodes[diffIdx+1] = (int32_t)((uint32_t)groupCodes[diffIdx]+(uint32_t)zigzagDecode((uint32_t)(accumulator & mask)));
+            accumulator >>= width;
+            accumulatedBits -= width;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,73 @@
+/*! \file trace_compression.h
+ * \brief Declares the lossless compression of blocks of data packets.
+ *
+ * Samples come from ADCs with a fixed resolution, so each channel of a block is stored as:
+ * - its ADC codes (sample / resolution), when every sample is reproduced exactly by code * resolution:
+ *   the first code, then the differences between consecutive codes, zigzag encoded and bit-packed
+ *   in groups of #TRACE_COMPRESSION_GROUP_SIZE with the bit width of the largest difference of each group;
+ * - the raw floats otherwise, so that compression is always lossless.
+ */
+#ifndef TRACE_COMPRESSION_H
+#define TRACE_COMPRESSION_H
+
+#include <vector>
+#include <stdint.h>
+
+#include "edl.h"
+#include "deinterleave.h"
+
+/*! \def TRACE_COMPRESSION_GROUP_SIZE
+ * \brief Number of code differences packed with the same bit width.
+ */
+#define TRACE_COMPRESSION_GROUP_SIZE 128
+
+/*! \fn traceChannelResolutions
+ * \brief Returns the resolution of each channel for a current range: #EDL_VOLTAGE_LSB_MV for the voltage channel,
+ * the range LSB for the current channels.
+ *
+ * \param rangeRadioId [in] EDL_RADIO_RANGE_* value.
+ * \param resolutions [out] #EDL_CHANNEL_NUM resolutions.
+ */
+void traceChannelResolutions(EDL_IN unsigned int rangeRadioId, EDL_OUT double * resolutions);
+
+/*! \class TraceCompressor
+ * \brief Compresses and decompresses blocks of data packets.
+ * Buffers are kept between calls, so a compressor reused for blocks of similar size stops allocating.
+ */
+class TraceCompressor {
+public:
+    /*! \brief TraceCompressor constructor.
+     *
+     * \param resolutions [in] #EDL_CHANNEL_NUM channel resolutions, e.g. from #traceChannelResolutions.
+     */
+    explicit TraceCompressor(EDL_IN const double * resolutions);
+
+    /*! \brief Compresses a block of data packets.
+     *
+     * \param packets [in] \a packetsNum data packets of #EDL_CHANNEL_NUM samples each.
+     * \param packetsNum [in] Number of data packets.
+     * \param compressed [out] Compressed block; replaced, not appended to.
+     */
+    void compress(EDL_IN const float * packets, EDL_IN unsigned int packetsNum, EDL_OUT std::vector <uint8_t> &compressed);
+
+    /*! \brief Decompresses a block of data packets.
+     *
+     * \param compressed [in] Compressed block.
+     * \param compressedSize [in] Size of \a compressed in bytes.
+     * \param packetsNum [in] Number of data packets in the block.
+     * \param packets [out] Destination of \a packetsNum data packets.
+     * \return False if \a compressed is not a valid compressed block of \a packetsNum data packets.
+     */
+    bool decompress(EDL_IN const uint8_t * compressed, EDL_IN size_t compressedSize, EDL_IN unsigned int packetsNum, EDL_OUT float * packets);
+
+private:
+    bool quantize(const float * samples, unsigned int samplesNum, double resolution);
+    void packCodes(std::vector <uint8_t> &compressed);
+    bool unpackCodes(const uint8_t * &data, const uint8_t * end, unsigned int samplesNum);
+
+    double resolutions[EDL_CHANNEL_NUM];
+    ChannelBlock block; /*!< Deinterleaved samples. */
+    std::vector <int32_t> codes; /*!< ADC codes of the channel being processed. */
+};
+
+#endif // TRACE_COMPRESSION_H
@@ -0,0 +1,375 @@
+/*! \file trace_pyramid.cpp
+ * \brief Defines classes PyramidWriter and PyramidReader.
+ */
+#include "trace_pyramid.h"
+
+#include <cstring>
+#include <limits>
+
+/*! \fn seekFile
+ * \brief Moves to a 64 bit offset from the beginning of a file; pyramid files of long recordings exceed 2GB.
+ */
+static bool seekFile(FILE * f, uint64_t offset) {
+#ifdef _WIN32
+    return _fseeki64(f, (__int64)offset, SEEK_SET) == 0;
+#else
+    return fseeko(f, (off_t)offset, SEEK_SET) == 0;
+#endif
+}
+
+/*! \fn fileSize
+ * \brief Returns the size of a file, leaving the position at its end.
+ */
+static uint64_t fileSize(FILE * f) {
+#ifdef _WIN32
+    _fseeki64(f, 0, SEEK_END);
+    return (uint64_t)_ftelli64(f);
+#else
+    fseeko(f, 0, SEEK_END);
+    return (uint64_t)ftello(f);
+#endif
+}
+
+static inline void accumulatorMerge(PyramidAccumulator_t &accumulator, const PyramidAccumulator_t &other, bool first) {
+    if (first) {
+        accumulator = other;
+        return;
+    }
+    accumulator.min = other.min < accumulator.min ? other.min : accumulator.min;
+    accumulator.max = other.max > accumulator.max ? other.max : accumulator.max;
+    accumulator.sum += other.sum;
+    accumulator.packetsNum += other.packetsNum;
+}
+
+static inline RecordingSummary_t accumulatorSummary(const PyramidAccumulator_t &accumulator) {
+    RecordingSummary_t summary;
+    if (accumulator.packetsNum == 0) {
+        summary.min = summary.max = summary.mean = std::numeric_limits <float>::quiet_NaN();
+
+    } else {
+        summary.min = accumulator.min;
+        summary.max = accumulator.max;
+        summary.mean = (float)(accumulator.sum/accumulator.packetsNum);
+    }
+    return summary;
+}
+
+std::string pyramidLevelPath(const std::string &recordingPath, unsigned int level) {
+    char suffix[16];
+    snprintf(suffix, sizeof(suffix), ".lvl%u", level);
+    return recordingPath+suffix;
+}
+
+PyramidWriter::PyramidWriter() :
+    levelsNum(0),
+    packetsNum(0),
+    failed(false) {
+    for (unsigned int levelIdx = 0; levelIdx < PYRAMID_MAX_LEVELS; levelIdx++) {
+        files[levelIdx] = NULL;
+        childrenNum[levelIdx] = 0;
+    }
+}
+
+PyramidWriter::~PyramidWriter() {
+    close();
+}
+
+bool PyramidWriter::open(const std::string &recordingPath, unsigned int levelsNum) {
+    if (isOpen() || levelsNum == 0 || levelsNum > PYRAMID_MAX_LEVELS) {
+        return false;
+    }
+
+    this->levelsNum = levelsNum;
+    packetsNum = 0;
+    failed = false;
+
+    PyramidHeader_t header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, PYRAMID_MAGIC, sizeof(header.magic));
+    header.version = PYRAMID_VERSION;
+    header.headerSize = sizeof(PyramidHeader_t);
+    header.channelsNum = EDL_CHANNEL_NUM;
+    header.entryPackets = 1;
+
+    for (unsigned int levelIdx = 0; levelIdx < levelsNum; levelIdx++) {
+        header.level = levelIdx+1;
+        header.entryPackets *= PYRAMID_FACTOR;
+        childrenNum[levelIdx] = 0;
+        files[levelIdx] = fopen(pyramidLevelPath(recordingPath, levelIdx+1).c_str(), "wb+");
+        if (files[levelIdx] == NULL || fwrite(&header, sizeof(header), 1, files[levelIdx]) != 1) {
+            /*! Leave no partial pyramid behind: #close would complete the headers of the levels created so far. */
+            for (unsigned int createdIdx = 0; createdIdx <= levelIdx; createdIdx++) {
+                if (files[createdIdx] != NULL) {
+                    fclose(files[createdIdx]);
+                    files[createdIdx] = NULL;
+                    std::remove(pyramidLevelPath(recordingPath, createdIdx+1).c_str());
+                }
+            }
+            this->levelsNum = 0;
+            return false;
+        }
+    }
+    return true;
+}
+
+bool PyramidWriter::write(const float * packets, unsigned int packetsNum) {
+    if (!isOpen()) {
+        return false;
+    }
+
+    PyramidAccumulator_t * accumulator = accumulators[0];
+    for (unsigned int packetIdx = 0; packetIdx < packetsNum; packetIdx++, packets += EDL_CHANNEL_NUM) {
+        if (childrenNum[0] == 0) {
+            for (unsigned int channelIdx = 0; channelIdx < EDL_CHANNEL_NUM; channelIdx++) {
+                accumulator[channelIdx].min = packets[channelIdx];
+                accumulator[channelIdx].max = packets[channelIdx];
+                accumulator[channelIdx].sum = packets[channelIdx];
+                accumulator[channelIdx].packetsNum = 1;
+            }
+
+        } else {
+            for (unsigned int channelIdx = 0; channelIdx < EDL_CHANNEL_NUM; channelIdx++) {
+                float sample = packets[channelIdx];
+                accumulator[channelIdx].min = sample < accumulator[channelIdx].min ? sample : accumulator[channelIdx].min;
+                accumulator[channelIdx].max = sample > accumulator[channelIdx].max ? sample : accumulator[channelIdx].max;
+                accumulator[channelIdx].sum += sample;
+                accumulator[channelIdx].packetsNum++;
+            }
+        }
+
+        if (++childrenNum[0] == PYRAMID_FACTOR) {
+            emitEntry(0);
+        }
+    }
+    this->packetsNum += packetsNum;
+    return !failed;
+}
+
+bool PyramidWriter::close() {
+    if (!isOpen()) {
+        return true;
+    }
+
+    /*! Write the incomplete entries from the bottom up, so that each one is merged into the level above before it is written. */
+    for (unsigned int levelIdx = 0; levelIdx < levelsNum; levelIdx++) {
+        if (childrenNum[levelIdx] > 0) {
+            emitEntry(levelIdx);
+        }
+    }
+
+    for (unsigned int levelIdx = 0; levelIdx < PYRAMID_MAX_LEVELS; levelIdx++) {
+        if (files[levelIdx] == NULL) {
+            continue;
+        }
+
+        /*! Store the number of data packets in the header, marking the file as complete. */
+        PyramidHeader_t header;
+        if (!seekFile(files[levelIdx], 0) || fread(&header, sizeof(header), 1, files[levelIdx]) != 1) {
+            failed = true;
+        }
+        header.packetsNum = packetsNum;
+        if (!seekFile(files[levelIdx], 0) || fwrite(&header, sizeof(header), 1, files[levelIdx]) != 1) {
+            failed = true;
+        }
+
+        if (fclose(files[levelIdx]) != 0) {
+            failed = true;
+        }
+        files[levelIdx] = NULL;
+    }
+    levelsNum = 0;
+    return !failed;
+}
+
+bool PyramidWriter::isOpen() const {
+    return files[0] != NULL;
+}
+
+void PyramidWriter::emitEntry(unsigned int levelIdx) {
+    RecordingSummary_t entry[EDL_CHANNEL_NUM];
+    for (unsigned int channelIdx = 0; channelIdx < EDL_CHANNEL_NUM; channelIdx++) {
+        entry[channelIdx] = accumulatorSummary(accumulators[levelIdx][channelIdx]);
+    }
+
+    if (fwrite(entry, sizeof(entry), 1, files[levelIdx]) != 1) {
+        failed = true;
+    }
+
+    unsigned int parentIdx = levelIdx+1;
+    if (parentIdx < levelsNum) {
+        for (unsigned int channelIdx = 0; channelIdx < EDL_CHANNEL_NUM; channelIdx++) {
+            accumulatorMerge(accumulators[parentIdx][channelIdx], accumulators[levelIdx][channelIdx], childrenNum[parentIdx] == 0);
+        }
+
+        if (++childrenNum[parentIdx] == PYRAMID_FACTOR) {
+            emitEntry(parentIdx);
+        }
+    }
+    childrenNum[levelIdx] = 0;
+}
+
+PyramidReader::PyramidReader() :
+    levelsNum(0) {
+    for (unsigned int levelIdx = 0; levelIdx < PYRAMID_MAX_LEVELS; levelIdx++) {
+        files[levelIdx] = NULL;
+        entriesNums[levelIdx] = 0;
+        headerSizes[levelIdx] = 0;
+    }
+}
+
+PyramidReader::~PyramidReader() {
+    close();
+}
+
+bool PyramidReader::open(const std::string &recordingPath) {
+    close();
+    if (!recording.open(recordingPath)) {
+        return false;
+    }
+
+    /*! Use the consecutive levels found, stopping at the first missing or invalid one. */
+    uint64_t entryPackets = 1;
+    for (unsigned int levelIdx = 0; levelIdx < PYRAMID_MAX_LEVELS; levelIdx++) {
+        entryPackets *= PYRAMID_FACTOR;
+        FILE * f = fopen(pyramidLevelPath(recordingPath, levelIdx+1).c_str(), "rb");
+        if (f == NULL) {
+            break;
+        }
+
+        PyramidHeader_t header;
+        if (fread(&header, sizeof(header), 1, f) != 1 || std::memcmp(header.magic, PYRAMID_MAGIC, sizeof(header.magic)) != 0 ||
+                header.version > PYRAMID_VERSION || header.headerSize < sizeof(header) || header.channelsNum != EDL_CHANNEL_NUM ||
+                header.level != levelIdx+1 || header.entryPackets != entryPackets) {
+            fclose(f);
+            break;
+        }
+
+        /*! Trust the entries in the file only as far as the recording goes. */
+        uint64_t size = fileSize(f);
+        uint64_t entriesNum = size > header.headerSize ? (size-header.headerSize)/(sizeof(RecordingSummary_t)*EDL_CHANNEL_NUM) : 0;
+        uint64_t recordingEntriesNum = (recording.getPacketsNum()+entryPackets-1)/entryPackets;
+        if (header.packetsNum > 0 && header.packetsNum != recording.getPacketsNum()) {
+            fclose(f);
+            break;
+        }
+
+        files[levelIdx] = f;
+        entriesNums[levelIdx] = entriesNum < recordingEntriesNum ? entriesNum : recordingEntriesNum;
+        headerSizes[levelIdx] = header.headerSize;
+        levelsNum = levelIdx+1;
+    }
+    return true;
+}
+
+void PyramidReader::close() {
+    for (unsigned int levelIdx = 0; levelIdx < PYRAMID_MAX_LEVELS; levelIdx++) {
+        if (files[levelIdx] != NULL) {
+            fclose(files[levelIdx]);
+            files[levelIdx] = NULL;
+        }
+        entriesNums[levelIdx] = 0;
+        headerSizes[levelIdx] = 0;
+    }
+    levelsNum = 0;
+    recording.close();
+}
+
+unsigned int PyramidReader::getLevelsNum() const {
+    return levelsNum;
+}
+
+RecordingReader &PyramidReader::getRecording() {
+    return recording;
+}
+
+bool PyramidReader::query(unsigned int channelIdx, uint64_t firstPacket, uint64_t packetsNum,
+                          unsigned int bucketsNum, std::vector <RecordingSummary_t> &buckets) {
+    uint64_t totalPacketsNum = recording.getPacketsNum();
+    if (channelIdx >= EDL_CHANNEL_NUM || bucketsNum == 0 || firstPacket >= totalPacketsNum) {
+        return false;
+    }
+
+    if (packetsNum > totalPacketsNum-firstPacket) {
+        packetsNum = totalPacketsNum-firstPacket;
+    }
+
+    /*! Select the coarsest level whose entries are not longer than the buckets. */
+    unsigned int levelsUsed = 0;
+    uint64_t entryPackets = 1;
+    while (levelsUsed < levelsNum && entryPackets*PYRAMID_FACTOR*bucketsNum <= packetsNum && entriesNums[levelsUsed] > 0) {
+        entryPackets *= PYRAMID_FACTOR;
+        levelsUsed++;
+    }
+
+    std::vector <PyramidAccumulator_t> accumulators(bucketsNum);
+    for (unsigned int bucketIdx = 0; bucketIdx < bucketsNum; bucketIdx++) {
+        accumulators[bucketIdx].packetsNum = 0;
+    }
+
+    if (levelsUsed == 0) {
+        /*! Finest zoom: summarize the data packets. */
+        uint64_t packetIdx = firstPacket;
+        uint64_t endPacket = firstPacket+packetsNum;
+        RecordingBlock_t block;
+        while (packetIdx < endPacket && recording.readBlock(packetIdx, (unsigned int)(endPacket-packetIdx < RECORDING_READER_BLOCK_PACKETS ?
+                                                                                       endPacket-packetIdx : RECORDING_READER_BLOCK_PACKETS), block)) {
+            ChannelView samples = recordingBlockChannel(block, channelIdx);
+            for (unsigned int sampleIdx = 0; sampleIdx < samples.size(); sampleIdx++, packetIdx++) {
+                PyramidAccumulator_t sample;
+                sample.min = sample.max = samples[sampleIdx];
+                sample.sum = samples[sampleIdx];
+                sample.packetsNum = 1;
+                PyramidAccumulator_t &bucket = accumulators[(packetIdx-firstPacket)*bucketsNum/packetsNum];
+                accumulatorMerge(bucket, sample, bucket.packetsNum == 0);
+            }
+        }
+
+        if (packetIdx < endPacket) {
+            return false;
+        }
+
+    } else {
+        unsigned int levelIdx = levelsUsed-1;
+        uint64_t firstEntry = firstPacket/entryPackets;
+        uint64_t endEntry = (firstPacket+packetsNum+entryPackets-1)/entryPackets;
+        if (endEntry > entriesNums[levelIdx]) {
+            endEntry = entriesNums[levelIdx];
+        }
+
+        if (!readEntries(levelIdx, firstEntry, endEntry-firstEntry)) {
+            return false;
+        }
+
+        for (uint64_t entryIdx = firstEntry; entryIdx < endEntry; entryIdx++) {
+            const RecordingSummary_t &summary = entries[(size_t)(entryIdx-firstEntry)*EDL_CHANNEL_NUM+channelIdx];
+            uint64_t entryStart = entryIdx*entryPackets;
+            uint64_t entryEnd = entryStart+entryPackets < totalPacketsNum ? entryStart+entryPackets : totalPacketsNum;
+
+            PyramidAccumulator_t entry;
+            entry.min = summary.min;
+            entry.max = summary.max;
+            entry.packetsNum = entryEnd-entryStart;
+            entry.sum = (double)summary.mean*entry.packetsNum;
+
+            uint64_t bucketIdx = entryStart > firstPacket ? (entryStart-firstPacket)*bucketsNum/packetsNum : 0;
+            PyramidAccumulator_t &bucket = accumulators[(size_t)bucketIdx];
+            accumulatorMerge(bucket, entry, bucket.packetsNum == 0);
+        }
+    }
+
+    buckets.resize(bucketsNum);
+    for (unsigned int bucketIdx = 0; bucketIdx < bucketsNum; bucketIdx++) {
+        buckets[bucketIdx] = accumulatorSummary(accumulators[bucketIdx]);
+    }
+    return true;
+}
+
+bool PyramidReader::readEntries(unsigned int levelIdx, uint64_t firstEntry, uint64_t entriesNum) {
+    const size_t entrySize = sizeof(RecordingSummary_t)*EDL_CHANNEL_NUM;
+    entries.resize((size_t)entriesNum*EDL_CHANNEL_NUM);
+    if (entriesNum == 0) {
+        return true;
+    }
+    return seekFile(files[levelIdx], headerSizes[levelIdx]+firstEntry*entrySize) &&
+            fread(entries.data(), entrySize, (size_t)entriesNum, files[levelIdx]) == entriesNum;
+}
@@ -0,0 +1,160 @@
+/*! \file trace_pyramid.h
+ * \brief Declares the classes that build and query the min/max/mean pyramids stored alongside the recordings.
+ * Level L summarizes #PYRAMID_FACTOR^L data packets per entry, so a time window can be drawn at any zoom
+ * by reading a number of entries proportional to the number of pixels.
+ */
+#ifndef TRACE_PYRAMID_H
+#define TRACE_PYRAMID_H
+
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+#include "edl.h"
+#include "recording_format.h"
+#include "recording_reader.h"
+
+/*! \def PYRAMID_LEVELS
+ * \brief Default number of pyramid levels: at 200kHz the entries of the 6th level summarize about 84 seconds.
+ */
+#define PYRAMID_LEVELS 6
+
+/*! \def PYRAMID_MAX_LEVELS
+ * \brief Maximum number of pyramid levels.
+ */
+#define PYRAMID_MAX_LEVELS 12
+
+/*! \fn pyramidLevelPath
+ * \brief Returns the path of the pyramid file of a level of a recording: the recording path followed by ".lvl" and the level.
+ */
+std::string pyramidLevelPath(const std::string &recordingPath, unsigned int level);
+
+/*! \struct PyramidAccumulator_t
+ * \brief Summary of the samples of one channel being collected for a pyramid entry.
+ */
+typedef struct {
+    float min;
+    float max;
+    double sum;
+    uint64_t packetsNum;
+} PyramidAccumulator_t;
+
+/*! \class PyramidWriter
+ * \brief Builds the pyramid of a recording incrementally, as the data packets are acquired.
+ * Level 1 is computed from the data packets, each other level from the level below, so the cost is about
+ * one comparison and one sum per sample.
+ */
+class PyramidWriter {
+public:
+    /*! \brief PyramidWriter constructor.
+     */
+    PyramidWriter();
+
+    /*! \brief PyramidWriter destructor. Closes the files if still open.
+     */
+    ~PyramidWriter();
+
+    /*! \brief Creates or truncates the pyramid files of a recording.
+     *
+     * \param recordingPath [in] Path of the recording.
+     * \param levelsNum [in] Number of levels, from 1 to #PYRAMID_MAX_LEVELS.
+     * \return True on success.
+     */
+    bool open(const std::string &recordingPath, unsigned int levelsNum = PYRAMID_LEVELS);
+
+    /*! \brief Adds data packets to the pyramid.
+     *
+     * \param packets [in] \a packetsNum data packets of #EDL_CHANNEL_NUM samples each.
+     * \param packetsNum [in] Number of data packets.
+     * \return False if the files are not open or could not be written.
+     */
+    bool write(const float * packets, unsigned int packetsNum);
+
+    /*! \brief Writes the incomplete entries, updates the headers and closes the files.
+     *
+     * \return True if the whole pyramid has been written.
+     */
+    bool close();
+
+    /*! \brief Returns true if the files are open.
+     */
+    bool isOpen() const;
+
+private:
+    PyramidWriter(const PyramidWriter &);
+    PyramidWriter &operator=(const PyramidWriter &);
+
+    void emitEntry(unsigned int levelIdx);
+
+    unsigned int levelsNum;
+    FILE * files[PYRAMID_MAX_LEVELS];
+    PyramidAccumulator_t accumulators[PYRAMID_MAX_LEVELS][EDL_CHANNEL_NUM];
+    unsigned int childrenNum[PYRAMID_MAX_LEVELS]; /*!< Data packets or entries of the level below merged in the accumulators. */
+    uint64_t packetsNum;
+    bool failed;
+};
+
+/*! \class PyramidReader
+ * \brief Renders time windows of a recording from its pyramid.
+ */
+class PyramidReader {
+public:
+    /*! \brief PyramidReader constructor.
+     */
+    PyramidReader();
+
+    /*! \brief PyramidReader destructor. Closes the files if still open.
+     */
+    ~PyramidReader();
+
+    /*! \brief Opens a recording and the pyramid files found alongside it.
+     * A recording without pyramid files can be opened too: it is then summarized from its data packets.
+     *
+     * \param recordingPath [in] Path of the recording.
+     * \return True if the recording has been opened.
+     */
+    bool open(const std::string &recordingPath);
+
+    /*! \brief Closes the recording and the pyramid files.
+     */
+    void close();
+
+    /*! \brief Returns the number of pyramid levels found.
+     */
+    unsigned int getLevelsNum() const;
+
+    /*! \brief Returns the recording, e.g. to access its header or its data packets.
+     */
+    RecordingReader &getRecording();
+
+    /*! \brief Summarizes a time window of one channel in buckets of equal duration, e.g. one per pixel.
+     * The coarsest level with at least one entry per bucket is used; at the bucket boundaries, entries are assigned
+     * to the bucket in which they start, so the boundaries are accurate to the duration of one entry.
+     * The data packets are used directly when the buckets are shorter than the entries of level 1.
+     *
+     * \param channelIdx [in] Channel index.
+     * \param firstPacket [in] Index of the first data packet of the window.
+     * \param packetsNum [in] Number of data packets of the window; clamped to the end of the recording.
+     * \param bucketsNum [in] Number of buckets.
+     * \param buckets [out] Summary of each bucket; buckets without data packets have NaN fields.
+     * \return False if the arguments are invalid or the files could not be read.
+     */
+    bool query(EDL_IN unsigned int channelIdx, EDL_IN uint64_t firstPacket, EDL_IN uint64_t packetsNum,
+               EDL_IN unsigned int bucketsNum, EDL_OUT std::vector <RecordingSummary_t> &buckets);
+
+private:
+    PyramidReader(const PyramidReader &);
+    PyramidReader &operator=(const PyramidReader &);
+
+    bool readEntries(unsigned int levelIdx, uint64_t firstEntry, uint64_t entriesNum);
+
+    RecordingReader recording;
+    unsigned int levelsNum;
+    FILE * files[PYRAMID_MAX_LEVELS];
+    uint64_t entriesNums[PYRAMID_MAX_LEVELS];
+    uint64_t headerSizes[PYRAMID_MAX_LEVELS]; /*!< Offset of the first entry of each level, from its header. */
+    std::vector <RecordingSummary_t> entries; /*!< Entries read by the last query. */
+};
+
+#endif // TRACE_PYRAMID_H
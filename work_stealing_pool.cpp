@@ -0,0 +1,130 @@
+/*! \file work_stealing_pool.cpp
+ * \brief Defines class WorkStealingPool.
+ */
+#include "work_stealing_pool.h"
+
+#include "thread_affinity.h"
+
+WorkStealingPool::WorkStealingPool(unsigned int workersNum) :
+    nextQueueIdx(0),
+    queuedTasksNum(0),
+    pendingTasksNum(0),
+    stolenTasksNum(0),
+    stopping(false) {
+    if (workersNum == 0) {
+        workersNum = processorCoresNum();
+    }
+
+    for (unsigned int workerIdx = 0; workerIdx < workersNum; workerIdx++) {
+        queues.push_back(new WorkerQueue_t);
+    }
+
+    for (unsigned int workerIdx = 0; workerIdx < workersNum; workerIdx++) {
+        workers.push_back(std::thread(&WorkStealingPool::workerLoop, this, workerIdx));
+    }
+}
+
+WorkStealingPool::~WorkStealingPool() {
+    wait();
+    {
+        std::lock_guard <std::mutex> lock(mutex);
+        stopping = true;
+    }
+    taskCondition.notify_all();
+    for (size_t workerIdx = 0; workerIdx < workers.size(); workerIdx++) {
+        workers[workerIdx].join();
+    }
+
+    for (size_t queueIdx = 0; queueIdx < queues.size(); queueIdx++) {
+        delete queues[queueIdx];
+    }
+}
+
+unsigned int WorkStealingPool::getWorkersNum() const {
+    return (unsigned int)workers.size();
+}
+
+void WorkStealingPool::submit(PoolTask * task) {
+    unsigned int workerIdx;
+    {
+        std::lock_guard <std::mutex> lock(mutex);
+        workerIdx = nextQueueIdx;
+        nextQueueIdx = (nextQueueIdx+1)%queues.size();
+    }
+    submit(task, workerIdx);
+}
+
+void WorkStealingPool::submit(PoolTask * task, unsigned int workerIdx) {
+    {
+        /*! Count the task before a worker can take it. */
+        std::lock_guard <std::mutex> lock(mutex);
+        WorkerQueue_t * queue = queues[workerIdx%queues.size()];
+        std::lock_guard <std::mutex> queueLock(queue->mutex);
+        queue->tasks.push_back(task);
+        queuedTasksNum++;
+        pendingTasksNum++;
+    }
+    taskCondition.notify_one();
+}
+
+void WorkStealingPool::wait() {
+    std::unique_lock <std::mutex> lock(mutex);
+    doneCondition.wait(lock, [this] { return pendingTasksNum == 0; });
+}
+
+unsigned long long WorkStealingPool::getStolenTasksNum() const {
+    std::lock_guard <std::mutex> lock(mutex);
+    return stolenTasksNum;
+}
+
+PoolTask * WorkStealingPool::takeTask(unsigned int workerIdx) {
+    /*! The task submitted first to the own queue, otherwise the one submitted last to the next queue that has any. */
+    PoolTask * task = NULL;
+    bool stolen = false;
+    for (unsigned int offset = 0; offset < queues.size() && task == NULL; offset++) {
+        WorkerQueue_t * queue = queues[(workerIdx+offset)%queues.size()];
+        std::lock_guard <std::mutex> queueLock(queue->mutex);
+        if (queue->tasks.empty()) {
+            continue;
+        }
+
+        if (offset == 0) {
+            task = queue->tasks.front();
+            queue->tasks.pop_front();
+
+        } else {
+            task = queue->tasks.back();
+            queue->tasks.pop_back();
+            stolen = true;
+        }
+    }
+
+    if (task != NULL) {
+        std::lock_guard <std::mutex> lock(mutex);
+        queuedTasksNum--;
+        stolenTasksNum += stolen ? 1 : 0;
+    }
+    return task;
+}
+
+void WorkStealingPool::workerLoop(unsigned int workerIdx) {
+    pinCurrentThread(workerIdx);
+    while (true) {
+        PoolTask * task = takeTask(workerIdx);
+        if (task != NULL) {
+            task->run(workerIdx);
+            std::lock_guard <std::mutex> lock(mutex);
+            pendingTasksNum--;
+            if (pendingTasksNum == 0) {
+                doneCondition.notify_all();
+            }
+            continue;
+        }
+
+        std::unique_lock <std::mutex> lock(mutex);
+        taskCondition.wait(lock, [this] { return stopping || queuedTasksNum > 0; });
+        if (stopping && queuedTasksNum == 0) {
+            return;
+        }
+    }
+}
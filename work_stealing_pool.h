@@ -0,0 +1,99 @@
+/*! \file work_stealing_pool.h
+ * \brief Declares class WorkStealingPool, which runs independent tasks on one worker thread per core.
+ */
+#ifndef WORK_STEALING_POOL_H
+#define WORK_STEALING_POOL_H
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "edl.h"
+
+/*! \class PoolTask
+ * \brief Interface of the tasks run by a #WorkStealingPool.
+ */
+class PoolTask {
+public:
+    virtual ~PoolTask() {}
+
+    /*! \brief Runs the task on a worker thread.
+     *
+     * \param workerIdx [in] Index of the worker running the task, lower than WorkStealingPool::getWorkersNum, e.g. to use
+     * resources that belong to the worker without locking them.
+     */
+    virtual void run(unsigned int workerIdx) = 0;
+};
+
+/*! \class WorkStealingPool
+ * \brief Fixed set of worker threads, each pinned to its own core, that run #PoolTask objects.
+ *
+ * Each worker has its own queue of tasks, to which #submit deals the tasks in turn unless told which worker should run them.
+ * A worker takes the tasks of its queue in the order they were submitted, and once the queue is empty it steals the task
+ * submitted last to the queue of another worker, the farthest from the ones that worker is running, so that the workers
+ * stay busy until the end even when the tasks take different times. Workers without tasks sleep.
+ */
+class WorkStealingPool {
+public:
+    /*! \brief WorkStealingPool constructor. Starts the worker threads.
+     *
+     * \param workersNum [in] Number of worker threads, 0 for one per core, see #processorCoresNum.
+     */
+    explicit WorkStealingPool(unsigned int workersNum = 0);
+
+    /*! \brief WorkStealingPool destructor. Runs the tasks still queued and stops the worker threads.
+     */
+    ~WorkStealingPool();
+
+    /*! \brief Returns the number of worker threads.
+     */
+    unsigned int getWorkersNum(EDL_VOID) const;
+
+    /*! \brief Queues a task. Returns without waiting.
+     *
+     * \param task [in] Task to run; it must stay valid until #wait returns.
+     */
+    void submit(PoolTask * task);
+
+    /*! \brief Queues a task to the queue of a worker, e.g. to give each worker a range of neighbouring tasks. Returns without waiting.
+     *
+     * \param task [in] Task to run; it must stay valid until #wait returns.
+     * \param workerIdx [in] Worker that runs the task unless another one steals it, lower than #getWorkersNum.
+     */
+    void submit(PoolTask * task, unsigned int workerIdx);
+
+    /*! \brief Waits until all of the submitted tasks have run.
+     */
+    void wait(EDL_VOID);
+
+    /*! \brief Returns the number of tasks run by a worker other than the one they were submitted to.
+     */
+    unsigned long long getStolenTasksNum(EDL_VOID) const;
+
+private:
+    WorkStealingPool(const WorkStealingPool &);
+    WorkStealingPool &operator=(const WorkStealingPool &);
+
+    typedef struct {
+        std::mutex mutex; /*!< Protects \a tasks; taken after WorkStealingPool::mutex when both are needed. */
+        std::deque <PoolTask *> tasks;
+    } WorkerQueue_t;
+
+    PoolTask * takeTask(unsigned int workerIdx);
+    void workerLoop(unsigned int workerIdx);
+
+    std::vector <WorkerQueue_t *> queues;
+    std::vector <std::thread> workers;
+    unsigned int nextQueueIdx; /*!< Queue of the next submitted task. */
+    mutable std::mutex mutex;
+    std::condition_variable taskCondition; /*!< Signaled when a task is queued or the pool stops. */
+    std::condition_variable doneCondition; /*!< Signaled when the last pending task has run. */
+    unsigned long long queuedTasksNum; /*!< Tasks in the queues. */
+    unsigned long long pendingTasksNum; /*!< Tasks submitted and not yet run. */
+    unsigned long long stolenTasksNum;
+    bool stopping;
+};
+
+#endif // WORK_STEALING_POOL_H